@@ -122,6 +122,9 @@ void BufferManager::initImmediateContext(
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
     vkCreateFence(device, &fenceInfo, nullptr, &immediate.fence);
+
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    vkCreateCommandPool(device, &poolInfo, nullptr, &async.pool);
 }
 
 void BufferManager::destroyImmediateContext()
@@ -138,6 +141,18 @@ void BufferManager::destroyImmediateContext()
     vkDestroyCommandPool(device, immediate.pool, nullptr);
     immediate.pool = VK_NULL_HANDLE;
     immediate.cmd = VK_NULL_HANDLE;
+
+    // the command buffers are freed with their pool
+    for (VkFence fence : async.fences)
+        vkDestroyFence(device, fence, nullptr);
+    async.fences.clear();
+    async.commandBuffers.clear();
+    async.freeSlots.clear();
+
+    if (async.pool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(device, async.pool, nullptr);
+        async.pool = VK_NULL_HANDLE;
+    }
 }
 
 VkCommandBuffer BufferManager::beginImmediate() {
@@ -166,6 +181,82 @@ void BufferManager::endImmediate() {
     vkWaitForFences(device, 1, &immediate.fence, VK_TRUE, UINT64_MAX);
 }
 
+void BufferManager::beginAsync(
+    AsyncSubmit& submit
+) {
+    if (async.freeSlots.empty()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = async.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate async command buffer!");
+        }
+
+        // signaled while unused, so isComplete holds for a buffer that was never submitted
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        VkFence fence;
+        if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            vkFreeCommandBuffers(device, async.pool, 1, &commandBuffer);
+            throw std::runtime_error("failed to create async fence!");
+        }
+
+        async.freeSlots.push_back(async.commandBuffers.size());
+        async.commandBuffers.push_back(commandBuffer);
+        async.fences.push_back(fence);
+    }
+
+    submit.slot = async.freeSlots.back();
+    submit.cmd = async.commandBuffers[submit.slot];
+    async.freeSlots.pop_back();
+
+    vkResetCommandBuffer(submit.cmd, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(submit.cmd, &beginInfo);
+}
+
+void BufferManager::endAsync(
+    const AsyncSubmit& submit
+) {
+    vkEndCommandBuffer(submit.cmd);
+
+    VkFence fence = async.fences[submit.slot];
+    vkResetFences(device, 1, &fence);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &submit.cmd;
+
+    vkQueueSubmit(graphicsQueue, 1, &submitInfo, fence);
+}
+
+bool BufferManager::isComplete(
+    const AsyncSubmit& submit
+) const {
+    return vkGetFenceStatus(device, async.fences[submit.slot]) == VK_SUCCESS;
+}
+
+void BufferManager::releaseAsync(
+    AsyncSubmit& submit
+) {
+    if (!submit.valid())
+        return;
+
+    async.freeSlots.push_back(submit.slot);
+    submit = AsyncSubmit();
+}
+
 void BufferManager::copyBufferToImage(
     VkBuffer buffer,
     VkImage image,
@@ -203,6 +294,25 @@ void BufferManager::copyBufferToImage(
     endImmediate();
 }
 
+void BufferManager::copyBufferToImage(
+    VkBuffer buffer,
+    VkImage image,
+    const std::vector<VkBufferImageCopy>& regions
+) {
+    VkCommandBuffer commandBuffer = beginImmediate();
+
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        buffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data()
+    );
+
+    endImmediate();
+}
+
 BufferManager::~BufferManager() {
     destroyImmediateContext();
 }
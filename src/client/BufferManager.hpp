@@ -2,6 +2,9 @@
 
 #include "CoreVulkan.hpp"
 
+#include <cstdint>
+#include <vector>
+
 /**
  * @brief Utility class for Vulkan buffer creation and immediate GPU transfers.
  *
@@ -36,6 +39,16 @@ private:
 
     ImmediateSubmitContext immediate;
 
+    // command buffers of beginAsync, each with its own fence
+    struct AsyncContext {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkFence> fences;
+        std::vector<size_t> freeSlots;
+    };
+
+    AsyncContext async;
+
     /**
      * @brief Initializes the immediate submission context.
      *
@@ -173,6 +186,49 @@ public:    /**
      */
     void endImmediate();
 
+    /**
+     * @brief Command buffer submitted without waiting, tracked by its fence.
+     */
+    struct AsyncSubmit {
+        size_t slot = SIZE_MAX;
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+
+        bool valid() const { return cmd != VK_NULL_HANDLE; }
+    };
+
+    /**
+     * @brief Begins recording a command buffer that endAsync submits without blocking.
+     *
+     * Meant for transfers the render thread must not wait on, such as
+     * mip streaming. Render thread only.
+     *
+     * @param submit Receives the command buffer to record into.
+     */
+    void beginAsync(
+        AsyncSubmit& submit
+    );
+
+    /**
+     * @brief Ends recording and submits to the graphics queue, without waiting.
+     */
+    void endAsync(
+        const AsyncSubmit& submit
+    );
+
+    /**
+     * @brief True once the GPU finished the submission, or if it was never submitted.
+     */
+    bool isComplete(
+        const AsyncSubmit& submit
+    ) const;
+
+    /**
+     * @brief Returns the command buffer for reuse. The submission must be complete.
+     */
+    void releaseAsync(
+        AsyncSubmit& submit
+    );
+
     /**
      * @brief Copies data from one buffer to another.
      *
@@ -208,6 +264,22 @@ public:    /**
         uint32_t height
     );
 
+    /**
+     * @brief Copies several buffer regions into an image in one submission.
+     *
+     * Used to upload a whole mip chain at once. Same layout requirements
+     * as the single-region overload.
+     *
+     * @param buffer Source buffer containing the packed levels.
+     * @param image Destination image.
+     * @param regions One copy region per mip level.
+     */
+    void copyBufferToImage(
+        VkBuffer buffer,
+        VkImage image,
+        const std::vector<VkBufferImageCopy>& regions
+    );
+
     /**
      * @brief Destroys the BufferManager and releases internal resources.
      */
@@ -1,4 +1,5 @@
 #include "CoreVulkan.hpp"
+#include <algorithm>
 #include <set>
 
 CoreVulkan::CoreVulkan(
@@ -21,7 +22,8 @@ CoreVulkan::CoreVulkan(
 
     // device extensions
     pickPhysicalDevice(physicalDeviceSelectors);
-    msaaSamples = findMaxLimitedUsableSampleCount(VK_SAMPLE_COUNT_8_BIT, physicalDevice);
+    maxMsaaSamples = findMaxLimitedUsableSampleCount(VK_SAMPLE_COUNT_8_BIT, physicalDevice);
+    msaaSamples = maxMsaaSamples;
     atomSize = takeAtomSize(physicalDevice);
     #ifndef NDEBUG
         std::cout << "Sample Count: " << msaaSamples << std::endl;
@@ -73,10 +75,13 @@ CoreVulkan::CoreVulkan(CoreVulkan&& other) noexcept
     physicalDevice = other.physicalDevice;
     swapchainSupportDetails = std::move(other.swapchainSupportDetails);
     msaaSamples = other.msaaSamples;
+    maxMsaaSamples = other.maxMsaaSamples;
     device = other.device;
     presentQueue = other.presentQueue;
     graphicsQueue = other.graphicsQueue;
     depthFormat = other.depthFormat;
+    enabledFeatures12 = other.enabledFeatures12;
+    apiVersion = other.apiVersion;
 
     // deixa o objeto movido em estado seguro
     other.instance = VK_NULL_HANDLE;
@@ -86,6 +91,7 @@ CoreVulkan::CoreVulkan(CoreVulkan&& other) noexcept
     other.presentQueue = VK_NULL_HANDLE;
     other.graphicsQueue = VK_NULL_HANDLE;
     other.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    other.maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
     other.depthFormat = VK_FORMAT_UNDEFINED;
     other.graphicsQueueFamilyIndices = {};
     other.swapchainSupportDetails = {};
@@ -104,7 +110,10 @@ CoreVulkan& CoreVulkan::operator=(CoreVulkan&& other) noexcept
         presentQueue = other.presentQueue;
         graphicsQueue = other.graphicsQueue;
         msaaSamples = other.msaaSamples;
+        maxMsaaSamples = other.maxMsaaSamples;
         depthFormat = other.depthFormat;
+        enabledFeatures12 = other.enabledFeatures12;
+        apiVersion = other.apiVersion;
         graphicsQueueFamilyIndices = std::move(other.graphicsQueueFamilyIndices);
         swapchainSupportDetails = std::move(other.swapchainSupportDetails);
 
@@ -115,6 +124,7 @@ CoreVulkan& CoreVulkan::operator=(CoreVulkan&& other) noexcept
         other.presentQueue = VK_NULL_HANDLE;
         other.graphicsQueue = VK_NULL_HANDLE;
         other.msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+        other.maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
         other.depthFormat = VK_FORMAT_UNDEFINED;
         other.graphicsQueueFamilyIndices =  {};
         other.swapchainSupportDetails = {};
@@ -184,6 +194,7 @@ void CoreVulkan::createInstance(
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
     appInfo.apiVersion = config.apiVersion;
+    apiVersion = config.apiVersion;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -382,10 +393,11 @@ VkSampleCountFlagBits CoreVulkan::findMaxLimitedUsableSampleCount(
     VkPhysicalDeviceProperties props{};
     vkGetPhysicalDeviceProperties(physicalDevice, &props);
 
+    // every count up to the desired one
     VkSampleCountFlags supported =
         props.limits.framebufferColorSampleCounts &
         props.limits.framebufferDepthSampleCounts &
-        maxDesiredSamples;
+        ((static_cast<VkSampleCountFlags>(maxDesiredSamples) << 1) - 1);
 
     if (supported == 0) {
         return VK_SAMPLE_COUNT_1_BIT;
@@ -396,6 +408,12 @@ VkSampleCountFlagBits CoreVulkan::findMaxLimitedUsableSampleCount(
     );
 }
 
+void CoreVulkan::setMsaaSamples(
+    VkSampleCountFlagBits requestedSamples
+) {
+    msaaSamples = findMaxLimitedUsableSampleCount(std::min(requestedSamples, maxMsaaSamples), physicalDevice);
+}
+
 VkDeviceSize CoreVulkan::takeAtomSize(
     VkPhysicalDevice physicalDevice
 ) {
@@ -494,6 +512,15 @@ void CoreVulkan::createLogicalDevice(
     config.requiredFeatures.samplerAnisotropy = VK_TRUE;
     config.optionalFeatures.sampleRateShading = VK_TRUE;
     config.optionalFeatures.wideLines = VK_TRUE;
+    config.optionalFeatures.textureCompressionBC = VK_TRUE;
+
+    // descriptor indexing, used by bindless materials
+    config.optionalFeatures12.descriptorIndexing = VK_TRUE;
+    config.optionalFeatures12.runtimeDescriptorArray = VK_TRUE;
+    config.optionalFeatures12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    config.optionalFeatures12.descriptorBindingPartiallyBound = VK_TRUE;
+    config.optionalFeatures12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    config.optionalFeatures12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
 
     // mods
     for (auto* p : providers) {
@@ -515,6 +542,15 @@ void CoreVulkan::createLogicalDevice(
         out = required || supportedFeature;
     };
 
+    // never fails, callers check support before relying on the feature
+    auto enableOptional = [&](
+        VkBool32 requested,
+        VkBool32 supportedFeature,
+        VkBool32& out
+    ) {
+        out = requested && supportedFeature;
+    };
+
     enableIfSupported(
         config.requiredFeatures.samplerAnisotropy,
         supported.samplerAnisotropy,
@@ -530,6 +566,61 @@ void CoreVulkan::createLogicalDevice(
         supported.wideLines,
         enabled.wideLines
     );
+    enableOptional(
+        config.optionalFeatures.textureCompressionBC,
+        supported.textureCompressionBC,
+        enabled.textureCompressionBC
+    );
+
+    // Vulkan 1.2 features, only chained when the device exposes 1.2
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    bool chainFeatures12 = properties.apiVersion >= VK_API_VERSION_1_2;
+    apiVersion = std::min(apiVersion, properties.apiVersion);
+
+    enabledFeatures12 = VkPhysicalDeviceVulkan12Features{};
+    enabledFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    if (chainFeatures12) {
+        VkPhysicalDeviceVulkan12Features supported12{};
+        supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 supported2{};
+        supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported2.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported2);
+
+        enableOptional(
+            config.optionalFeatures12.descriptorIndexing,
+            supported12.descriptorIndexing,
+            enabledFeatures12.descriptorIndexing
+        );
+        enableOptional(
+            config.optionalFeatures12.runtimeDescriptorArray,
+            supported12.runtimeDescriptorArray,
+            enabledFeatures12.runtimeDescriptorArray
+        );
+        enableOptional(
+            config.optionalFeatures12.shaderSampledImageArrayNonUniformIndexing,
+            supported12.shaderSampledImageArrayNonUniformIndexing,
+            enabledFeatures12.shaderSampledImageArrayNonUniformIndexing
+        );
+        enableOptional(
+            config.optionalFeatures12.descriptorBindingPartiallyBound,
+            supported12.descriptorBindingPartiallyBound,
+            enabledFeatures12.descriptorBindingPartiallyBound
+        );
+        enableOptional(
+            config.optionalFeatures12.descriptorBindingSampledImageUpdateAfterBind,
+            supported12.descriptorBindingSampledImageUpdateAfterBind,
+            enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind
+        );
+        enableOptional(
+            config.optionalFeatures12.descriptorBindingUpdateUnusedWhilePending,
+            supported12.descriptorBindingUpdateUnusedWhilePending,
+            enabledFeatures12.descriptorBindingUpdateUnusedWhilePending
+        );
+    }
 
     // create info
     VkDeviceCreateInfo createInfo{};
@@ -537,6 +628,7 @@ void CoreVulkan::createLogicalDevice(
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &enabled;
+    createInfo.pNext = chainFeatures12 ? &enabledFeatures12 : nullptr;
 
     createInfo.enabledExtensionCount = static_cast<uint32_t>(config.extensions.size());
     createInfo.ppEnabledExtensionNames = config.extensions.data();
@@ -627,6 +719,21 @@ bool CoreVulkan::hasStencilComponent(VkFormat format) {
     return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
+bool CoreVulkan::isFormatSupported(
+    VkPhysicalDevice physicalDevice,
+    VkFormat format,
+    VkImageTiling tiling,
+    VkFormatFeatureFlags features
+) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+
+    if (tiling == VK_IMAGE_TILING_LINEAR)
+        return (props.linearTilingFeatures & features) == features;
+
+    return (props.optimalTilingFeatures & features) == features;
+}
+
 #ifndef NDEBUG
 
 void CoreVulkan::CreateDebugCallback()
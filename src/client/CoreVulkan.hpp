@@ -105,11 +105,17 @@ protected:
     VkPhysicalDevice physicalDevice;
     SwapchainSupportDetails swapchainSupportDetails;
     VkSampleCountFlagBits msaaSamples;
+    // highest count findMaxLimitedUsableSampleCount allows, the startup default
+    VkSampleCountFlagBits maxMsaaSamples;
     VkDevice device;
     VkQueue presentQueue;
     VkQueue graphicsQueue;
     VkFormat depthFormat;
     VkDeviceSize atomSize;
+    /// Vulkan 1.2 features actually enabled on the device (descriptor indexing, ...)
+    VkPhysicalDeviceVulkan12Features enabledFeatures12{};
+    /// Vulkan version usable on the device, the lower of the instance and device versions
+    uint32_t apiVersion = 0;
     /// Device extensions required by the engine.
     const std::vector<const char*> DEVICE_EXTENSIONS = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,  // * Enables swapchain functionality for presenting images to the screen
@@ -195,6 +201,8 @@ public:
         std::vector<const char*> extensions;
         VkPhysicalDeviceFeatures requiredFeatures{};
         VkPhysicalDeviceFeatures optionalFeatures{};
+        /// Vulkan 1.2 features, chained through pNext. Always optional.
+        VkPhysicalDeviceVulkan12Features optionalFeatures12{};
     };
 
     /**
@@ -258,7 +266,7 @@ private:
         const std::vector<IPhysicalDeviceSelector*>& selectors
     );
 
-    /// Determines the maximum usable MSAA sample count.
+    /// Determines the highest usable MSAA sample count up to maxDesiredSamples.
     VkSampleCountFlagBits findMaxLimitedUsableSampleCount(
         VkSampleCountFlagBits maxDesiredSamples,
         VkPhysicalDevice physicalDevice
@@ -366,6 +374,26 @@ public:
      */
     static bool hasStencilComponent(VkFormat format);
 
+    /**
+     * @brief Checks whether a format can be used with the given tiling and features.
+     *
+     * Used before uploading pre-compressed textures: BCn formats are only
+     * reported when the device supports textureCompressionBC, which is
+     * enabled as an optional feature whenever available.
+     *
+     * @param physicalDevice Physical device used for the format query.
+     * @param format Format to test.
+     * @param tiling Image tiling the format will be used with.
+     * @param features Required format feature flags.
+     * @return true if every requested feature is supported.
+     */
+    static bool isFormatSupported(
+        VkPhysicalDevice physicalDevice,
+        VkFormat format,
+        VkImageTiling tiling,
+        VkFormatFeatureFlags features
+    );
+
     /**
      * @brief Retrieves the non-coherent atom size of the physical device.
      *
@@ -417,6 +445,17 @@ public:
         uint32_t memoryTypeIndex
     );
 
+    /**
+     * @brief Changes the MSAA sample count returned by getMsaaSamples.
+     *
+     * Rounded down to a count the device supports for both color and depth,
+     * at most getMaxMsaaSamples. Everything built with the old count (render
+     * pass, pipelines, attachments) must be recreated by the caller.
+     */
+    void setMsaaSamples(
+        VkSampleCountFlagBits requestedSamples
+    );
+
 //* get
     const VkInstance& getInstance() const { return instance; }
     const VkSurfaceKHR& getSurface() const { return surface; }
@@ -424,10 +463,38 @@ public:
     const VkPhysicalDevice& getPhysicalDevice() const { return physicalDevice; }
     const SwapchainSupportDetails& getSwapchainSupportDetails() const { return swapchainSupportDetails; }
     const VkSampleCountFlagBits& getMsaaSamples() const { return msaaSamples; }
+    VkSampleCountFlagBits getMaxMsaaSamples() const { return maxMsaaSamples; }
     const VkDevice& getDevice() const { return device; }
     const VkQueue& getGraphicsQueue() const { return graphicsQueue; }
     const VkQueue& getPresentQueue() const { return presentQueue; }
     const VkFormat& getDepthFormat() const { return depthFormat; }
     const std::vector<const char*>& getDeviceExtensions() const { return DEVICE_EXTENSIONS; }
     const VkDeviceSize getAtomSize() const { return atomSize; }
+    const VkPhysicalDeviceVulkan12Features& getEnabledFeatures12() const { return enabledFeatures12; }
+    uint32_t getApiVersion() const { return apiVersion; }
+
+    /**
+     * @brief Whether cull mode, topology and depth test/write can be set while recording.
+     *
+     * Core since Vulkan 1.3 (formerly VK_EXT_extended_dynamic_state), no
+     * feature has to be enabled.
+     */
+    bool supportsExtendedDynamicState() const {
+        return apiVersion >= VK_API_VERSION_1_3;
+    }
+
+    /**
+     * @brief Whether the descriptor indexing features used by bindless materials are enabled.
+     *
+     * Requires a partially bound, update-after-bind, runtime-sized array of
+     * combined image samplers indexed non-uniformly from the fragment shader.
+     */
+    bool supportsBindlessTextures() const {
+        return enabledFeatures12.descriptorIndexing &&
+            enabledFeatures12.runtimeDescriptorArray &&
+            enabledFeatures12.shaderSampledImageArrayNonUniformIndexing &&
+            enabledFeatures12.descriptorBindingPartiallyBound &&
+            enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind &&
+            enabledFeatures12.descriptorBindingUpdateUnusedWhilePending;
+    }
 };
@@ -3,6 +3,8 @@
 Render::Render(){};
 
 int Render::run(){
+    startTime = std::chrono::steady_clock::now();
+
     //GLFW things
     initWindow();
 
@@ -19,11 +21,35 @@ int Render::run(){
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        // sample count picked in the UI last frame, everything built with the old one is rebuilt
+        if (msaaSamples != coreVulkan->getMsaaSamples()) {
+            coreVulkan->setMsaaSamples(msaaSamples);
+            msaaSamples = coreVulkan->getMsaaSamples();
+            recreateSwapChain();
+        }
+
         // ui new frame
         this->ui->newFrame();
-        this->ui->build();
+        this->ui->build(
+            this->resourceManager->getStats(),
+            this->graphicsPipeline->getCompileStats(),
+            this->particleSystem->getStats(),
+            this->debugDraw->getStats(),
+            occlusionCuller ? occlusionCuller->getStats() : OcclusionCuller::Stats{},
+            *this->clusteredLighting,
+            *this->shadowMaps,
+            *this->gpuTimer,
+            this->useDepthPrepass,
+            this->msaaSamples,
+            coreVulkan->getMaxMsaaSamples(),
+            *this->dynamicResolution,
+            startupSeconds
+        );
 
         drawFrame();
+
+        if (startupSeconds == 0.0)
+            startupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     }
 
     //free memory (secure)
@@ -56,6 +82,7 @@ void Render::initVulkan(){
         {},
         {}
     );
+    msaaSamples = coreVulkan->getMsaaSamples();
 
     bufferManager = new BufferManager(
         coreVulkan->getPhysicalDevice(),
@@ -101,6 +128,20 @@ void Render::initVulkan(){
         coreVulkan->getMsaaSamples()
     );
 
+    // what the render pass resolves into, copied to the swapchain image
+    sceneColor = new ImageColor(
+        coreVulkan->getPhysicalDevice(),
+        coreVulkan->getDevice(),
+        swapchainManager->getImageFormat(),
+        swapchainManager->getExtent(),
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    );
+
+    // the scene is drawn in part of the attachments when scaled down
+    dynamicResolution = new DynamicResolution(coreVulkan->getPhysicalDevice());
+    dynamicResolution->setDisplay(swapchainManager->getExtent(), swapchainManager->getImageFormat());
+
     //Create DepthResources
     depthBufferManager = new DepthBufferManager(
         coreVulkan->getPhysicalDevice(),
@@ -111,12 +152,18 @@ void Render::initVulkan(){
         VK_IMAGE_ASPECT_DEPTH_BIT
     );
 
+    // depth read back by the transparent subpass
+    depthInputDescriptorManager = new DepthInputDescriptorManager(coreVulkan->getDevice());
+    depthInputDescriptorManager->update(depthBufferManager->getDepthInputView());
+
     //Create framebuffers
     framebufferManager = new FramebufferManager(
         coreVulkan->getDevice(),
         renderPass->get(),
+        renderPass->getOverlay(),
         swapchainManager->getImageViews(),
         imageColor->getColorImageView(),
+        sceneColor->getColorImageView(),
         depthBufferManager->getDepthImageView(),
         swapchainManager->getExtent(),
         (coreVulkan->getMsaaSamples() != VK_SAMPLE_COUNT_1_BIT)
@@ -135,25 +182,81 @@ void Render::initVulkan(){
         this->framebufferManager->getFramebuffers()
     );
 
+    // shared by every pipeline build, created before the first of them
+    VkPipelineCacheCreateInfo pipelineCacheInfo{};
+    pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (vkCreatePipelineCache(coreVulkan->getDevice(), &pipelineCacheInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    // before the shadow maps, their casters are bound with its layout
+    instanceDescriptorManager = new InstanceDescriptorManager(
+        coreVulkan->getDevice(),
+        bufferManager,
+        coreVulkan->getAtomSize(),
+        Render::MAX_FRAMES_IN_FLIGHT,
+        maxInstances
+    );
+
+    // Lights and their view clusters, read through the global set
+    clusteredLighting = new ClusteredLighting(
+        coreVulkan->getDevice(),
+        bufferManager,
+        coreVulkan->getAtomSize(),
+        pipelineCache,
+        Render::MAX_FRAMES_IN_FLIGHT,
+        maxLights
+    );
+
+    // Sun cascades, sampled through the global set
+    shadowMaps = new CascadedShadowMaps(
+        coreVulkan->getPhysicalDevice(),
+        coreVulkan->getDevice(),
+        bufferManager,
+        coreVulkan->getAtomSize(),
+        instanceDescriptorManager->getLayout(),
+        Render::MAX_FRAMES_IN_FLIGHT,
+        maxShadowInstances,
+        shadowMapResolution
+    );
+
     // Create descript
     globalDescriptorManager = new GlobalDescriptorManager(
         coreVulkan->getDevice(),
         this->cameraBufferManager,
+        clusteredLighting,
+        shadowMaps,
         Render::MAX_FRAMES_IN_FLIGHT
     );
 
+    samplerCache = new SamplerCache(
+        coreVulkan->getPhysicalDevice(),
+        coreVulkan->getDevice()
+    );
+
+    // every engine texture uses the default sampler, baked into the layout
     materialDescriptorManager = new MaterialDescriptorManager(
         coreVulkan->getDevice(),
         maxMaterials,
-        {}
+        {},
+        samplerCache->get(SamplerCache::SamplerDesc{})
     );
 
-    instanceDescriptorManager = new InstanceDescriptorManager(
+    if (useBindlessMaterials && coreVulkan->supportsBindlessTextures())
+    {
+        bindlessTextureManager = new BindlessTextureManager(
+            coreVulkan->getPhysicalDevice(),
+            coreVulkan->getDevice(),
+            maxBindlessTextures,
+            Render::MAX_FRAMES_IN_FLIGHT
+        );
+    }
+
+    materialParameterBuffer = new MaterialParameterBuffer(
         coreVulkan->getDevice(),
         bufferManager,
-        coreVulkan->getAtomSize(),
         Render::MAX_FRAMES_IN_FLIGHT,
-        maxInstances
+        maxMaterialParams
     );
 
     particleInstanceDescriptorManager = new ParticleInstanceDescriptorManager(
@@ -161,21 +264,94 @@ void Render::initVulkan(){
         bufferManager,
         coreVulkan->getAtomSize(),
         Render::MAX_FRAMES_IN_FLIGHT,
-        maxInstances
+        maxCpuParticles
     );
 
-    // Create graphics pipeline
+    debugDraw = new DebugDraw(
+        coreVulkan->getDevice(),
+        bufferManager,
+        coreVulkan->getAtomSize(),
+        Render::MAX_FRAMES_IN_FLIGHT,
+        maxDebugLines
+    );
+
+    // pipelines compile on the workers, the pool is needed before any of them
+    jobSystem = new JobSystem();
+
+#ifdef SHADER_HOT_RELOAD
+    shaderHotReload = new ShaderHotReload(SHADER_SOURCE_DIR, "shaders", jobSystem);
+#endif
+
+    // Create graphics pipeline, returns once the startup set is built
     graphicsPipeline = new GraphicsPipeline(
         coreVulkan->getDevice(),
         swapchainManager->getExtent(),
         renderPass->get(),
+        shadowMaps->getRenderPass(),
         globalDescriptorManager->getLayout(),
-        materialDescriptorManager->getLayout(),
+        bindlessTextureManager ? bindlessTextureManager->getLayout() : materialDescriptorManager->getLayout(),
         instanceDescriptorManager->getLayout(),
+        materialParameterBuffer->getLayout(),
         particleInstanceDescriptorManager->getLayout(),
-        coreVulkan->getMsaaSamples()
+        depthInputDescriptorManager->getLayout(),
+        debugDraw->getLayout(),
+        coreVulkan->getMsaaSamples(),
+        bindlessTextureManager != nullptr,
+        useDynamicRenderState && coreVulkan->supportsExtendedDynamicState(),
+        pipelineCache,
+        jobSystem,
+        Render::MAX_FRAMES_IN_FLIGHT
+    );
+
+    gpuTimer = new GpuTimer(
+        coreVulkan->getPhysicalDevice(),
+        coreVulkan->getDevice(),
+        coreVulkan->getGraphicsQueueFamilyIndices().graphicsFamily.value(),
+        Render::MAX_FRAMES_IN_FLIGHT,
+        static_cast<uint32_t>(CommandManager::TimerScope::Count)
     );
 
+    // Instances culled on the GPU against the frustum and the depth of the previous and current frame
+    if (useOcclusionCulling) {
+        occlusionCuller = new OcclusionCuller(
+            coreVulkan->getPhysicalDevice(),
+            coreVulkan->getDevice(),
+            bufferManager,
+            coreVulkan->getAtomSize(),
+            instanceDescriptorManager,
+            pipelineCache,
+            Render::MAX_FRAMES_IN_FLIGHT,
+            maxInstances,
+            maxCullDraws
+        );
+        occlusionCuller->setDepth(
+            depthBufferManager->getDepthInputView(),
+            swapchainManager->getExtent(),
+            coreVulkan->getMsaaSamples()
+        );
+    }
+
+    // Particle pool, simulated on the GPU from the emitters only or on the workers
+    if (useGpuParticles) {
+        particleSystem = new GpuParticleSystem(
+            coreVulkan->getDevice(),
+            bufferManager,
+            coreVulkan->getAtomSize(),
+            particleInstanceDescriptorManager->getLayout(),
+            pipelineCache,
+            Render::MAX_FRAMES_IN_FLIGHT,
+            maxGpuParticles,
+            maxParticleEmitters
+        );
+    } else {
+        particleSystem = new CpuParticleSystem(
+            particleInstanceDescriptorManager,
+            jobSystem,
+            Render::MAX_FRAMES_IN_FLIGHT,
+            useSimdParticles
+        );
+    }
+
     #ifndef NDEBUG
         // VkPhysicalDeviceProperties deviceProperties;
         // vkGetPhysicalDeviceProperties(CoreVulkan::getPhysicalDevice(), &deviceProperties);
@@ -195,9 +371,10 @@ void Render::initImGui(){
         coreVulkan->getDevice(),
         coreVulkan->getGraphicsQueueFamilyIndices(),
         coreVulkan->getGraphicsQueue(),
-        this->renderPass->get(),
+        this->renderPass->getOverlay(),
         this->swapchainManager->getImages().size(),
-        coreVulkan->getMsaaSamples()
+        VK_SAMPLE_COUNT_1_BIT,
+        pipelineCache
     );
 }
 
@@ -207,7 +384,13 @@ void Render::initInstances(){
         coreVulkan->getDevice(),
         bufferManager,
         materialDescriptorManager->getDescriptorPool(),
-        materialDescriptorManager->getLayout()
+        materialDescriptorManager->getLayout(),
+        bindlessTextureManager,
+        materialParameterBuffer,
+        samplerCache,
+        jobSystem,
+        assetMemoryBudget,
+        MAX_FRAMES_IN_FLIGHT
     );
 
     renderBatchManager = new RenderBatchManager(
@@ -221,6 +404,47 @@ void Render::initInstances(){
         renderInstance
     );
 
+    // fountain above the room
+    ParticleEmitter fountain{};
+    fountain.position = glm::vec3(0.0f, 1.0f, 0.0f);
+    fountain.radius = 0.05f;
+    fountain.velocity = glm::vec3(0.0f, 3.0f, 0.0f);
+    fountain.velocitySpread = 0.8f;
+    fountain.colorStart = glm::vec4(1.0f, 0.3f, 0.0f, 1.0f);
+    fountain.colorEnd = glm::vec4(1.0f, 0.9f, 0.2f, 0.0f);
+    fountain.sizeStart = 0.05f;
+    fountain.sizeEnd = 0.01f;
+    fountain.blendMode = ParticleBlendMode::Additive;
+    fountain.lifetime = 1.5f;
+    fountain.lifetimeSpread = 0.5f;
+    fountain.rate = 20000.0f;
+    particleSystem->addEmitter(fountain);
+
+    // a ring of flickering torches and a spot light over the room
+    const glm::vec3 torchColors[] = {
+        { 1.0f, 0.55f, 0.2f },
+        { 1.0f, 0.35f, 0.1f },
+        { 0.9f, 0.6f, 0.3f }
+    };
+    for (uint32_t i = 0; i < 24; i++) {
+        Light torch{};
+        torch.type = LightType::Point;
+        torch.range = 0.8f;
+        torch.color = torchColors[i % 3];
+        torch.intensity = 1.5f;
+        torchLights.push_back(clusteredLighting->addLight(torch));
+    }
+
+    Light spot{};
+    spot.type = LightType::Spot;
+    spot.position = glm::vec3(0.0f, 0.0f, 2.0f);
+    spot.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    spot.range = 4.0f;
+    spot.color = glm::vec3(0.6f, 0.7f, 1.0f);
+    spot.intensity = 3.0f;
+    spot.innerAngle = glm::radians(15.0f);
+    spot.outerAngle = glm::radians(25.0f);
+    clusteredLighting->addLight(spot);
 }
 
 void Render::drawFrame(){
@@ -228,6 +452,9 @@ void Render::drawFrame(){
 
     // Wait for this frame to be free
     vkWaitForFences(coreVulkan->getDevice(), 1, &this->inFlightFences[this->currentFrame], VK_TRUE, UINT64_MAX);
+    gpuTimer->beginFrame(currentFrame);
+    dynamicResolution->update(gpuTimer->getMilliseconds(static_cast<uint32_t>(CommandManager::TimerScope::Scene)));
+    VkExtent2D renderExtent = dynamicResolution->getRenderExtent();
 
     uint32_t imageIndex;
     VkResult next_img_result = vkAcquireNextImageKHR(coreVulkan->getDevice(), this->swapchainManager->getSwapchain(),
@@ -250,6 +477,19 @@ void Render::drawFrame(){
     // Reset the fence for the current frame
     vkResetFences(coreVulkan->getDevice(), 1, &this->inFlightFences[this->currentFrame]);
 
+    // Finalize assets decoded by the job system and swap out placeholders
+    resourceManager->processUploads();
+    renderBatchManager->update();
+
+#ifdef SHADER_HOT_RELOAD
+    // Rebuild the pipelines of edited shaders, the old ones draw until ready
+    for (const std::string& program : shaderHotReload->poll())
+        graphicsPipeline->reloadProgram(program);
+#endif
+
+    // Swap in pipelines finished in the background
+    graphicsPipeline->collectCompiled();
+
     // Update UBOs for this frame
     UniformBufferGlobal ubg{};
     iCameraProvider->fill(
@@ -257,7 +497,21 @@ void Render::drawFrame(){
         time,
         swapchainManager->getExtent()
     );
+    ubg.ambient = glm::vec4(clusteredLighting->ambient, 1.0f);
     this->cameraBufferManager->update(currentFrame, ubg);
+
+    // torches circle the room, flickering
+    for (size_t i = 0; i < torchLights.size(); i++) {
+        float angle = 6.2831853f * i / torchLights.size() + 0.2f * time;
+        Light torch = clusteredLighting->getLight(torchLights[i]);
+        torch.position = glm::vec3(1.2f * std::cos(angle), 1.2f * std::sin(angle), 0.3f + 0.2f * std::sin(3.0f * angle));
+        torch.intensity = 1.5f * (0.85f + 0.15f * std::sin(17.0f * time + 5.0f * i));
+        clusteredLighting->setLight(torchLights[i], torch);
+    }
+    clusteredLighting->update(currentFrame, ubg.view, ubg.proj, ubg.zNear, ubg.zFar);
+
+    if (occlusionCuller)
+        occlusionCuller->beginFrame(currentFrame, ubg.proj * ubg.view, renderExtent);
     renderInstance->rotation = glm::vec3(
         0.15* time,
         0.3,
@@ -265,29 +519,70 @@ void Render::drawFrame(){
     );
     renderInstance->updateModelMatrix();
 
+    // Pick the level of detail of each instance for this view, in pixels actually rendered
+    RenderBatchManager::LodSelectionParams lodParams{};
+    lodParams.cameraPosition = glm::vec3(glm::inverse(ubg.view)[3]);
+    lodParams.projectionScale =
+        std::abs(ubg.proj[1][1]) * static_cast<float>(renderExtent.height) * 0.5f;
+    renderBatchManager->updateLods(lodParams);
+
+    // Cascades fitted to this view, casters culled with their final LODs
+    shadowMaps->update(currentFrame, ubg.view, ubg.proj, ubg.zNear, ubg.zFar, *renderBatchManager);
+
+    if (showDebugBounds)
+    {
+        renderBatchManager->drawDebugBounds(*debugDraw);
+        debugDraw->grid(glm::vec3(-4.0f, 0.0f, -4.0f), 1.0f, 8, 8, glm::vec4(0.5f, 0.5f, 0.5f, 0.4f));
+    }
+
+    // Upload material parameters changed since this frame slot was last used
+    materialParameterBuffer->flush(currentFrame);
+
+    // Emitters of this frame; on the CPU backend also the particles themselves
+    particleSystem->update(currentFrame, lastFrameTime > 0.0f ? time - lastFrameTime : 0.0f, ubg.view);
+    lastFrameTime = time;
+
+    // Lines added this frame, into the frame's slice of the ring buffer
+    debugDraw->flush(currentFrame);
+
     // Reset + record only the command buffer for this swapchain image
     VkCommandBuffer cmd = this->commandManager->getCommandBuffers()[imageIndex];
     vkResetCommandBuffer(cmd, 0);
     this->commandManager->recordCommandBuffer(
         imageIndex,
         currentFrame,
-        this->renderPass->get(),
+        this->renderPass,
         this->graphicsPipeline,
         this->framebufferManager->getFramebuffers(),
+        this->framebufferManager->getSceneFramebuffer(),
+        this->sceneColor->getColorImage(),
+        this->swapchainManager->getImages()[imageIndex],
+        renderExtent,
         this->swapchainManager->getExtent(),
+        dynamicResolution->getUpscaleFilter(),
         globalDescriptorManager,
         instanceDescriptorManager,
-        particleInstanceDescriptorManager,
+        bindlessTextureManager,
+        materialParameterBuffer,
+        particleSystem,
+        depthInputDescriptorManager,
+        debugDraw,
         renderBatchManager,
+        occlusionCuller,
+        clusteredLighting,
+        shadowMaps,
+        useDepthPrepass,
+        gpuTimer,
         {},
-        {},
-        {},
+        {dynamicResolution},
+        {dynamicResolution},
         {&UI::ImGuiCommandBufferRecorder::instance()}
     );
 
     // --- Submit work ---
     VkSemaphore waitSemaphores[] = { this->imageAvailableSemaphores[this->currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    // the swapchain image is first touched by the upscale, the scene renders while it is acquired
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
     VkSemaphore signalSemaphores[] = { this->renderFinishedSemaphores[this->currentFrame] };
 
     VkSubmitInfo submitInfo{};
@@ -359,15 +654,32 @@ void Render::cleanup(){
         if (this->commandManager){ delete this->commandManager; this->commandManager = nullptr; }
         if (this->framebufferManager){ delete this->framebufferManager; this->framebufferManager = nullptr; }
         if (this->imageColor){ delete this->imageColor; this->imageColor = nullptr; }
+        if (sceneColor){ delete sceneColor; sceneColor = nullptr; }
+        if (dynamicResolution){ delete dynamicResolution; dynamicResolution = nullptr; }
         if (this->depthBufferManager){ delete this->depthBufferManager; this->depthBufferManager = nullptr; }
         if (this->graphicsPipeline){ delete this->graphicsPipeline; this->graphicsPipeline = nullptr; }
+        if (depthInputDescriptorManager){ delete depthInputDescriptorManager; depthInputDescriptorManager = nullptr; }
+#ifdef SHADER_HOT_RELOAD
+        if ( shaderHotReload ){ delete shaderHotReload; shaderHotReload = nullptr; }
+#endif
+        if ( jobSystem ){ delete jobSystem; jobSystem = nullptr; }
         if (globalDescriptorManager){ delete globalDescriptorManager; globalDescriptorManager = nullptr; }
         if (materialDescriptorManager){ delete materialDescriptorManager; materialDescriptorManager = nullptr; }
+        if (bindlessTextureManager){ delete bindlessTextureManager; bindlessTextureManager = nullptr; }
+        if (samplerCache){ delete samplerCache; samplerCache = nullptr; }
+        if (materialParameterBuffer){ delete materialParameterBuffer; materialParameterBuffer = nullptr; }
+        if (occlusionCuller){ delete occlusionCuller; occlusionCuller = nullptr; }
+        if (gpuTimer){ delete gpuTimer; gpuTimer = nullptr; }
+        if (clusteredLighting){ delete clusteredLighting; clusteredLighting = nullptr; }
+        if (shadowMaps){ delete shadowMaps; shadowMaps = nullptr; }
         if (instanceDescriptorManager){ delete instanceDescriptorManager; instanceDescriptorManager = nullptr; }
+        if (particleSystem){ delete particleSystem; particleSystem = nullptr; }
         if (particleInstanceDescriptorManager){ delete particleInstanceDescriptorManager; particleInstanceDescriptorManager = nullptr; }
+        if (debugDraw){ delete debugDraw; debugDraw = nullptr; }
         if (iCameraProvider){ delete iCameraProvider; iCameraProvider = nullptr; }
         if (this->cameraBufferManager){ delete this->cameraBufferManager; this->cameraBufferManager = nullptr; }
         if (this->ui) { this->ui->cleanup(); delete this->ui; this->ui = nullptr; }
+        if (pipelineCache != VK_NULL_HANDLE){ vkDestroyPipelineCache(coreVulkan->getDevice(), pipelineCache, nullptr); pipelineCache = VK_NULL_HANDLE; }
         if (this->renderPass){ delete this->renderPass; this->renderPass = nullptr; }
         if ( bufferManager ){ delete bufferManager; bufferManager = nullptr; }
 
@@ -438,6 +750,7 @@ void Render::cleanupSwapChain() {
 
     if (this->framebufferManager){ delete this->framebufferManager; this->framebufferManager = nullptr; }
     if (this->imageColor){ delete this->imageColor; this->imageColor = nullptr; }
+    if (sceneColor){ delete sceneColor; sceneColor = nullptr; }
     if (this->depthBufferManager){ delete this->depthBufferManager; this->depthBufferManager = nullptr; }
     if (this->graphicsPipeline){ delete this->graphicsPipeline; this->graphicsPipeline = nullptr; }
     if (this->ui) { vkDeviceWaitIdle(coreVulkan->getDevice()); ImGui_ImplVulkan_Shutdown(); }
@@ -482,14 +795,23 @@ void Render::recreateSwapChain() {
         coreVulkan->getDevice(),
         swapchainManager->getExtent(),
         renderPass->get(),
+        shadowMaps->getRenderPass(),
         globalDescriptorManager->getLayout(),
-        materialDescriptorManager->getLayout(),
+        bindlessTextureManager ? bindlessTextureManager->getLayout() : materialDescriptorManager->getLayout(),
         instanceDescriptorManager->getLayout(),
+        materialParameterBuffer->getLayout(),
         particleInstanceDescriptorManager->getLayout(),
-        coreVulkan->getMsaaSamples()
+        depthInputDescriptorManager->getLayout(),
+        debugDraw->getLayout(),
+        coreVulkan->getMsaaSamples(),
+        bindlessTextureManager != nullptr,
+        useDynamicRenderState && coreVulkan->supportsExtendedDynamicState(),
+        pipelineCache,
+        jobSystem,
+        Render::MAX_FRAMES_IN_FLIGHT
     );
 
-    // 5. Recreate Multisampling
+    // 5. Recreate Multisampling and the scene color
     imageColor = new ImageColor(
         coreVulkan->getPhysicalDevice(),
         coreVulkan->getDevice(),
@@ -498,6 +820,17 @@ void Render::recreateSwapChain() {
         coreVulkan->getMsaaSamples()
     );
 
+    // what the render pass resolves into, copied to the swapchain image
+    sceneColor = new ImageColor(
+        coreVulkan->getPhysicalDevice(),
+        coreVulkan->getDevice(),
+        swapchainManager->getImageFormat(),
+        swapchainManager->getExtent(),
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    );
+    dynamicResolution->setDisplay(swapchainManager->getExtent(), swapchainManager->getImageFormat());
+
     // 6. Recreate depth buffer
     depthBufferManager = new DepthBufferManager(
         coreVulkan->getPhysicalDevice(),
@@ -507,13 +840,23 @@ void Render::recreateSwapChain() {
         coreVulkan->getDepthFormat(),
         VK_IMAGE_ASPECT_DEPTH_BIT
     );
+    depthInputDescriptorManager->update(depthBufferManager->getDepthInputView());
+    if (occlusionCuller) {
+        occlusionCuller->setDepth(
+            depthBufferManager->getDepthInputView(),
+            swapchainManager->getExtent(),
+            coreVulkan->getMsaaSamples()
+        );
+    }
 
     // 7. Recreate framebuffers
     framebufferManager = new FramebufferManager(
         coreVulkan->getDevice(),
         renderPass->get(),
+        renderPass->getOverlay(),
         swapchainManager->getImageViews(),
         imageColor->getColorImageView(),
+        sceneColor->getColorImageView(),
         depthBufferManager->getDepthImageView(),
         swapchainManager->getExtent(),
         (coreVulkan->getMsaaSamples() != VK_SAMPLE_COUNT_1_BIT)
@@ -531,9 +874,10 @@ void Render::recreateSwapChain() {
         coreVulkan->getPhysicalDevice(),
         coreVulkan->getGraphicsQueueFamilyIndices(),
         coreVulkan->getGraphicsQueue(),
-        renderPass->get(),
+        renderPass->getOverlay(),
         swapchainManager->getImages().size(),
-        coreVulkan->getMsaaSamples()
+        VK_SAMPLE_COUNT_1_BIT,
+        pipelineCache
     );
 }
 
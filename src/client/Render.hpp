@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "CoreVulkan.hpp"
 #include "CoreVulkan.hpp"
 #include "ui/UI.hpp"
@@ -8,18 +10,31 @@
 #include "graphics_pipeline/GlobalDescriptorManager.hpp"
 #include "camera/CameraBufferManager.hpp"
 #include "graphics_pipeline/GraphicsPipeline.hpp"
+#include "graphics_pipeline/ShaderHotReload.hpp"
 #include "swapchain&framebuffer/DepthBufferManager.hpp"
+#include "swapchain&framebuffer/DepthInputDescriptorManager.hpp"
 #include "swapchain&framebuffer/FramebufferManager.hpp"
+#include "swapchain&framebuffer/DynamicResolution.hpp"
 //todo fix mash name :)
 #include "swapchain&framebuffer/CommandManager.hpp"
 #include "camera/UniformBufferGlobal.hpp"
 #include "image/ImageColor.hpp"
 #include "batch/material/MaterialDescriptorManager.hpp"
+#include "batch/material/BindlessTextureManager.hpp"
+#include "batch/material/SamplerCache.hpp"
+#include "batch/material/MaterialParameterBuffer.hpp"
 #include "batch/RenderBatchManager.hpp"
 #include "batch/ResourceManager.hpp"
 #include "batch/instance/RenderInstance.hpp"
 #include "batch/instance/InstanceDescriptorManager.hpp"
 #include "particle/ParticleInstanceDescriptorManager.hpp"
+#include "particle/GpuParticleSystem.hpp"
+#include "particle/CpuParticleSystem.hpp"
+#include "debug/DebugDraw.hpp"
+#include "culling/OcclusionCuller.hpp"
+#include "debug/GpuTimer.hpp"
+#include "lighting/ClusteredLighting.hpp"
+#include "lighting/CascadedShadowMaps.hpp"
 
 class Render {
 public:
@@ -40,6 +55,8 @@ private:
     uint32_t height = 600;
 
     uint32_t currentFrame = 0;
+    // glfwGetTime of the previous frame, for the particle simulation step
+    float lastFrameTime = 0.0f;
 
     GLFWwindow* window;
     CoreVulkan* coreVulkan;
@@ -50,9 +67,21 @@ private:
     CameraBufferManager* cameraBufferManager;
     GlobalDescriptorManager* globalDescriptorManager;
     MaterialDescriptorManager* materialDescriptorManager;
+    // null when the device lacks descriptor indexing or bindless is disabled
+    BindlessTextureManager* bindlessTextureManager = nullptr;
+    SamplerCache* samplerCache = nullptr;
+    MaterialParameterBuffer* materialParameterBuffer = nullptr;
     GraphicsPipeline* graphicsPipeline;
+    // shared by every pipeline build, survives swapchain recreation
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
     ImageColor* imageColor;
+    // single-sampled scene, resolved into then scaled to the swapchain image
+    ImageColor* sceneColor = nullptr;
+    // render extent of the scene and the viewport/scissor matching it
+    DynamicResolution* dynamicResolution = nullptr;
     DepthBufferManager* depthBufferManager;
+    // set 2 of the particle pipelines, repointed when the depth buffer is recreated
+    DepthInputDescriptorManager* depthInputDescriptorManager = nullptr;
     FramebufferManager* framebufferManager;
     CommandManager* commandManager;
     CameraBufferManager::ICameraProvider* iCameraProvider;
@@ -62,13 +91,69 @@ private:
     std::vector<VkFence> imagesInFlight;
     RenderBatchManager* renderBatchManager;
     ResourceManager* resourceManager;
+    JobSystem* jobSystem;
+#ifdef SHADER_HOT_RELOAD
+    ShaderHotReload* shaderHotReload = nullptr;
+#endif
     RenderInstance* renderInstance;
+    // from run() to the end of the first frame
+    std::chrono::steady_clock::time_point startTime;
+    double startupSeconds = 0.0;
     BufferManager* bufferManager;
     InstanceDescriptorManager* instanceDescriptorManager;
     ParticleInstanceDescriptorManager* particleInstanceDescriptorManager;
+    ParticleSystem* particleSystem = nullptr;
+    DebugDraw* debugDraw = nullptr;
+    // null draws every instance in a single opaque pass
+    OcclusionCuller* occlusionCuller = nullptr;
+    // GPU time of the CommandManager::TimerScope ranges
+    GpuTimer* gpuTimer = nullptr;
+    // point and spot lights, culled into view clusters for the mesh pass
+    ClusteredLighting* clusteredLighting = nullptr;
+    // sun shadows, far cascades cached while the view and static geometry hold still
+    CascadedShadowMaps* shadowMaps = nullptr;
+    // torches around the room, animated in drawFrame
+    std::vector<uint32_t> torchLights;
 
     uint32_t maxMaterials = 1024;
+    // one texture array for every material instead of per-material sets, when supported
+    bool useBindlessMaterials = true;
+    // slots of the bindless texture array, clamped to the device limits
+    uint32_t maxBindlessTextures = 16384;
+    // cull mode, topology and depth test/write as dynamic state, fewer pipelines, when supported
+    bool useDynamicRenderState = true;
     uint32_t maxInstances = 21080;
+    // live particles of the GPU pool, 64 + 32 + 12 bytes of device memory each
+    uint32_t maxGpuParticles = 262144;
+    uint32_t maxParticleEmitters = 256;
+    // simulate particles in compute passes, otherwise on the CPU workers
+    bool useGpuParticles = true;
+    // AVX2 kernels for the CPU particles when the processor has them
+    bool useSimdParticles = true;
+    // live particles of the CPU pools, also the size of the per-frame particle buffers
+    uint32_t maxCpuParticles = 65536;
+    // debug lines per frame, 32 bytes each per frame in flight
+    uint32_t maxDebugLines = 65536;
+    // instance bounding spheres colored by LOD, and the ground grid
+    bool showDebugBounds = true;
+    // two-phase frustum and depth pyramid culling of the mesh instances
+    bool useOcclusionCulling = true;
+    // draws per frame after merging batches, each culled on the GPU
+    uint32_t maxCullDraws = 4096;
+    // lights uploaded per frame, 64 bytes each per frame in flight
+    uint32_t maxLights = 4096;
+    // texels per side of every cascade, 4 bytes each with a 32-bit depth format
+    uint32_t shadowMapResolution = 2048;
+    // caster instances per frame over every cascade, 96 bytes each per frame in flight
+    uint32_t maxShadowInstances = 65536;
+    // depth-only walk before the opaque one, toggled from the UI; pays off with expensive materials
+    bool useDepthPrepass = false;
+    // picked in the UI, applied with a swapchain recreation before the next frame
+    VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    // slots of the material parameter buffer, one per material with a description
+    uint32_t maxMaterialParams = 4096;
+    // GPU memory kept alive by the ResourceManager cache once unused
+    VkDeviceSize assetMemoryBudget = 512ull * 1024 * 1024;
 
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
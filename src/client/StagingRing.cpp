@@ -0,0 +1,123 @@
+#include "StagingRing.hpp"
+
+StagingRing::StagingRing(
+    BufferManager* bufferManager,
+    VkDevice device,
+    VkDeviceSize capacity
+) :
+    device(device),
+    capacity(capacity)
+{
+    bufferManager->createBuffer(
+        capacity,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        buffer
+    );
+
+    try {
+        bufferManager->allocateBufferMemory(
+            buffer,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            memory
+        );
+    } catch (...) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        throw;
+    }
+
+    void* data = nullptr;
+    if (vkBindBufferMemory(device, buffer, memory, 0) != VK_SUCCESS ||
+        vkMapMemory(device, memory, 0, capacity, 0, &data) != VK_SUCCESS)
+    {
+        vkDestroyBuffer(device, buffer, nullptr);
+        vkFreeMemory(device, memory, nullptr);
+        throw std::runtime_error("failed to map staging ring!");
+    }
+    mapped = static_cast<uint8_t*>(data);
+}
+
+StagingRing::~StagingRing()
+{
+    if (mapped)
+        vkUnmapMemory(device, memory);
+
+    if (buffer != VK_NULL_HANDLE)
+        vkDestroyBuffer(device, buffer, nullptr);
+
+    if (memory != VK_NULL_HANDLE)
+        vkFreeMemory(device, memory, nullptr);
+}
+
+bool StagingRing::allocate(
+    VkDeviceSize size,
+    Allocation& allocation
+) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size == 0 || size > capacity)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    VkDeviceSize offset = 0;
+    if (!blocks.empty())
+    {
+        const VkDeviceSize tail = blocks.front().offset;
+        const VkDeviceSize head = blocks.back().offset + blocks.back().size;
+
+        if (blocks.back().offset >= tail)
+        {
+            // live data in [tail, head): take the end, or wrap to the start
+            if (head + size <= capacity)
+                offset = head;
+            else if (size <= tail)
+                offset = 0;
+            else
+                return false;
+        }
+        else
+        {
+            // wrapped, live data in [tail, capacity) and [0, head)
+            if (head + size > tail)
+                return false;
+            offset = head;
+        }
+    }
+
+    blocks.push_back({offset, size, false});
+    usedBytes += size;
+
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.data = mapped + offset;
+    return true;
+}
+
+void StagingRing::free(
+    Allocation& allocation
+) {
+    if (!allocation.valid())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (Block& block : blocks)
+    {
+        if (block.offset == allocation.offset && !block.freed)
+        {
+            block.freed = true;
+            usedBytes -= block.size;
+            break;
+        }
+    }
+
+    while (!blocks.empty() && blocks.front().freed)
+        blocks.pop_front();
+
+    allocation = Allocation();
+}
+
+VkDeviceSize StagingRing::getUsedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
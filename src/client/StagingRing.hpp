@@ -0,0 +1,97 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "BufferManager.hpp"
+
+/**
+ * @brief Persistently mapped staging buffer shared by asset uploads.
+ *
+ * Worker threads allocate a region, write decoded data straight into
+ * the mapped memory and hand the region to the render thread, which
+ * copies it to the GPU and frees it. This replaces one staging buffer
+ * and memory allocation per upload and the copy from a CPU-side buffer
+ * into it.
+ *
+ * Regions are handed out in ring order but may be freed in any order;
+ * space is reclaimed once every older region is freed too. Allocation
+ * fails instead of waiting when the ring is full, callers then fall
+ * back to a private staging buffer.
+ *
+ * The memory is host coherent, so writes need no flush. Allocate and
+ * free are thread-safe.
+ */
+class StagingRing
+{
+public:
+    struct Allocation {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint8_t* data = nullptr;
+
+        bool valid() const { return data != nullptr; }
+    };
+
+private:
+    struct Block {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        bool freed;
+    };
+
+    // covers every format TextureImage uploads: texel and block sizes up to 16
+    static constexpr VkDeviceSize ALIGNMENT = 16;
+
+    VkDevice device;
+    VkDeviceSize capacity;
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    uint8_t* mapped = nullptr;
+
+    std::mutex mutex;
+    std::deque<Block> blocks;
+    VkDeviceSize usedBytes = 0;
+
+public:
+    /**
+     * @brief Creates and maps the ring buffer.
+     *
+     * @param bufferManager Buffer creation utility.
+     * @param device Logical Vulkan device.
+     * @param capacity Ring size in bytes.
+     *
+     * @throws std::runtime_error if the buffer cannot be created or mapped.
+     */
+    StagingRing(
+        BufferManager* bufferManager,
+        VkDevice device,
+        VkDeviceSize capacity
+    );
+
+    ~StagingRing();
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    /**
+     * @brief Reserves size bytes, aligned for buffer-to-image copies.
+     *
+     * @return false, leaving allocation untouched, when there is no room.
+     */
+    bool allocate(
+        VkDeviceSize size,
+        Allocation& allocation
+    );
+
+    /**
+     * @brief Returns a region. The GPU must be done reading it.
+     */
+    void free(
+        Allocation& allocation
+    );
+
+    VkBuffer getBuffer() const { return buffer; }
+    VkDeviceSize getCapacity() const { return capacity; }
+    VkDeviceSize getUsedBytes();
+};
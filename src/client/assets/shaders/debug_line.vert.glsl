@@ -0,0 +1,30 @@
+#version 450
+
+// One line per instance, gl_VertexIndex picks its end.
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, set = 0, binding = 0) uniform UniformBufferGlobal {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct DebugLine {
+    vec3 from;
+    uint color;     // packUnorm4x8
+    vec3 to;
+    uint pad;
+};
+
+// this frame's slice of the ring buffer, selected by the dynamic offset
+layout(std430, set = 1, binding = 0) readonly buffer DebugLineBuffer {
+    DebugLine lines[];
+};
+
+void main() {
+    DebugLine line = lines[gl_InstanceIndex];
+
+    gl_Position = ubo.proj * ubo.view * vec4(gl_VertexIndex == 0 ? line.from : line.to, 1.0);
+
+    fragColor = unpackUnorm4x8(line.color);
+}
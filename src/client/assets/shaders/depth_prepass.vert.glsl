@@ -0,0 +1,30 @@
+#version 450
+
+// positions only, from the tightly packed stream of the mesh
+layout(location = 0) in vec3 inPosition;
+
+// bit-identical to triangle.vert, the main pass tests its depth for EQUAL
+invariant gl_Position;
+
+layout(std140, set = 0, binding = 0) uniform UniformBufferGlobal {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// mirrors InstanceData
+struct Instance {
+    mat4 model;
+    vec4 uvTransform;
+    uint materialIndex;
+    uint paramsIndex;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer {
+    Instance instances[];
+} instanceData;
+
+void main() {
+    mat4 model = instanceData.instances[gl_InstanceIndex].model;
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+}
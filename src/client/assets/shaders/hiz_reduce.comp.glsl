@@ -0,0 +1,39 @@
+#version 450
+
+// One level of the depth pyramid: every texel keeps the farthest depth of
+// the 2x2 texels below it. Level 0 reads the depth buffer itself. Mip sizes
+// round down, so the last row and column also take the odd edge of the
+// level below and every texel of it stays covered. Only the part of each
+// level covering the render extent is reduced, texels past it are stale.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform Push {
+    // parts of the source and destination levels drawn to
+    ivec2 sourceSize;
+    ivec2 size;
+} push;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = push.size;
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    ivec2 sourceSize = push.sourceSize;
+    ivec2 last = sourceSize - 1;
+    ivec2 base = texel * 2;
+    ivec2 span = ivec2(2) + (sourceSize & 1) * ivec2(equal(texel, size - 1));
+
+    float depth = 0.0;
+    for (int y = 0; y < span.y; y++)
+    {
+        for (int x = 0; x < span.x; x++)
+            depth = max(depth, texelFetch(source, min(base + ivec2(x, y), last), 0).r);
+    }
+
+    imageStore(destination, texel, vec4(depth));
+}
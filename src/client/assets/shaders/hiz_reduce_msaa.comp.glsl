@@ -0,0 +1,41 @@
+#version 450
+
+// Level 0 of the depth pyramid from a multisampled depth buffer: the
+// farthest depth of every sample of the 2x2 pixels below each texel, see
+// hiz_reduce.comp.glsl for the odd edges and the render extent.
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2DMS source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform Push {
+    ivec2 sourceSize;
+    ivec2 size;
+} push;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = push.size;
+    if (any(greaterThanEqual(texel, size)))
+        return;
+
+    ivec2 sourceSize = push.sourceSize;
+    ivec2 last = sourceSize - 1;
+    ivec2 base = texel * 2;
+    ivec2 span = ivec2(2) + (sourceSize & 1) * ivec2(equal(texel, size - 1));
+    int samples = textureSamples(source);
+
+    float depth = 0.0;
+    for (int y = 0; y < span.y; y++)
+    {
+        for (int x = 0; x < span.x; x++)
+        {
+            ivec2 pixel = min(base + ivec2(x, y), last);
+            for (int s = 0; s < samples; s++)
+                depth = max(depth, texelFetch(source, pixel, s).r);
+        }
+    }
+
+    imageStore(destination, texel, vec4(depth));
+}
@@ -0,0 +1,179 @@
+#version 450
+
+// Assigns the lights to the clusters of the view frustum, one cluster per
+// invocation. The frustum is cut into GRID.x x GRID.y screen tiles and
+// GRID.z exponential depth slices. The lights are moved to view space a
+// batch at a time through shared memory, then every invocation tests the
+// batch against the bounding box of its cluster: the range sphere for
+// every light, plus the cone for spot lights.
+
+layout(local_size_x = 64) in;
+
+// mirrors ClusteredLighting
+const uvec3 GRID = uvec3(16u, 9u, 24u);
+const uint CLUSTER_COUNT = GRID.x * GRID.y * GRID.z;
+const uint MAX_LIGHTS_PER_CLUSTER = 128u;
+const uint LIGHT_SPOT = 1u;
+
+// mirrors ClusteredLighting::GpuLight
+struct Light {
+    // world position, range
+    vec4 positionRange;
+    vec4 colorIntensity;
+    // spot axis, cosine of the outer half angle
+    vec4 directionOuterCos;
+    float innerCos;
+    uint type;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, set = 0, binding = 0) buffer CullStats {
+    uint maxClusterLights;
+    uint overflowClusters;
+    uint litClusters;
+} stats;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+layout(std430, set = 0, binding = 2) writeonly buffer ClusterGrid {
+    uint clusterLightCounts[];
+};
+
+layout(std430, set = 0, binding = 3) writeonly buffer ClusterLightIndices {
+    uint clusterLightIndices[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 view;
+    // P[0][0], P[1][1], P[2][0], P[2][1] of the perspective projection
+    vec4 projection;
+    float zNear;
+    float zFar;
+    uint lightCount;
+} push;
+
+// view-space range sphere and cone of the current batch, w of the cone < -1 for point lights
+shared vec4 batchSpheres[64];
+shared vec4 batchCones[64];
+
+shared uint groupMaxLights;
+shared uint groupOverflow;
+shared uint groupLit;
+
+// view-space point of the frustum at a NDC position and view depth
+vec3 frustumPoint(vec2 ndc, float depth) {
+    return vec3(
+        (ndc + push.projection.zw) / push.projection.xy * depth,
+        -depth
+    );
+}
+
+void main() {
+    uint clusterIndex = gl_GlobalInvocationID.x;
+    bool active = clusterIndex < CLUSTER_COUNT;
+
+    if (gl_LocalInvocationIndex == 0u) {
+        groupMaxLights = 0u;
+        groupOverflow = 0u;
+        groupLit = 0u;
+    }
+    barrier();
+
+//* cluster bounds
+    uvec3 cell = uvec3(
+        clusterIndex % GRID.x,
+        (clusterIndex / GRID.x) % GRID.y,
+        clusterIndex / (GRID.x * GRID.y)
+    );
+
+    vec2 ndcMin = vec2(cell.xy) / vec2(GRID.xy) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(cell.xy + 1u) / vec2(GRID.xy) * 2.0 - 1.0;
+
+    float depthRatio = push.zFar / push.zNear;
+    float sliceNear = push.zNear * pow(depthRatio, float(cell.z) / float(GRID.z));
+    float sliceFar = push.zNear * pow(depthRatio, float(cell.z + 1u) / float(GRID.z));
+
+    vec3 boxMin = vec3(1e30);
+    vec3 boxMax = vec3(-1e30);
+    for (uint corner = 0u; corner < 8u; corner++) {
+        vec2 ndc = vec2(
+            (corner & 1u) != 0u ? ndcMax.x : ndcMin.x,
+            (corner & 2u) != 0u ? ndcMax.y : ndcMin.y
+        );
+        vec3 p = frustumPoint(ndc, (corner & 4u) != 0u ? sliceFar : sliceNear);
+        boxMin = min(boxMin, p);
+        boxMax = max(boxMax, p);
+    }
+
+    vec3 boxCenter = (boxMin + boxMax) * 0.5;
+    float boxRadius = length(boxMax - boxCenter);
+
+//* lights, a shared batch at a time
+    uint count = 0u;
+
+    for (uint batch = 0u; batch < push.lightCount; batch += 64u) {
+        uint lightIndex = batch + gl_LocalInvocationIndex;
+        if (lightIndex < push.lightCount) {
+            Light light = lights[lightIndex];
+            batchSpheres[gl_LocalInvocationIndex] = vec4(
+                (push.view * vec4(light.positionRange.xyz, 1.0)).xyz,
+                light.positionRange.w
+            );
+            batchCones[gl_LocalInvocationIndex] = light.type == LIGHT_SPOT
+                ? vec4(mat3(push.view) * light.directionOuterCos.xyz, light.directionOuterCos.w)
+                : vec4(0.0, 0.0, 0.0, -2.0);
+        }
+
+        barrier();
+
+        uint batchSize = min(64u, push.lightCount - batch);
+        for (uint i = 0u; active && i < batchSize; i++) {
+            vec4 sphere = batchSpheres[i];
+
+            // range sphere against the box
+            vec3 closest = clamp(sphere.xyz, boxMin, boxMax) - sphere.xyz;
+            if (dot(closest, closest) > sphere.w * sphere.w)
+                continue;
+
+            // cone against the bounding sphere of the box
+            vec4 cone = batchCones[i];
+            if (cone.w >= -1.0) {
+                vec3 v = boxCenter - sphere.xyz;
+                float lengthSq = dot(v, v);
+                float axial = dot(v, cone.xyz);
+                float sinOuter = sqrt(max(1.0 - cone.w * cone.w, 0.0));
+                float distanceToCone = cone.w * sqrt(max(lengthSq - axial * axial, 0.0)) - axial * sinOuter;
+                if (distanceToCone > boxRadius || axial < -boxRadius)
+                    continue;
+            }
+
+            if (count < MAX_LIGHTS_PER_CLUSTER)
+                clusterLightIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + count] = batch + i;
+            count++;
+        }
+
+        // the batch is reused by the next one
+        barrier();
+    }
+
+    if (active) {
+        clusterLightCounts[clusterIndex] = min(count, MAX_LIGHTS_PER_CLUSTER);
+
+        atomicMax(groupMaxLights, count);
+        if (count > MAX_LIGHTS_PER_CLUSTER)
+            atomicAdd(groupOverflow, 1u);
+        if (count > 0u)
+            atomicAdd(groupLit, 1u);
+    }
+
+    // one update of the host-visible stats per group
+    barrier();
+    if (gl_LocalInvocationIndex == 0u) {
+        atomicMax(stats.maxClusterLights, groupMaxLights);
+        atomicAdd(stats.overflowClusters, groupOverflow);
+        atomicAdd(stats.litClusters, groupLit);
+    }
+}
\ No newline at end of file
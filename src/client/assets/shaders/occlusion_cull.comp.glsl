@@ -0,0 +1,203 @@
+#version 450
+
+// Frustum and Hi-Z occlusion test of one instance per invocation, in two
+// phases. The early phase tests every instance against the pyramid of the
+// previous frame; occluded ones go to the late list. The late phase
+// re-tests that list against the pyramid rebuilt from the early depth.
+// Visible instances are copied to the draw buffer behind the others of
+// their draw, and counted in the indirect command of the phase.
+
+layout(local_size_x = 64) in;
+
+// mirrors InstanceData
+struct Instance {
+    mat4 model;
+    vec4 uvTransform;
+    uint materialIndex;
+    uint paramsIndex;
+};
+
+// mirrors OcclusionCuller::CullDraw
+struct CullDraw {
+    // object-space bounding sphere of the mesh
+    vec4 sphere;
+    uint firstInstance;
+    uint instanceCount;
+    uint pad0;
+    uint pad1;
+};
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) buffer CullState {
+    uint earlyDispatch[3];
+    // grows with the late list, one group per 64 entries
+    uint lateDispatch[3];
+    uint instanceCount;
+    uint lateCount;
+    uint frustumCulled;
+    uint earlyOccluded;
+    uint lateOccluded;
+} state;
+
+layout(std430, set = 0, binding = 1) readonly buffer CullDraws {
+    CullDraw draws[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer InstanceDraws {
+    uint instanceDraw[];
+};
+
+// early and late command of every draw, interleaved
+layout(std430, set = 0, binding = 3) buffer DrawCommands {
+    DrawCommand commands[];
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer SourceInstances {
+    Instance sourceInstances[];
+};
+
+layout(std430, set = 0, binding = 5) writeonly buffer VisibleInstances {
+    Instance visibleInstances[];
+};
+
+layout(std430, set = 0, binding = 6) buffer LateList {
+    uint lateList[];
+};
+
+layout(set = 0, binding = 7) uniform sampler2D pyramid;
+
+layout(push_constant) uniform Push {
+    mat4 viewProjection;
+    // pixels of the depth buffer drawn to, level 0 of the pyramid has half of them
+    vec2 depthSize;
+    uint pyramidLevels;
+    // 0 early, 1 late
+    uint phase;
+    // 0: frustum only, no pyramid yet
+    uint occlusion;
+} push;
+
+void main() {
+    uint slot = gl_GlobalInvocationID.x;
+    uint instanceIndex;
+
+    if (push.phase == 0u) {
+        if (slot >= state.instanceCount)
+            return;
+        instanceIndex = slot;
+    } else {
+        if (slot >= state.lateCount)
+            return;
+        instanceIndex = lateList[slot];
+    }
+
+    uint drawIndex = instanceDraw[instanceIndex];
+    CullDraw draw = draws[drawIndex];
+    Instance instance = sourceInstances[instanceIndex];
+
+    // world-space sphere, the same one LOD selection measures
+    vec3 center = (instance.model * vec4(draw.sphere.xyz, 1.0)).xyz;
+    float scale = max(
+        length(instance.model[0].xyz),
+        max(length(instance.model[1].xyz), length(instance.model[2].xyz))
+    );
+    float radius = draw.sphere.w * scale;
+
+    // clip-space corners of the box around the sphere
+    uint outside = 0x3Fu;
+    bool inFront = true;
+    vec3 ndcMin = vec3(1e30);
+    vec3 ndcMax = vec3(-1e30);
+
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + radius * vec3(
+            (i & 1) != 0 ? 1.0 : -1.0,
+            (i & 2) != 0 ? 1.0 : -1.0,
+            (i & 4) != 0 ? 1.0 : -1.0
+        );
+        vec4 clip = push.viewProjection * vec4(corner, 1.0);
+
+        uint code = 0u;
+        code |= clip.x < -clip.w ? 0x01u : 0u;
+        code |= clip.x >  clip.w ? 0x02u : 0u;
+        code |= clip.y < -clip.w ? 0x04u : 0u;
+        code |= clip.y >  clip.w ? 0x08u : 0u;
+        code |= clip.z < 0.0     ? 0x10u : 0u;
+        code |= clip.z >  clip.w ? 0x20u : 0u;
+        outside &= code;
+
+        if (clip.z < 0.0 || clip.w <= 0.0) {
+            inFront = false;
+        } else {
+            vec3 ndc = clip.xyz / clip.w;
+            ndcMin = min(ndcMin, ndc);
+            ndcMax = max(ndcMax, ndc);
+        }
+    }
+
+    // every corner outside the same plane
+    if (outside != 0u) {
+        if (push.phase == 0u)
+            atomicAdd(state.frustumCulled, 1u);
+        return;
+    }
+
+    // a box crossing the near plane is always drawn
+    bool occluded = false;
+    if (push.occlusion != 0u && inFront) {
+        vec2 levelSize = push.depthSize * 0.5;
+        vec2 texMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0) * levelSize;
+        vec2 texMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0) * levelSize;
+
+        // the level where the rectangle spans at most 2x2 texels
+        float extent = max(texMax.x - texMin.x, texMax.y - texMin.y);
+        int level = int(ceil(log2(max(extent, 1.0))));
+
+        if (level < int(push.pyramidLevels)) {
+            // the part of the level built from the drawn pixels, see hiz_reduce.comp.glsl
+            ivec2 last = min(max(((ivec2(push.depthSize) + 1) / 2) >> level, ivec2(1)), textureSize(pyramid, level)) - 1;
+            ivec2 lo = min(ivec2(texMin) >> level, last);
+            ivec2 hi = min(ivec2(texMax) >> level, last);
+
+            float farthest = max(
+                max(texelFetch(pyramid, lo, level).r, texelFetch(pyramid, ivec2(hi.x, lo.y), level).r),
+                max(texelFetch(pyramid, ivec2(lo.x, hi.y), level).r, texelFetch(pyramid, hi, level).r)
+            );
+
+            // nearest point of the box behind everything drawn there
+            occluded = ndcMin.z > farthest;
+        }
+    }
+
+    if (occluded) {
+        if (push.phase == 0u) {
+            atomicAdd(state.earlyOccluded, 1u);
+            uint lateSlot = atomicAdd(state.lateCount, 1u);
+            lateList[lateSlot] = instanceIndex;
+            atomicMax(state.lateDispatch[0], lateSlot / 64u + 1u);
+        } else {
+            atomicAdd(state.lateOccluded, 1u);
+        }
+        return;
+    }
+
+    uint target;
+    if (push.phase == 0u) {
+        target = draw.firstInstance + atomicAdd(commands[drawIndex * 2u].instanceCount, 1u);
+    } else {
+        // after the early instances of the draw, final once the early phase ran
+        uint first = draw.firstInstance + commands[drawIndex * 2u].instanceCount;
+        commands[drawIndex * 2u + 1u].firstInstance = first;
+        target = first + atomicAdd(commands[drawIndex * 2u + 1u].instanceCount, 1u);
+    }
+
+    visibleInstances[target] = instance;
+}
@@ -1,6 +1,14 @@
 #version 450
 
+// One camera-facing quad per particle, drawn as a 4 vertex strip per
+// instance in the order sorted back to front.
+
 layout(location = 0) out vec4 fragColor;
+// quad corner in [-1, 1]
+layout(location = 1) out vec2 fragCorner;
+layout(location = 2) out float fragDistance;
+// proj[2][2] and proj[3][2], to linearize the scene depth
+layout(location = 3) flat out vec2 fragDepthParams;
 
 layout(std140, set = 0, binding = 0) uniform UniformBufferGlobal {
     mat4 view;
@@ -17,11 +25,24 @@ layout(std430, set = 1, binding = 0) readonly buffer ParticleBuffer {
     Particle particles[];
 };
 
+// x = sort key, y = particle index
+layout(std430, set = 1, binding = 1) readonly buffer OrderBuffer {
+    uvec2 order[];
+};
+
 void main() {
-    Particle p = particles[gl_InstanceIndex];
+    Particle p = particles[order[gl_InstanceIndex].y];
+
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+
+    // expanded in view space, size is the world-space width
+    vec4 viewPosition = ubo.view * vec4(p.position, 1.0);
+    viewPosition.xy += corner * (p.size * 0.5);
 
-    gl_Position = ubo.proj * ubo.view * vec4(p.position, 1.0);
-    gl_PointSize = p.size;
+    gl_Position = ubo.proj * viewPosition;
 
     fragColor = p.color;
-}
\ No newline at end of file
+    fragCorner = corner;
+    fragDistance = -viewPosition.z;
+    fragDepthParams = vec2(ubo.proj[2][2], ubo.proj[3][2]);
+}
@@ -0,0 +1,145 @@
+#version 450
+
+// Spawns this frame's particles of every emitter into free pool slots and
+// appends them to the next alive list and the draw buffer.
+
+layout(local_size_x = 64) in;
+
+struct Particle {
+    vec4 positionAge;       // xyz = position, w = age
+    vec4 velocityLifetime;  // xyz = velocity, w = lifetime
+    vec4 accelerationDrag;  // xyz = acceleration, w = drag
+    uint colorStart;        // packUnorm4x8
+    uint colorEnd;
+    float sizeStart;
+    float sizeEnd;
+};
+
+struct DrawParticle {
+    vec4 positionSize;
+    vec4 color;
+};
+
+struct Emitter {
+    vec4 positionRadius;    // xyz = origin, w = spawn sphere radius
+    vec4 velocitySpread;    // xyz = velocity, w = random spread
+    vec4 accelerationDrag;
+    vec4 colorStart;
+    vec4 colorEnd;
+    vec4 sizeLifetime;      // x = start size, y = end size, z = lifetime, w = lifetime spread
+    uint firstSpawn;
+    uint spawnCount;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, set = 0, binding = 0) buffer ParticleState {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    int deadCount;
+    uint freshCount;
+    uint aliveCount[2];
+    // VkDispatchIndirectCommand of the sort, one group per 512 keys
+    uint sortDispatchX;
+    uint sortDispatchY;
+    uint sortDispatchZ;
+    uint sortCount;
+} state;
+
+layout(std430, set = 0, binding = 1) buffer ParticlePool {
+    Particle particles[];
+};
+
+layout(std430, set = 0, binding = 2) buffer AliveList {
+    uint alive[];
+};
+
+layout(std430, set = 0, binding = 3) buffer DeadList {
+    uint dead[];
+};
+
+layout(std430, set = 0, binding = 4) writeonly buffer DrawBuffer {
+    DrawParticle draw[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer EmitterBuffer {
+    Emitter emitters[];
+};
+
+layout(push_constant) uniform Push {
+    float deltaTime;
+    uint current;
+    uint capacity;
+    uint emitterCount;
+    uint spawnTotal;
+    uint seed;
+} push;
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// [-1, 1)
+float random(inout uint state) {
+    state = hash(state);
+    return float(state >> 8) * (2.0 / 16777216.0) - 1.0;
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= push.spawnTotal)
+        return;
+
+    uint e = 0;
+    while (e + 1 < push.emitterCount && id >= emitters[e].firstSpawn + emitters[e].spawnCount)
+        e++;
+    Emitter emitter = emitters[e];
+
+    // a recycled slot, else one never used, else the pool is full
+    uint index;
+    int deadSlot = atomicAdd(state.deadCount, -1) - 1;
+    if (deadSlot >= 0) {
+        index = dead[deadSlot];
+    } else {
+        atomicAdd(state.deadCount, 1);
+        if (state.freshCount >= push.capacity)
+            return;
+        index = atomicAdd(state.freshCount, 1u);
+        if (index >= push.capacity)
+            return;
+    }
+
+    uint rng = hash(id ^ hash(push.seed));
+    vec3 offset = vec3(random(rng), random(rng), random(rng));
+    vec3 jitter = vec3(random(rng), random(rng), random(rng));
+
+    Particle p;
+    p.positionAge = vec4(emitter.positionRadius.xyz + offset * emitter.positionRadius.w, 0.0);
+    p.velocityLifetime = vec4(
+        emitter.velocitySpread.xyz + jitter * emitter.velocitySpread.w,
+        max(0.001, emitter.sizeLifetime.z + random(rng) * emitter.sizeLifetime.w)
+    );
+    p.accelerationDrag = emitter.accelerationDrag;
+    p.colorStart = packUnorm4x8(emitter.colorStart);
+    p.colorEnd = packUnorm4x8(emitter.colorEnd);
+    p.sizeStart = emitter.sizeLifetime.x;
+    p.sizeEnd = emitter.sizeLifetime.y;
+    particles[index] = p;
+
+    uint next = 1u - push.current;
+    uint slot = atomicAdd(state.aliveCount[next], 1u);
+    alive[next * push.capacity + slot] = index;
+
+    draw[slot].positionSize = vec4(p.positionAge.xyz, p.sizeStart);
+    draw[slot].color = emitter.colorStart;
+}
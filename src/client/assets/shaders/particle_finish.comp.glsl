@@ -0,0 +1,60 @@
+#version 450
+
+// Single invocation: turns the next alive count into the indirect draw and
+// sort dispatch of this frame and the simulate dispatch of the next one.
+
+layout(local_size_x = 1) in;
+
+layout(std430, set = 0, binding = 0) buffer ParticleState {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    int deadCount;
+    uint freshCount;
+    uint aliveCount[2];
+    // VkDispatchIndirectCommand of the sort, one group per 512 keys
+    uint sortDispatchX;
+    uint sortDispatchY;
+    uint sortDispatchZ;
+    uint sortCount;
+} state;
+
+layout(push_constant) uniform Push {
+    float deltaTime;
+    uint current;
+    uint capacity;
+    uint emitterCount;
+    uint spawnTotal;
+    uint seed;
+} push;
+
+void main() {
+    uint next = 1u - push.current;
+    uint count = state.aliveCount[next];
+
+    // one quad per particle, the vertex shader reads the sorted order by instance
+    state.vertexCount = 4u;
+    state.instanceCount = count;
+    state.firstVertex = 0u;
+    state.firstInstance = 0u;
+
+    state.dispatchX = (count + 63u) / 64u;
+    state.dispatchY = 1u;
+    state.dispatchZ = 1u;
+
+    // bitonic sort over the next power of two, at least one 512 key block
+    uint sortCount = 512u;
+    while (sortCount < count)
+        sortCount <<= 1;
+    state.sortCount = sortCount;
+    state.sortDispatchX = count == 0u ? 0u : sortCount / 512u;
+    state.sortDispatchY = 1u;
+    state.sortDispatchZ = 1u;
+
+    // the list read this frame is written next frame
+    state.aliveCount[push.current] = 0u;
+}
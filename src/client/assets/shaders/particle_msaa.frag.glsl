@@ -0,0 +1,25 @@
+#version 450
+
+// particle.frag.glsl for a multisampled depth buffer, the fade reads sample 0.
+
+// view distance over which a particle fades into the geometry behind it
+#define SOFT_DISTANCE 0.25
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragCorner;
+layout(location = 2) in float fragDistance;
+layout(location = 3) flat in vec2 fragDepthParams;
+
+layout(location = 0) out vec4 outColor;
+
+layout(input_attachment_index = 0, set = 2, binding = 0) uniform subpassInputMS sceneDepth;
+
+void main() {
+    float depth = subpassLoad(sceneDepth, 0).r;
+    float sceneDistance = fragDepthParams.y / (depth + fragDepthParams.x);
+
+    float fade = clamp((sceneDistance - fragDistance) / SOFT_DISTANCE, 0.0, 1.0);
+    float shape = clamp(1.0 - dot(fragCorner, fragCorner), 0.0, 1.0);
+
+    outColor = fragColor * (fade * shape);
+}
@@ -0,0 +1,96 @@
+#version 450
+
+// Ages and moves every alive particle. Survivors are appended to the other
+// alive list and to the draw buffer, dead ones go back to the dead list.
+
+layout(local_size_x = 64) in;
+
+struct Particle {
+    vec4 positionAge;       // xyz = position, w = age
+    vec4 velocityLifetime;  // xyz = velocity, w = lifetime
+    vec4 accelerationDrag;  // xyz = acceleration, w = drag
+    uint colorStart;        // packUnorm4x8
+    uint colorEnd;
+    float sizeStart;
+    float sizeEnd;
+};
+
+struct DrawParticle {
+    vec4 positionSize;
+    vec4 color;
+};
+
+layout(std430, set = 0, binding = 0) buffer ParticleState {
+    // VkDrawIndirectCommand
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    // VkDispatchIndirectCommand of this pass
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    int deadCount;
+    // slots never used yet, handed out once the dead list is empty
+    uint freshCount;
+    uint aliveCount[2];
+    // VkDispatchIndirectCommand of the sort, one group per 512 keys
+    uint sortDispatchX;
+    uint sortDispatchY;
+    uint sortDispatchZ;
+    uint sortCount;
+} state;
+
+layout(std430, set = 0, binding = 1) buffer ParticlePool {
+    Particle particles[];
+};
+
+// two lists of capacity entries, current and next
+layout(std430, set = 0, binding = 2) buffer AliveList {
+    uint alive[];
+};
+
+layout(std430, set = 0, binding = 3) buffer DeadList {
+    uint dead[];
+};
+
+layout(std430, set = 0, binding = 4) writeonly buffer DrawBuffer {
+    DrawParticle draw[];
+};
+
+layout(push_constant) uniform Push {
+    float deltaTime;
+    uint current;
+    uint capacity;
+    uint emitterCount;
+    uint spawnTotal;
+    uint seed;
+} push;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= state.aliveCount[push.current])
+        return;
+
+    uint index = alive[push.current * push.capacity + id];
+    Particle p = particles[index];
+
+    p.positionAge.w += push.deltaTime;
+    if (p.positionAge.w >= p.velocityLifetime.w) {
+        dead[atomicAdd(state.deadCount, 1)] = index;
+        return;
+    }
+
+    p.velocityLifetime.xyz += p.accelerationDrag.xyz * push.deltaTime;
+    p.velocityLifetime.xyz *= max(0.0, 1.0 - p.accelerationDrag.w * push.deltaTime);
+    p.positionAge.xyz += p.velocityLifetime.xyz * push.deltaTime;
+    particles[index] = p;
+
+    uint next = 1u - push.current;
+    uint slot = atomicAdd(state.aliveCount[next], 1u);
+    alive[next * push.capacity + slot] = index;
+
+    float t = p.positionAge.w / p.velocityLifetime.w;
+    draw[slot].positionSize = vec4(p.positionAge.xyz, mix(p.sizeStart, p.sizeEnd, t));
+    draw[slot].color = mix(unpackUnorm4x8(p.colorStart), unpackUnorm4x8(p.colorEnd), t);
+}
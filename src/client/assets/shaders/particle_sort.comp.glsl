@@ -0,0 +1,122 @@
+#version 450
+
+// Bitonic sort of the draw order by view depth, farthest first. Each group
+// owns a block of 512 (key, index) pairs:
+// - k == 0: builds the keys of its block from the draw buffer and sorts
+//   it in shared memory,
+// - j >= 512: one compare-exchange step across blocks, in place,
+// - otherwise: finishes merge k from j down to 1 in shared memory.
+// Directions follow the global index, so the blocks merge into one
+// ascending sequence.
+
+#define BLOCK 512u
+
+layout(local_size_x = 256) in;
+
+struct DrawParticle {
+    vec4 positionSize;
+    vec4 color;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ParticleState {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint dispatchX;
+    uint dispatchY;
+    uint dispatchZ;
+    int deadCount;
+    uint freshCount;
+    uint aliveCount[2];
+    uint sortDispatchX;
+    uint sortDispatchY;
+    uint sortDispatchZ;
+    uint sortCount;
+} state;
+
+layout(std430, set = 0, binding = 4) readonly buffer DrawBuffer {
+    DrawParticle draw[];
+};
+
+// x = key, y = draw buffer index
+layout(std430, set = 0, binding = 6) buffer SortBuffer {
+    uvec2 pairs[];
+};
+
+layout(push_constant) uniform Push {
+    // third row of the view matrix, negated: dot gives the view depth
+    vec4 viewDepthRow;
+    uint k;
+    uint j;
+} push;
+
+shared uvec2 block[BLOCK];
+
+uvec2 makePair(uint index) {
+    // padding sorts behind every particle and is never drawn
+    if (index >= state.instanceCount)
+        return uvec2(0xFFFFFFFFu, index);
+
+    float depth = dot(push.viewDepthRow, vec4(draw[index].positionSize.xyz, 1.0));
+    // positive floats order like their bits, inverted for farthest first
+    return uvec2(~floatBitsToUint(max(depth, 1e-6)), index);
+}
+
+void compareExchange(inout uvec2 a, inout uvec2 b, bool ascending) {
+    if ((a.x > b.x) == ascending) {
+        uvec2 t = a;
+        a = b;
+        b = t;
+    }
+}
+
+// steps j..1 of merge k on the shared block
+void mergeLocal(uint base, uint k, uint j) {
+    uint t = gl_LocalInvocationID.x;
+    for (; j > 0u; j >>= 1) {
+        uint i = 2u * j * (t / j) + t % j;
+        compareExchange(block[i], block[i + j], ((base + i) & k) == 0u);
+        barrier();
+    }
+}
+
+void main() {
+    // steps beyond this frame's count, the dispatch itself is indirect
+    if (push.k > state.sortCount)
+        return;
+
+    uint t = gl_LocalInvocationID.x;
+
+    if (push.j >= BLOCK) {
+        uint id = gl_GlobalInvocationID.x;
+        uint i = 2u * push.j * (id / push.j) + id % push.j;
+        uvec2 a = pairs[i];
+        uvec2 b = pairs[i + push.j];
+        compareExchange(a, b, (i & push.k) == 0u);
+        pairs[i] = a;
+        pairs[i + push.j] = b;
+        return;
+    }
+
+    uint base = gl_WorkGroupID.x * BLOCK;
+
+    if (push.k == 0u) {
+        block[t] = makePair(base + t);
+        block[t + 256u] = makePair(base + t + 256u);
+    } else {
+        block[t] = pairs[base + t];
+        block[t + 256u] = pairs[base + t + 256u];
+    }
+    barrier();
+
+    if (push.k == 0u) {
+        for (uint k = 2u; k <= BLOCK; k <<= 1)
+            mergeLocal(base, k, k >> 1);
+    } else {
+        mergeLocal(base, push.k, push.j);
+    }
+
+    pairs[base + t] = block[t];
+    pairs[base + t + 256u] = block[t + 256u];
+}
@@ -0,0 +1,36 @@
+#version 450
+
+// positions only, from the tightly packed stream of the mesh
+layout(location = 0) in vec3 inPosition;
+
+// cascade drawn, pushed by CascadedShadowMaps before its draws
+layout(push_constant) uniform Push {
+    uint cascade;
+} push;
+
+// mirrors CascadedShadowMaps::GpuShadowData
+layout(std140, set = 0, binding = 4) uniform ShadowData {
+    mat4 cascadeViewProj[4];
+    vec4 cascadeSplits;
+    vec4 cascadeTexelSizes;
+    vec4 sunDirection;
+    vec4 sunColor;
+} shadow;
+
+// mirrors InstanceData
+struct Instance {
+    mat4 model;
+    vec4 uvTransform;
+    uint materialIndex;
+    uint paramsIndex;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer {
+    Instance instances[];
+} instanceData;
+
+void main() {
+    mat4 model = instanceData.instances[gl_InstanceIndex].model;
+
+    gl_Position = shadow.cascadeViewProj[push.cascade] * model * vec4(inPosition, 1.0);
+}
\ No newline at end of file
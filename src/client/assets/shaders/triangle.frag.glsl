@@ -2,12 +2,156 @@
 
 layout(set = 1, binding = 0) uniform sampler2D texSampler;
 
+// MaterialDesc::Feature bits, set per pipeline so unused paths compile out
+layout(constant_id = 0) const uint MATERIAL_FEATURES = 0u;
+const uint FEATURE_ALPHA_TEST = 1u;
+const uint FEATURE_EMISSIVE = 2u;
+
+// mirrors MaterialParams
+struct MaterialParams {
+    vec4 baseColor;
+    vec4 emissive;
+    float alphaCutoff;
+};
+
+layout(std430, set = 3, binding = 0) readonly buffer MaterialParamsBuffer {
+    MaterialParams params[];
+} materialParams;
+
+// mirrors ClusteredLighting
+const uvec3 CLUSTER_GRID = uvec3(16u, 9u, 24u);
+const uint MAX_LIGHTS_PER_CLUSTER = 128u;
+const uint LIGHT_SPOT = 1u;
+
+layout(std140, set = 0, binding = 0) uniform UniformBufferGlobal {
+    mat4 view;
+    mat4 proj;
+    vec4 ambient;
+    float zNear;
+    float zFar;
+} ubo;
+
+// mirrors ClusteredLighting::GpuLight
+struct Light {
+    vec4 positionRange;
+    vec4 colorIntensity;
+    vec4 directionOuterCos;
+    float innerCos;
+    uint type;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+// written by light_cull.comp
+layout(std430, set = 0, binding = 2) readonly buffer ClusterGrid {
+    uint clusterLightCounts[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer ClusterLightIndices {
+    uint clusterLightIndices[];
+};
+
+// mirrors CascadedShadowMaps::GpuShadowData
+const uint SHADOW_CASCADES = 4u;
+
+layout(std140, set = 0, binding = 4) uniform ShadowData {
+    mat4 cascadeViewProj[SHADOW_CASCADES];
+    vec4 cascadeSplits;
+    vec4 cascadeTexelSizes;
+    vec4 sunDirection;
+    vec4 sunColor;
+} shadow;
+
+layout(set = 0, binding = 5) uniform sampler2DArrayShadow shadowMap;
+
 layout(location = 0) in vec4 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 3) flat in uint fragParamsIndex;
+layout(location = 4) in vec3 fragWorldPosition;
+layout(location = 5) in vec3 fragNormal;
 
 layout(location = 0) out vec4 outColor;
 
+// ambient plus the diffuse light of every light assigned to the cluster of the fragment
+vec3 clusteredLighting(vec3 position, vec3 normal) {
+    vec4 viewPosition = ubo.view * vec4(position, 1.0);
+    vec4 clip = ubo.proj * viewPosition;
+    vec2 tile = (clip.xy / clip.w * 0.5 + 0.5) * vec2(CLUSTER_GRID.xy);
+    float slice = log(-viewPosition.z / ubo.zNear) / log(ubo.zFar / ubo.zNear) * float(CLUSTER_GRID.z);
+    uvec3 cell = uvec3(clamp(vec3(tile, slice), vec3(0.0), vec3(CLUSTER_GRID) - 1.0));
+    uint cluster = cell.x + CLUSTER_GRID.x * (cell.y + CLUSTER_GRID.y * cell.z);
+
+    vec3 lit = ubo.ambient.rgb;
+    uint count = clusterLightCounts[cluster];
+    for (uint i = 0u; i < count; i++) {
+        Light light = lights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+
+        vec3 toLight = light.positionRange.xyz - position;
+        float distanceSq = dot(toLight, toLight);
+        float rangeSq = light.positionRange.w * light.positionRange.w;
+        if (distanceSq >= rangeSq)
+            continue;
+
+        vec3 direction = toLight * inversesqrt(max(distanceSq, 1e-8));
+        // inverse square, windowed to reach zero at the range
+        float window = clamp(1.0 - (distanceSq * distanceSq) / (rangeSq * rangeSq), 0.0, 1.0);
+        float attenuation = window * window / (distanceSq + 1.0);
+        if (light.type == LIGHT_SPOT)
+            attenuation *= smoothstep(light.directionOuterCos.w, light.innerCos, dot(-direction, light.directionOuterCos.xyz));
+
+        lit += light.colorIntensity.rgb * light.colorIntensity.a * attenuation * max(dot(normal, direction), 0.0);
+    }
+    return lit;
+}
+
+// fraction of the sun reaching the fragment, 3x3 comparisons in the cascade covering its view depth
+float sunVisibility(vec3 position, vec3 normal) {
+    float depth = -(ubo.view * vec4(position, 1.0)).z;
+    uint cascade = 0u;
+    while (cascade < SHADOW_CASCADES && depth > shadow.cascadeSplits[cascade])
+        cascade++;
+    if (cascade == SHADOW_CASCADES)
+        return 1.0;
+
+    // pushed off the surface by its texel size, against acne on surfaces facing away from the sun
+    vec3 offsetPosition = position + normal * shadow.cascadeTexelSizes[cascade] * 1.5;
+    vec4 clip = shadow.cascadeViewProj[cascade] * vec4(offsetPosition, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    vec2 uv = ndc.xy * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+
+    float visibility = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++)
+            visibility += texture(shadowMap, vec4(uv + vec2(x, y) * texel, float(cascade), ndc.z));
+    }
+    return visibility / 9.0;
+}
+
+vec3 sunLighting(vec3 position, vec3 normal) {
+    float diffuse = max(dot(normal, shadow.sunDirection.xyz), 0.0);
+    if (diffuse <= 0.0)
+        return vec3(0.0);
+    return shadow.sunColor.rgb * diffuse * sunVisibility(position, normal);
+}
+
 void main() {
+    MaterialParams material = materialParams.params[fragParamsIndex];
+
     vec4 texColor = texture(texSampler, fragTexCoord);
-    outColor = texColor * fragColor;
+    outColor = texColor * fragColor * material.baseColor;
+
+    // a discard anywhere in the shader can disable early depth testing
+    if ((MATERIAL_FEATURES & FEATURE_ALPHA_TEST) != 0u && outColor.a < material.alphaCutoff)
+        discard;
+
+    vec3 normal = normalize(fragNormal);
+    outColor.rgb *= clusteredLighting(fragWorldPosition, normal) + sunLighting(fragWorldPosition, normal);
+
+    if ((MATERIAL_FEATURES & FEATURE_EMISSIVE) != 0u)
+        outColor.rgb += material.emissive.rgb * material.emissive.a;
 }
@@ -3,23 +3,45 @@
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec4 inColor;
 layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inNormal;
 
 layout(location = 0) out vec4 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterialIndex;
+layout(location = 3) flat out uint fragParamsIndex;
+layout(location = 4) out vec3 fragWorldPosition;
+layout(location = 5) out vec3 fragNormal;
+
+// matches depth_prepass.vert, whose depth the pre-pass leaves for an EQUAL test
+invariant gl_Position;
 
 layout(std140, set = 0, binding = 0) uniform UniformBufferGlobal {
     mat4 view;
     mat4 proj;
 } ubo;
 
+// mirrors InstanceData
+struct Instance {
+    mat4 model;
+    vec4 uvTransform;
+    uint materialIndex;
+    uint paramsIndex;
+};
+
 layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer {
-    mat4 models[];
+    Instance instances[];
 } instanceData;
 
 void main() {
-    mat4 model = instanceData.models[gl_InstanceIndex];
+    Instance instance = instanceData.instances[gl_InstanceIndex];
+    mat4 model = instance.model;
 
     gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+    fragWorldPosition = (model * vec4(inPosition, 1.0)).xyz;
+    // inverse transpose, instances may be scaled unevenly
+    fragNormal = transpose(inverse(mat3(model))) * inNormal;
     fragColor = inColor;
-    fragTexCoord = inTexCoord;
+    fragTexCoord = inTexCoord * instance.uvTransform.xy + instance.uvTransform.zw;
+    fragMaterialIndex = instance.materialIndex;
+    fragParamsIndex = instance.paramsIndex;
 }
@@ -2,54 +2,78 @@
 #include "material/Material.hpp"
 #include "mesh/Mesh.hpp"
 #include "instance/RenderInstance.hpp"
+#include "../debug/DebugDraw.hpp"
 
-//* BatchKey
-bool RenderBatchManager::BatchKey::operator==(
-    const RenderBatchManager::BatchKey& other
-) const {
-    return mesh == other.mesh && material == other.material;
-}
-
-bool RenderBatchManager::BatchKey::operator<(
-    const RenderBatchManager::BatchKey& other
-) const {
-    if (mesh.get() != other.mesh.get())
-        return mesh.get() < other.mesh.get();
-
-    return material.get() < other.material.get();
-}
+#include <algorithm>
 
 //* RenderBatch
 RenderBatchManager::RenderBatch::RenderBatch(
-    BatchKey batchKey
+    BatchKey batchKey,
+    std::shared_ptr<Mesh> mesh,
+    std::shared_ptr<Material> material
 ) :
-    batchKey(batchKey)
+    batchKey(batchKey),
+    mesh(std::move(mesh)),
+    material(std::move(material))
 {}
 
 RenderBatchManager::RenderBatch::RenderBatch(
     RenderBatch&& other
 ) noexcept :
-    batchKey(std::move(other.batchKey)),
+    manager(other.manager),
+    batchKey(other.batchKey),
+    mesh(std::move(other.mesh)),
+    material(std::move(other.material)),
+    drawMesh(other.drawMesh),
+    drawMaterial(other.drawMaterial),
+    drawTextureIndex(other.drawTextureIndex),
     instances(std::move(other.instances)),
-    instancesData(std::move(other.instancesData))
+    instancesData(std::move(other.instancesData)),
+    textureLevel(other.textureLevel),
+    sweepTextureLevel(other.sweepTextureLevel)
 {}
 
 RenderBatchManager::RenderBatch& RenderBatchManager::RenderBatch::operator=(
     RenderBatch&& other
 ) noexcept {
     if (this != &other) {
-        batchKey = std::move(other.batchKey);
+        manager = other.manager;
+        batchKey = other.batchKey;
+        mesh = std::move(other.mesh);
+        material = std::move(other.material);
+        drawMesh = other.drawMesh;
+        drawMaterial = other.drawMaterial;
+        drawTextureIndex = other.drawTextureIndex;
         instances = std::move(other.instances);
         instancesData = std::move(other.instancesData);
+        textureLevel = other.textureLevel;
+        sweepTextureLevel = other.sweepTextureLevel;
     }
     return *this;
 }
 
+void RenderBatchManager::RenderBatch::setDrawAssets(
+    Mesh* mesh,
+    Material* material
+) {
+    drawMesh = mesh;
+    drawMaterial = material;
+
+    const uint32_t materialIndex = material ? material->getTextureIndex() : 0;
+    const uint32_t paramsIndex = material ? material->getParamsIndex() : 0;
+    drawTextureIndex = materialIndex;
+    for (InstanceData& data : instancesData)
+    {
+        data.materialIndex = materialIndex;
+        data.paramsIndex = paramsIndex;
+    }
+}
+
 bool RenderBatchManager::RenderBatch::isEquivalent(
-    const std::shared_ptr<Mesh>& mesh,
-    const std::shared_ptr<Material>& material
+    AssetId meshId,
+    AssetId materialId
 ) const {
-    return batchKey.mesh == mesh && batchKey.material == material;
+    return batchKey.meshId == meshId && batchKey.materialId == materialId;
 }
 
 void RenderBatchManager::RenderBatch::addInstance(
@@ -61,6 +85,8 @@ void RenderBatchManager::RenderBatch::addInstance(
 
     instances.push_back(instance);
     instancesData.emplace_back();
+    instancesData.back().materialIndex = drawMaterial ? drawMaterial->getTextureIndex() : 0;
+    instancesData.back().paramsIndex = drawMaterial ? drawMaterial->getParamsIndex() : 0;
     instance->updateModelMatrix();
 }
 
@@ -96,8 +122,9 @@ void RenderBatchManager::findBatchKey(
     const std::string& texturePath,
     BatchKey& key
 ) {
-    key.mesh = resourceManager->getMesh(meshPath);
-    key.material = resourceManager->getMaterial(texturePath);
+    key.meshId = resourceManager->getMeshId(meshPath);
+    key.materialId = resourceManager->getMaterialId(texturePath);
+    key.lod = 0;
 }
 
 RenderBatchManager::BatchKey RenderBatchManager::findBatchKey(
@@ -105,32 +132,78 @@ RenderBatchManager::BatchKey RenderBatchManager::findBatchKey(
     const std::string& texturePath
 ) {
     BatchKey key;
-    key.mesh = resourceManager->getMesh(meshPath);
-    key.material = resourceManager->getMaterial(texturePath);
+    findBatchKey(meshPath, texturePath, key);
     return key;
 }
 
+void RenderBatchManager::findBatchKey(
+    const std::string& meshPath,
+    const std::string& texturePath,
+    BatchKey& key,
+    glm::vec4& uvTransform
+) {
+    findBatchKey(meshPath, texturePath, key);
+    uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+
+    AssetId atlasId;
+    TextureAtlas::Region region;
+    if (resourceManager->findAtlasTile(key.materialId, atlasId, region))
+    {
+        key.materialId = atlasId;
+        uvTransform = glm::vec4(region.scaleX, region.scaleY, region.offsetX, region.offsetY);
+    }
+}
+
 void RenderBatchManager::addInstance(
     const BatchKey& key,
     RenderInstance* instance
 ) {
-    auto it = batches_map.find(key);
+    if (instance->isStatic())
+        staticGeneration++;
 
+    findOrCreateBatch(key)->addInstance(instance);
+}
+
+RenderBatchManager::RenderBatch* RenderBatchManager::findOrCreateBatch(
+    const BatchKey& key
+) {
+    auto it = batches_map.find(key);
     if (it != batches_map.end())
-    {
-        it->second->addInstance(instance);
-    }
-    else
-    {
-        auto batch = std::make_unique<RenderBatch>(key);
-        auto* batchPtr = batch.get();
+        return it->second.get();
+
+    // new batch: the only place ids are turned into asset references
+    auto batch = std::make_unique<RenderBatch>(
+        key,
+        resourceManager->requestMesh(key.meshId),
+        resourceManager->requestMaterial(key.materialId)
+    );
+    auto* batchPtr = batch.get();
+    batchPtr->manager = this;
+    resolveBatch(*batchPtr);
 
-        batches_map.emplace(key, std::move(batch));
+    batches_map.emplace(key, std::move(batch));
 
-        batchPtr->addInstance(instance);
+    if (!batchPtr->isResolved())
+        batches_pending.push_back(batchPtr);
 
-        batches_dirty = true;
+    batches_dirty = true;
+
+    return batchPtr;
+}
+
+void RenderBatchManager::eraseBatch(
+    RenderBatch* batch
+) {
+    auto pendingIt = std::find(batches_pending.begin(), batches_pending.end(), batch);
+    if (pendingIt != batches_pending.end())
+    {
+        *pendingIt = batches_pending.back();
+        batches_pending.pop_back();
     }
+
+    BatchKey key = batch->getKey();
+    batches_map.erase(key);
+    batches_dirty = true;
 }
 
 bool RenderBatchManager::removeInstance(
@@ -141,13 +214,13 @@ bool RenderBatchManager::removeInstance(
     if (!batch)
         return false;
 
+    if (instance->isStatic())
+        staticGeneration++;
+
     batch->removeInstance(instance);
 
     if (batch->empty())
-    {
-        batches_map.erase(batch->getKey());
-        batches_dirty = true;
-    }
+        eraseBatch(batch);
 
     return true;
 }
@@ -163,11 +236,32 @@ void RenderBatchManager::rebuildSortedBatches()
     for (auto& [key, batch] : batches_map)
         batches_sorted.push_back(batch.get());
 
+    // bindless materials need no rebind, so batches of one mesh LOD are
+    // kept adjacent and the command recorder merges them into one draw
+    const bool bindless = resourceManager->getBindlessTextures() != nullptr;
+
     std::sort(batches_sorted.begin(), batches_sorted.end(),
-        [](RenderBatch* a, RenderBatch* b)
+        [bindless](RenderBatch* a, RenderBatch* b)
         {
-            // defina aqui sua ordenação real
-            return a->getKey() < b->getKey();
+            // blended materials draw over everything opaque
+            if (a->getDrawMaterial()->isTransparent() != b->getDrawMaterial()->isTransparent())
+                return b->getDrawMaterial()->isTransparent();
+
+            // then one run per pipeline
+            if (a->getDrawMaterial()->getPipelineHash() != b->getDrawMaterial()->getPipelineHash())
+                return a->getDrawMaterial()->getPipelineHash() < b->getDrawMaterial()->getPipelineHash();
+
+            // group by drawn assets to minimize rebinds
+            if (a->getDrawMesh() != b->getDrawMesh())
+                return a->getDrawMesh() < b->getDrawMesh();
+
+            if (bindless && a->getKey().lod != b->getKey().lod)
+                return a->getKey().lod < b->getKey().lod;
+
+            if (a->getDrawMaterial() != b->getDrawMaterial())
+                return a->getDrawMaterial() < b->getDrawMaterial();
+
+            return a->getKey().lod < b->getKey().lod;
         });
 
     batches_dirty = false;
@@ -187,6 +281,330 @@ bool RenderBatchManager::moveInstance(
     return false;
 }
 
+bool RenderBatchManager::resolveBatch(
+    RenderBatch& batch
+) const {
+    Mesh* mesh = batch.getMesh()->isResident()
+        ? batch.getMesh().get()
+        : resourceManager->getPlaceholderMesh().get();
+
+    Material* material = batch.getMaterial()->isResident()
+        ? batch.getMaterial().get()
+        : resourceManager->getPlaceholderMaterial().get();
+
+    if (mesh == batch.getDrawMesh() && material == batch.getDrawMaterial())
+        return false;
+
+    batch.setDrawAssets(mesh, material);
+    return true;
+}
+
+void RenderBatchManager::update()
+{
+    for (size_t i = 0; i < batches_pending.size();)
+    {
+        RenderBatch* batch = batches_pending[i];
+
+        if (resolveBatch(*batch))
+        {
+            batches_dirty = true;
+
+            // the streamed mesh replaces the placeholder in cached shadows too
+            const auto& instances = batch->getRenderInstance();
+            if (std::any_of(instances.begin(), instances.end(), [](const RenderInstance* instance) { return instance->isStatic(); }))
+                staticGeneration++;
+        }
+
+        // failed assets keep their placeholder for good
+        Residency meshState = batch->getMesh()->getResidency();
+        Residency materialState = batch->getMaterial()->getResidency();
+        bool settled =
+            (meshState == Residency::Resident || meshState == Residency::Failed) &&
+            (materialState == Residency::Resident || materialState == Residency::Failed);
+
+        if (settled)
+        {
+            batches_pending[i] = batches_pending.back();
+            batches_pending.pop_back();
+            continue;
+        }
+
+        i++;
+    }
+
+    // mip streaming gives the material a new bindless slot, the old one is recycled
+    for (auto& [key, batch] : batches_map)
+    {
+        Material* material = batch->getDrawMaterial();
+        if (material && material->getTextureIndex() != batch->drawTextureIndex)
+            batch->setDrawAssets(batch->getDrawMesh(), material);
+    }
+}
+
+void RenderBatchManager::updateLods(
+    const LodSelectionParams& params
+) {
+    struct PendingMove {
+        RenderInstance* instance;
+        BatchKey key;
+    };
+    std::vector<PendingMove> moves;
+
+    const float refineThreshold = params.pixelErrorThreshold * (1.0f + params.hysteresis);
+    const float coarsenThreshold = params.pixelErrorThreshold * (1.0f - params.hysteresis);
+
+    // evaluates instances [first, last) of a batch
+    auto evaluate = [&](RenderBatch& batch, size_t first, size_t last)
+    {
+        // placeholders have a single LOD and no mip chain, so streaming batches only keep their key
+        const Mesh* mesh = batch.getDrawMesh();
+        const uint32_t lodCount = mesh->getLodCount();
+        const BatchKey& key = batch.getKey();
+
+        Material* material = batch.getMaterial().get();
+        if (material != batch.getDrawMaterial() || material->getLevelCount() <= 1)
+            material = nullptr;
+
+        if (first == 0)
+            batch.sweepTextureLevel = UINT32_MAX;
+
+        if (lodCount <= 1 && !material)
+            return;
+
+        const auto& instances = batch.getRenderInstance();
+        const auto& instancesData = batch.getinstancesData();
+
+        for (size_t i = first; i < last; i++)
+        {
+            const glm::mat4& model = instancesData[i].model;
+
+            glm::vec3 center = glm::vec3(model * glm::vec4(mesh->getBoundsCenter(), 1.0f));
+            float maxScale = std::max(
+                glm::length(glm::vec3(model[0])),
+                std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))
+            );
+
+            // distance to the sphere surface, clamped so the camera inside it keeps LOD 0
+            float distance = glm::length(center - params.cameraPosition) - mesh->getBoundsRadius() * maxScale;
+            float pixelsPerUnit = maxScale * params.projectionScale / std::max(distance, 1e-4f);
+
+            if (material)
+            {
+                // assume the UV range spans the bounding sphere: one texel per pixel across it
+                const glm::vec4& uvTransform = instancesData[i].uvTransform;
+                float texels = std::max(
+                    material->getWidth() * uvTransform.x,
+                    material->getHeight() * uvTransform.y
+                );
+                float pixels = std::max(2.0f * mesh->getBoundsRadius() * pixelsPerUnit, 1.0f);
+                float level = std::floor(std::log2(std::max(texels / pixels, 1.0f)));
+                batch.sweepTextureLevel = std::min(batch.sweepTextureLevel, static_cast<uint32_t>(level));
+            }
+
+            if (lodCount <= 1)
+                continue;
+
+            uint32_t lod = key.lod;
+
+            while (lod > 0 && mesh->getLod(lod).error * pixelsPerUnit > refineThreshold)
+                lod--;
+
+            while (lod + 1 < lodCount && mesh->getLod(lod + 1).error * pixelsPerUnit < coarsenThreshold)
+                lod++;
+
+            if (lod != key.lod)
+            {
+                BatchKey newKey = key;
+                newKey.lod = lod;
+                moves.push_back({instances[i], newKey});
+            }
+        }
+
+        // the sweep went through the whole batch
+        if (last == instances.size() && batch.sweepTextureLevel != UINT32_MAX)
+            batch.textureLevel = batch.sweepTextureLevel;
+    };
+
+    rebuildSortedBatches();
+
+    size_t total = 0;
+    for (RenderBatch* batch : batches_sorted)
+        total += batch->getRenderInstance().size();
+
+    if (total == 0)
+        return;
+
+    // the slice [lodCursor, lodCursor + budget), wrapping around the scene
+    if (lodCursor >= total)
+        lodCursor = 0;
+
+    const size_t budget = std::min<size_t>(std::max(params.instanceBudget, 1u), total);
+    const size_t sliceBegin = lodCursor;
+    const size_t sliceEnd = sliceBegin + budget;
+    lodCursor = sliceEnd % total;
+
+    size_t offset = 0;
+    for (RenderBatch* batch : batches_sorted)
+    {
+        const size_t count = batch->getRenderInstance().size();
+
+        size_t first = std::max(sliceBegin, offset);
+        size_t last = std::min(sliceEnd, offset + count);
+        if (first < last)
+            evaluate(*batch, first - offset, last - offset);
+
+        // wrapped part of the slice
+        if (sliceEnd > total)
+        {
+            first = offset;
+            last = std::min(sliceEnd - total, offset + count);
+            if (first < last)
+                evaluate(*batch, first - offset, last - offset);
+        }
+
+        offset += count;
+
+        // one request per material, from the finest level its last sweep needed
+        Material* material = batch->getMaterial().get();
+        if (material == batch->getDrawMaterial() && material->getLevelCount() > 1)
+            material->requestLevel(batch->textureLevel);
+    }
+
+    if (moves.empty())
+        return;
+
+    // one lookup per target batch; static instances switching LOD keep their cached shadows
+    std::sort(moves.begin(), moves.end(),
+        [](const PendingMove& a, const PendingMove& b) { return a.key < b.key; });
+
+    std::vector<RenderBatch*> sources;
+    sources.reserve(moves.size());
+
+    for (size_t i = 0; i < moves.size();)
+    {
+        RenderBatch* target = findOrCreateBatch(moves[i].key);
+
+        size_t end = i;
+        while (end < moves.size() && moves[end].key == moves[i].key)
+            end++;
+
+        target->instances.reserve(target->instances.size() + (end - i));
+        target->instancesData.reserve(target->instancesData.size() + (end - i));
+
+        for (; i < end; i++)
+        {
+            RenderInstance* instance = moves[i].instance;
+            sources.push_back(instance->ownerBatch);
+            instance->ownerBatch->removeInstance(instance);
+            target->addInstance(instance);
+        }
+    }
+
+    // sources emptied by the moves, each erased once
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    for (RenderBatch* source : sources)
+    {
+        if (source->empty())
+            eraseBatch(source);
+    }
+}
+
+uint32_t RenderBatchManager::cullInstances(
+    const RenderBatch& batch,
+    const glm::mat4& viewProjection,
+    Mobility mobility,
+    std::vector<InstanceData>& out
+) const {
+    // clip planes of the volume, rows of the matrix (0..1 depth: near is the third row alone)
+    const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    glm::vec4 planes[6] = {
+        row3 + row0,
+        row3 - row0,
+        row3 + row1,
+        row3 - row1,
+        row2,
+        row3 - row2
+    };
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    const Mesh* mesh = batch.getDrawMesh();
+    const auto& instances = batch.getRenderInstance();
+    const auto& instancesData = batch.getinstancesData();
+    uint32_t count = 0;
+
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        if ((mobility == Mobility::Static && !instances[i]->isStatic()) ||
+            (mobility == Mobility::Dynamic && instances[i]->isStatic()))
+            continue;
+
+        const glm::mat4& model = instancesData[i].model;
+
+        glm::vec3 center = glm::vec3(model * glm::vec4(mesh->getBoundsCenter(), 1.0f));
+        float maxScale = std::max(
+            glm::length(glm::vec3(model[0])),
+            std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))
+        );
+        float radius = mesh->getBoundsRadius() * maxScale;
+
+        bool inside = true;
+        for (const glm::vec4& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            {
+                inside = false;
+                break;
+            }
+        }
+
+        if (inside)
+        {
+            out.push_back(instancesData[i]);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void RenderBatchManager::drawDebugBounds(
+    DebugDraw& debugDraw
+) const {
+    static const glm::vec4 lodColors[] = {
+        {0.2f, 1.0f, 0.2f, 1.0f},
+        {0.8f, 1.0f, 0.2f, 1.0f},
+        {1.0f, 0.7f, 0.1f, 1.0f},
+        {1.0f, 0.2f, 0.1f, 1.0f}
+    };
+    const glm::vec4 placeholderColor(0.6f, 0.6f, 0.6f, 1.0f);
+
+    for (const auto& [key, batch] : batches_map)
+    {
+        const Mesh* mesh = batch->getDrawMesh();
+        const glm::vec4& color = batch->isResolved()
+            ? lodColors[std::min<size_t>(key.lod, std::size(lodColors) - 1)]
+            : placeholderColor;
+
+        for (const InstanceData& data : batch->getinstancesData())
+        {
+            // same world-space sphere updateLods measures
+            glm::vec3 center = glm::vec3(data.model * glm::vec4(mesh->getBoundsCenter(), 1.0f));
+            float maxScale = std::max(
+                glm::length(glm::vec3(data.model[0])),
+                std::max(glm::length(glm::vec3(data.model[1])), glm::length(glm::vec3(data.model[2])))
+            );
+
+            debugDraw.sphere(center, mesh->getBoundsRadius() * maxScale, color, 12);
+        }
+    }
+}
+
 RenderBatchManager::RenderBatchManager(
     ResourceManager* resourceManager
 ) :
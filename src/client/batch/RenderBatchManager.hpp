@@ -8,38 +8,123 @@
 class RenderInstance;
 class Mesh;
 class Material;
+class DebugDraw;
 
 class RenderBatchManager
 {
 public:
 
+    using AssetId = ResourceManager::AssetId;
+
+    /**
+     * @brief Identifies a batch by interned asset ids.
+     *
+     * Plain data: copying, comparing and hashing never touch strings or
+     * reference counts. Build it once per asset pair with findBatchKey
+     * and reuse it for every spawn.
+     */
     struct BatchKey
     {
-        std::shared_ptr<Mesh> mesh;
-        std::shared_ptr<Material> material;
+        AssetId meshId = AssetRegistry::InvalidId;
+        AssetId materialId = AssetRegistry::InvalidId;
+        uint32_t lod = 0;
 
-        bool operator==(const RenderBatchManager::BatchKey& other) const;
-        bool operator<(const RenderBatchManager::BatchKey& other) const;
+        bool operator==(const RenderBatchManager::BatchKey& other) const
+        {
+            return meshId == other.meshId && materialId == other.materialId && lod == other.lod;
+        }
+
+        bool operator<(const RenderBatchManager::BatchKey& other) const
+        {
+            if (meshId != other.meshId)
+                return meshId < other.meshId;
+
+            if (materialId != other.materialId)
+                return materialId < other.materialId;
+
+            return lod < other.lod;
+        }
     };
 
     struct BatchKeyHasher
     {
         size_t operator()(const BatchKey& key) const
         {
-            size_t h1 = std::hash<Mesh*>()(key.mesh.get());
-            size_t h2 = std::hash<Material*>()(key.material.get());
-            return h1 ^ (h2 << 1);
+            // 64-bit finalizer (murmur3 fmix64) over the packed ids
+            uint64_t h = (static_cast<uint64_t>(key.meshId) << 32) | key.materialId;
+            h ^= static_cast<uint64_t>(key.lod) * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
         }
     };
 
+    /**
+     * @brief Per-frame camera data used to pick a level of detail.
+     */
+    struct LodSelectionParams
+    {
+        /// World-space camera position
+        glm::vec3 cameraPosition;
+
+        /// Pixels per world unit at distance 1 (|proj[1][1]| * viewportHeight / 2)
+        float projectionScale;
+
+        /// Maximum projected geometric error, in pixels, before refining
+        float pixelErrorThreshold = 1.0f;
+
+        /// Relative band around the threshold that prevents LOD popping
+        float hysteresis = 0.2f;
+
+        /// Instances re-evaluated per call; the others keep their level until the sweep reaches them
+        uint32_t instanceBudget = 4096;
+    };
+
+    /**
+     * @brief Instances kept by cullInstances, by RenderInstance::isStatic.
+     */
+    enum class Mobility
+    {
+        Any,
+        Static,
+        Dynamic
+    };
+
+    /**
+     * @brief Group of instances sharing the same mesh, material and LOD.
+     *
+     * The batch owns the references to the assets its instances asked for.
+     * drawMesh / drawMaterial are the assets actually drawn; they point at
+     * the ResourceManager placeholders while an asset is still streaming.
+     * Every InstanceData carries the bindless texture and parameter slots of drawMaterial.
+     */
     class RenderBatch {
     private:
+        friend class RenderBatchManager;
+
+        RenderBatchManager* manager = nullptr;
         BatchKey batchKey;
+        std::shared_ptr<Mesh> mesh;
+        std::shared_ptr<Material> material;
+        Mesh* drawMesh = nullptr;
+        Material* drawMaterial = nullptr;
+        // bindless slot of drawMaterial written into instancesData, a restream moves the material to another
+        uint32_t drawTextureIndex = 0;
         std::vector<RenderInstance*> instances;
         std::vector<InstanceData> instancesData;
+
+        // finest mip level the instances needed over the last full updateLods sweep,
+        // full detail until the first sweep; the next value while a sweep is inside the batch
+        uint32_t textureLevel = 0;
+        uint32_t sweepTextureLevel = UINT32_MAX;
     public:
-        explicit RenderBatch(
-            BatchKey batchKey
+        RenderBatch(
+            BatchKey batchKey,
+            std::shared_ptr<Mesh> mesh,
+            std::shared_ptr<Material> material
         );
 
         ~RenderBatch();
@@ -62,9 +147,25 @@ public:
 
         const BatchKey& getKey() const { return batchKey; }
 
+        const std::shared_ptr<Mesh>& getMesh() const { return mesh; }
+        const std::shared_ptr<Material>& getMaterial() const { return material; }
+
+        Mesh* getDrawMesh() const { return drawMesh; }
+        Material* getDrawMaterial() const { return drawMaterial; }
+
+        /**
+         * @brief Sets the drawn assets and refreshes the bindless material index of every instance.
+         */
+        void setDrawAssets(
+            Mesh* mesh,
+            Material* material
+        );
+
+        bool isResolved() const { return drawMesh == mesh.get() && drawMaterial == material.get(); }
+
         bool isEquivalent(
-            const std::shared_ptr<Mesh>& mesh,
-            const std::shared_ptr<Material>& material
+            AssetId meshId,
+            AssetId materialId
         ) const;
 
         const std::vector<RenderInstance*>& getRenderInstance() const{ return instances; }
@@ -78,8 +179,40 @@ private:
     std::vector<RenderBatch*> batches_sorted;
     bool batches_dirty = false;
 
+    // batches still drawing a placeholder for at least one asset
+    std::vector<RenderBatch*> batches_pending;
+
     ResourceManager* resourceManager;
 
+    // bumped whenever the static geometry may have changed
+    uint64_t staticGeneration = 0;
+
+    // first instance, over batches_sorted, the next updateLods evaluates
+    size_t lodCursor = 0;
+
+    /**
+     * @brief Batch of a key, created and resolved if it does not exist yet.
+     */
+    RenderBatch* findOrCreateBatch(
+        const BatchKey& key
+    );
+
+    /**
+     * @brief Drops an empty batch from the map and the pending list.
+     */
+    void eraseBatch(
+        RenderBatch* batch
+    );
+
+    /**
+     * @brief Points the batch at placeholders for assets that are not resident yet.
+     *
+     * @return true if the drawn assets changed.
+     */
+    bool resolveBatch(
+        RenderBatch& batch
+    ) const;
+
 public:
     void addInstance(
         const BatchKey& batchKey,
@@ -95,6 +228,12 @@ public:
         RenderInstance* instance
     );
 
+    /**
+     * @brief Interns both paths into a BatchKey.
+     *
+     * Hashes the strings; cache the returned key when spawning many
+     * instances of the same asset pair.
+     */
     void findBatchKey(
         const std::string& meshPath,
         const std::string& texturePath,
@@ -106,6 +245,20 @@ public:
         const std::string& texturePath
     );
 
+    /**
+     * @brief Like findBatchKey, but redirects textures packed in an atlas.
+     *
+     * The key then names the atlas material, shared by every tile, and
+     * uvTransform selects the tile; store it in RenderInstance::uvTransform.
+     * Textures outside any atlas get the identity transform.
+     */
+    void findBatchKey(
+        const std::string& meshPath,
+        const std::string& texturePath,
+        BatchKey& key,
+        glm::vec4& uvTransform
+    );
+
     template<typename Func> void forEachBatch(Func&& func)
     {
         rebuildSortedBatches();
@@ -119,6 +272,82 @@ public:
 
     void rebuildSortedBatches();
 
+    /**
+     * @brief Swaps placeholders for assets that became resident since the last call.
+     *
+     * Instances keep their batch key; only the assets drawn change,
+     * so callers never observe the placeholder swap. Also points the
+     * instances of every batch at the new bindless slot of a material
+     * whose texture was restreamed; the old slot stays valid for the
+     * frames in flight. Call once per frame after
+     * ResourceManager::processUploads.
+     */
+    void update();
+
+    /**
+     * @brief Re-selects the level of detail of a slice of the instances.
+     *
+     * Evaluates params.instanceBudget instances per call, resuming where
+     * the previous call stopped, so the cost does not grow with the scene
+     * and every instance is revisited once per sweep.
+     *
+     * The object-space error of each LOD is projected to screen space
+     * using the instance bounding sphere distance to the camera. The
+     * coarsest level whose projected error stays under the threshold is
+     * chosen, with a hysteresis band so instances near a transition
+     * distance do not switch every frame. Instances whose LOD changes
+     * are moved to the batch of the new level, grouped by target batch.
+     *
+     * The same projection tells each resident material which mip level
+     * its instances need, for ResourceManager mip streaming. Each batch
+     * keeps the finest level of its last sweep and requests it once per
+     * call.
+     *
+     * @param params Camera data for the current frame.
+     */
+    void updateLods(
+        const LodSelectionParams& params
+    );
+
+    /**
+     * @brief Appends the instances of a batch whose bounding sphere touches a clip volume.
+     *
+     * The volume is the one of viewProjection with a 0..1 depth range, as
+     * the shadow cascades build; the spheres are the ones updateLods measures.
+     *
+     * @param mobility Instances considered, by RenderInstance::isStatic.
+     * @param out Receives the InstanceData of the instances inside.
+     *
+     * @return Number of instances appended.
+     */
+    uint32_t cullInstances(
+        const RenderBatch& batch,
+        const glm::mat4& viewProjection,
+        Mobility mobility,
+        std::vector<InstanceData>& out
+    ) const;
+
+    /**
+     * @brief Changes whenever static instances are added, removed, swap in their streamed assets or invalidateStatic is called.
+     *
+     * LOD switches keep it, a cached shadow of the other level is close enough.
+     */
+    uint64_t getStaticGeneration() const { return staticGeneration; }
+
+    /**
+     * @brief Marks the static geometry as changed, after editing a static instance in place.
+     */
+    void invalidateStatic() { staticGeneration++; }
+
+    /**
+     * @brief Draws the bounding sphere of every instance, colored by its level of detail.
+     *
+     * LOD 0 is green, coarser levels shift to red; placeholders are grey.
+     */
+    void drawDebugBounds(
+        DebugDraw& debugDraw
+    ) const;
+
     RenderBatchManager(ResourceManager* resourceManager);
     ~RenderBatchManager() = default;
 };
\ No newline at end of file
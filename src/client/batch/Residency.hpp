@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Streaming state of a GPU asset.
+ *
+ * Assets are handed out as soon as they are requested. Until they reach
+ * Resident the renderer draws a placeholder in their place.
+ */
+enum class Residency : uint8_t {
+    Requested, ///< Created, waiting for a worker
+    Loading,   ///< CPU stage running on a worker
+    Resident,  ///< GPU data uploaded, ready to draw
+    Evicted,   ///< GPU data released, must be requested again to draw
+    Failed     ///< Load failed, the placeholder is kept
+};
@@ -1,71 +1,1094 @@
 #include "ResourceManager.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "texture/MipGenerator.hpp"
+#include "texture/TextureAtlas.hpp"
+#include "texture/PixelConvert.hpp"
+
 ResourceManager::ResourceManager(
     VkPhysicalDevice physicalDevice,
     VkDevice device,
     BufferManager* bufferManager,
     VkDescriptorPool descriptorPool,
-    VkDescriptorSetLayout layout
+    VkDescriptorSetLayout layout,
+    BindlessTextureManager* bindlessTextures,
+    MaterialParameterBuffer* materialParameters,
+    SamplerCache* samplerCache,
+    JobSystem* jobSystem,
+    VkDeviceSize memoryBudget,
+    uint32_t framesInFlight
 ) :
     physicalDevice(physicalDevice),
     device(device),
     bufferManager(bufferManager),
     descriptorPool(descriptorPool),
-    layout(layout)
+    layout(layout),
+    bindlessTextures(bindlessTextures),
+    materialParameters(materialParameters),
+    samplerCache(samplerCache),
+    jobSystem(jobSystem),
+    memoryBudget(memoryBudget),
+    framesInFlight(framesInFlight)
 {
+    stagingRing = new StagingRing(bufferManager, device, stagingRingSize);
+    createPlaceholders();
 }
 
-std::shared_ptr<Mesh> ResourceManager::getMesh(
-    const std::string& meshPath
-) {
-    auto it = meshes.find(meshPath);
-
-    if (it != meshes.end())
+ResourceManager::~ResourceManager()
+{
+    std::vector<std::shared_ptr<PendingMesh>> meshJobs;
+    std::vector<std::shared_ptr<PendingMaterial>> materialJobs;
     {
-        if (auto mesh = it->second.lock())
-            return mesh;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& slot : meshSlots)
+            if (slot.pending) meshJobs.push_back(slot.pending);
+        for (auto& slot : materialSlots)
+            if (slot.pending) materialJobs.push_back(slot.pending);
     }
 
-    auto mesh = std::make_shared<Mesh>(
-        meshPath,
-        device,
-        bufferManager
-    );
-    meshes[meshPath] = mesh;
+    for (auto& pending : meshJobs)
+        jobSystem->wait(pending->counter);
+    for (auto& pending : materialJobs)
+        jobSystem->wait(pending->counter);
+    for (auto& stream : activeStreams)
+        jobSystem->wait(stream->counter);
 
-    return mesh;
-}
-
-std::shared_ptr<Material> ResourceManager::getMaterial(
-    const std::string& texturePath
-) {
-    auto it = materials.find(texturePath);
+    // in-flight copies still read their staging region and source texture
+    if (!restreams.empty())
+        vkDeviceWaitIdle(device);
+    for (PendingRestream& restream : restreams)
+        bufferManager->releaseAsync(restream.submit);
 
-    if (it != materials.end())
+    for (RetiredTexture& retiredTexture : retiredTextures)
     {
-        if (auto mat = it->second.lock())
-            return mat;
+        if (retiredTexture.resources.descriptorSet != VK_NULL_HANDLE)
+            vkFreeDescriptorSets(device, descriptorPool, 1, &retiredTexture.resources.descriptorSet);
     }
 
-    //TODO auto texture = getTexture(texturePath);
+    delete stagingRing;
+}
+
+void ResourceManager::createPlaceholders()
+{
+    placeholderMesh = std::make_shared<Mesh>(
+        Mesh::createCubeData(0.5f),
+        device,
+        bufferManager
+    );
 
+    // 1x1 light grey, close to the average albedo of most textures
+    const stbi_uc grey[4] = { 180, 180, 180, 255 };
     TextureImage::TextureImageDesc textureImageDesc = TextureImage::TextureImageDesc();
+    textureImageDesc.generateMipmaps = false;
+    textureImageDesc.samplerCache = samplerCache;
+
     std::shared_ptr<TextureImage> texture = std::make_shared<TextureImage>(
         physicalDevice,
         device,
-        texturePath,
+        TextureImage::LoadedImage::solidColor(1, 1, grey),
         bufferManager,
         textureImageDesc,
         &TextureImage::DefaultImageTransitionPolicy::instance()
     );
 
-    std::shared_ptr<Material> material = std::make_shared<Material>(
+    placeholderMaterial = std::make_shared<Material>(
+        device,
+        descriptorPool,
+        layout,
+        texture,
+        bindlessTextures,
+        materialParameters
+    );
+}
+
+void ResourceManager::resolveTexture(
+    AssetId materialId,
+    std::string& texturePath,
+    std::vector<std::string>& tiles,
+    uint32_t& tileSize
+) const {
+    AssetId textureId = materialId;
+
+    auto desc = materialDescs.find(materialId);
+    if (desc != materialDescs.end())
+        textureId = materialRegistry.find(desc->second.texturePath);
+
+    texturePath = materialRegistry.getPath(textureId);
+
+    auto atlas = atlases.find(textureId);
+    if (atlas != atlases.end())
+    {
+        tiles = atlas->second.tilePaths;
+        tileSize = atlas->second.tileSize;
+    }
+}
+
+bool ResourceManager::loadCookedTexture(
+    const std::string& texturePath,
+    TextureContainer& container,
+    uint32_t firstLevel,
+    uint32_t endLevel
+) const {
+    std::filesystem::path cooked;
+    for (const char* extension : {".ktx2", ".dds"})
+    {
+        std::filesystem::path candidate(texturePath);
+        candidate.replace_extension(extension);
+        if (std::filesystem::exists(candidate))
+        {
+            cooked = candidate;
+            break;
+        }
+    }
+
+    if (cooked.empty())
+        return false;
+
+    try {
+        container = TextureContainer::load(cooked.string(), firstLevel, endLevel);
+    } catch (const std::exception& e) {
+        std::cerr << "ignoring cooked texture " << cooked.string() << ": " << e.what() << std::endl;
+        return false;
+    }
+
+    // devices without textureCompressionBC report no features for BCn formats
+    bool supported = CoreVulkan::isFormatSupported(
+        physicalDevice,
+        static_cast<VkFormat>(container.format),
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+    );
+
+    if (!supported)
+    {
+        container = TextureContainer();
+        return false;
+    }
+
+    return true;
+}
+
+template<typename SlotT>
+SlotT& ResourceManager::slotAt(
+    std::vector<SlotT>& slots,
+    AssetId id
+) {
+    if (id >= slots.size())
+        slots.resize(static_cast<size_t>(id) + 1);
+    return slots[id];
+}
+
+std::shared_ptr<Mesh> ResourceManager::requestMesh(
+    AssetId meshId
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MeshSlot& slot = slotAt(meshSlots, meshId);
+
+    if (auto mesh = slot.asset.lock())
+    {
+        stats.hits++;
+        touch(slot);
+        return mesh;
+    }
+
+    stats.misses++;
+
+    auto pending = std::make_shared<PendingMesh>();
+    pending->id = meshId;
+    pending->mesh = std::make_shared<Mesh>();
+    slot.pending = pending;
+    slot.asset = pending->mesh;
+
+    jobSystem->submit(
+        [this, pending]()
+        {
+            pending->mesh->setResidency(Residency::Loading);
+            try {
+                pending->data = Mesh::loadData(meshRegistry.getPath(pending->id));
+            } catch (const std::exception& e) {
+                pending->error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decodedMeshes.push_back(pending);
+        },
+        &pending->counter
+    );
+
+    return pending->mesh;
+}
+
+std::shared_ptr<Material> ResourceManager::requestMaterial(
+    AssetId materialId
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MaterialSlot& slot = slotAt(materialSlots, materialId);
+
+    if (auto mat = slot.asset.lock())
+    {
+        stats.hits++;
+        touch(slot);
+        return mat;
+    }
+
+    stats.misses++;
+
+    auto pending = std::make_shared<PendingMaterial>();
+    pending->id = materialId;
+    pending->material = std::make_shared<Material>(
         device,
         descriptorPool,
         layout,
-        texture
+        bindlessTextures,
+        materialParameters
     );
 
-    materials[texturePath] = material;
+    auto desc = materialDescs.find(materialId);
+    if (desc != materialDescs.end())
+        pending->material->setDesc(desc->second);
+
+    resolveTexture(materialId, pending->texturePath, pending->atlasTiles, pending->atlasTileSize);
+
+    slot.pending = pending;
+    slot.asset = pending->material;
+
+    jobSystem->submit(
+        [this, pending]()
+        {
+            pending->material->setResidency(Residency::Loading);
+            try {
+                loadTextureContainer(
+                    pending->texturePath,
+                    pending->atlasTiles,
+                    pending->atlasTileSize,
+                    pending->container,
+                    &pending->staging
+                );
+            } catch (const std::exception& e) {
+                pending->error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decodedMaterials.push_back(pending);
+        },
+        &pending->counter
+    );
+
+    return pending->material;
+}
+
+void ResourceManager::loadTextureContainer(
+    const std::string& texturePath,
+    const std::vector<std::string>& atlasTiles,
+    uint32_t atlasTileSize,
+    TextureContainer& container,
+    StagingRing::Allocation* staging
+) {
+    if (!atlasTiles.empty())
+    {
+        std::vector<TextureImage::LoadedImage> images(atlasTiles.size());
+        std::vector<const uint8_t*> tiles;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            TextureImage::loadImageFromFile(atlasTiles[i], images[i]);
+            if (images[i].width != static_cast<int>(atlasTileSize) ||
+                images[i].height != static_cast<int>(atlasTileSize))
+                throw std::runtime_error("atlas tile " + atlasTiles[i] + " has the wrong size");
+            tiles.push_back(images[i].pixels);
+        }
+
+        container = TextureAtlas::build(tiles, atlasTileSize, true);
+    }
+    else if (!loadCookedTexture(texturePath, container))
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        TextureImage::LoadedImage image;
+        int channels;
+        TextureImage::decodeImageFromFile(texturePath, image, channels);
+
+        const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+        TextureContainer layout = MipGenerator::layout(
+            static_cast<uint32_t>(image.width),
+            static_cast<uint32_t>(image.height),
+            true
+        );
+
+        // level 0 stays in cached memory, the staging mapping is write-combined and only written
+        std::vector<uint8_t> expanded;
+        const uint8_t* level0 = image.pixels;
+        if (channels == 3)
+        {
+            expanded.resize(pixelCount * 4);
+            PixelConvert::rgbToRgba(image.pixels, expanded.data(), pixelCount);
+            level0 = expanded.data();
+        }
+
+        const std::chrono::duration<double> decodeTime = std::chrono::steady_clock::now() - start;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.decodedBytes += pixelCount * 4;
+            stats.decodeSeconds += decodeTime.count();
+        }
+
+        // the chain is written straight to its final place
+        uint8_t* chain;
+        if (staging && stagingRing->allocate(MipGenerator::chainSize(layout), *staging))
+        {
+            chain = staging->data;
+        }
+        else
+        {
+            layout.data.resize(static_cast<size_t>(MipGenerator::chainSize(layout)));
+            chain = layout.data.data();
+        }
+
+        MipGenerator::generateInto(level0, layout, chain);
+        container = std::move(layout);
+    }
+}
+
+std::shared_ptr<TextureImage> ResourceManager::uploadTexture(
+    const TextureContainer& container,
+    StagingRing::Allocation& staging,
+    uint32_t firstMip
+) {
+    TextureImage::TextureImageDesc textureImageDesc = TextureImage::TextureImageDesc();
+    textureImageDesc.samplerCache = samplerCache;
+    textureImageDesc.firstMip = firstMip;
+
+    std::shared_ptr<TextureImage> texture;
+    try {
+        if (staging.valid())
+        {
+            TextureImage::StagedTexture staged;
+            staged.buffer = stagingRing->getBuffer();
+            staged.offset = staging.offset;
+
+            texture = std::make_shared<TextureImage>(
+                physicalDevice,
+                device,
+                container,
+                staged,
+                bufferManager,
+                textureImageDesc,
+                &TextureImage::DefaultImageTransitionPolicy::instance()
+            );
+        }
+        else
+        {
+            texture = std::make_shared<TextureImage>(
+                physicalDevice,
+                device,
+                container,
+                bufferManager,
+                textureImageDesc,
+                &TextureImage::DefaultImageTransitionPolicy::instance()
+            );
+        }
+    } catch (...) {
+        stagingRing->free(staging);
+        throw;
+    }
+
+    // the copy was waited on, the region is free again
+    stagingRing->free(staging);
+    return texture;
+}
+
+void ResourceManager::loadStreamLevels(
+    PendingStream& stream
+) {
+    std::shared_ptr<const TextureContainer> chain;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        chain = findSourceChain(stream.texturePath);
+    }
+
+    // cooked files read the missing levels alone, decoded sources are kept for the next steps
+    TextureContainer levels;
+    if (!chain && (!stream.atlasTiles.empty() ||
+        !loadCookedTexture(stream.texturePath, levels, stream.level, stream.residentLevel)))
+    {
+        auto decoded = std::make_shared<TextureContainer>();
+        loadTextureContainer(stream.texturePath, stream.atlasTiles, stream.atlasTileSize, *decoded, nullptr);
+        chain = decoded;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        cacheSourceChain(stream.texturePath, chain);
+    }
+
+    const TextureContainer& source = chain ? *chain : levels;
+    if (stream.residentLevel > source.mips.size())
+        throw std::runtime_error("texture source changed while streaming");
+
+    // the missing levels are packed, rebase them to the staged bytes
+    const TextureContainer::Mip& last = source.mips[stream.residentLevel - 1];
+    const uint64_t begin = source.mips[stream.level].offset;
+    const uint64_t size = last.offset + last.size - begin;
+
+    stream.container.format = source.format;
+    stream.container.width = source.width;
+    stream.container.height = source.height;
+    stream.container.mips = source.mips;
+    for (uint32_t level = stream.level; level < stream.residentLevel; level++)
+        stream.container.mips[level].offset -= begin;
+
+    // with the ring full, staging stays invalid and the stream is retried later
+    if (stagingRing->allocate(size, stream.staging))
+        memcpy(stream.staging.data, source.data.data() + begin, static_cast<size_t>(size));
+}
+
+std::shared_ptr<const TextureContainer> ResourceManager::findSourceChain(
+    const std::string& texturePath
+) {
+    auto it = std::find_if(sourceChains.begin(), sourceChains.end(),
+        [&](const SourceChain& chain) { return chain.texturePath == texturePath; });
+
+    if (it == sourceChains.end())
+        return nullptr;
+
+    sourceChains.splice(sourceChains.begin(), sourceChains, it);
+    return it->container;
+}
+
+void ResourceManager::cacheSourceChain(
+    const std::string& texturePath,
+    std::shared_ptr<const TextureContainer> container
+) {
+    const VkDeviceSize size = container->totalSize();
+    if (size > sourceChainBudget)
+        return;
+
+    // another stream of the same source may have cached it meanwhile
+    if (findSourceChain(texturePath))
+        return;
+
+    sourceChains.push_front({texturePath, std::move(container)});
+    sourceChainBytes += size;
+
+    while (sourceChainBytes > sourceChainBudget)
+    {
+        sourceChainBytes -= sourceChains.back().container->totalSize();
+        sourceChains.pop_back();
+    }
+}
+
+uint32_t ResourceManager::tailLevel(
+    const Material& material
+) const {
+    uint32_t level = 0;
+    while (level + 1 < material.getLevelCount() &&
+        std::max(material.getWidth() >> level, material.getHeight() >> level) > streamingTailSize)
+        level++;
+    return level;
+}
+
+void ResourceManager::uploadMesh(
+    PendingMesh& pending
+) {
+    if (pending.error.empty())
+    {
+        try {
+            pending.mesh->upload(
+                pending.data,
+                device,
+                bufferManager
+            );
+        } catch (const std::exception& e) {
+            pending.error = e.what();
+        }
+    }
+
+    if (!pending.error.empty())
+    {
+        std::cerr << "failed to load mesh " << meshRegistry.getPath(pending.id) << ": " << pending.error << std::endl;
+        pending.mesh->setResidency(Residency::Failed);
+    }
+
+    // CPU copy is no longer needed once on the GPU
+    pending.data = Mesh::MeshData();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    MeshSlot& slot = meshSlots[pending.id];
+    slot.pending.reset();
+
+    if (pending.error.empty())
+    {
+        CacheEntry entry;
+        entry.id = pending.id;
+        entry.mesh = pending.mesh;
+        entry.size = pending.mesh->getGpuMemorySize();
+        retain(slot, std::move(entry));
+    }
+}
+
+void ResourceManager::uploadMaterial(
+    PendingMaterial& pending
+) {
+    if (pending.error.empty())
+    {
+        try {
+            // start from the mip tail, finer levels stream in on demand
+            pending.material->setMipChain(
+                static_cast<uint32_t>(pending.container.mips.size()),
+                pending.container.width,
+                pending.container.height
+            );
+
+            const uint32_t firstMip = tailLevel(*pending.material);
+            std::shared_ptr<TextureImage> texture = uploadTexture(pending.container, pending.staging, firstMip);
+
+            pending.material->setTexture(texture, firstMip);
+        } catch (const std::exception& e) {
+            pending.error = e.what();
+        }
+    }
+
+    if (!pending.error.empty())
+    {
+        std::cerr << "failed to load material " << materialRegistry.getPath(pending.id) << ": " << pending.error << std::endl;
+        pending.material->setResidency(Residency::Failed);
+    }
+
+    pending.container = TextureContainer();
+    stagingRing->free(pending.staging);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    MaterialSlot& slot = materialSlots[pending.id];
+    slot.pending.reset();
+
+    if (pending.error.empty())
+    {
+        CacheEntry entry;
+        entry.id = pending.id;
+        entry.material = pending.material;
+        entry.size = pending.material->getGpuMemorySize();
+        retain(slot, std::move(entry));
+    }
+}
+
+void ResourceManager::submitRestream(
+    AssetId id,
+    const std::shared_ptr<Material>& material,
+    uint32_t level,
+    const TextureContainer& layout,
+    StagingRing::Allocation& staging
+) {
+    TextureImage::TextureImageDesc textureImageDesc = TextureImage::TextureImageDesc();
+    textureImageDesc.samplerCache = samplerCache;
+    textureImageDesc.firstMip = level;
+
+    TextureImage::StagedTexture staged;
+    if (staging.valid())
+    {
+        staged.buffer = stagingRing->getBuffer();
+        staged.offset = staging.offset;
+    }
+
+    PendingRestream restream;
+    restream.id = id;
+    restream.material = material;
+    restream.source = material->getTexture();
+    restream.sourceLevel = material->getResidentLevel();
+    restream.level = level;
+
+    try {
+        bufferManager->beginAsync(restream.submit);
+        restream.texture = std::make_shared<TextureImage>(
+            physicalDevice,
+            device,
+            *restream.source,
+            restream.sourceLevel,
+            layout,
+            staged,
+            restream.submit.cmd,
+            textureImageDesc
+        );
+    } catch (...) {
+        // never submitted, the command buffer is free again
+        bufferManager->releaseAsync(restream.submit);
+        stagingRing->free(staging);
+        throw;
+    }
+
+    bufferManager->endAsync(restream.submit);
+
+    // the copy reads the region, it is freed once the copy completed
+    restream.staging = staging;
+    staging = StagingRing::Allocation();
+
+    material->setStreaming(true);
+    restreams.push_back(std::move(restream));
+}
+
+void ResourceManager::finishRestreams()
+{
+    size_t write = 0;
+    for (size_t i = 0; i < restreams.size(); i++)
+    {
+        PendingRestream& restream = restreams[i];
+        if (!bufferManager->isComplete(restream.submit))
+        {
+            if (write != i)
+                restreams[write] = std::move(restream);
+            write++;
+            continue;
+        }
+
+        bufferManager->releaseAsync(restream.submit);
+        stagingRing->free(restream.staging);
+
+        Material& material = *restream.material;
+        material.setStreaming(false);
+
+        // failed or reloaded while the copy ran
+        if (!material.isResident() || material.getTexture() != restream.source)
+            continue;
+
+        try {
+            retiredTextures.push_back({frameIndex, material.replaceTexture(restream.texture, restream.level)});
+        } catch (const std::exception& e) {
+            std::cerr << "failed to stream material " << materialRegistry.getPath(restream.id) << ": " << e.what() << std::endl;
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.mipStreams++;
+
+        MaterialSlot& slot = materialSlots[restream.id];
+        if (slot.retained && slot.lruEntry->material == restream.material)
+        {
+            VkDeviceSize size = material.getGpuMemorySize();
+            retainedBytes = retainedBytes - slot.lruEntry->size + size;
+            slot.lruEntry->size = size;
+        }
+    }
+    restreams.resize(write);
+}
+
+void ResourceManager::uploadStream(
+    PendingStream& stream
+) {
+    stream.material->setStreaming(false);
+
+    if (!stream.error.empty())
+    {
+        std::cerr << "failed to stream material " << materialRegistry.getPath(stream.id) << ": " << stream.error << std::endl;
+        stagingRing->free(stream.staging);
+        return;
+    }
+
+    // evicted or reloaded while the job ran, or the ring was full: the next update asks again
+    if (!stream.material->isResident() || stream.material->getResidentLevel() != stream.residentLevel ||
+        !stream.staging.valid())
+    {
+        stagingRing->free(stream.staging);
+        return;
+    }
+
+    try {
+        submitRestream(stream.id, stream.material, stream.level, stream.container, stream.staging);
+    } catch (const std::exception& e) {
+        std::cerr << "failed to stream material " << materialRegistry.getPath(stream.id) << ": " << e.what() << std::endl;
+    }
+
+    stream.container = TextureContainer();
+}
+
+void ResourceManager::uploadDecoded()
+{
+    std::vector<std::shared_ptr<PendingMesh>> readyMeshes;
+    std::vector<std::shared_ptr<PendingMaterial>> readyMaterials;
+    std::vector<std::shared_ptr<PendingStream>> readyStreams;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyMeshes.swap(decodedMeshes);
+        readyMaterials.swap(decodedMaterials);
+        readyStreams.swap(decodedStreams);
+    }
+
+    for (auto& pending : readyMeshes)
+        uploadMesh(*pending);
+
+    for (auto& pending : readyMaterials)
+        uploadMaterial(*pending);
+
+    for (auto& stream : readyStreams)
+    {
+        uploadStream(*stream);
+        activeStreams.erase(std::find(activeStreams.begin(), activeStreams.end(), stream));
+    }
+}
+
+void ResourceManager::updateStreaming()
+{
+    if (frameIndex % streamingInterval != 0)
+        return;
+
+    struct Candidate {
+        std::shared_ptr<PendingStream> stream;
+        uint32_t residentLevel;
+        VkDeviceSize size;
+    };
+
+    std::vector<Candidate> drops;
+    std::vector<Candidate> loads;
+    VkDeviceSize textureBytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // most recently used first, they get the budget first
+        for (CacheEntry& entry : lru)
+        {
+            if (!entry.material)
+                continue;
+
+            Material& material = *entry.material;
+            VkDeviceSize size = material.getGpuMemorySize();
+            textureBytes += size;
+
+            const uint32_t demanded = material.takeDemandedLevel();
+            if (material.isStreaming() || !material.isResident())
+                continue;
+
+            const uint32_t resident = material.getResidentLevel();
+            const uint32_t target = std::min(demanded, tailLevel(material));
+
+            // one level of hysteresis before dropping mips again
+            if (target >= resident && target <= resident + 1)
+                continue;
+
+            auto stream = std::make_shared<PendingStream>();
+            stream->id = entry.id;
+            stream->material = entry.material;
+            stream->level = target;
+            stream->residentLevel = resident;
+            if (target < resident)
+                resolveTexture(entry.id, stream->texturePath, stream->atlasTiles, stream->atlasTileSize);
+
+            (target < resident ? loads : drops).push_back({stream, resident, size});
+        }
+
+        stats.textureBytes = textureBytes;
+    }
+
+    // every level is about 4 times the size of the next one
+    auto scaledSize = [](VkDeviceSize size, uint32_t from, uint32_t to)
+    {
+        return to < from ? size << (2 * (from - to)) : size >> (2 * (to - from));
+    };
+
+    std::vector<std::shared_ptr<PendingStream>> submits;
+
+    // dropping first frees budget for the loads; a drop only submits a GPU copy of the levels it keeps
+    VkDeviceSize projected = textureBytes;
+    for (Candidate& drop : drops)
+    {
+        if (activeStreams.size() + restreams.size() >= maxStreamsInFlight)
+            break;
+
+        PendingStream& stream = *drop.stream;
+        try {
+            submitRestream(stream.id, stream.material, stream.level, stream.container, stream.staging);
+        } catch (const std::exception& e) {
+            std::cerr << "failed to drop mips of material " << materialRegistry.getPath(stream.id) << ": " << e.what() << std::endl;
+            continue;
+        }
+
+        projected -= drop.size - scaledSize(drop.size, drop.residentLevel, stream.level);
+    }
+
+    for (Candidate& load : loads)
+    {
+        if (activeStreams.size() + restreams.size() + submits.size() >= maxStreamsInFlight)
+            break;
+
+        // step towards the demanded level as far as the budget allows
+        uint32_t level = load.stream->level;
+        while (level < load.residentLevel &&
+            projected + scaledSize(load.size, load.residentLevel, level) - load.size > textureStreamingBudget)
+            level++;
+
+        if (level == load.residentLevel)
+            continue;
+
+        load.stream->level = level;
+        projected += scaledSize(load.size, load.residentLevel, level) - load.size;
+        submits.push_back(load.stream);
+    }
+
+    for (auto& stream : submits)
+    {
+        stream->material->setStreaming(true);
+        activeStreams.push_back(stream);
+
+        jobSystem->submit(
+            [this, stream]()
+            {
+                try {
+                    loadStreamLevels(*stream);
+                } catch (const std::exception& e) {
+                    stream->error = e.what();
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                decodedStreams.push_back(stream);
+            },
+            &stream->counter
+        );
+    }
+}
+
+void ResourceManager::processUploads()
+{
+    uploadDecoded();
+    finishRestreams();
+
+    frameIndex++;
+
+    // the fence of this frame slot was waited on, older frames are done
+    size_t write = 0;
+    for (size_t i = 0; i < retired.size(); i++)
+    {
+        if (frameIndex - retired[i].frame <= framesInFlight)
+            retired[write++] = std::move(retired[i]);
+    }
+    retired.resize(write);
+
+    write = 0;
+    for (size_t i = 0; i < retiredTextures.size(); i++)
+    {
+        if (frameIndex - retiredTextures[i].frame <= framesInFlight)
+        {
+            retiredTextures[write++] = std::move(retiredTextures[i]);
+            continue;
+        }
+
+        if (retiredTextures[i].resources.descriptorSet != VK_NULL_HANDLE)
+            vkFreeDescriptorSets(device, descriptorPool, 1, &retiredTextures[i].resources.descriptorSet);
+    }
+    retiredTextures.resize(write);
+
+    if (bindlessTextures)
+        bindlessTextures->advanceFrame();
+
+    updateStreaming();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    evictToBudget();
+
+    // slot scans are linear, amortize them
+    if ((frameIndex & 63) == 0)
+        purgeExpired();
+}
+
+template<typename SlotT>
+void ResourceManager::touch(
+    SlotT& slot
+) {
+    if (slot.retained)
+        lru.splice(lru.begin(), lru, slot.lruEntry);
+}
+
+template<typename SlotT>
+void ResourceManager::retain(
+    SlotT& slot,
+    CacheEntry entry
+) {
+    retainedBytes += entry.size;
+
+    lru.push_front(std::move(entry));
+    slot.lruEntry = lru.begin();
+    slot.retained = true;
+}
+
+void ResourceManager::evictToBudget()
+{
+    auto it = lru.end();
+    while (retainedBytes > memoryBudget && it != lru.begin())
+    {
+        --it;
+
+        // still drawn somewhere, evicting would not free anything
+        if (it->useCount() > 1)
+            continue;
+
+        if (it->mesh)
+        {
+            it->mesh->setResidency(Residency::Evicted);
+            meshSlots[it->id] = MeshSlot();
+        }
+        else
+        {
+            it->material->setResidency(Residency::Evicted);
+            materialSlots[it->id] = MaterialSlot();
+        }
+
+        retainedBytes -= it->size;
+        stats.evictions++;
+
+        retired.push_back({frameIndex, std::move(*it)});
+        it = lru.erase(it);
+    }
+}
+
+void ResourceManager::purgeExpired()
+{
+    for (MeshSlot& slot : meshSlots)
+    {
+        if (!slot.pending && slot.asset.expired())
+            slot.asset.reset();
+    }
+
+    for (MaterialSlot& slot : materialSlots)
+    {
+        if (!slot.pending && slot.asset.expired())
+            slot.asset.reset();
+    }
+}
+
+void ResourceManager::setMemoryBudget(
+    VkDeviceSize budget
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    memoryBudget = budget;
+}
+
+void ResourceManager::setTextureStreamingBudget(
+    VkDeviceSize budget
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    textureStreamingBudget = budget;
+}
+
+ResourceManager::AssetId ResourceManager::defineMaterial(
+    const std::string& materialName,
+    const MaterialDesc& desc
+) {
+    if (desc.texturePath.empty())
+        throw std::runtime_error("material " + materialName + " has no texture");
+
+    AssetId materialId = getMaterialId(materialName);
+    getMaterialId(desc.texturePath);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (materialDescs.count(materialId))
+        throw std::runtime_error("material " + materialName + " is already defined");
+
+    materialDescs[materialId] = desc;
+    return materialId;
+}
+
+ResourceManager::AssetId ResourceManager::defineAtlas(
+    const std::string& atlasName,
+    const std::vector<std::string>& tilePaths,
+    uint32_t tileSize
+) {
+    if (tilePaths.empty())
+        throw std::runtime_error("atlas " + atlasName + " has no tiles");
+
+    AssetId atlasId = getMaterialId(atlasName);
+    const uint32_t tileCount = static_cast<uint32_t>(tilePaths.size());
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (atlases.count(atlasId))
+        throw std::runtime_error("atlas " + atlasName + " is already defined");
+
+    atlases[atlasId] = AtlasDesc{tilePaths, tileSize};
+
+    for (uint32_t i = 0; i < tileCount; i++)
+    {
+        AtlasTile tile;
+        tile.atlasId = atlasId;
+        tile.region = TextureAtlas::region(tileCount, tileSize, i);
+        atlasTiles[getMaterialId(tilePaths[i])] = tile;
+    }
+
+    return atlasId;
+}
+
+bool ResourceManager::findAtlasTile(
+    AssetId textureId,
+    AssetId& atlasId,
+    TextureAtlas::Region& region
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = atlasTiles.find(textureId);
+    if (it == atlasTiles.end())
+        return false;
+
+    atlasId = it->second.atlasId;
+    region = it->second.region;
+    return true;
+}
+
+ResourceManager::CacheStats ResourceManager::getStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    CacheStats result = stats;
+    result.retainedAssets = lru.size();
+    result.retainedBytes = retainedBytes;
+    result.memoryBudget = memoryBudget;
+    result.textureStreamingBudget = textureStreamingBudget;
+    result.stagingRingUsed = stagingRing->getUsedBytes();
+    result.stagingRingCapacity = stagingRing->getCapacity();
+    return result;
+}
+
+std::shared_ptr<Mesh> ResourceManager::getMesh(
+    const std::string& meshPath
+) {
+    AssetId id = getMeshId(meshPath);
+    std::shared_ptr<Mesh> mesh = requestMesh(id);
+
+    std::shared_ptr<PendingMesh> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = meshSlots[id].pending;
+    }
+
+    if (pending)
+    {
+        jobSystem->wait(pending->counter);
+        uploadDecoded();
+    }
+
+    if (mesh->getResidency() == Residency::Failed)
+        throw std::runtime_error("failed to load mesh " + meshPath);
+
+    return mesh;
+}
+
+std::shared_ptr<Material> ResourceManager::getMaterial(
+    const std::string& texturePath
+) {
+    AssetId id = getMaterialId(texturePath);
+    std::shared_ptr<Material> material = requestMaterial(id);
+
+    std::shared_ptr<PendingMaterial> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = materialSlots[id].pending;
+    }
+
+    if (pending)
+    {
+        jobSystem->wait(pending->counter);
+        uploadDecoded();
+    }
+
+    if (material->getResidency() == Residency::Failed)
+        throw std::runtime_error("failed to load material " + texturePath);
+
     return material;
 }
@@ -1,38 +1,590 @@
 #pragma once
 
-#include <unordered_map>
 #include <memory>
 #include <string>
+#include <mutex>
+#include <vector>
+#include <list>
+#include <unordered_map>
 
+#include "assets/AssetRegistry.hpp"
+#include "jobs/JobSystem.hpp"
 #include "mesh/Mesh.hpp"
 #include "material/Material.hpp"
+#include "texture/TextureAtlas.hpp"
+#include "../StagingRing.hpp"
 
+/**
+ * @brief Thread-safe cache of meshes and materials.
+ *
+ * Paths are interned once into AssetRegistry ids, later lookups index
+ * the slot of the id. Assets are returned immediately in the Requested
+ * state: the CPU stage runs on JobSystem workers, the GPU stage on the
+ * render thread in processUploads, which marks them Resident. Until
+ * then callers draw the placeholders. Concurrent requests for one asset
+ * share one object and one load.
+ *
+ * Material textures stream their mip levels (see updateStreaming), and
+ * resident assets are retained in an LRU list under a memory budget.
+ */
 class ResourceManager
 {
+public:
+    using AssetId = AssetRegistry::AssetId;
+
+    /**
+     * @brief Cache counters, cumulative since creation.
+     */
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t mipStreams = 0;
+        /// RGBA8 bytes produced by image decoding, and the worker time it took
+        uint64_t decodedBytes = 0;
+        double decodeSeconds = 0.0;
+        VkDeviceSize stagingRingUsed = 0;
+        VkDeviceSize stagingRingCapacity = 0;
+        VkDeviceSize textureBytes = 0;
+        VkDeviceSize textureStreamingBudget = 0;
+        size_t retainedAssets = 0;
+        VkDeviceSize retainedBytes = 0;
+        VkDeviceSize memoryBudget = 0;
+    };
+
 private:
+    /**
+     * @brief Strong reference kept by the LRU list, exactly one asset is set.
+     */
+    struct CacheEntry {
+        AssetId id;
+        std::shared_ptr<Mesh> mesh;
+        std::shared_ptr<Material> material;
+        VkDeviceSize size = 0;
+
+        long useCount() const { return mesh ? mesh.use_count() : material.use_count(); }
+    };
+
+    struct RetiredEntry {
+        uint64_t frame;
+        CacheEntry entry;
+    };
+
+    struct PendingMesh {
+        AssetId id;
+        std::shared_ptr<Mesh> mesh;
+        Mesh::MeshData data;
+        std::string error;
+        JobSystem::JobCounter counter;
+    };
+
+    struct PendingMaterial {
+        AssetId id;
+        std::shared_ptr<Material> material;
+        // path of the texture, the material path itself unless it has a description
+        std::string texturePath;
+        // set when the material is an atlas
+        std::vector<std::string> atlasTiles;
+        uint32_t atlasTileSize = 0;
+        TextureContainer container;
+        // decoded sources are written here, container then only holds the layout
+        StagingRing::Allocation staging;
+        std::string error;
+        JobSystem::JobCounter counter;
+    };
+
+    /**
+     * @brief Per-id cache state, indexed by AssetId.
+     */
+    template<typename T, typename Pending>
+    struct Slot {
+        std::weak_ptr<T> asset;
+        std::shared_ptr<Pending> pending;
+        std::list<CacheEntry>::iterator lruEntry;
+        bool retained = false;
+    };
+
+    using MeshSlot = Slot<Mesh, PendingMesh>;
+    using MaterialSlot = Slot<Material, PendingMaterial>;
+
+    /**
+     * @brief Load of the levels a resident texture is missing, level up to residentLevel.
+     */
+    struct PendingStream {
+        AssetId id;
+        std::shared_ptr<Material> material;
+        std::string texturePath;
+        std::vector<std::string> atlasTiles;
+        uint32_t atlasTileSize = 0;
+        uint32_t level = 0;
+        uint32_t residentLevel = 0;
+        // layout of the full chain, only the missing levels have bytes
+        TextureContainer container;
+        StagingRing::Allocation staging;
+        std::string error;
+        JobSystem::JobCounter counter;
+    };
+
+    struct RetiredTexture {
+        uint64_t frame;
+        Material::RetiredTexture resources;
+    };
+
+    /**
+     * @brief Rebuilt texture whose GPU copy is in flight, swapped in once it completed.
+     */
+    struct PendingRestream {
+        AssetId id;
+        std::shared_ptr<Material> material;
+        // read by the copy, kept alive until it completed
+        std::shared_ptr<TextureImage> source;
+        std::shared_ptr<TextureImage> texture;
+        uint32_t sourceLevel = 0;
+        uint32_t level = 0;
+        StagingRing::Allocation staging;
+        BufferManager::AsyncSubmit submit;
+    };
+
+    struct SourceChain {
+        std::string texturePath;
+        std::shared_ptr<const TextureContainer> container;
+    };
+
+    struct AtlasDesc {
+        std::vector<std::string> tilePaths;
+        uint32_t tileSize;
+    };
+
+    struct AtlasTile {
+        AssetId atlasId;
+        TextureAtlas::Region region;
+    };
+
     VkPhysicalDevice physicalDevice;
     VkDevice device;
     BufferManager* bufferManager;
     VkDescriptorPool descriptorPool;
     VkDescriptorSetLayout layout;
+    BindlessTextureManager* bindlessTextures;
+    MaterialParameterBuffer* materialParameters;
+    SamplerCache* samplerCache;
+    JobSystem* jobSystem;
+
+    VkDeviceSize memoryBudget;
+    uint32_t framesInFlight;
+    uint64_t frameIndex = 0;
+
+    AssetRegistry meshRegistry;
+    AssetRegistry materialRegistry;
+
+    std::shared_ptr<Mesh> placeholderMesh;
+    std::shared_ptr<Material> placeholderMaterial;
+
+    // guards every container below
+    std::mutex mutex;
+
+    std::vector<MeshSlot> meshSlots;
+    std::vector<MaterialSlot> materialSlots;
+
+    // atlas material id -> tiles, tile texture id -> atlas
+    std::unordered_map<AssetId, AtlasDesc> atlases;
+    std::unordered_map<AssetId, AtlasTile> atlasTiles;
+
+    // named material -> description, materials without one are plain textures
+    std::unordered_map<AssetId, MaterialDesc> materialDescs;
+
+    // CPU stage finished, waiting for the render thread
+    std::vector<std::shared_ptr<PendingMesh>> decodedMeshes;
+    std::vector<std::shared_ptr<PendingMaterial>> decodedMaterials;
+
+    // front is the most recently used
+    std::list<CacheEntry> lru;
+    VkDeviceSize retainedBytes = 0;
+
+    // evicted assets waiting for the GPU to stop using them (render thread only)
+    std::vector<RetiredEntry> retired;
+
+    // decoded textures go straight into mapped memory
+    StagingRing* stagingRing = nullptr;
+    VkDeviceSize stagingRingSize = 64ull * 1024 * 1024;
+
+    // mip streaming
+    VkDeviceSize textureStreamingBudget = 256ull * 1024 * 1024;
+    uint32_t streamingTailSize = 128;
+    uint32_t streamingInterval = 8;
+    uint32_t maxStreamsInFlight = 2;
+    std::vector<std::shared_ptr<PendingStream>> activeStreams; // render thread only
+    std::vector<std::shared_ptr<PendingStream>> decodedStreams;
+    std::vector<RetiredTexture> retiredTextures; // render thread only
+    std::vector<PendingRestream> restreams; // render thread only
+
+    // decoded chains of streamed sources, front is the most recently used
+    std::list<SourceChain> sourceChains;
+    VkDeviceSize sourceChainBytes = 0;
+    VkDeviceSize sourceChainBudget = 64ull * 1024 * 1024;
+
+    CacheStats stats;
+
+    void createPlaceholders();
+
+    /**
+     * @brief Texture path and atlas tiles of a material. Caller holds mutex.
+     */
+    void resolveTexture(
+        AssetId materialId,
+        std::string& texturePath,
+        std::vector<std::string>& tiles,
+        uint32_t& tileSize
+    ) const;
+
+    /**
+     * @brief Loads the cooked container of a texture if one exists and is usable.
+     *
+     * Only levels firstLevel up to endLevel are read, see TextureContainer::load.
+     *
+     * @return true if container was filled.
+     */
+    bool loadCookedTexture(
+        const std::string& texturePath,
+        TextureContainer& container,
+        uint32_t firstLevel = 0,
+        uint32_t endLevel = UINT32_MAX
+    ) const;
+
+    /**
+     * @brief CPU stage of a material texture: atlas, cooked file or decoded source with mips.
+     *
+     * A cooked .ktx2 or .dds next to the source is used as is, block
+     * compressed with its chain, unless the device lacks its format.
+     * Otherwise the source is decoded and its mips built here, so every
+     * upload is a single copy with no GPU mip generation.
+     *
+     * With staging set, decoded sources are expanded and mipmapped
+     * straight into the staging ring when it has room; staging is then
+     * valid and container holds only the layout. Without it the chain
+     * always stays in container.data.
+     *
+     * @throws std::runtime_error if the texture cannot be loaded.
+     */
+    void loadTextureContainer(
+        const std::string& texturePath,
+        const std::vector<std::string>& atlasTiles,
+        uint32_t atlasTileSize,
+        TextureContainer& container,
+        StagingRing::Allocation* staging
+    );
+
+    /**
+     * @brief CPU stage of a stream: stages the levels the texture is missing.
+     *
+     * Cooked files read those levels alone. Other sources come from
+     * sourceChains, or are decoded once and added to it.
+     *
+     * @throws std::runtime_error if the texture cannot be loaded.
+     */
+    void loadStreamLevels(
+        PendingStream& stream
+    );
+
+    /**
+     * @brief Most recently used cached chain of a source, or null. Caller holds mutex.
+     */
+    std::shared_ptr<const TextureContainer> findSourceChain(
+        const std::string& texturePath
+    );
+
+    /**
+     * @brief Caches a decoded chain, evicting the oldest past sourceChainBudget. Caller holds mutex.
+     */
+    void cacheSourceChain(
+        const std::string& texturePath,
+        std::shared_ptr<const TextureContainer> container
+    );
+
+    /**
+     * @brief Uploads a loaded texture from the staging ring or its container, then frees the region.
+     */
+    std::shared_ptr<TextureImage> uploadTexture(
+        const TextureContainer& container,
+        StagingRing::Allocation& staging,
+        uint32_t firstMip
+    );
+
+    /**
+     * @brief Coarsest level kept resident, the first one within streamingTailSize.
+     */
+    uint32_t tailLevel(
+        const Material& material
+    ) const;
+
+    /**
+     * @brief Turns the levels requested by draws into drops and stream jobs. Render thread only.
+     *
+     * Only the levels up to streamingTailSize texels are uploaded at
+     * first. Draws report the level they need through
+     * Material::requestLevel; every streamingInterval frames unneeded
+     * levels are dropped and finer ones loaded, within the texture
+     * streaming budget. The rebuilt image copies the levels it keeps on
+     * the GPU, so a drop never touches the source and a load uploads
+     * only the missing levels, see submitRestream. Cooked files read
+     * those levels alone, decoded sources are kept in sourceChains.
+     */
+    void updateStreaming();
+
+    /**
+     * @brief Starts rebuilding the texture of a material from level, copying the levels it keeps.
+     *
+     * Levels finer than the resident one come from layout and staging,
+     * which is then owned by the restream. Nothing is uploaded for a
+     * drop. The copy is submitted without waiting; finishRestreams swaps
+     * the texture in once it completed. The material stays streaming
+     * until then.
+     */
+    void submitRestream(
+        AssetId id,
+        const std::shared_ptr<Material>& material,
+        uint32_t level,
+        const TextureContainer& layout,
+        StagingRing::Allocation& staging
+    );
+
+    /**
+     * @brief Swaps in the textures whose copies completed. Render thread only.
+     */
+    void finishRestreams();
+
+    void uploadStream(
+        PendingStream& stream
+    );
+
+    /**
+     * @brief Returns the slot of an id, growing the slot array. Caller holds mutex.
+     */
+    template<typename SlotT>
+    static SlotT& slotAt(
+        std::vector<SlotT>& slots,
+        AssetId id
+    );
+
+    /**
+     * @brief Moves a retained asset to the front of the LRU list. Caller holds mutex.
+     */
+    template<typename SlotT>
+    void touch(
+        SlotT& slot
+    );
+
+    /**
+     * @brief Starts retaining a freshly uploaded asset. Caller holds mutex.
+     */
+    template<typename SlotT>
+    void retain(
+        SlotT& slot,
+        CacheEntry entry
+    );
+
+    /**
+     * @brief Evicts unreferenced LRU assets until under budget. Caller holds mutex.
+     *
+     * Retained assets survive their last instance going away. Evicted
+     * ones have their GPU resources released framesInFlight frames
+     * later, once no in-flight command buffer can reference them.
+     */
+    void evictToBudget();
+
+    /**
+     * @brief Releases control blocks of expired weak references. Caller holds mutex.
+     */
+    void purgeExpired();
+
+    void uploadMesh(
+        PendingMesh& pending
+    );
+
+    void uploadMaterial(
+        PendingMaterial& pending
+    );
+
+    /**
+     * @brief Uploads every asset whose CPU stage has finished. Render thread only.
+     */
+    void uploadDecoded();
 
-    std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
-    std::unordered_map<std::string, std::weak_ptr<Material>> materials;
 public:
+    /**
+     * @brief Creates the staging ring and the placeholders.
+     *
+     * With bindlessTextures set, materials register their texture in the
+     * global bindless array instead of allocating per-material descriptor
+     * sets from descriptorPool. Every texture takes its sampler from
+     * samplerCache.
+     */
     ResourceManager(
         VkPhysicalDevice physicalDevice,
         VkDevice device,
         BufferManager* bufferManager,
         VkDescriptorPool descriptorPool,
-        VkDescriptorSetLayout layout
+        VkDescriptorSetLayout layout,
+        BindlessTextureManager* bindlessTextures,
+        MaterialParameterBuffer* materialParameters,
+        SamplerCache* samplerCache,
+        JobSystem* jobSystem,
+        VkDeviceSize memoryBudget,
+        uint32_t framesInFlight
     );
-    ~ResourceManager() = default;
 
+    /**
+     * @brief Waits for in-flight loads so no job outlives the manager.
+     */
+    ~ResourceManager();
+
+    /**
+     * @brief Interns a mesh path. Hash the string once, then keep the id.
+     */
+    AssetId getMeshId(
+        const std::string& meshPath
+    ) { return meshRegistry.intern(meshPath); }
+
+    /**
+     * @brief Interns a material texture path. Hash the string once, then keep the id.
+     */
+    AssetId getMaterialId(
+        const std::string& texturePath
+    ) { return materialRegistry.intern(texturePath); }
+
+    const std::string& getMeshPath(AssetId id) const { return meshRegistry.getPath(id); }
+    const std::string& getMaterialPath(AssetId id) const { return materialRegistry.getPath(id); }
+
+    /**
+     * @brief Returns the mesh of an id, starting a background load if needed.
+     *
+     * Safe to call from any thread. Never blocks on IO: a new mesh is
+     * returned in the Requested state and becomes Resident once
+     * processUploads has finalized it.
+     */
+    std::shared_ptr<Mesh> requestMesh(
+        AssetId meshId
+    );
+
+    /**
+     * @brief Returns the material of an id, starting a background load if needed.
+     *
+     * Same threading and coalescing rules as requestMesh.
+     */
+    std::shared_ptr<Material> requestMaterial(
+        AssetId materialId
+    );
+
+    std::shared_ptr<Mesh> requestMesh(
+        const std::string& meshPath
+    ) { return requestMesh(getMeshId(meshPath)); }
+
+    std::shared_ptr<Material> requestMaterial(
+        const std::string& texturePath
+    ) { return requestMaterial(getMaterialId(texturePath)); }
+
+    /**
+     * @brief Declares a named material with its own pipeline and parameters.
+     *
+     * Requesting the name then loads desc.texturePath, which may be an
+     * atlas, and applies the description to the material. Several
+     * materials can share one texture; each loads it on its own.
+     *
+     * @param materialName Material path of the material, must not be a real file.
+     * @return Material id of the material.
+     *
+     * @throws std::runtime_error if materialName is already defined or desc has no texture.
+     */
+    AssetId defineMaterial(
+        const std::string& materialName,
+        const MaterialDesc& desc
+    );
+
+    /**
+     * @brief Declares an atlas material packing several textures.
+     *
+     * Nothing is loaded until the atlas is requested like any material,
+     * through its name. It is then loaded, retained and evicted as one
+     * texture, and its tiles share one material and one batch through
+     * the uv transform of findAtlasTile. Tiles must be tileSize x
+     * tileSize, a power of two; a tile of another size fails the whole
+     * atlas.
+     *
+     * @param atlasName Material path of the atlas, must not be a real file.
+     * @param tilePaths Texture paths, in tile order.
+     * @param tileSize Width and height of every tile.
+     * @return Material id of the atlas.
+     *
+     * @throws std::runtime_error if atlasName is already an atlas or tilePaths is empty.
+     */
+    AssetId defineAtlas(
+        const std::string& atlasName,
+        const std::vector<std::string>& tilePaths,
+        uint32_t tileSize
+    );
+
+    /**
+     * @brief Finds the atlas a texture was packed into.
+     *
+     * @param textureId Material id of the tile texture.
+     * @param atlasId Output material id of the atlas.
+     * @param region Output uv transform selecting the tile.
+     * @return false if the texture is in no atlas.
+     */
+    bool findAtlasTile(
+        AssetId textureId,
+        AssetId& atlasId,
+        TextureAtlas::Region& region
+    );
+
+    /**
+     * @brief Finalizes decoded assets on the GPU and trims the cache.
+     *
+     * Must be called from the render thread once per frame, after the
+     * fence of the frame being recorded has been waited on.
+     */
+    void processUploads();
+
+    /**
+     * @brief Changes the retained GPU-memory budget; takes effect on the next processUploads.
+     */
+    void setMemoryBudget(
+        VkDeviceSize budget
+    );
+
+    /**
+     * @brief Caps the VRAM material textures may grow to by streaming in finer mips.
+     */
+    void setTextureStreamingBudget(
+        VkDeviceSize budget
+    );
+
+    CacheStats getStats();
+
+    /// Null when materials use per-material descriptor sets
+    BindlessTextureManager* getBindlessTextures() const { return bindlessTextures; }
+
+    /**
+     * @brief Loads a mesh and blocks until it is resident.
+     *
+     * Render thread only. The caller helps the job system while waiting.
+     */
     std::shared_ptr<Mesh> getMesh(
         const std::string& meshPath
     );
 
+    /**
+     * @brief Loads a material and blocks until it is resident.
+     *
+     * Render thread only. The caller helps the job system while waiting.
+     */
     std::shared_ptr<Material> getMaterial(
         const std::string& texturePath
     );
+
+    /// Always resident, drawn in place of meshes that are still streaming
+    const std::shared_ptr<Mesh>& getPlaceholderMesh() const { return placeholderMesh; }
+
+    /// Always resident, drawn in place of materials that are still streaming
+    const std::shared_ptr<Material>& getPlaceholderMaterial() const { return placeholderMaterial; }
 };
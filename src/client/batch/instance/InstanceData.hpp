@@ -1,30 +1,47 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 #define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
 
+/**
+ * Per-instance data, mirrored by the std430 InstanceBuffer of the shaders
+ * (96 bytes, the struct is padded to the 16-byte mat4 alignment).
+ */
 struct InstanceData {
     alignas(16) glm::mat4 model;
+    // texture coordinates are remapped to uv * xy + zw, selects an atlas tile
+    alignas(16) glm::vec4 uvTransform;
+    // slot of the material texture in the bindless array
+    uint32_t materialIndex;
+    // slot of the material in MaterialParameterBuffer, fits in the padding
+    uint32_t paramsIndex;
 
-    InstanceData() : model(glm::mat4(1.0f)) {}
+    InstanceData() : model(glm::mat4(1.0f)), uvTransform(1.0f, 1.0f, 0.0f, 0.0f), materialIndex(0), paramsIndex(0) {}
 
-    InstanceData(glm::mat4 model) : model(model){}
+    InstanceData(glm::mat4 model) : model(model), uvTransform(1.0f, 1.0f, 0.0f, 0.0f), materialIndex(0), paramsIndex(0) {}
 
     ~InstanceData() = default;
 
-    InstanceData(const InstanceData& other) : model(other.model) {}
+    InstanceData(const InstanceData& other) : model(other.model), uvTransform(other.uvTransform), materialIndex(other.materialIndex), paramsIndex(other.paramsIndex) {}
     InstanceData& operator=(const InstanceData& other) {
         if (this != &other) {
             model = other.model;
+            uvTransform = other.uvTransform;
+            materialIndex = other.materialIndex;
+            paramsIndex = other.paramsIndex;
         }
         return *this;
     }
 
-    InstanceData(InstanceData&& other) noexcept : model(std::move(other.model)) {}
+    InstanceData(InstanceData&& other) noexcept : model(std::move(other.model)), uvTransform(other.uvTransform), materialIndex(other.materialIndex), paramsIndex(other.paramsIndex) {}
     InstanceData& operator=(InstanceData&& other) noexcept {
         if (this != &other) {
             model = std::move(other.model);
+            uvTransform = other.uvTransform;
+            materialIndex = other.materialIndex;
+            paramsIndex = other.paramsIndex;
         }
         return *this;
     }
-};
\ No newline at end of file
+};
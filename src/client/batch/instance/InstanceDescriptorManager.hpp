@@ -35,4 +35,5 @@ public:
 
     VkDescriptorSetLayout getLayout() const { return descriptorSetLayout; }
     const std::vector<VkDescriptorSet>& getDescriptorSets() const { return descriptorSets; }
+    VkBuffer getBuffer(uint32_t frameIndex) const { return buffers[frameIndex]; }
 };
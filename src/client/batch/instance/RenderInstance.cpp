@@ -24,11 +24,25 @@ void RenderInstance::updateModelMatrix()
 
     model = glm::scale(model, scale);
 
-    ownerBatch->getinstancesData()[indexInBatch] = model;
+    InstanceData& data = ownerBatch->getinstancesData()[indexInBatch];
+    data.model = model;
+    data.uvTransform = uvTransform;
+}
+
+void RenderInstance::setStatic(
+    bool value
+) {
+    if (staticInstance == value)
+        return;
+
+    staticInstance = value;
+    if (ownerBatch)
+        ownerBatch->manager->invalidateStatic();
 }
 
 RenderInstance::~RenderInstance()
 {
+    // through the manager, so cached shadows drop a static instance
     if (ownerBatch)
-        ownerBatch->removeInstance(this);
+        ownerBatch->manager->removeInstance(this);
 }
\ No newline at end of file
@@ -13,12 +13,15 @@ class RenderInstance
     friend class RenderBatchManager;
     RenderBatchManager::RenderBatch* ownerBatch = nullptr;
     size_t indexInBatch = 0;
+    bool staticInstance = false;
 
 public:
 
     glm::vec3 position;
     glm::vec3 rotation; // Euler (radians)
     glm::vec3 scale;
+    // uv * xy + zw, the tile of a texture atlas (see RenderBatchManager::findBatchKey)
+    glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
 
     RenderInstance(
         const glm::vec3& position = glm::vec3(0.0f),
@@ -38,6 +41,19 @@ public:
     const glm::vec3& getRotation() const { return rotation; }
     const glm::vec3& getScale() const { return scale; }
 
+    /// The instance never moves, so its shadow is cached (see RenderBatchManager::getStaticGeneration)
+    bool isStatic() const { return staticInstance; }
+
+    /**
+     * @brief Marks the instance as static or dynamic, invalidating cached shadows if it is in a batch.
+     */
+    void setStatic(
+        bool value
+    );
+
+    /**
+     * @brief Writes the model matrix and uvTransform into the batch instance data.
+     */
     void updateModelMatrix();
 
     const InstanceData& getModelMatrix() const { return ownerBatch->getinstancesData()[indexInBatch]; }
@@ -0,0 +1,184 @@
+#include "BindlessTextureManager.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+BindlessTextureManager::BindlessTextureManager(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    uint32_t capacity,
+    uint32_t framesInFlight
+)
+: device(device)
+, capacity(capacity)
+, framesInFlight(framesInFlight)
+{
+    // update-after-bind arrays have their own, separate limits
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    this->capacity = std::min({
+        capacity,
+        properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+        properties12.maxDescriptorSetUpdateAfterBindSamplers,
+        properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        properties12.maxPerStageDescriptorUpdateAfterBindSamplers
+    });
+
+    if (this->capacity < 2)
+        throw std::runtime_error("Device limits too low for bindless textures");
+
+    // layout
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = this->capacity;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    VkDescriptorBindingFlags bindingFlags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flagsInfo.bindingCount = 1;
+    flagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &flagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create bindless texture descriptor layout");
+
+    // pool
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = this->capacity;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        throw std::runtime_error("Failed to create bindless texture descriptor pool");
+    }
+
+    // set
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    {
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        throw std::runtime_error("Failed to allocate bindless texture descriptor set");
+    }
+}
+
+BindlessTextureManager::~BindlessTextureManager()
+{
+    // the set is freed with the pool
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    if (descriptorSetLayout)
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+void BindlessTextureManager::writeSlot(
+    uint32_t index,
+    const TextureImage& texture
+) {
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = texture.getTextureImageView();
+    imageInfo.sampler = texture.getTextureSampler();
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+uint32_t BindlessTextureManager::add(
+    const TextureImage& texture
+) {
+    // vkUpdateDescriptorSets needs the set externally synchronized
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index;
+    if (!freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else if (nextIndex < capacity)
+    {
+        index = nextIndex++;
+    }
+    else
+    {
+        throw std::runtime_error("Bindless texture array is full");
+    }
+
+    if (!fallbackWritten)
+    {
+        writeSlot(0, texture);
+        fallbackWritten = true;
+    }
+
+    writeSlot(index, texture);
+    return index;
+}
+
+void BindlessTextureManager::release(
+    uint32_t index
+) {
+    if (index == 0 || index >= capacity)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    released.push_back({frameIndex, index});
+}
+
+void BindlessTextureManager::advanceFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    frameIndex++;
+
+    size_t write = 0;
+    for (size_t i = 0; i < released.size(); i++)
+    {
+        if (frameIndex - released[i].frame <= framesInFlight)
+            released[write++] = released[i];
+        else
+            freeIndices.push_back(released[i].index);
+    }
+    released.resize(write);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../../CoreVulkan.hpp"
+#include "TextureImage.hpp"
+
+/**
+ * @brief One global, partially bound array of material textures.
+ *
+ * Replaces the per-material descriptor sets when the device supports
+ * descriptor indexing: every resident texture owns a slot of a single
+ * update-after-bind array at set 1, binding 0, and shaders pick it with
+ * the materialIndex of the instance. The set is bound once per frame, so
+ * batches that differ only by material can be drawn with one call.
+ *
+ * Slots are written while command buffers that use the set are pending,
+ * which UPDATE_UNUSED_WHILE_PENDING allows as long as the written slot is
+ * not read by them. Released slots are therefore only reused
+ * framesInFlight frames later.
+ *
+ * Slot 0 is never handed out and always points at the first texture
+ * added, so an uninitialized index still samples something valid.
+ */
+class BindlessTextureManager
+{
+private:
+    struct ReleasedSlot {
+        uint64_t frame;
+        uint32_t index;
+    };
+
+    VkDevice device;
+    uint32_t capacity;
+    uint32_t framesInFlight;
+    uint64_t frameIndex = 0;
+
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+    // guards the slot bookkeeping and descriptor writes
+    std::mutex mutex;
+    uint32_t nextIndex = 1;
+    std::vector<uint32_t> freeIndices;
+    std::vector<ReleasedSlot> released;
+    bool fallbackWritten = false;
+
+    void writeSlot(
+        uint32_t index,
+        const TextureImage& texture
+    );
+
+public:
+    /**
+     * @brief Creates the layout, pool and the single descriptor set.
+     *
+     * @param physicalDevice Used to clamp capacity to the update-after-bind limits.
+     * @param device Device with the descriptor indexing features enabled.
+     * @param capacity Requested number of slots.
+     * @param framesInFlight Frames a released slot stays untouched.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    BindlessTextureManager(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        uint32_t capacity,
+        uint32_t framesInFlight
+    );
+
+    ~BindlessTextureManager();
+
+    BindlessTextureManager(const BindlessTextureManager&) = delete;
+    BindlessTextureManager& operator=(const BindlessTextureManager&) = delete;
+
+    /**
+     * @brief Writes a texture into a free slot.
+     *
+     * @return Slot index to store in InstanceData::materialIndex.
+     *
+     * @throws std::runtime_error when every slot is in use.
+     */
+    uint32_t add(
+        const TextureImage& texture
+    );
+
+    /**
+     * @brief Returns a slot; it is reused once no in-flight frame can read it.
+     */
+    void release(
+        uint32_t index
+    );
+
+    /**
+     * @brief Recycles slots released more than framesInFlight frames ago.
+     *
+     * Render thread only, once per frame after the frame fence was waited on.
+     */
+    void advanceFrame();
+
+    VkDescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    uint32_t getCapacity() const { return capacity; }
+};
@@ -6,19 +6,87 @@ Material::Material(
     VkDevice device,
     VkDescriptorPool descriptorPool,
     VkDescriptorSetLayout layout,
-    std::shared_ptr<TextureImage> texture
+    BindlessTextureManager* bindlessTextures,
+    MaterialParameterBuffer* parameters
 )
 : device(device)
-, texture(std::move(texture))
+, descriptorPool(descriptorPool)
+, layout(layout)
+, bindlessTextures(bindlessTextures)
+, parameters(parameters)
 {
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &layout;
+}
+
+Material::Material(
+    VkDevice device,
+    VkDescriptorPool descriptorPool,
+    VkDescriptorSetLayout layout,
+    std::shared_ptr<TextureImage> texture,
+    BindlessTextureManager* bindlessTextures,
+    MaterialParameterBuffer* parameters
+)
+: Material(device, descriptorPool, layout, bindlessTextures, parameters)
+{
+    setTexture(std::move(texture));
+}
+
+Material::~Material()
+{
+    if (bindlessTextures && textureIndex != 0)
+        bindlessTextures->release(textureIndex);
+
+    if (parameters && paramsIndex != 0)
+        parameters->release(paramsIndex);
+
+    if (descriptorSet != VK_NULL_HANDLE)
+        vkFreeDescriptorSets(device, descriptorPool, 1, &descriptorSet);
+}
+
+void Material::setDesc(
+    const MaterialDesc& desc
+) {
+    pipelineKey = desc.resolvePipeline();
+    pipelineHash = pipelineKey.hash();
 
-    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate material descriptor set");
+    if (!parameters)
+        return;
+
+    if (paramsIndex == 0)
+        paramsIndex = parameters->add(desc.params);
+    else
+        parameters->set(paramsIndex, desc.params);
+}
+
+void Material::setTexture(
+    std::shared_ptr<TextureImage> texture,
+    uint32_t residentLevel
+) {
+    this->texture = std::move(texture);
+    this->residentLevel = residentLevel;
+
+    if (bindlessTextures)
+    {
+        // the old slot stays valid for frames still in flight
+        uint32_t previous = textureIndex;
+        textureIndex = bindlessTextures->add(*this->texture);
+        if (previous != 0)
+            bindlessTextures->release(previous);
+
+        setResidency(Residency::Resident);
+        return;
+    }
+
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate material descriptor set");
+    }
 
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -34,4 +102,45 @@ Material::Material(
     write.pImageInfo = &imageInfo;
 
     vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    setResidency(Residency::Resident);
+}
+
+Material::RetiredTexture Material::replaceTexture(
+    std::shared_ptr<TextureImage> texture,
+    uint32_t residentLevel
+) {
+    RetiredTexture retired;
+    retired.texture = std::move(this->texture);
+
+    // the bindless slot is recycled by the manager itself
+    if (!bindlessTextures)
+    {
+        retired.descriptorSet = descriptorSet;
+        descriptorSet = VK_NULL_HANDLE;
+    }
+
+    const uint32_t previousLevel = this->residentLevel;
+    try {
+        setTexture(std::move(texture), residentLevel);
+    } catch (...) {
+        // keep drawing the previous texture
+        this->texture = retired.texture;
+        this->residentLevel = previousLevel;
+        if (!bindlessTextures)
+            descriptorSet = retired.descriptorSet;
+        throw;
+    }
+
+    return retired;
+}
+
+void Material::setMipChain(
+    uint32_t levelCount,
+    uint32_t width,
+    uint32_t height
+) {
+    this->levelCount = levelCount;
+    this->width = width;
+    this->height = height;
 }
@@ -2,22 +2,172 @@
 
 #include "../../CoreVulkan.hpp"
 #include "TextureImage.hpp"
+#include "BindlessTextureManager.hpp"
+#include "MaterialDesc.hpp"
+#include "MaterialParameterBuffer.hpp"
+#include "../Residency.hpp"
 #include <memory>
+#include <atomic>
+#include <cstdint>
 
 class Material
 {
+public:
+    /**
+     * @brief Resources replaced by replaceTexture that in-flight frames may still use.
+     */
+    struct RetiredTexture {
+        std::shared_ptr<TextureImage> texture;
+        /// per-material set to return to the pool, VK_NULL_HANDLE with bindless
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+
 private:
     VkDevice device;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSetLayout layout;
+    BindlessTextureManager* bindlessTextures;
+    MaterialParameterBuffer* parameters;
 
     std::shared_ptr<TextureImage> texture;
     VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+    uint32_t textureIndex{0};
+    std::atomic<Residency> residency{Residency::Requested};
+
+    MaterialDesc::PipelineKey pipelineKey;
+    size_t pipelineHash{MaterialDesc::PipelineKey().hash()};
+    uint32_t paramsIndex{0};
+
+    // mip streaming, render thread only
+    uint32_t levelCount{1};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t residentLevel{0};
+    uint32_t demandedLevel{UINT32_MAX};
+    bool streaming{false};
 public:
+    /**
+     * @brief Creates a material in the Requested state.
+     *
+     * The descriptor set is allocated once a texture is bound through setTexture.
+     * With bindlessTextures set, no per-material set is allocated: the texture
+     * gets a slot of the global array instead, see getTextureIndex.
+     *
+     * Until setDesc is called the material uses the default pipeline
+     * and parameter slot 0.
+     */
+    Material(
+        VkDevice device,
+        VkDescriptorPool descriptorPool,
+        VkDescriptorSetLayout layout,
+        BindlessTextureManager* bindlessTextures = nullptr,
+        MaterialParameterBuffer* parameters = nullptr
+    );
+
     Material(
         VkDevice device,
         VkDescriptorPool descriptorPool,
         VkDescriptorSetLayout layout,
-        std::shared_ptr<TextureImage> texture
+        std::shared_ptr<TextureImage> texture,
+        BindlessTextureManager* bindlessTextures = nullptr,
+        MaterialParameterBuffer* parameters = nullptr
+    );
+
+    /**
+     * @brief Applies the pipeline and parameters of a description.
+     *
+     * The texture is not touched, it is loaded from desc.texturePath by
+     * ResourceManager. Parameters take a slot of the parameter buffer on
+     * the first call and update it afterwards.
+     *
+     * @throws std::runtime_error when the parameter buffer is full.
+     */
+    void setDesc(
+        const MaterialDesc& desc
+    );
+
+    /**
+     * @brief Binds the texture, writes the descriptor set (or bindless slot) and marks the material Resident.
+     *
+     * Render thread only.
+     *
+     * @param residentLevel Level of the full mip chain uploaded as level 0 of texture.
+     */
+    void setTexture(
+        std::shared_ptr<TextureImage> texture,
+        uint32_t residentLevel = 0
+    );
+
+    /**
+     * @brief Swaps the texture of a resident material for one with other mip levels.
+     *
+     * Non-bindless materials get a fresh descriptor set, since the current
+     * one may be in use by frames in flight. Bindless ones get a fresh
+     * slot for the same reason, RenderBatchManager::update moves the
+     * instances to it. Render thread only.
+     *
+     * @return The previous texture and set; destroy them once no frame in
+     *         flight can reference them.
+     */
+    RetiredTexture replaceTexture(
+        std::shared_ptr<TextureImage> texture,
+        uint32_t residentLevel
     );
 
+    /**
+     * @brief Describes the full mip chain of the texture source, for streaming.
+     */
+    void setMipChain(
+        uint32_t levelCount,
+        uint32_t width,
+        uint32_t height
+    );
+
+    /**
+     * @brief Returns the descriptor set to the pool, the bindless and parameter slots to their buffers.
+     */
+    ~Material();
+
+    Material(const Material&) = delete;
+    Material& operator=(const Material&) = delete;
+
     VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+    /// Slot in the bindless texture array, 0 (fallback slot) until resident or without bindless
+    uint32_t getTextureIndex() const { return textureIndex; }
+    bool isBindless() const { return bindlessTextures != nullptr; }
+
+    const MaterialDesc::PipelineKey& getPipelineKey() const { return pipelineKey; }
+    /// Cached hash of the pipeline key, equal hashes are compared before binding
+    size_t getPipelineHash() const { return pipelineHash; }
+    bool isTransparent() const { return pipelineKey.state.blend != MaterialDesc::BlendMode::Opaque; }
+
+    /// Slot in MaterialParameterBuffer, 0 (defaults) without a description
+    uint32_t getParamsIndex() const { return paramsIndex; }
+
+    uint32_t getLevelCount() const { return levelCount; }
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+
+    /// Finest level of the full chain currently in VRAM
+    uint32_t getResidentLevel() const { return residentLevel; }
+
+    /// Records that a draw wants this level; the finest request wins until takeDemandedLevel
+    void requestLevel(uint32_t level) { demandedLevel = level < demandedLevel ? level : demandedLevel; }
+
+    /// Returns the finest requested level since the last call, UINT32_MAX if none
+    uint32_t takeDemandedLevel() { uint32_t level = demandedLevel; demandedLevel = UINT32_MAX; return level; }
+
+    bool isStreaming() const { return streaming; }
+    void setStreaming(bool value) { streaming = value; }
+
+    /// Texture holding the resident levels, streaming copies them into its replacement
+    const std::shared_ptr<TextureImage>& getTexture() const { return texture; }
+
+    /// GPU memory owned through the bound texture
+    VkDeviceSize getGpuMemorySize() const { return texture ? texture->getMemorySize() : 0; }
+
+    Residency getResidency() const { return residency.load(std::memory_order_acquire); }
+    bool isResident() const { return getResidency() == Residency::Resident; }
+    void setResidency(Residency state) { residency.store(state, std::memory_order_release); }
 };
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <glm/glm.hpp>
+
+#include "../../CoreVulkan.hpp"
+
+/**
+ * Per-material shading parameters, mirrored by the std430
+ * MaterialParamsBuffer of the mesh shaders (48 bytes).
+ */
+struct MaterialParams {
+    // multiplies the texture color
+    alignas(16) glm::vec4 baseColor{1.0f};
+    // rgb color, a = intensity, added after lighting
+    alignas(16) glm::vec4 emissive{0.0f};
+    // fragments with alpha below are discarded, 0 disables the test
+    float alphaCutoff = 0.0f;
+    float padding[3] = {0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * @brief Data-driven description of a material look.
+ *
+ * A material names a shader permutation and a render state, which pick
+ * its pipeline, plus parameters packed into MaterialParameterBuffer.
+ * Materials sharing a permutation and state share one pipeline however
+ * different their parameters and textures are.
+ */
+struct MaterialDesc {
+    enum class BlendMode : uint8_t {
+        Opaque,
+        AlphaBlend,
+        Additive
+    };
+
+    /**
+     * @brief Optional shader paths, passed as specialization constant 0.
+     *
+     * Every combination shares one SPIR-V module; the driver removes the
+     * disabled paths when compiling the pipeline.
+     */
+    enum Feature : uint32_t {
+        FeatureAlphaTest = 1u << 0,
+        FeatureEmissive = 1u << 1
+    };
+
+    /**
+     * @brief Fixed-function state baked into the pipeline.
+     */
+    struct RenderState {
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        BlendMode blend = BlendMode::Opaque;
+        bool depthTest = true;
+        bool depthWrite = true;
+        // EQUAL once a depth pre-pass has written the final depth
+        VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+        bool operator==(const RenderState& other) const {
+            return topology == other.topology &&
+                cullMode == other.cullMode &&
+                polygonMode == other.polygonMode &&
+                blend == other.blend &&
+                depthTest == other.depthTest &&
+                depthWrite == other.depthWrite &&
+                depthCompare == other.depthCompare;
+        }
+    };
+
+    /**
+     * @brief Everything a pipeline depends on, the pipeline cache key.
+     *
+     * shader is the base name of a program in shaders/: the pipeline
+     * loads <shader>.vert.glsl.spv and <shader>.frag.glsl.spv, or
+     * <shader>_bindless.frag.glsl.spv with bindless materials.
+     * features is a mask of Feature bits.
+     */
+    struct PipelineKey {
+        std::string shader = "triangle";
+        RenderState state;
+        uint32_t features = 0;
+
+        bool operator==(const PipelineKey& other) const {
+            return shader == other.shader && state == other.state && features == other.features;
+        }
+
+        size_t hash() const {
+            size_t h = std::hash<std::string>()(shader);
+            uint64_t bits =
+                static_cast<uint64_t>(state.cullMode) |
+                static_cast<uint64_t>(state.polygonMode) << 4 |
+                static_cast<uint64_t>(state.blend) << 8 |
+                static_cast<uint64_t>(state.depthTest) << 12 |
+                static_cast<uint64_t>(state.depthWrite) << 13 |
+                static_cast<uint64_t>(state.topology) << 16 |
+                static_cast<uint64_t>(state.depthCompare) << 24 |
+                static_cast<uint64_t>(features) << 32;
+            return h ^ (bits + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+        }
+    };
+
+    struct PipelineKeyHasher {
+        size_t operator()(const PipelineKey& key) const { return key.hash(); }
+    };
+
+    PipelineKey pipeline;
+    MaterialParams params;
+
+    /**
+     * @brief pipeline with the features the parameters need turned on.
+     *
+     * A positive alphaCutoff enables FeatureAlphaTest, a visible emissive
+     * FeatureEmissive; explicitly requested features are kept.
+     */
+    PipelineKey resolvePipeline() const {
+        PipelineKey key = pipeline;
+        if (params.alphaCutoff > 0.0f)
+            key.features |= FeatureAlphaTest;
+        if (params.emissive.a > 0.0f)
+            key.features |= FeatureEmissive;
+        return key;
+    }
+
+    /// Source image, cooked texture or atlas name, as for ResourceManager::requestMaterial
+    std::string texturePath;
+};
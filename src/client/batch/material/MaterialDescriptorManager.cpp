@@ -5,14 +5,15 @@
 MaterialDescriptorManager::MaterialDescriptorManager(
     VkDevice device,
     uint32_t maxMaterials,
-    std::vector<MaterialDescriptorManager::IMaterialLayoutProvider*> providers
+    std::vector<MaterialDescriptorManager::IMaterialLayoutProvider*> providers,
+    VkSampler engineSampler
 )
     : device(device)
 {
     MaterialLayoutBuilder builder(0, 7);
 
     // engine provider
-    EngineMaterialProvider engineProvider;
+    EngineMaterialProvider engineProvider(engineSampler);
     engineProvider.contribute(builder);
 
     // mods providers
@@ -29,7 +30,7 @@ MaterialDescriptorManager::MaterialDescriptorManager(
         vk.descriptorType = b.type;
         vk.descriptorCount = b.count;
         vk.stageFlags = b.stages;
-        vk.pImmutableSamplers = nullptr;
+        vk.pImmutableSamplers = b.immutableSamplers;
 
         vkBindings.push_back(vk);
     }
@@ -55,6 +56,8 @@ MaterialDescriptorManager::MaterialDescriptorManager(
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    // materials are evicted and reloaded by the ResourceManager cache
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
     poolInfo.maxSets = maxMaterials;
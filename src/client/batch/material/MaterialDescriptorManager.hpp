@@ -64,18 +64,30 @@ public:
      *
      * These bindings are considered engine-reserved and should not be reused
      * by external providers.
+     *
+     * With an immutable sampler both bindings bake it into the layout, and
+     * the sampler written with each descriptor is ignored.
      */
     class EngineMaterialProvider : public IMaterialLayoutProvider
     {
+    private:
+        VkSampler immutableSampler;
     public:
+        explicit EngineMaterialProvider(
+            VkSampler immutableSampler = VK_NULL_HANDLE
+        ) : immutableSampler(immutableSampler) {}
+
         void contribute(MaterialLayoutBuilder& builder) override
         {
+            const VkSampler* samplers = immutableSampler != VK_NULL_HANDLE ? &immutableSampler : nullptr;
+
             // Binding 0 reserved for albedo
             builder.addEngineBinding(
                 0,
                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 1,
-                VK_SHADER_STAGE_FRAGMENT_BIT
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                samplers
             );
 
             // Binding 1 reserved for normal
@@ -83,7 +95,8 @@ public:
                 1,
                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                 1,
-                VK_SHADER_STAGE_FRAGMENT_BIT
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                samplers
             );
         }
     };
@@ -105,13 +118,17 @@ public:
      * @param maxMaterials Maximum number of material descriptor sets that can be allocated.
      *                     This directly determines pool capacity.
      * @param providers External layout providers that contribute additional bindings.
+     * @param engineSampler Immutable sampler of the engine texture bindings, usually
+     *                      the default sampler of the SamplerCache. VK_NULL_HANDLE
+     *                      keeps the sampler of each written descriptor.
      *
      * @throws std::runtime_error if layout or pool creation fails.
      */
     MaterialDescriptorManager(
         VkDevice device,
         uint32_t maxMaterials,
-        std::vector<MaterialDescriptorManager::IMaterialLayoutProvider*> providers
+        std::vector<MaterialDescriptorManager::IMaterialLayoutProvider*> providers,
+        VkSampler engineSampler = VK_NULL_HANDLE
     );
 
     /**
@@ -12,7 +12,8 @@ void MaterialLayoutBuilder::addEngineBinding(
     uint32_t binding,
     VkDescriptorType type,
     uint32_t count,
-    VkShaderStageFlags stages
+    VkShaderStageFlags stages,
+    const VkSampler* immutableSamplers
 ) {
     if (usedBindings.count(binding))
         throw std::runtime_error("Engine binding already defined");
@@ -22,6 +23,7 @@ void MaterialLayoutBuilder::addEngineBinding(
     info.type = type;
     info.count = count;
     info.stages = stages;
+    info.immutableSamplers = immutableSamplers;
 
     bindings.push_back(info);
     usedBindings.insert(binding);
@@ -33,7 +35,8 @@ void MaterialLayoutBuilder::addBinding(
     uint32_t binding,
     VkDescriptorType type,
     uint32_t count,
-    VkShaderStageFlags stages
+    VkShaderStageFlags stages,
+    const VkSampler* immutableSamplers
 ) {
     if (binding >= reservedStart && binding <= reservedEnd)
         throw std::runtime_error("Binding is reserved for engine core");
@@ -46,6 +49,7 @@ void MaterialLayoutBuilder::addBinding(
     info.type = type;
     info.count = count;
     info.stages = stages;
+    info.immutableSamplers = immutableSamplers;
 
     bindings.push_back(info);
     usedBindings.insert(binding);
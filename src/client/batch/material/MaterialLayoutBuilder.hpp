@@ -42,6 +42,7 @@ public:
         VkDescriptorType type; ///< Descriptor type (e.g., uniform buffer, sampler)
         uint32_t count; ///< Number of descriptors for this binding
         VkShaderStageFlags stages; ///< Shader stages that can access this binding
+        const VkSampler* immutableSamplers; ///< count samplers baked into the layout, or nullptr
     };
 
 private:
@@ -90,6 +91,8 @@ public:
      * @param type Descriptor type.
      * @param count Number of descriptors for this binding.
      * @param stages Shader stages that can access this binding.
+     * @param immutableSamplers Optional samplers baked into the layout, one per
+     *                          descriptor. Must outlive the layout creation.
      *
      * @throws std::runtime_error if:
      * - The binding falls within the reserved range.
@@ -99,7 +102,8 @@ public:
         uint32_t binding,
         VkDescriptorType type,
         uint32_t count,
-        VkShaderStageFlags stages
+        VkShaderStageFlags stages,
+        const VkSampler* immutableSamplers = nullptr
     );
 
     /**
@@ -117,6 +121,8 @@ public:
      * @param type Descriptor type.
      * @param count Number of descriptors for this binding.
      * @param stages Shader stages that can access this binding.
+     * @param immutableSamplers Optional samplers baked into the layout, one per
+     *                          descriptor. Must outlive the layout creation.
      *
      * @throws std::runtime_error if the binding index was already defined.
      */
@@ -124,7 +130,8 @@ public:
         uint32_t binding,
         VkDescriptorType type,
         uint32_t count,
-        VkShaderStageFlags stages
+        VkShaderStageFlags stages,
+        const VkSampler* immutableSamplers = nullptr
     );
 
     const std::vector<BindingInfo>& getBindings() const { return bindings; }
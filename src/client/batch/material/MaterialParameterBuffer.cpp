@@ -0,0 +1,218 @@
+#include "MaterialParameterBuffer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+MaterialParameterBuffer::MaterialParameterBuffer(
+    VkDevice device,
+    BufferManager* bufferManager,
+    uint32_t framesInFlight,
+    uint32_t capacity
+) :
+    device(device),
+    capacity(capacity),
+    framesInFlight(framesInFlight)
+{
+    VkDeviceSize bufferSize = sizeof(MaterialParams) * capacity;
+
+    buffers.resize(framesInFlight);
+    memoryInfo.resize(framesInFlight);
+    mapped.resize(framesInFlight);
+    bufferVersions.assign(framesInFlight, 0);
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        bufferManager->createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            buffers[i]
+        );
+
+        bufferManager->allocateBufferMemory(
+            buffers[i],
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+            memoryInfo[i]
+        );
+
+        vkBindBufferMemory(device, buffers[i], memoryInfo[i].memory, 0);
+
+        vkMapMemory(
+            device,
+            memoryInfo[i].memory,
+            0,
+            bufferSize,
+            0,
+            &mapped[i]
+        );
+    }
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create material parameter descriptor set layout");
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create material parameter descriptor pool");
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(framesInFlight);
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate material parameter descriptor sets");
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = buffers[i];
+        bufferInfo.offset = 0;
+        bufferInfo.range = bufferSize;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSets[i];
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    // slot 0, the defaults of materials without a description
+    params.emplace_back();
+}
+
+MaterialParameterBuffer::~MaterialParameterBuffer()
+{
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (mapped[i])
+            vkUnmapMemory(device, memoryInfo[i].memory);
+
+        if (buffers[i])
+            vkDestroyBuffer(device, buffers[i], nullptr);
+
+        if (memoryInfo[i].memory)
+            vkFreeMemory(device, memoryInfo[i].memory, nullptr);
+    }
+
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    if (descriptorSetLayout)
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+uint32_t MaterialParameterBuffer::add(
+    const MaterialParams& values
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t index;
+    if (!freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+        params[index] = values;
+    }
+    else
+    {
+        if (params.size() >= capacity)
+            throw std::runtime_error("material parameter buffer is full");
+
+        index = static_cast<uint32_t>(params.size());
+        params.push_back(values);
+    }
+
+    version++;
+    return index;
+}
+
+void MaterialParameterBuffer::set(
+    uint32_t index,
+    const MaterialParams& values
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (index == 0 || index >= params.size())
+        throw std::runtime_error("invalid material parameter slot");
+
+    params[index] = values;
+    version++;
+}
+
+void MaterialParameterBuffer::release(
+    uint32_t index
+) {
+    if (index == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    released.push_back({frameIndex, index});
+}
+
+void MaterialParameterBuffer::flush(
+    uint32_t currentFrame
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    frameIndex++;
+
+    size_t write = 0;
+    for (size_t i = 0; i < released.size(); i++)
+    {
+        if (frameIndex - released[i].frame <= framesInFlight)
+            released[write++] = released[i];
+        else
+            freeIndices.push_back(released[i].index);
+    }
+    released.resize(write);
+
+    if (bufferVersions[currentFrame] == version)
+        return;
+
+    // the whole used range, edits are rare next to frames
+    VkDeviceSize size = params.size() * sizeof(MaterialParams);
+    std::memcpy(mapped[currentFrame], params.data(), static_cast<size_t>(size));
+
+    if (!memoryInfo[currentFrame].isCoherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = memoryInfo[currentFrame].memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+
+        vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    bufferVersions[currentFrame] = version;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../../CoreVulkan.hpp"
+#include "../../BufferManager.hpp"
+#include "MaterialDesc.hpp"
+
+/**
+ * @brief Parameters of every material in one storage buffer.
+ *
+ * Each material owns a slot; instances carry the slot in
+ * InstanceData::paramsIndex and shaders read
+ * MaterialParamsBuffer.params[paramsIndex], so parameter changes never
+ * touch descriptor sets and batches are not split by them.
+ *
+ * The set (set 3, binding 0) has one buffer per frame in flight. Slots
+ * are edited in a CPU copy and flush copies it to the buffer of the
+ * frame being recorded when that buffer is stale. Released slots are
+ * reused only framesInFlight frames later, like bindless texture slots.
+ *
+ * Slot 0 holds the default parameters and is never handed out.
+ */
+class MaterialParameterBuffer
+{
+private:
+    struct ReleasedSlot {
+        uint64_t frame;
+        uint32_t index;
+    };
+
+    VkDevice device;
+    uint32_t capacity;
+    uint32_t framesInFlight;
+
+    std::vector<VkBuffer> buffers;
+    std::vector<BufferManager::AllocatedMemoryINFO> memoryInfo;
+    std::vector<void*> mapped;
+
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    // guards everything below, slots are edited from loader threads
+    std::mutex mutex;
+    std::vector<MaterialParams> params;
+    std::vector<uint32_t> freeIndices;
+    std::vector<ReleasedSlot> released;
+    uint64_t frameIndex = 0;
+    // bumped on every edit, each frame buffer remembers the version it holds
+    uint64_t version = 1;
+    std::vector<uint64_t> bufferVersions;
+
+public:
+    /**
+     * @brief Creates the per-frame buffers, layout, pool and sets.
+     *
+     * @param device Logical Vulkan device.
+     * @param bufferManager Buffer creation utility.
+     * @param framesInFlight Number of per-frame buffers.
+     * @param capacity Maximum number of slots, including the default one.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    MaterialParameterBuffer(
+        VkDevice device,
+        BufferManager* bufferManager,
+        uint32_t framesInFlight,
+        uint32_t capacity
+    );
+
+    ~MaterialParameterBuffer();
+
+    MaterialParameterBuffer(const MaterialParameterBuffer&) = delete;
+    MaterialParameterBuffer& operator=(const MaterialParameterBuffer&) = delete;
+
+    /**
+     * @brief Stores parameters in a free slot.
+     *
+     * @return Slot index to store in InstanceData::paramsIndex.
+     *
+     * @throws std::runtime_error when every slot is in use.
+     */
+    uint32_t add(
+        const MaterialParams& values
+    );
+
+    /**
+     * @brief Changes the parameters of a slot; visible from the next flushed frame.
+     */
+    void set(
+        uint32_t index,
+        const MaterialParams& values
+    );
+
+    /**
+     * @brief Returns a slot; it is reused once no in-flight frame can read it.
+     */
+    void release(
+        uint32_t index
+    );
+
+    /**
+     * @brief Uploads the slots to the buffer of a frame if it is stale and recycles released slots.
+     *
+     * Render thread only, once per frame after the frame fence was waited on.
+     */
+    void flush(
+        uint32_t currentFrame
+    );
+
+    VkDescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+    const std::vector<VkDescriptorSet>& getDescriptorSets() const { return descriptorSets; }
+};
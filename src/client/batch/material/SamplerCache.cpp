@@ -0,0 +1,123 @@
+#include "SamplerCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+bool SamplerCache::SamplerDesc::operator==(
+    const SamplerDesc& other
+) const {
+    return magFilter == other.magFilter &&
+        minFilter == other.minFilter &&
+        mipmapMode == other.mipmapMode &&
+        addressModeU == other.addressModeU &&
+        addressModeV == other.addressModeV &&
+        addressModeW == other.addressModeW &&
+        borderColor == other.borderColor &&
+        anisotropyEnable == other.anisotropyEnable &&
+        maxAnisotropy == other.maxAnisotropy &&
+        compareEnable == other.compareEnable &&
+        compareOp == other.compareOp &&
+        mipLodBias == other.mipLodBias &&
+        minLod == other.minLod &&
+        maxLod == other.maxLod;
+}
+
+size_t SamplerCache::SamplerDescHasher::operator()(
+    const SamplerDesc& desc
+) const {
+    auto bits = [](float value)
+    {
+        uint32_t out;
+        std::memcpy(&out, &value, sizeof(out));
+        return out;
+    };
+
+    // the enums fit in a byte each
+    uint64_t h =
+        static_cast<uint64_t>(desc.magFilter) |
+        static_cast<uint64_t>(desc.minFilter) << 4 |
+        static_cast<uint64_t>(desc.mipmapMode) << 8 |
+        static_cast<uint64_t>(desc.addressModeU) << 12 |
+        static_cast<uint64_t>(desc.addressModeV) << 16 |
+        static_cast<uint64_t>(desc.addressModeW) << 20 |
+        static_cast<uint64_t>(desc.borderColor) << 24 |
+        static_cast<uint64_t>(desc.compareOp) << 32 |
+        static_cast<uint64_t>(desc.anisotropyEnable) << 40 |
+        static_cast<uint64_t>(desc.compareEnable) << 41;
+
+    for (uint32_t value : {bits(desc.maxAnisotropy), bits(desc.mipLodBias), bits(desc.minLod), bits(desc.maxLod)})
+    {
+        h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    }
+
+    return static_cast<size_t>(h);
+}
+
+VkSamplerCreateInfo SamplerCache::makeCreateInfo(
+    const SamplerDesc& desc,
+    float deviceMaxAnisotropy
+) {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = desc.magFilter;
+    samplerInfo.minFilter = desc.minFilter;
+
+    samplerInfo.addressModeU = desc.addressModeU;
+    samplerInfo.addressModeV = desc.addressModeV;
+    samplerInfo.addressModeW = desc.addressModeW;
+
+    samplerInfo.anisotropyEnable = desc.anisotropyEnable ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = desc.maxAnisotropy > 0.0f
+        ? std::min(desc.maxAnisotropy, deviceMaxAnisotropy)
+        : deviceMaxAnisotropy;
+
+    samplerInfo.borderColor = desc.borderColor;
+
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = desc.compareEnable ? VK_TRUE : VK_FALSE;
+    samplerInfo.compareOp = desc.compareOp;
+
+    samplerInfo.mipmapMode = desc.mipmapMode;
+    samplerInfo.mipLodBias = desc.mipLodBias;
+    samplerInfo.minLod = desc.minLod;
+    samplerInfo.maxLod = desc.maxLod;
+
+    return samplerInfo;
+}
+
+SamplerCache::SamplerCache(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device
+) :
+    device(device)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    deviceMaxAnisotropy = properties.limits.maxSamplerAnisotropy;
+}
+
+SamplerCache::~SamplerCache()
+{
+    for (auto& [desc, sampler] : samplers)
+        vkDestroySampler(device, sampler, nullptr);
+}
+
+VkSampler SamplerCache::get(
+    const SamplerDesc& desc
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = samplers.find(desc);
+    if (it != samplers.end())
+        return it->second;
+
+    VkSamplerCreateInfo samplerInfo = makeCreateInfo(desc, deviceMaxAnisotropy);
+
+    VkSampler sampler;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture sampler!");
+
+    samplers.emplace(desc, sampler);
+    return sampler;
+}
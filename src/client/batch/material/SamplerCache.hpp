@@ -0,0 +1,97 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include "../../CoreVulkan.hpp"
+
+/**
+ * @brief Deduplicates VkSampler objects by their state.
+ *
+ * Nearly every texture samples the same way, so textures reference a
+ * shared sampler instead of owning one. Samplers live until the cache
+ * is destroyed, which must happen after every texture and descriptor
+ * set using them.
+ *
+ * The device anisotropy limit is queried once at construction.
+ */
+class SamplerCache
+{
+public:
+    /**
+     * @brief Sampler state, the cache key.
+     *
+     * Defaults match the engine material sampler: trilinear, repeat,
+     * maximum anisotropy.
+     */
+    struct SamplerDesc {
+        VkFilter magFilter = VK_FILTER_LINEAR;
+        VkFilter minFilter = VK_FILTER_LINEAR;
+        VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+        bool anisotropyEnable = true;
+        /// Clamped to the device limit, 0 means the device maximum
+        float maxAnisotropy = 0.0f;
+
+        bool compareEnable = false;
+        VkCompareOp compareOp = VK_COMPARE_OP_ALWAYS;
+
+        float mipLodBias = 0.0f;
+        float minLod = 0.0f;
+        float maxLod = VK_LOD_CLAMP_NONE;
+
+        bool operator==(const SamplerDesc& other) const;
+    };
+
+    struct SamplerDescHasher {
+        size_t operator()(const SamplerDesc& desc) const;
+    };
+
+private:
+    VkDevice device;
+    float deviceMaxAnisotropy;
+
+    std::mutex mutex;
+    std::unordered_map<SamplerDesc, VkSampler, SamplerDescHasher> samplers;
+
+public:
+    /**
+     * @brief Fills a VkSamplerCreateInfo from a description.
+     *
+     * @param deviceMaxAnisotropy limits.maxSamplerAnisotropy of the device.
+     */
+    static VkSamplerCreateInfo makeCreateInfo(
+        const SamplerDesc& desc,
+        float deviceMaxAnisotropy
+    );
+
+    SamplerCache(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device
+    );
+
+    /**
+     * @brief Destroys every cached sampler.
+     */
+    ~SamplerCache();
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    /**
+     * @brief Returns the sampler for a state, creating it on first use.
+     *
+     * Thread-safe. The cache keeps ownership.
+     *
+     * @throws std::runtime_error if sampler creation fails.
+     */
+    VkSampler get(
+        const SamplerDesc& desc
+    );
+
+    float getDeviceMaxAnisotropy() const { return deviceMaxAnisotropy; }
+};
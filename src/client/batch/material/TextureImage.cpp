@@ -1,6 +1,12 @@
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 #include "TextureImage.hpp"
+#include "texture/MipGenerator.hpp"
+#include "texture/PixelConvert.hpp"
+#include "io/MappedFile.hpp"
 #include "../../image/VulkanImageUtils.hpp"
 
 void TextureImage::DefaultImageTransitionPolicy::transition(
@@ -79,27 +85,84 @@ void TextureImage::DefaultImageTransitionPolicy::transition(
     bufferManager->endImmediate();
 }
 
+TextureImage::LoadedImage TextureImage::LoadedImage::solidColor(
+    int width,
+    int height,
+    const stbi_uc rgba[4]
+) {
+    LoadedImage img;
+    img.width = width;
+    img.height = height;
+    img.size = static_cast<VkDeviceSize>(width) * height * 4;
+    img.pixels = static_cast<stbi_uc*>(malloc(static_cast<size_t>(img.size)));
+
+    if (!img.pixels) {
+        throw std::runtime_error("failed to allocate placeholder image");
+    }
+
+    for (VkDeviceSize i = 0; i < img.size; i += 4)
+        memcpy(img.pixels + i, rgba, 4);
+
+    return img;
+}
+
+void TextureImage::decodeImageFromFile(
+    const std::string& path,
+    LoadedImage& img,
+    int& channels
+) {
+    const MappedFile file(path);
+    const stbi_uc* bytes = file.data();
+    const int length = static_cast<int>(file.size());
+
+    int sourceChannels = 0;
+    if (!bytes || !stbi_info_from_memory(bytes, length, &img.width, &img.height, &sourceChannels)) {
+        throw std::runtime_error("failed to load texture image");
+    }
+
+    // stb expands RGB to RGBA one texel at a time, PixelConvert does it vectorized
+    channels = sourceChannels == 3 ? 3 : 4;
+    img.pixels = stbi_load_from_memory(bytes, length, &img.width, &img.height, &sourceChannels, channels);
+
+    if (!img.pixels || img.width <= 0 || img.height <= 0) {
+        throw std::runtime_error("failed to load texture image");
+    }
+    img.size = static_cast<VkDeviceSize>(img.width) * img.height * channels;
+}
+
 void TextureImage::loadImageFromFile(
     const std::string& path,
     LoadedImage& img
 ) {
     int channels;
-    img.pixels = stbi_load(path.c_str(), &img.width, &img.height, &channels, STBI_rgb_alpha);
+    decodeImageFromFile(path, img, channels);
 
-    if (!img.pixels || img.width <= 0 || img.height <= 0) {
-        throw std::runtime_error("failed to load texture image");
+    if (channels == 4)
+        return;
+
+    LoadedImage rgba;
+    rgba.width = img.width;
+    rgba.height = img.height;
+    rgba.size = static_cast<VkDeviceSize>(img.width) * img.height * 4;
+    rgba.pixels = static_cast<stbi_uc*>(malloc(static_cast<size_t>(rgba.size)));
+
+    if (!rgba.pixels) {
+        throw std::runtime_error("failed to allocate texture image");
     }
-    img.size = static_cast<VkDeviceSize>(img.width) * img.height * 4;
+
+    PixelConvert::rgbToRgba(img.pixels, rgba.pixels, static_cast<size_t>(img.width) * img.height);
+    img = std::move(rgba);
 }
 
 void TextureImage::createStagingBuffer(
     BufferManager* bufferManager,
-    const LoadedImage& img,
+    const void* pixels,
+    VkDeviceSize size,
     VkBuffer& buffer,
     VkDeviceMemory& memory
 ) {
     bufferManager->createBuffer(
-        img.size,
+        size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         buffer
     );
@@ -113,8 +176,8 @@ void TextureImage::createStagingBuffer(
     vkBindBufferMemory(device, buffer, memory, 0);
 
     void* data;
-    vkMapMemory(device, memory, 0, img.size, 0, &data);
-    memcpy(data, img.pixels, static_cast<size_t>(img.size));
+    vkMapMemory(device, memory, 0, size, 0, &data);
+    memcpy(data, pixels, static_cast<size_t>(size));
     vkUnmapMemory(device, memory);
 }
 
@@ -122,58 +185,42 @@ void TextureImage::createTextureImageView(){
     textureImageView = createImageView(
         device,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        format,
         VK_IMAGE_ASPECT_COLOR_BIT,
         mipLevels
     );
 }
 
 void TextureImage::createTextureSampler(
-    VkPhysicalDevice physicalDevice
+    VkPhysicalDevice physicalDevice,
+    const TextureImageDesc& desc
 ) {
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    if (desc.samplerCache) {
+        textureSampler = desc.samplerCache->get(desc.sampler);
+        ownsSampler = false;
+        return;
+    }
 
-    samplerInfo.anisotropyEnable = VK_TRUE;
     VkPhysicalDeviceProperties properties{};
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-    samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy; //TODO it`s on max quality sould change this?
-
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VkSamplerCreateInfo samplerInfo = SamplerCache::makeCreateInfo(
+        desc.sampler,
+        properties.limits.maxSamplerAnisotropy
+    );
 
     if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
     }
+    ownsSampler = true;
 }
 
 void TextureImage::createTextureImage(
     VkPhysicalDevice physicalDevice,
-    const std::string& path,
+    const LoadedImage& img,
     BufferManager* bufferManager,
     const TextureImageDesc& desc,
     IImageTransitionPolicy* transitionPolicy
 ) {
-    LoadedImage img{};
-    loadImageFromFile(
-        path,
-        img
-    );
-
     if (desc.generateMipmaps) {
         mipLevels = static_cast<uint32_t>(
             std::floor(std::log2(std::max(img.width, img.height)))
@@ -181,9 +228,12 @@ void TextureImage::createTextureImage(
     } else {
         mipLevels = 1;
     }
+    format = desc.format;
+    width = static_cast<uint32_t>(img.width);
+    height = static_cast<uint32_t>(img.height);
 
     StagingBufferRAII staging(device);
-    createStagingBuffer(bufferManager, img, staging.buffer, staging.memory);
+    createStagingBuffer(bufferManager, img.pixels, img.size, staging.buffer, staging.memory);
 
     // createGpuImage
     createImage(
@@ -201,11 +251,15 @@ void TextureImage::createTextureImage(
         textureImageMemory
     );
 
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+    memorySize = memRequirements.size;
+
     // uploadToGpu
     transitionPolicy->transition(
         bufferManager,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        format,
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         mipLevels
@@ -223,13 +277,132 @@ void TextureImage::createTextureImage(
         physicalDevice,
         bufferManager,
         textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
+        format,
         img.width,
         img.height,
         mipLevels
     );
 }
 
+void TextureImage::createTextureImage(
+    VkPhysicalDevice physicalDevice,
+    const TextureContainer& container,
+    BufferManager* bufferManager,
+    const TextureImageDesc& desc,
+    IImageTransitionPolicy* transitionPolicy
+) {
+    if (container.mips.empty()) {
+        throw std::runtime_error("texture container has no mip levels");
+    }
+
+    // streamed textures skip their finest levels, the first uploaded one becomes level 0
+    const uint32_t firstMip = std::min(desc.firstMip, static_cast<uint32_t>(container.mips.size()) - 1);
+
+    // only stage the bytes of the uploaded levels
+    uint64_t dataBegin = container.totalSize();
+    uint64_t dataEnd = 0;
+    for (uint32_t level = firstMip; level < container.mips.size(); level++) {
+        dataBegin = std::min(dataBegin, container.mips[level].offset);
+        dataEnd = std::max(dataEnd, container.mips[level].offset + container.mips[level].size);
+    }
+
+    StagingBufferRAII staging(device);
+    createStagingBuffer(
+        bufferManager,
+        container.data.data() + dataBegin,
+        dataEnd - dataBegin,
+        staging.buffer,
+        staging.memory
+    );
+
+    createTextureImage(
+        physicalDevice,
+        container,
+        firstMip,
+        staging.buffer,
+        container.mips[firstMip].offset - dataBegin,
+        bufferManager,
+        desc,
+        transitionPolicy
+    );
+}
+
+void TextureImage::createTextureImage(
+    VkPhysicalDevice physicalDevice,
+    const TextureContainer& container,
+    uint32_t firstMip,
+    VkBuffer stagingBuffer,
+    VkDeviceSize bufferOffset,
+    BufferManager* bufferManager,
+    const TextureImageDesc& desc,
+    IImageTransitionPolicy* transitionPolicy
+) {
+    format = static_cast<VkFormat>(container.format);
+    mipLevels = static_cast<uint32_t>(container.mips.size()) - firstMip;
+    width = container.mips[firstMip].width;
+    height = container.mips[firstMip].height;
+
+    // transfer source so streaming can copy the levels it keeps
+    createImage(
+        physicalDevice,
+        device,
+        width,
+        height,
+        mipLevels,
+        desc.samples,
+        format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        textureImage,
+        textureImageMemory
+    );
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+    memorySize = memRequirements.size;
+
+    std::vector<VkBufferImageCopy> regions(mipLevels);
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        const TextureContainer::Mip& mip = container.mips[firstMip + level];
+
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = bufferOffset + mip.offset - container.mips[firstMip].offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {mip.width, mip.height, 1};
+    }
+
+    transitionPolicy->transition(
+        bufferManager,
+        textureImage,
+        format,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        mipLevels
+    );
+
+    bufferManager->copyBufferToImage(
+        stagingBuffer,
+        textureImage,
+        regions
+    );
+
+    transitionPolicy->transition(
+        bufferManager,
+        textureImage,
+        format,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        mipLevels
+    );
+}
+
 TextureImage::TextureImage(
     VkPhysicalDevice physicalDevice,
     VkDevice device,
@@ -240,9 +413,260 @@ TextureImage::TextureImage(
 ) :
     device(device)
 {
-    createTextureImage(physicalDevice, path, bufferManager, desc, transitionPolicy);
+    LoadedImage img{};
+    loadImageFromFile(
+        path,
+        img
+    );
+
+    if (desc.generateMipmaps) {
+        // precomputed on the CPU, uploaded with a single copy
+        TextureContainer container = MipGenerator::generate(
+            img.pixels,
+            static_cast<uint32_t>(img.width),
+            static_cast<uint32_t>(img.height),
+            desc.format == VK_FORMAT_R8G8B8A8_SRGB
+        );
+        createTextureImage(physicalDevice, container, bufferManager, desc, transitionPolicy);
+    } else {
+        createTextureImage(physicalDevice, img, bufferManager, desc, transitionPolicy);
+    }
+    createTextureImageView();
+    createTextureSampler(physicalDevice, desc);
+}
+
+TextureImage::TextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    const LoadedImage& img,
+    BufferManager* bufferManager,
+    const TextureImageDesc& desc,
+    IImageTransitionPolicy* transitionPolicy
+) :
+    device(device)
+{
+    createTextureImage(physicalDevice, img, bufferManager, desc, transitionPolicy);
+    createTextureImageView();
+    createTextureSampler(physicalDevice, desc);
+}
+
+TextureImage::TextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    const TextureContainer& container,
+    BufferManager* bufferManager,
+    const TextureImageDesc& desc,
+    IImageTransitionPolicy* transitionPolicy
+) :
+    device(device)
+{
+    createTextureImage(physicalDevice, container, bufferManager, desc, transitionPolicy);
     createTextureImageView();
-    createTextureSampler(physicalDevice);
+    createTextureSampler(physicalDevice, desc);
+}
+
+TextureImage::TextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    const TextureContainer& layout,
+    const StagedTexture& staged,
+    BufferManager* bufferManager,
+    const TextureImageDesc& desc,
+    IImageTransitionPolicy* transitionPolicy
+) :
+    device(device)
+{
+    if (layout.mips.empty()) {
+        throw std::runtime_error("texture container has no mip levels");
+    }
+
+    const uint32_t firstMip = std::min(desc.firstMip, static_cast<uint32_t>(layout.mips.size()) - 1);
+    createTextureImage(
+        physicalDevice,
+        layout,
+        firstMip,
+        staged.buffer,
+        staged.offset + layout.mips[firstMip].offset,
+        bufferManager,
+        desc,
+        transitionPolicy
+    );
+    createTextureImageView();
+    createTextureSampler(physicalDevice, desc);
+}
+
+TextureImage::TextureImage(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    const TextureImage& source,
+    uint32_t sourceLevel,
+    const TextureContainer& layout,
+    const StagedTexture& staged,
+    VkCommandBuffer commandBuffer,
+    const TextureImageDesc& desc
+) :
+    device(device)
+{
+    const uint32_t firstMip = desc.firstMip;
+    const uint32_t endLevel = sourceLevel + source.mipLevels;
+    if (firstMip >= endLevel) {
+        throw std::runtime_error("streamed texture keeps no mip level");
+    }
+    if (firstMip < sourceLevel && staged.buffer == VK_NULL_HANDLE) {
+        throw std::runtime_error("streamed mip levels were not staged");
+    }
+
+    // levels finer than the source are uploaded, the others copied from it
+    const uint32_t uploaded = firstMip < sourceLevel ? sourceLevel - firstMip : 0;
+    const uint32_t copiedFrom = firstMip + uploaded - sourceLevel;
+
+    format = source.format;
+    mipLevels = endLevel - firstMip;
+    if (uploaded > 0) {
+        width = layout.mips[firstMip].width;
+        height = layout.mips[firstMip].height;
+    } else {
+        width = std::max(source.width >> copiedFrom, 1u);
+        height = std::max(source.height >> copiedFrom, 1u);
+    }
+
+    createImage(
+        physicalDevice,
+        device,
+        width,
+        height,
+        mipLevels,
+        desc.samples,
+        format,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        textureImage,
+        textureImageMemory
+    );
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, textureImage, &memRequirements);
+    memorySize = memRequirements.size;
+
+    // nothing may throw once commands reference the image
+    createTextureImageView();
+    createTextureSampler(physicalDevice, desc);
+
+    std::vector<VkBufferImageCopy> uploads(uploaded);
+    for (uint32_t level = 0; level < uploaded; level++) {
+        const TextureContainer::Mip& mip = layout.mips[firstMip + level];
+
+        VkBufferImageCopy& region = uploads[level];
+        region.bufferOffset = staged.offset + mip.offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {mip.width, mip.height, 1};
+    }
+
+    std::vector<VkImageCopy> copies(mipLevels - uploaded);
+    for (uint32_t i = 0; i < copies.size(); i++) {
+        const uint32_t sourceMip = copiedFrom + i;
+
+        VkImageCopy& region = copies[i];
+        region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, sourceMip, 0, 1};
+        region.srcOffset = {0, 0, 0};
+        region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, uploaded + i, 0, 1};
+        region.dstOffset = {0, 0, 0};
+        region.extent = {
+            std::max(source.width >> sourceMip, 1u),
+            std::max(source.height >> sourceMip, 1u),
+            1
+        };
+    }
+
+    // the default policy has no transitions for a sampled copy source, record them here
+    VkImageMemoryBarrier barriers[2]{};
+    for (VkImageMemoryBarrier& barrier : barriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+    }
+
+    VkImageMemoryBarrier& target = barriers[0];
+    target.image = textureImage;
+    target.subresourceRange.baseMipLevel = 0;
+    target.subresourceRange.levelCount = mipLevels;
+
+    VkImageMemoryBarrier& kept = barriers[1];
+    kept.image = source.textureImage;
+    kept.subresourceRange.baseMipLevel = copiedFrom;
+    kept.subresourceRange.levelCount = static_cast<uint32_t>(copies.size());
+
+    target.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    target.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    target.srcAccessMask = 0;
+    target.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    kept.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    kept.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    kept.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    kept.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        2,
+        barriers
+    );
+
+    if (!uploads.empty()) {
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            staged.buffer,
+            textureImage,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(uploads.size()),
+            uploads.data()
+        );
+    }
+
+    vkCmdCopyImage(
+        commandBuffer,
+        source.textureImage,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        textureImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copies.size()),
+        copies.data()
+    );
+
+    target.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    target.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    target.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    target.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    kept.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    kept.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    kept.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    kept.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        2,
+        barriers
+    );
 }
 
 TextureImage::~TextureImage()
@@ -253,7 +677,7 @@ TextureImage::~TextureImage()
     if (textureImageMemory != VK_NULL_HANDLE)
         vkFreeMemory(device, textureImageMemory, nullptr);
 
-    if (textureSampler != VK_NULL_HANDLE)
+    if (ownsSampler && textureSampler != VK_NULL_HANDLE)
         vkDestroySampler(device, textureSampler, nullptr);
 
     if (textureImageView != VK_NULL_HANDLE)
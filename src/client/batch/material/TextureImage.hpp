@@ -1,21 +1,25 @@
 #pragma once
 
 #include "stb_image.h"
+#include "texture/TextureContainer.hpp"
 #include "../../CoreVulkan.hpp"
 #include "../../BufferManager.hpp"
+#include "SamplerCache.hpp"
 
 /**
  * @brief Represents a GPU texture loaded from an image file.
  *
  * TextureImage encapsulates the full lifetime and upload process of a 2D texture:
- * - Image loading via stb_image
+ * - Image loading via stb_image from a memory-mapped file, or a
+ *   pre-compressed KTX2/DDS container
  * - CPU staging buffer creation
  * - GPU image creation
  * - Layout transitions
  * - Optional mipmap generation
- * - Image view and sampler creation
+ * - Image view creation, and a sampler shared through a SamplerCache
  *
- * The class owns all Vulkan resources it creates and releases them on destruction.
+ * The class owns all Vulkan resources it creates and releases them on
+ * destruction, except samplers taken from a SamplerCache.
  */
 class TextureImage
 {
@@ -39,8 +43,30 @@ public:
         /// Sample count (normally 1 for textures)
         VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
 
-        /// Whether mipmaps should be generated on the GPU
+        /**
+         * Whether mipmaps should be generated on the GPU with a blit chain.
+         *
+         * Only used when uploading a LoadedImage. Prefer a TextureContainer
+         * with precomputed mips (MipGenerator), which uploads in one copy
+         * and needs no linear-blit support.
+         */
         bool generateMipmaps = true;
+
+        /**
+         * First level of a TextureContainer to upload; it becomes level 0
+         * of the image. Used by mip streaming to keep the finest levels
+         * out of VRAM. Clamped to the coarsest level.
+         */
+        uint32_t firstMip = 0;
+
+        /// Sampler state
+        SamplerCache::SamplerDesc sampler{};
+
+        /**
+         * Shared samplers. When null the texture creates and owns its
+         * sampler, querying the device limits on every texture.
+         */
+        SamplerCache* samplerCache = nullptr;
     };
 
 
@@ -104,14 +130,6 @@ public:
         DefaultImageTransitionPolicy() = default;
     };
 
-protected:
-    VkDevice device;
-    uint32_t mipLevels;
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
-    VkImageView textureImageView;
-    VkSampler textureSampler;
-
     /**
      * @brief RAII wrapper for image data loaded from disk.
      *
@@ -132,6 +150,17 @@ protected:
 
         LoadedImage()
         : width(0), height(0), size(0), pixels(nullptr) {}
+
+        /**
+         * @brief Creates a solid color RGBA8 image, used for placeholders.
+         *
+         * Memory comes from malloc, which is what stbi_image_free releases.
+         */
+        static LoadedImage solidColor(
+            int width,
+            int height,
+            const stbi_uc rgba[4]
+        );
         //block copy
         LoadedImage(const LoadedImage&) = delete;
         LoadedImage& operator=(const LoadedImage&) = delete;
@@ -160,6 +189,61 @@ protected:
         }
     };
 
+    /**
+     * @brief Container data already written to a StagingRing region.
+     */
+    struct StagedTexture {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        /// Offset of the container byte 0 in buffer
+        VkDeviceSize offset = 0;
+    };
+
+    /**
+     * @brief Decodes a memory-mapped image file without the RGBA expansion.
+     *
+     * RGB sources stay packed RGB8 (channels = 3), so the caller can
+     * expand them straight into their final memory with
+     * PixelConvert::rgbToRgba. Every other source is RGBA8
+     * (channels = 4), size always describes the returned pixels.
+     * Safe to call from worker threads.
+     *
+     * @param path File path.
+     * @param img Output decoded image.
+     * @param channels Output channel count of img.pixels, 3 or 4.
+     */
+    static void decodeImageFromFile(
+        const std::string& path,
+        LoadedImage& img,
+        int& channels
+    );
+
+    /**
+     * @brief Loads an image from disk into CPU memory.
+     *
+     * The image is always converted to RGBA8 format.
+     * Does not touch Vulkan, so it is safe to call from worker threads.
+     *
+     * @param path File path.
+     * @param img Output loaded image.
+     */
+    static void loadImageFromFile(
+        const std::string& path,
+        LoadedImage& img
+    );
+
+protected:
+    VkDevice device;
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t mipLevels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkImage textureImage;
+    VkDeviceMemory textureImageMemory;
+    VkImageView textureImageView;
+    VkSampler textureSampler = VK_NULL_HANDLE;
+    bool ownsSampler = false;
+    VkDeviceSize memorySize = 0;
+
     /**
      * @brief RAII wrapper for a staging buffer used during texture upload.
      *
@@ -190,30 +274,19 @@ protected:
     };
 
 
-        /**
-     * @brief Loads an image from disk into CPU memory.
-     *
-     * The image is always converted to RGBA8 format.
-     *
-     * @param path File path.
-     * @param img Output loaded image.
-     */
-    void loadImageFromFile(
-        const std::string& path,
-        LoadedImage& img
-    );
-
     /**
      * @brief Creates a host-visible staging buffer and uploads pixel data.
      *
      * @param bufferManager Buffer creation utility.
-     * @param img Loaded CPU image.
+     * @param pixels Texel or block data to upload.
+     * @param size Size of the data in bytes.
      * @param buffer Output staging buffer.
      * @param memory Output staging memory.
      */
     void createStagingBuffer(
         BufferManager* bufferManager,
-        const LoadedImage& img,
+        const void* pixels,
+        VkDeviceSize size,
         VkBuffer& buffer,
         VkDeviceMemory& memory
     );
@@ -230,28 +303,62 @@ protected:
      */
     void createTextureImage(
         VkPhysicalDevice physicalDevice,
-        const std::string& path,
+        const LoadedImage& img,
         BufferManager* bufferManager,
         const TextureImageDesc& desc,
         IImageTransitionPolicy* transitionPolicy
     );
+    /**
+     * @brief Creates the GPU image from a container and uploads every mip level.
+     *
+     * All levels are copied with a single multi-region command, no
+     * mipmaps are generated on the GPU.
+     */
+    void createTextureImage(
+        VkPhysicalDevice physicalDevice,
+        const TextureContainer& container,
+        BufferManager* bufferManager,
+        const TextureImageDesc& desc,
+        IImageTransitionPolicy* transitionPolicy
+    );
+    /**
+     * @brief Creates the GPU image and copies its levels from a buffer laid out like the container.
+     *
+     * @param bufferOffset Offset of mip level firstMip in stagingBuffer.
+     */
+    void createTextureImage(
+        VkPhysicalDevice physicalDevice,
+        const TextureContainer& container,
+        uint32_t firstMip,
+        VkBuffer stagingBuffer,
+        VkDeviceSize bufferOffset,
+        BufferManager* bufferManager,
+        const TextureImageDesc& desc,
+        IImageTransitionPolicy* transitionPolicy
+    );
+
     /**
      * @brief Creates the image view for the texture.
      */
     void createTextureImageView();
     /**
-     * @brief Creates the Vulkan sampler for the texture.
+     * @brief Picks the sampler for the texture.
      *
-     * Uses linear filtering, repeat addressing and max supported anisotropy.
+     * Taken from desc.samplerCache when set, otherwise created from
+     * desc.sampler and owned by the texture.
      */
     void createTextureSampler(
-        VkPhysicalDevice physicalDevice
+        VkPhysicalDevice physicalDevice,
+        const TextureImageDesc& desc
     );
 
 public:
     /**
      * @brief Loads a texture from disk and uploads it to the GPU.
      *
+     * When desc.generateMipmaps is set, the chain is built on the CPU
+     * with MipGenerator and uploaded in one copy.
+     *
      * @param physicalDevice Physical device used for limits and memory selection.
      * @param device Logical Vulkan device.
      * @param path Image file path.
@@ -267,6 +374,111 @@ public:
         const TextureImageDesc& desc,
         IImageTransitionPolicy* transitionPolicy
     );
+
+    /**
+     * @brief Uploads an image already decoded in CPU memory.
+     *
+     * Lets the file IO and decode run on a worker thread while the upload
+     * stays on the render thread.
+     *
+     * @param physicalDevice Physical device used for limits and memory selection.
+     * @param device Logical Vulkan device.
+     * @param img Decoded RGBA8 image.
+     * @param bufferManager Command and buffer helper.
+     * @param desc Texture creation parameters.
+     * @param transitionPolicy Image layout transition policy.
+     */
+    TextureImage(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        const LoadedImage& img,
+        BufferManager* bufferManager,
+        const TextureImageDesc& desc,
+        IImageTransitionPolicy* transitionPolicy
+    );
+
+    /**
+     * @brief Uploads a pre-compressed texture with its mip chain.
+     *
+     * The container format is used as is; desc.format and
+     * desc.generateMipmaps are ignored. Levels before desc.firstMip
+     * are not uploaded. Check the format with
+     * CoreVulkan::isFormatSupported before calling.
+     *
+     * @param physicalDevice Physical device used for limits and memory selection.
+     * @param device Logical Vulkan device.
+     * @param container Texture loaded from a KTX2 or DDS file.
+     * @param bufferManager Command and buffer helper.
+     * @param desc Texture creation parameters.
+     * @param transitionPolicy Image layout transition policy.
+     */
+    TextureImage(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        const TextureContainer& container,
+        BufferManager* bufferManager,
+        const TextureImageDesc& desc,
+        IImageTransitionPolicy* transitionPolicy
+    );
+
+    /**
+     * @brief Uploads a texture whose data a worker wrote to a StagingRing.
+     *
+     * No staging buffer is created and nothing is copied on the CPU.
+     * The region can be freed once the constructor returns.
+     *
+     * @param physicalDevice Physical device used for limits and memory selection.
+     * @param device Logical Vulkan device.
+     * @param layout Format and mip offsets; its data is ignored.
+     * @param staged Buffer holding the container bytes.
+     * @param bufferManager Command and buffer helper.
+     * @param desc Texture creation parameters.
+     * @param transitionPolicy Image layout transition policy.
+     */
+    TextureImage(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        const TextureContainer& layout,
+        const StagedTexture& staged,
+        BufferManager* bufferManager,
+        const TextureImageDesc& desc,
+        IImageTransitionPolicy* transitionPolicy
+    );
+
+    /**
+     * @brief Rebuilds a streamed texture with another finest level, copying the levels it keeps on the GPU.
+     *
+     * source holds the levels from sourceLevel of the full chain, the new
+     * texture those from desc.firstMip. Levels both hold are copied image
+     * to image; finer ones are uploaded from staged, laid out like
+     * layout. Dropping levels uploads nothing and ignores layout and staged.
+     *
+     * The copies are only recorded into commandBuffer: nothing waits, so
+     * source and staged must outlive its execution, and the texture must
+     * not be sampled before it completed.
+     *
+     * @param physicalDevice Physical device used for limits and memory selection.
+     * @param device Logical Vulkan device.
+     * @param source Texture currently bound, in SHADER_READ_ONLY_OPTIMAL.
+     * @param sourceLevel Level of the full chain that is level 0 of source.
+     * @param layout Mip extents and offsets of the uploaded levels.
+     * @param staged Buffer holding the uploaded levels.
+     * @param commandBuffer Command buffer in the recording state.
+     * @param desc Texture creation parameters.
+     *
+     * @throws std::runtime_error if no level of source is kept.
+     */
+    TextureImage(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        const TextureImage& source,
+        uint32_t sourceLevel,
+        const TextureContainer& layout,
+        const StagedTexture& staged,
+        VkCommandBuffer commandBuffer,
+        const TextureImageDesc& desc
+    );
+
     /**
      * @brief Releases all Vulkan resources owned by the texture.
      */
@@ -276,4 +488,8 @@ public:
     const VkDeviceMemory& getTextureImageMemory() const { return textureImageMemory; }
     const VkImageView& getTextureImageView() const { return textureImageView; }
     const VkSampler& getTextureSampler() const { return textureSampler; }
+    VkFormat getFormat() const { return format; }
+
+    /// Size of the device memory backing the image, including all mips
+    VkDeviceSize getMemorySize() const { return memorySize; }
 };
\ No newline at end of file
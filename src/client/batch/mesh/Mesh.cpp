@@ -1,5 +1,7 @@
 #include "Mesh.hpp"
 
+#include <cmath>
+
 void Mesh::load(
     const std::string& path,
     std::vector<Vertex>& vertices,
@@ -49,7 +51,14 @@ void Mesh::load(
                     mesh->mTextureCoords[0][v].x,
                     mesh->mTextureCoords[0][v].y
                 }
-                : glm::vec2{ 0.0f, 0.0f }
+                : glm::vec2{ 0.0f, 0.0f },
+            mesh->mNormals
+                ? glm::vec3{
+                    mesh->mNormals[v].x,
+                    mesh->mNormals[v].y,
+                    mesh->mNormals[v].z
+                }
+                : glm::vec3{ 0.0f, 0.0f, 1.0f }
             });
         }
 
@@ -64,20 +73,123 @@ void Mesh::load(
     }
 }
 
-Mesh::Mesh(
+Mesh::MeshData Mesh::loadData(
     const std::string& path,
-    VkDevice device,
-    BufferManager* bufferManager
+    const MeshSimplifier::LodChainDesc& lodDesc
 ) {
-    std::vector<Vertex> vertices;
+    MeshData data;
     std::vector<uint32_t> indices;
     load(
         path,
-        vertices,
+        data.vertices,
         indices
     );
 
-    vertexBufferManager = std::make_unique<VertexBufferManager>(device, bufferManager, vertices);
-    indexCount = static_cast<uint32_t>(indices.size());
-    indexBufferManager = std::make_unique<IndexBufferManager>(device, bufferManager, indices);
-}
\ No newline at end of file
+    //bounding sphere, used for LOD selection
+    if (!data.vertices.empty()) {
+        glm::vec3 minPos = data.vertices[0].pos;
+        glm::vec3 maxPos = data.vertices[0].pos;
+        for (const Vertex& v : data.vertices) {
+            minPos = glm::min(minPos, v.pos);
+            maxPos = glm::max(maxPos, v.pos);
+        }
+        data.boundsCenter = (minPos + maxPos) * 0.5f;
+        for (const Vertex& v : data.vertices)
+            data.boundsRadius = std::max(data.boundsRadius, glm::length(v.pos - data.boundsCenter));
+    }
+
+    //all levels share the vertex buffer and are packed in one index buffer
+    std::vector<MeshSimplifier::Level> levels = MeshSimplifier::buildLodChain(
+        data.vertices,
+        indices,
+        lodDesc
+    );
+
+    data.indices.reserve(indices.size() * 2);
+    data.lods.reserve(levels.size());
+    for (const MeshSimplifier::Level& level : levels) {
+        data.lods.push_back({
+            static_cast<uint32_t>(data.indices.size()),
+            static_cast<uint32_t>(level.indices.size()),
+            level.error
+        });
+        data.indices.insert(data.indices.end(), level.indices.begin(), level.indices.end());
+    }
+
+    return data;
+}
+
+Mesh::MeshData Mesh::createCubeData(
+    float halfExtent
+) {
+    // one quad per face so every face gets its own UVs
+    static const glm::vec3 faceNormals[6] = {
+        { 1, 0, 0 }, { -1, 0, 0 },
+        { 0, 1, 0 }, { 0, -1, 0 },
+        { 0, 0, 1 }, { 0, 0, -1 }
+    };
+
+    MeshData data;
+    data.vertices.reserve(24);
+    data.indices.reserve(36);
+
+    for (const glm::vec3& n : faceNormals) {
+        glm::vec3 up = std::abs(n.z) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, 1);
+        glm::vec3 right = glm::cross(up, n);
+        uint32_t base = static_cast<uint32_t>(data.vertices.size());
+
+        const glm::vec2 corners[4] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+        for (const glm::vec2& c : corners) {
+            glm::vec3 p = (n + right * (c.x * 2.0f - 1.0f) + up * (c.y * 2.0f - 1.0f)) * halfExtent;
+            data.vertices.emplace_back(Vertex{ p, { 1.0f, 1.0f, 1.0f, 1.0f }, c, n });
+        }
+
+        data.indices.insert(data.indices.end(), {
+            base, base + 1, base + 2,
+            base, base + 2, base + 3
+        });
+    }
+
+    data.lods.push_back({ 0, static_cast<uint32_t>(data.indices.size()), 0.0f });
+    data.boundsCenter = glm::vec3(0.0f);
+    data.boundsRadius = halfExtent * std::sqrt(3.0f);
+    return data;
+}
+
+void Mesh::upload(
+    const MeshData& data,
+    VkDevice device,
+    BufferManager* bufferManager
+) {
+    lods = data.lods;
+    boundsCenter = data.boundsCenter;
+    boundsRadius = data.boundsRadius;
+
+    vertexBufferManager = std::make_unique<VertexBufferManager>(device, bufferManager, data.vertices);
+    indexCount = data.lods.empty() ? 0 : data.lods[0].indexCount;
+    indexBufferManager = std::make_unique<IndexBufferManager>(device, bufferManager, data.indices);
+
+    gpuMemorySize =
+        data.vertices.size() * (sizeof(Vertex) + sizeof(glm::vec3)) +
+        data.indices.size() * sizeof(uint32_t);
+
+    setResidency(Residency::Resident);
+}
+
+Mesh::Mesh(
+    const MeshData& data,
+    VkDevice device,
+    BufferManager* bufferManager
+) {
+    upload(data, device, bufferManager);
+}
+
+Mesh::Mesh(
+    const std::string& path,
+    VkDevice device,
+    BufferManager* bufferManager,
+    const MeshSimplifier::LodChainDesc& lodDesc
+) :
+    Mesh(loadData(path, lodDesc), device, bufferManager)
+{
+}
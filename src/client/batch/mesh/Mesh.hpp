@@ -4,6 +4,8 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
+#include <atomic>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -11,27 +13,111 @@
 
 #include "VertexBufferManager.hpp"
 #include "IndexBufferManager.hpp"
+#include "MeshSimplifier.hpp"
+#include "../Residency.hpp"
 
 class Mesh {
+public:
+    /**
+     * @brief Range of the shared index buffer holding one level of detail.
+     */
+    struct Lod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error; ///< Object-space geometric error relative to LOD 0
+    };
+
+    /**
+     * @brief CPU-side result of importing a mesh file.
+     *
+     * Produced by loadData without touching Vulkan, so it can be built on
+     * a worker thread and uploaded later on the render thread.
+     */
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices; ///< Every LOD packed back to back
+        std::vector<Lod> lods;
+        glm::vec3 boundsCenter{0.0f};
+        float boundsRadius = 0.0f;
+    };
+
 private:
     std::unique_ptr<VertexBufferManager> vertexBufferManager;
     std::unique_ptr<IndexBufferManager> indexBufferManager;
-    uint32_t indexCount;
+    uint32_t indexCount = 0;
+    VkDeviceSize gpuMemorySize = 0;
+    std::atomic<Residency> residency{Residency::Requested};
 
-    void load(
+    std::vector<Lod> lods;
+    glm::vec3 boundsCenter{0.0f};
+    float boundsRadius = 0.0f;
+
+    static void load(
         const std::string& path,
         std::vector<Vertex>& vertices,
         std::vector<uint32_t>& indices
     );
 
 public:
-    explicit Mesh(
+    /**
+     * @brief Imports a mesh file and builds its LOD chain.
+     *
+     * Pure CPU work, safe to call from any thread.
+     *
+     * @param path Model file path.
+     * @param lodDesc LOD chain parameters.
+     */
+    static MeshData loadData(
         const std::string& path,
+        const MeshSimplifier::LodChainDesc& lodDesc = MeshSimplifier::LodChainDesc()
+    );
+
+    /**
+     * @brief Builds an axis-aligned cube, used as the streaming placeholder.
+     *
+     * @param halfExtent Half of the cube edge length.
+     */
+    static MeshData createCubeData(
+        float halfExtent
+    );
+
+    /**
+     * @brief Creates an empty mesh in the Requested state.
+     *
+     * GPU data is provided later through upload.
+     */
+    Mesh() = default;
+
+    /**
+     * @brief Uploads previously loaded mesh data to the GPU.
+     *
+     * Must run on the thread that owns the BufferManager immediate submissions.
+     */
+    Mesh(
+        const MeshData& data,
         VkDevice device,
         BufferManager* bufferManager
     );
+
+    explicit Mesh(
+        const std::string& path,
+        VkDevice device,
+        BufferManager* bufferManager,
+        const MeshSimplifier::LodChainDesc& lodDesc = MeshSimplifier::LodChainDesc()
+    );
     ~Mesh() = default;
 
+    /**
+     * @brief Uploads mesh data and marks the mesh Resident.
+     *
+     * Render thread only.
+     */
+    void upload(
+        const MeshData& data,
+        VkDevice device,
+        BufferManager* bufferManager
+    );
+
     Mesh(const Mesh&) = delete;
     Mesh& operator=(const Mesh&) = delete;
 
@@ -40,5 +126,20 @@ public:
 
     VkBuffer getIndexBuffer() const {return indexBufferManager.get()->getIndexBuffer();}
     VkBuffer getVertexBuffer() const {return vertexBufferManager.get()->getVertexBuffer();}
+    /// Positions only, for the depth pre-pass
+    VkBuffer getPositionBuffer() const {return vertexBufferManager.get()->getPositionBuffer();}
     uint32_t getIndexCount() const {return indexCount;}
+
+    Residency getResidency() const {return residency.load(std::memory_order_acquire);}
+    bool isResident() const {return getResidency() == Residency::Resident;}
+    void setResidency(Residency state) {residency.store(state, std::memory_order_release);}
+
+    /// Bytes of vertex, position and index data uploaded to the GPU
+    VkDeviceSize getGpuMemorySize() const {return gpuMemorySize;}
+
+    uint32_t getLodCount() const {return static_cast<uint32_t>(lods.size());}
+    const Lod& getLod(uint32_t level) const {return lods[std::min<size_t>(level, lods.size() - 1)];}
+
+    const glm::vec3& getBoundsCenter() const {return boundsCenter;}
+    float getBoundsRadius() const {return boundsRadius;}
 };
@@ -0,0 +1,400 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+/**
+ * Symmetric 4x4 error quadric stored as its 10 unique coefficients,
+ * plus the accumulated plane weight used to normalize the error back
+ * into a squared distance.
+ */
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double w) {
+        a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+        c2 += w * c * c; cd += w * c * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        weight += o.weight;
+    }
+
+    // squared distance of p to the weighted set of planes
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e =
+            a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+            b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+            c2 * z * z + 2 * cd * z +
+            d2;
+
+        return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+enum class VertexKind : uint8_t {
+    Manifold, // single wedge, free to collapse
+    Seam,     // several wedges share the position (UV seam)
+    Locked    // open border or non-manifold edge, never moved
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    float cost;
+};
+
+struct PositionKey {
+    uint32_t x, y, z;
+
+    bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct PositionKeyHasher {
+    size_t operator()(const PositionKey& k) const {
+        return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u);
+    }
+};
+
+PositionKey makePositionKey(const glm::vec3& p) {
+    PositionKey k;
+    std::memcpy(&k.x, &p.x, sizeof(float));
+    std::memcpy(&k.y, &p.y, sizeof(float));
+    std::memcpy(&k.z, &p.z, sizeof(float));
+    return k;
+}
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+    if (a > b) std::swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+}
+
+float MeshSimplifier::simplify(
+    const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    size_t targetIndexCount,
+    float targetError,
+    std::vector<uint32_t>& result
+) {
+    result = indices;
+
+    if (indices.size() < 3 || indices.size() <= targetIndexCount)
+        return 0.0f;
+
+    // Weld wedges by position; collapses operate on unique positions
+    std::vector<uint32_t> canonical(vertices.size());
+    std::vector<uint32_t> canonicalVertex;
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHasher> positionMap;
+    positionMap.reserve(vertices.size());
+
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+        auto [it, inserted] = positionMap.emplace(
+            makePositionKey(vertices[v].pos),
+            static_cast<uint32_t>(canonicalVertex.size())
+        );
+        if (inserted)
+            canonicalVertex.push_back(v);
+        canonical[v] = it->second;
+    }
+
+    const uint32_t positionCount = static_cast<uint32_t>(canonicalVertex.size());
+
+    // Wedges of each position, stored as CSR lists
+    std::vector<uint32_t> wedgeOffsets(positionCount + 1, 0);
+    std::vector<uint32_t> wedges(vertices.size());
+    for (uint32_t v = 0; v < vertices.size(); v++)
+        wedgeOffsets[canonical[v] + 1]++;
+    for (uint32_t p = 0; p < positionCount; p++)
+        wedgeOffsets[p + 1] += wedgeOffsets[p];
+    {
+        std::vector<uint32_t> fill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+        for (uint32_t v = 0; v < vertices.size(); v++)
+            wedges[fill[canonical[v]]++] = v;
+    }
+
+    auto positionOf = [&](uint32_t p) -> const glm::vec3& {
+        return vertices[canonicalVertex[p]].pos;
+    };
+
+    // Classify positions and accumulate face quadrics
+    std::vector<VertexKind> kinds(positionCount, VertexKind::Manifold);
+    std::vector<Quadric> quadrics(positionCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    edgeUse.reserve(result.size());
+
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        uint32_t c0 = canonical[result[i]];
+        uint32_t c1 = canonical[result[i + 1]];
+        uint32_t c2 = canonical[result[i + 2]];
+
+        edgeUse[edgeKey(c0, c1)]++;
+        edgeUse[edgeKey(c1, c2)]++;
+        edgeUse[edgeKey(c2, c0)]++;
+
+        glm::vec3 p0 = positionOf(c0);
+        glm::vec3 n = glm::cross(positionOf(c1) - p0, positionOf(c2) - p0);
+        float area2 = glm::length(n);
+        if (area2 <= 0.0f)
+            continue;
+
+        n /= area2;
+        double d = -static_cast<double>(glm::dot(n, p0));
+        double w = area2 * 0.5;
+
+        quadrics[c0].addPlane(n.x, n.y, n.z, d, w);
+        quadrics[c1].addPlane(n.x, n.y, n.z, d, w);
+        quadrics[c2].addPlane(n.x, n.y, n.z, d, w);
+    }
+
+    for (uint32_t p = 0; p < positionCount; p++) {
+        if (wedgeOffsets[p + 1] - wedgeOffsets[p] > 1)
+            kinds[p] = VertexKind::Seam;
+    }
+
+    // borders (one triangle) and junctions (three or more) would tear or fold
+    for (const auto& [key, count] : edgeUse) {
+        if (count != 2) {
+            kinds[static_cast<uint32_t>(key >> 32)] = VertexKind::Locked;
+            kinds[static_cast<uint32_t>(key & 0xffffffffu)] = VertexKind::Locked;
+        }
+    }
+
+    // Picks the wedge of position `to` whose UV best matches vertex `from`
+    auto pickWedge = [&](uint32_t from, uint32_t to) -> uint32_t {
+        uint32_t begin = wedgeOffsets[to];
+        uint32_t end = wedgeOffsets[to + 1];
+
+        uint32_t best = wedges[begin];
+        float bestDistance = std::numeric_limits<float>::max();
+        for (uint32_t w = begin; w < end; w++) {
+            glm::vec2 delta = vertices[wedges[w]].texCoord - vertices[from].texCoord;
+            float distance = glm::dot(delta, delta);
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = wedges[w];
+            }
+        }
+        return best;
+    };
+
+    const double maxCost = static_cast<double>(targetError) * targetError;
+    double resultError = 0.0;
+
+    std::vector<uint32_t> triangleOffsets(positionCount + 1);
+    std::vector<uint32_t> triangleList;
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> collapseTarget(positionCount);
+    std::vector<uint8_t> touched(positionCount);
+
+    while (result.size() > targetIndexCount) {
+        const size_t triangleCount = result.size() / 3;
+
+        // Position -> triangles adjacency
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (uint32_t index : result)
+            triangleOffsets[canonical[index] + 1]++;
+        for (uint32_t p = 0; p < positionCount; p++)
+            triangleOffsets[p + 1] += triangleOffsets[p];
+
+        triangleList.resize(result.size());
+        {
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                triangleList[fill[canonical[result[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // Gather collapse candidates from triangle edges
+        candidates.clear();
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = canonical[result[t * 3 + e]];
+                uint32_t b = canonical[result[t * 3 + (e + 1) % 3]];
+                if (a >= b)
+                    continue;
+
+                auto allowed = [&](uint32_t from, uint32_t to) {
+                    if (kinds[from] == VertexKind::Locked) return false;
+                    if (kinds[from] == VertexKind::Seam) return kinds[to] != VertexKind::Manifold;
+                    return true;
+                };
+
+                Quadric q = quadrics[a];
+                q.add(quadrics[b]);
+
+                float costAB = allowed(a, b) ? static_cast<float>(q.evaluate(positionOf(b))) : std::numeric_limits<float>::max();
+                float costBA = allowed(b, a) ? static_cast<float>(q.evaluate(positionOf(a))) : std::numeric_limits<float>::max();
+
+                if (costAB == std::numeric_limits<float>::max() && costBA == std::numeric_limits<float>::max())
+                    continue;
+
+                if (costAB <= costBA)
+                    candidates.push_back({a, b, costAB});
+                else
+                    candidates.push_back({b, a, costBA});
+            }
+        }
+
+        if (candidates.empty())
+            break;
+
+        std::sort(candidates.begin(), candidates.end(),
+            [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        for (uint32_t p = 0; p < positionCount; p++)
+            collapseTarget[p] = p;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        // Each collapse removes roughly two triangles
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved = 0;
+        size_t collapses = 0;
+
+        for (const Collapse& c : candidates) {
+            if (c.cost > maxCost)
+                break;
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            // Reject collapses that flip or degenerate neighbouring faces
+            bool flips = false;
+            size_t removedHere = 0;
+            for (uint32_t k = triangleOffsets[c.from]; k < triangleOffsets[c.from + 1] && !flips; k++) {
+                uint32_t t = triangleList[k];
+                uint32_t tc[3] = {
+                    canonical[result[t * 3 + 0]],
+                    canonical[result[t * 3 + 1]],
+                    canonical[result[t * 3 + 2]]
+                };
+
+                if (tc[0] == c.to || tc[1] == c.to || tc[2] == c.to) {
+                    removedHere++;
+                    continue;
+                }
+
+                glm::vec3 p0 = positionOf(tc[0]);
+                glm::vec3 p1 = positionOf(tc[1]);
+                glm::vec3 p2 = positionOf(tc[2]);
+                glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+                glm::vec3 q0 = tc[0] == c.from ? positionOf(c.to) : p0;
+                glm::vec3 q1 = tc[1] == c.from ? positionOf(c.to) : p1;
+                glm::vec3 q2 = tc[2] == c.from ? positionOf(c.to) : p2;
+                glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+
+                float lengths = glm::length(before) * glm::length(after);
+                if (lengths <= 0.0f || glm::dot(before, after) < 1e-2f * lengths)
+                    flips = true;
+            }
+
+            if (flips)
+                continue;
+
+            collapseTarget[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+
+            // Lock the whole one-ring: the flip test of a later collapse in this pass
+            // reads corner positions, which are only remapped once the pass ends
+            for (uint32_t k = triangleOffsets[c.from]; k < triangleOffsets[c.from + 1]; k++) {
+                uint32_t t = triangleList[k];
+                touched[canonical[result[t * 3 + 0]]] = 1;
+                touched[canonical[result[t * 3 + 1]]] = 1;
+                touched[canonical[result[t * 3 + 2]]] = 1;
+            }
+            touched[c.to] = 1;
+
+            resultError = std::max(resultError, static_cast<double>(c.cost));
+            trianglesRemoved += removedHere;
+            collapses++;
+
+            if (trianglesRemoved >= trianglesToRemove)
+                break;
+        }
+
+        if (collapses == 0)
+            break;
+
+        // Remap indices and drop degenerate triangles
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            uint32_t v[3];
+            uint32_t c[3];
+            for (int e = 0; e < 3; e++) {
+                uint32_t index = result[t * 3 + e];
+                uint32_t target = collapseTarget[canonical[index]];
+                v[e] = target == canonical[index] ? index : pickWedge(index, target);
+                c[e] = target;
+            }
+
+            if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0])
+                continue;
+
+            result[write++] = v[0];
+            result[write++] = v[1];
+            result[write++] = v[2];
+        }
+        result.resize(write);
+    }
+
+    return static_cast<float>(std::sqrt(resultError));
+}
+
+std::vector<MeshSimplifier::Level> MeshSimplifier::buildLodChain(
+    const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices,
+    const LodChainDesc& desc
+) {
+    std::vector<Level> levels;
+    levels.push_back({indices, 0.0f});
+
+    if (vertices.empty() || desc.maxLevels <= 1)
+        return levels;
+
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    for (const Vertex& v : vertices) {
+        minPos = glm::min(minPos, v.pos);
+        maxPos = glm::max(maxPos, v.pos);
+    }
+    glm::vec3 size = maxPos - minPos;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    float targetError = desc.maxRelativeError * extent;
+
+    while (levels.size() < desc.maxLevels) {
+        const Level& previous = levels.back();
+
+        size_t target = static_cast<size_t>(previous.indices.size() / 3 * desc.reductionRatio) * 3;
+        if (target / 3 < desc.minTriangles)
+            break;
+
+        Level level;
+        float error = simplify(vertices, previous.indices, target, targetError, level.indices);
+
+        // stop when the simplifier cannot make meaningful progress
+        if (level.indices.empty() || level.indices.size() > previous.indices.size() * 9 / 10)
+            break;
+
+        level.error = previous.error + error;
+        levels.push_back(std::move(level));
+    }
+
+    return levels;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Quadric-error mesh simplifier used to build LOD chains.
+ *
+ * Implements iterative half-edge collapse driven by Garland-Heckbert
+ * error quadrics. A collapse always moves a vertex onto one of its
+ * neighbours, so every simplified level still indexes the original
+ * vertex array and all levels of a mesh can share one vertex buffer.
+ *
+ * Vertices sharing a position but not attributes (UV seams) are moved
+ * together. Vertices on open borders are locked so silhouettes and
+ * chunk edges stay watertight, and so are vertices on non-manifold
+ * edges, so junctions do not tear.
+ *
+ * This class has no Vulkan dependency and can run at load or cook time.
+ */
+class MeshSimplifier
+{
+public:
+
+    /**
+     * @brief Controls how a LOD chain is generated.
+     */
+    struct LodChainDesc {
+        /// Maximum number of levels, including the full-resolution LOD 0
+        uint32_t maxLevels = 5;
+
+        /// Target index count of each level relative to the previous one
+        float reductionRatio = 0.5f;
+
+        /// Maximum error allowed per level, relative to the mesh extent
+        float maxRelativeError = 0.05f;
+
+        /// Levels that would fall below this triangle count are not generated
+        uint32_t minTriangles = 32;
+    };
+
+    /**
+     * @brief One generated level of detail.
+     */
+    struct Level {
+        std::vector<uint32_t> indices; ///< Triangle list into the original vertices
+        float error; ///< Object-space geometric error of this level
+    };
+
+    /**
+     * @brief Simplifies a triangle list towards a target index count.
+     *
+     * Collapses are applied cheapest first until the index count reaches
+     * targetIndexCount or the next collapse would exceed targetError.
+     *
+     * @param vertices Vertex array referenced by indices.
+     * @param indices Source triangle list.
+     * @param targetIndexCount Desired number of indices (multiple of 3).
+     * @param targetError Maximum object-space error of a single collapse.
+     * @param result (out) Simplified triangle list.
+     *
+     * @return Largest object-space error introduced by the simplification.
+     */
+    static float simplify(
+        const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices,
+        size_t targetIndexCount,
+        float targetError,
+        std::vector<uint32_t>& result
+    );
+
+    /**
+     * @brief Builds a chain of progressively coarser levels.
+     *
+     * Level 0 is always the source triangle list with zero error.
+     * Each following level is simplified from the previous one and its
+     * error accumulates the error of all previous levels, so errors are
+     * monotonically increasing along the chain.
+     *
+     * Generation stops early when a level fails to reduce the triangle
+     * count meaningfully or would fall below desc.minTriangles.
+     *
+     * @param vertices Vertex array referenced by indices.
+     * @param indices Full-resolution triangle list.
+     * @param desc LOD chain parameters.
+     *
+     * @return Levels ordered from finest to coarsest.
+     */
+    static std::vector<Level> buildLodChain(
+        const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices,
+        const LodChainDesc& desc
+    );
+};
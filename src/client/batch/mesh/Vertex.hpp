@@ -8,8 +8,10 @@ struct Vertex {
     glm::vec3 pos;
     glm::vec4 color;
     glm::vec2 texCoord;
+    // object space, lit by the clustered lights
+    glm::vec3 normal;
 
-    Vertex(const glm::vec3 p, const glm::vec4 c, const glm::vec2 t) : pos(p), color(c), texCoord(t) {}
+    Vertex(const glm::vec3 p, const glm::vec4 c, const glm::vec2 t, const glm::vec3 n) : pos(p), color(c), texCoord(t), normal(n) {}
 
     // bindingDescription.binding = 0;
     // bindingDescription.stride = sizeof(Vertex);
@@ -21,15 +23,17 @@ struct Vertex {
         return bindingDescription;
     }
 
-    //     attributeDescriptions[0].binding = 0;
     //     attributeDescriptions[0].location = 0;
+    //     attributeDescriptions[0].binding = 0;
     //     attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
     //     attributeDescriptions[0].offset = offsetof(Vertex, pos);
-    static const std::array<VkVertexInputAttributeDescription, 3>& getAttributeDescriptions() {
-        static const std::array<VkVertexInputAttributeDescription, 3> attributes{{
+    // the mesh pipelines build their vertex input from these, location 0 must stay the position
+    static const std::array<VkVertexInputAttributeDescription, 4>& getAttributeDescriptions() {
+        static const std::array<VkVertexInputAttributeDescription, 4> attributes{{
             {0, 0, VK_FORMAT_R32G32B32_SFLOAT,     offsetof(Vertex, pos)},
-            {0, 1, VK_FORMAT_R32G32B32A32_SFLOAT,  offsetof(Vertex, color)},
-            {0, 2, VK_FORMAT_R32G32_SFLOAT,     offsetof(Vertex, texCoord)}
+            {1, 0, VK_FORMAT_R32G32B32A32_SFLOAT,  offsetof(Vertex, color)},
+            {2, 0, VK_FORMAT_R32G32_SFLOAT,     offsetof(Vertex, texCoord)},
+            {3, 0, VK_FORMAT_R32G32B32_SFLOAT,     offsetof(Vertex, normal)}
         }};
         return attributes;
     }
@@ -7,7 +7,35 @@ VertexBufferManager::VertexBufferManager(
 ) :
     device(device)
 {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    createDeviceBuffer(
+        bufferManager,
+        vertices.data(),
+        sizeof(vertices[0]) * vertices.size(),
+        this->vertexBuffer,
+        this->vertexBufferMemory
+    );
+
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        positions.push_back(vertex.pos);
+
+    createDeviceBuffer(
+        bufferManager,
+        positions.data(),
+        sizeof(positions[0]) * positions.size(),
+        this->positionBuffer,
+        this->positionBufferMemory
+    );
+};
+
+void VertexBufferManager::createDeviceBuffer(
+    BufferManager* bufferManager,
+    const void* data,
+    VkDeviceSize bufferSize,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory
+) {
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
 
@@ -15,23 +43,25 @@ VertexBufferManager::VertexBufferManager(
     bufferManager->allocateBufferMemory(stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBufferMemory);
     vkBindBufferMemory(device, stagingBuffer, stagingBufferMemory, 0);
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
+    void* mapped;
+    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &mapped);
+    memcpy(mapped, data, static_cast<size_t>(bufferSize));
     vkUnmapMemory(device, stagingBufferMemory);
 
-    bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, this->vertexBuffer);
-    bufferManager->allocateBufferMemory(this->vertexBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->vertexBufferMemory);
-    vkBindBufferMemory(device, this->vertexBuffer, this->vertexBufferMemory, 0);
+    bufferManager->createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, buffer);
+    bufferManager->allocateBufferMemory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferMemory);
+    vkBindBufferMemory(device, buffer, bufferMemory, 0);
 
-    bufferManager->copyBuffer(stagingBuffer, this->vertexBuffer, bufferSize);
+    bufferManager->copyBuffer(stagingBuffer, buffer, bufferSize);
 
     vkDestroyBuffer(device, stagingBuffer, nullptr);
     vkFreeMemory(device, stagingBufferMemory, nullptr);
-};
+}
 
 VertexBufferManager::~VertexBufferManager()
 {
     vkDestroyBuffer(device, this->vertexBuffer, nullptr);
     vkFreeMemory(device, this->vertexBufferMemory, nullptr);
+    vkDestroyBuffer(device, this->positionBuffer, nullptr);
+    vkFreeMemory(device, this->positionBufferMemory, nullptr);
 }
\ No newline at end of file
@@ -13,6 +13,17 @@ private:
 
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
+    // tightly packed positions, the only stream the depth pre-pass fetches
+    VkBuffer positionBuffer;
+    VkDeviceMemory positionBufferMemory;
+
+    void createDeviceBuffer(
+        BufferManager* bufferManager,
+        const void* data,
+        VkDeviceSize bufferSize,
+        VkBuffer& buffer,
+        VkDeviceMemory& bufferMemory
+    );
 public:
     VertexBufferManager(
         VkDevice device,
@@ -30,4 +41,5 @@ public:
 
     VkBuffer getVertexBuffer() const {return vertexBuffer;}
     VkDeviceMemory getVertexBufferMemory() const {return vertexBufferMemory;}
+    VkBuffer getPositionBuffer() const {return positionBuffer;}
 };
\ No newline at end of file
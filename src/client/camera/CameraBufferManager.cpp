@@ -14,11 +14,13 @@ void CameraBufferManager::DefaultCameraProvider::fill(
     );
 
     float aspect = extent.width / float(extent.height);
+    ubg.zNear = 0.1f;
+    ubg.zFar = 10.0f;
     ubg.proj = glm::perspective(
         glm::radians(45.0f),
         aspect,
-        0.1f,
-        10.0f
+        ubg.zNear,
+        ubg.zFar
     );
     ubg.proj[1][1] *= -1;
 }
@@ -41,7 +41,8 @@ public:
      * @brief Interface for camera data providers.
      *
      * Camera providers are responsible for filling a UniformBufferGlobal
-     * with view/projection (and optionally model) matrices.
+     * with view/projection (and optionally model) matrices, and the near
+     * and far planes of the projection.
      *
      * This abstraction allows:
      * - Different camera behaviors (FPS, orbit, cinematic, debug)
@@ -5,4 +5,9 @@
 struct UniformBufferGlobal {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    // rgb, light added to the clustered lights
+    alignas(16) glm::vec4 ambient;
+    // planes of proj, the depth slices of the light clusters span them
+    float zNear;
+    float zFar;
 };
\ No newline at end of file
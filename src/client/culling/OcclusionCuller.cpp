@@ -0,0 +1,731 @@
+#include "OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "../graphics_pipeline/ShaderLoader.hpp"
+#include "../image/VulkanImageUtils.hpp"
+
+namespace {
+    // the largest minStorageBufferOffsetAlignment allowed
+    VkDeviceSize alignOffset(VkDeviceSize size)
+    {
+        return (size + 255) & ~VkDeviceSize(255);
+    }
+}
+
+OcclusionCuller::OcclusionCuller(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    BufferManager* bufferManager,
+    VkDeviceSize nonCoherentAtomSize,
+    InstanceDescriptorManager* instanceDescriptorManager,
+    VkPipelineCache pipelineCache,
+    uint32_t framesInFlight,
+    uint32_t maxInstances,
+    uint32_t maxDraws
+) :
+    physicalDevice(physicalDevice),
+    device(device),
+    bufferManager(bufferManager),
+    nonCoherentAtomSize(nonCoherentAtomSize),
+    maxInstances(maxInstances),
+    maxDraws(maxDraws),
+    frames(framesInFlight)
+{
+    if (maxInstances == 0 || maxDraws == 0)
+        throw std::runtime_error("occlusion culling needs room for instances and draws");
+
+//* per-frame buffers
+    drawsOffset = alignOffset(sizeof(CullState));
+    commandsOffset = drawsOffset + alignOffset(sizeof(CullDraw) * maxDraws);
+    instanceDrawOffset = commandsOffset + alignOffset(sizeof(VkDrawIndexedIndirectCommand) * 2 * maxDraws);
+    hostSize = instanceDrawOffset + alignOffset(sizeof(uint32_t) * maxInstances);
+
+    lateListOffset = alignOffset(sizeof(InstanceData) * maxInstances);
+    deviceSize = lateListOffset + sizeof(uint32_t) * maxInstances;
+
+    for (FrameResources& frame : frames)
+    {
+        bufferManager->createBuffer(
+            hostSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            frame.hostBuffer
+        );
+
+        bufferManager->allocateBufferMemory(
+            frame.hostBuffer,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+            frame.hostMemory
+        );
+
+        vkBindBufferMemory(device, frame.hostBuffer, frame.hostMemory.memory, 0);
+        vkMapMemory(device, frame.hostMemory.memory, 0, hostSize, 0, &frame.mapped);
+
+        bufferManager->createBuffer(deviceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, frame.deviceBuffer);
+        bufferManager->allocateBufferMemory(frame.deviceBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.deviceMemory);
+        vkBindBufferMemory(device, frame.deviceBuffer, frame.deviceMemory, 0);
+    }
+
+//* pyramid sampler, only fetched from
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create depth pyramid sampler");
+
+    createDescriptors(instanceDescriptorManager);
+
+//* compute pipelines
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(Push);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create occlusion cull pipeline layout!");
+
+    VkPushConstantRange reducePushConstantRange{};
+    reducePushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    reducePushConstantRange.offset = 0;
+    reducePushConstantRange.size = sizeof(ReducePush);
+
+    pipelineLayoutInfo.pSetLayouts = &reduceLayout;
+    pipelineLayoutInfo.pPushConstantRanges = &reducePushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &reducePipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+
+    cullPipeline = createComputePipeline("shaders/occlusion_cull.comp.glsl.spv", cullPipelineLayout, pipelineCache);
+    reducePipeline = createComputePipeline("shaders/hiz_reduce.comp.glsl.spv", reducePipelineLayout, pipelineCache);
+    // both, the sample count of the depth buffer changes at runtime
+    reduceMsaaPipeline = createComputePipeline("shaders/hiz_reduce_msaa.comp.glsl.spv", reducePipelineLayout, pipelineCache);
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    destroyPyramid();
+
+    for (VkPipeline pipeline : {cullPipeline, reducePipeline, reduceMsaaPipeline})
+    {
+        if (pipeline)
+            vkDestroyPipeline(device, pipeline, nullptr);
+    }
+
+    for (VkPipelineLayout layout : {cullPipelineLayout, reducePipelineLayout})
+    {
+        if (layout)
+            vkDestroyPipelineLayout(device, layout, nullptr);
+    }
+
+    for (VkDescriptorPool pool : {descriptorPool, reducePool})
+    {
+        if (pool)
+            vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+
+    for (VkDescriptorSetLayout layout : {cullLayout, reduceLayout})
+    {
+        if (layout)
+            vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+
+    if (sampler)
+        vkDestroySampler(device, sampler, nullptr);
+
+    for (FrameResources& frame : frames)
+    {
+        if (frame.mapped)
+            vkUnmapMemory(device, frame.hostMemory.memory);
+
+        if (frame.hostBuffer)
+            vkDestroyBuffer(device, frame.hostBuffer, nullptr);
+
+        if (frame.hostMemory.memory)
+            vkFreeMemory(device, frame.hostMemory.memory, nullptr);
+
+        if (frame.deviceBuffer)
+            vkDestroyBuffer(device, frame.deviceBuffer, nullptr);
+
+        if (frame.deviceMemory)
+            vkFreeMemory(device, frame.deviceMemory, nullptr);
+    }
+}
+
+void OcclusionCuller::createDescriptors(
+    InstanceDescriptorManager* instanceDescriptorManager
+) {
+    const uint32_t framesInFlight = static_cast<uint32_t>(frames.size());
+
+    // 0 state, 1 draws, 2 draw of every instance, 3 indirect commands,
+    // 4 uploaded instances, 5 visible instances, 6 late list, 7 pyramid
+    VkDescriptorSetLayoutBinding cullBindings[8]{};
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = i == 7 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        cullBindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 8;
+    layoutInfo.pBindings = cullBindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create occlusion cull descriptor set layout");
+
+    // 0 level below (or the depth buffer), 1 level written
+    VkDescriptorSetLayoutBinding reduceBindings[2]{};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        reduceBindings[i].binding = i;
+        reduceBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        reduceBindings[i].descriptorCount = 1;
+        reduceBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        reduceBindings[i].pImmutableSamplers = nullptr;
+    }
+
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = reduceBindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &reduceLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create depth pyramid descriptor set layout");
+
+    // a cull set and a visible instance set per frame in flight
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 8 * framesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    poolInfo.maxSets = 2 * framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create occlusion cull descriptor pool");
+
+    VkDescriptorPoolSize reducePoolSizes[2]{};
+    reducePoolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    reducePoolSizes[0].descriptorCount = MAX_PYRAMID_LEVELS;
+    reducePoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    reducePoolSizes[1].descriptorCount = MAX_PYRAMID_LEVELS;
+
+    poolInfo.pPoolSizes = reducePoolSizes;
+    poolInfo.maxSets = MAX_PYRAMID_LEVELS;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &reducePool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create depth pyramid descriptor pool");
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, cullLayout);
+    layouts.insert(layouts.end(), framesInFlight, instanceDescriptorManager->getLayout());
+
+    std::vector<VkDescriptorSet> sets(layouts.size());
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate occlusion cull descriptor sets");
+
+    // the pyramid (binding 7) is written by setDepth
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(8 * framesInFlight);
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        FrameResources& frame = frames[i];
+        frame.cullSet = sets[i];
+        frame.instanceSet = sets[framesInFlight + i];
+
+        VkDescriptorBufferInfo cullInfos[7] = {
+            {frame.hostBuffer, 0, sizeof(CullState)},
+            {frame.hostBuffer, drawsOffset, sizeof(CullDraw) * maxDraws},
+            {frame.hostBuffer, instanceDrawOffset, sizeof(uint32_t) * maxInstances},
+            {frame.hostBuffer, commandsOffset, sizeof(VkDrawIndexedIndirectCommand) * 2 * maxDraws},
+            {instanceDescriptorManager->getBuffer(i), 0, sizeof(InstanceData) * maxInstances},
+            {frame.deviceBuffer, 0, sizeof(InstanceData) * maxInstances},
+            {frame.deviceBuffer, lateListOffset, sizeof(uint32_t) * maxInstances}
+        };
+
+        for (uint32_t binding = 0; binding < 7; binding++)
+        {
+            bufferInfos.push_back(cullInfos[binding]);
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = frame.cullSet;
+            write.dstBinding = binding;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = 1;
+            write.pBufferInfo = &bufferInfos.back();
+            writes.push_back(write);
+        }
+
+        // the vertex shaders read the visible instances like the uploaded ones
+        bufferInfos.push_back(cullInfos[5]);
+
+        VkWriteDescriptorSet instanceWrite{};
+        instanceWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        instanceWrite.dstSet = frame.instanceSet;
+        instanceWrite.dstBinding = 0;
+        instanceWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        instanceWrite.descriptorCount = 1;
+        instanceWrite.pBufferInfo = &bufferInfos.back();
+        writes.push_back(instanceWrite);
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+VkPipeline OcclusionCuller::createComputePipeline(
+    const std::string& path,
+    VkPipelineLayout layout,
+    VkPipelineCache pipelineCache
+) {
+    ShaderLoader shaderLoader(device, path);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderLoader.getCompModule();
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create occlusion culling compute pipeline!");
+
+    return pipeline;
+}
+
+void OcclusionCuller::destroyPyramid()
+{
+    for (VkImageView view : levelViews)
+        vkDestroyImageView(device, view, nullptr);
+    levelViews.clear();
+
+    if (pyramidView)
+    {
+        vkDestroyImageView(device, pyramidView, nullptr);
+        pyramidView = VK_NULL_HANDLE;
+    }
+
+    if (pyramidImage)
+    {
+        vkDestroyImage(device, pyramidImage, nullptr);
+        pyramidImage = VK_NULL_HANDLE;
+    }
+
+    if (pyramidMemory)
+    {
+        vkFreeMemory(device, pyramidMemory, nullptr);
+        pyramidMemory = VK_NULL_HANDLE;
+    }
+
+    pyramidValid = false;
+}
+
+VkExtent2D OcclusionCuller::levelExtent(
+    VkExtent2D extent,
+    uint32_t level
+) {
+    // level 0 is half the depth buffer, rounded up so it covers every pixel; mip sizes round down
+    return {
+        std::max(((extent.width + 1) / 2) >> level, 1u),
+        std::max(((extent.height + 1) / 2) >> level, 1u)
+    };
+}
+
+void OcclusionCuller::setDepth(
+    VkImageView depthView,
+    VkExtent2D extent,
+    VkSampleCountFlagBits depthSamples
+) {
+    destroyPyramid();
+
+    this->depthSamples = depthSamples;
+    VkExtent2D baseExtent = levelExtent(extent, 0);
+
+    uint32_t levels = 1;
+    while ((std::max(baseExtent.width, baseExtent.height) >> levels) > 0 && levels < MAX_PYRAMID_LEVELS)
+        levels++;
+
+    createImage(
+        physicalDevice,
+        device,
+        baseExtent.width,
+        baseExtent.height,
+        levels,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        pyramidImage,
+        pyramidMemory
+    );
+
+    pyramidView = createImageView(device, pyramidImage, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, levels);
+
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = pyramidImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create depth pyramid level view");
+
+        levelViews.push_back(view);
+    }
+
+    // general for good: written as storage, fetched through the sampler
+    VkCommandBuffer cmd = bufferManager->beginImmediate();
+
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = pyramidImage;
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &imageBarrier
+    );
+
+    bufferManager->endImmediate();
+
+//* descriptors of the new pyramid
+    vkResetDescriptorPool(device, reducePool, 0);
+    reduceSets.assign(levels, VK_NULL_HANDLE);
+
+    std::vector<VkDescriptorSetLayout> layouts(levels, reduceLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = reducePool;
+    allocInfo.descriptorSetCount = levels;
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, reduceSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate depth pyramid descriptor sets");
+
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    imageInfos.reserve(2 * levels + frames.size());
+    std::vector<VkWriteDescriptorSet> writes;
+
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        // level 0 reduces the depth buffer, the others the level below
+        imageInfos.push_back({
+            sampler,
+            level == 0 ? depthView : levelViews[level - 1],
+            level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+        });
+
+        VkWriteDescriptorSet sourceWrite{};
+        sourceWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        sourceWrite.dstSet = reduceSets[level];
+        sourceWrite.dstBinding = 0;
+        sourceWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sourceWrite.descriptorCount = 1;
+        sourceWrite.pImageInfo = &imageInfos.back();
+        writes.push_back(sourceWrite);
+
+        imageInfos.push_back({VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL});
+
+        VkWriteDescriptorSet destinationWrite{};
+        destinationWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        destinationWrite.dstSet = reduceSets[level];
+        destinationWrite.dstBinding = 1;
+        destinationWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        destinationWrite.descriptorCount = 1;
+        destinationWrite.pImageInfo = &imageInfos.back();
+        writes.push_back(destinationWrite);
+    }
+
+    for (FrameResources& frame : frames)
+    {
+        imageInfos.push_back({sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL});
+
+        VkWriteDescriptorSet pyramidWrite{};
+        pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        pyramidWrite.dstSet = frame.cullSet;
+        pyramidWrite.dstBinding = 7;
+        pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pyramidWrite.descriptorCount = 1;
+        pyramidWrite.pImageInfo = &imageInfos.back();
+        writes.push_back(pyramidWrite);
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    renderExtent = extent;
+    push.depthSize = glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+    push.pyramidLevels = levels;
+}
+
+void OcclusionCuller::beginFrame(
+    uint32_t currentFrame,
+    const glm::mat4& viewProjection,
+    VkExtent2D renderExtent
+) {
+    FrameResources& frame = frames[currentFrame];
+    CullState* state = static_cast<CullState*>(frame.mapped);
+
+    if (frame.submitted)
+    {
+        if (!frame.hostMemory.isCoherent)
+        {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = frame.hostMemory.memory;
+            range.offset = 0;
+            range.size = (sizeof(CullState) + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+
+        stats.instances = frame.instanceCount;
+        stats.draws = frame.drawCount;
+        stats.frustumCulled = state->frustumCulled;
+        stats.earlyOccluded = state->earlyOccluded;
+        stats.lateOccluded = state->lateOccluded;
+    }
+
+    // the late dispatch grows with the list, from no groups
+    *state = CullState{};
+    state->earlyDispatch = {0, 1, 1};
+    state->lateDispatch = {0, 1, 1};
+
+    frame.drawCount = 0;
+    frame.instanceCount = 0;
+    frame.submitted = false;
+
+    push.viewProjection = viewProjection;
+    push.depthSize = glm::vec2(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height));
+    this->renderExtent = renderExtent;
+}
+
+void OcclusionCuller::addDraw(
+    uint32_t currentFrame,
+    uint32_t indexCount,
+    uint32_t firstIndex,
+    uint32_t firstInstance,
+    uint32_t instanceCount,
+    const glm::vec3& boundsCenter,
+    float boundsRadius
+) {
+    FrameResources& frame = frames[currentFrame];
+
+    if (frame.drawCount == maxDraws)
+        throw std::runtime_error("Occlusion culling draw buffer overflow");
+
+    if (firstInstance + instanceCount > maxInstances)
+        throw std::runtime_error("Instance buffer overflow");
+
+    char* mapped = static_cast<char*>(frame.mapped);
+    uint32_t drawIndex = frame.drawCount++;
+
+    CullDraw& draw = reinterpret_cast<CullDraw*>(mapped + drawsOffset)[drawIndex];
+    draw.sphere = glm::vec4(boundsCenter, boundsRadius);
+    draw.firstInstance = firstInstance;
+    draw.instanceCount = instanceCount;
+
+    // early and late command, the cull fills in the instances
+    VkDrawIndexedIndirectCommand* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(mapped + commandsOffset);
+    for (uint32_t phase = 0; phase < 2; phase++)
+        commands[drawIndex * 2 + phase] = {indexCount, 0, firstIndex, 0, firstInstance};
+
+    uint32_t* instanceDraw = reinterpret_cast<uint32_t*>(mapped + instanceDrawOffset);
+    std::fill(instanceDraw + firstInstance, instanceDraw + firstInstance + instanceCount, drawIndex);
+
+    frame.instanceCount = std::max(frame.instanceCount, firstInstance + instanceCount);
+}
+
+void OcclusionCuller::flush(
+    uint32_t currentFrame
+) {
+    FrameResources& frame = frames[currentFrame];
+    CullState* state = static_cast<CullState*>(frame.mapped);
+
+    state->instanceCount = frame.instanceCount;
+    state->earlyDispatch.x = (frame.instanceCount + 63) / 64;
+
+    if (!frame.hostMemory.isCoherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = frame.hostMemory.memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+
+        vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    frame.submitted = true;
+}
+
+void OcclusionCuller::barrier(
+    VkCommandBuffer cmd,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess
+) {
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void OcclusionCuller::recordCull(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    Phase phase
+) {
+    const FrameResources& frame = frames[currentFrame];
+
+    if (phase == Phase::Early)
+    {
+        // the pyramid written last frame
+        barrier(
+            cmd,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+
+    push.phase = phase == Phase::Early ? 0 : 1;
+    // the late phase always has the pyramid of this frame
+    push.occlusion = phase == Phase::Late || pyramidValid ? 1 : 0;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+    vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+    vkCmdDispatchIndirect(
+        cmd,
+        frame.hostBuffer,
+        phase == Phase::Early ? offsetof(CullState, earlyDispatch) : offsetof(CullState, lateDispatch)
+    );
+
+    // commands and visible instances to the draws, the late list to the late cull,
+    // the counters to the CPU once the frame is done
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT
+    );
+}
+
+void OcclusionCuller::recordPyramid(
+    VkCommandBuffer cmd
+) {
+    // the early cull is done reading the previous pyramid
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT
+    );
+
+    for (uint32_t level = 0; level < reduceSets.size(); level++)
+    {
+        VkPipeline pipeline = level == 0 && depthSamples != VK_SAMPLE_COUNT_1_BIT ? reduceMsaaPipeline : reducePipeline;
+
+        // only the part of each level covering the render extent
+        VkExtent2D source = level == 0 ? renderExtent : levelExtent(renderExtent, level - 1);
+        VkExtent2D destination = levelExtent(renderExtent, level);
+
+        ReducePush reducePush{};
+        reducePush.sourceSize = glm::ivec2(source.width, source.height);
+        reducePush.size = glm::ivec2(destination.width, destination.height);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipelineLayout, 0, 1, &reduceSets[level], 0, nullptr);
+        vkCmdPushConstants(cmd, reducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePush), &reducePush);
+        vkCmdDispatch(cmd, (destination.width + 7) / 8, (destination.height + 7) / 8, 1);
+
+        // the next level and the late cull read this one
+        barrier(
+            cmd,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+
+    pyramidValid = true;
+}
+
+void OcclusionCuller::recordDraw(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    Phase phase,
+    uint32_t drawIndex
+) const {
+    uint32_t command = drawIndex * 2 + (phase == Phase::Early ? 0 : 1);
+
+    vkCmdDrawIndexedIndirect(
+        cmd,
+        frames[currentFrame].hostBuffer,
+        commandsOffset + command * sizeof(VkDrawIndexedIndirectCommand),
+        1,
+        sizeof(VkDrawIndexedIndirectCommand)
+    );
+}
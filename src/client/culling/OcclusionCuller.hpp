@@ -0,0 +1,305 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../CoreVulkan.hpp"
+#include "../BufferManager.hpp"
+#include "../batch/instance/InstanceDescriptorManager.hpp"
+
+/**
+ * @brief Two-phase frustum and hierarchical-Z occlusion culling of the mesh instances.
+ *
+ * The opaque geometry is drawn in the Early and Late parts of the render
+ * pass (see RenderPass::Part), every draw once per phase as an indexed
+ * indirect draw whose instance count the GPU decides:
+ *
+ * - early cull: every instance is tested against the frustum and the depth
+ *   pyramid of the previous frame. Visible ones are copied to the draw
+ *   buffer and counted in the early command of their draw; occluded ones
+ *   go to the late list.
+ * - early draw, then the depth pyramid is rebuilt from that depth: level 0
+ *   is half the depth buffer, every texel keeps the farthest depth below it.
+ * - late cull: the late list is re-tested against the new pyramid, instances
+ *   that became visible (disocclusion, camera motion) are appended behind
+ *   the early ones of their draw and drawn in the late part.
+ *
+ * An instance is tested with the box around its world bounding sphere: its
+ * nearest depth against the farthest depth of the 2x2 pyramid texels its
+ * screen rectangle covers, at the level where it spans at most two. Boxes
+ * crossing the near plane are always drawn.
+ *
+ * With dynamic resolution only the top-left render extent of the depth
+ * buffer is drawn; the pyramid is built from and tested within that part.
+ * The early cull reads a pyramid built at the previous frame's extent, any
+ * instance it wrongly finds occluded is drawn by the late phase.
+ *
+ * The CPU still walks the batches and uploads the instances to the
+ * InstanceDescriptorManager buffers; addDraw records each draw for the
+ * cull. Visible instances are read through getInstanceSet instead of the
+ * InstanceDescriptorManager sets. The cull counters are read back once the
+ * frame slot comes around again, so the stats lag by the frames in flight.
+ */
+class OcclusionCuller
+{
+public:
+    enum class Phase {
+        Early,
+        Late
+    };
+
+    struct Stats {
+        uint32_t instances = 0;
+        uint32_t draws = 0;
+        // early phase: outside the frustum, occluded in the previous frame's pyramid
+        uint32_t frustumCulled = 0;
+        uint32_t earlyOccluded = 0;
+        // late phase: still occluded after the re-test
+        uint32_t lateOccluded = 0;
+    };
+
+private:
+    // layout of CullState in occlusion_cull.comp.glsl, the indirect dispatches come first
+    struct CullState {
+        VkDispatchIndirectCommand earlyDispatch;
+        VkDispatchIndirectCommand lateDispatch;
+        uint32_t instanceCount;
+        uint32_t lateCount;
+        uint32_t frustumCulled;
+        uint32_t earlyOccluded;
+        uint32_t lateOccluded;
+    };
+
+    // std430 layout of CullDraw in occlusion_cull.comp.glsl
+    struct CullDraw {
+        glm::vec4 sphere;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        uint32_t pad[2];
+    };
+
+    struct Push {
+        glm::mat4 viewProjection;
+        glm::vec2 depthSize;
+        uint32_t pyramidLevels;
+        uint32_t phase;
+        uint32_t occlusion;
+    };
+
+    // push constants of hiz_reduce.comp.glsl, the parts of the levels drawn to
+    struct ReducePush {
+        glm::ivec2 sourceSize;
+        glm::ivec2 size;
+    };
+
+    struct FrameResources {
+        // state, draws, indirect commands and the draw of every instance, written by the CPU
+        VkBuffer hostBuffer{VK_NULL_HANDLE};
+        BufferManager::AllocatedMemoryINFO hostMemory{};
+        void* mapped = nullptr;
+        // visible instances and the late list
+        VkBuffer deviceBuffer{VK_NULL_HANDLE};
+        VkDeviceMemory deviceMemory{VK_NULL_HANDLE};
+
+        VkDescriptorSet cullSet{VK_NULL_HANDLE};
+        // set 2 of the Mesh layout, the visible instances
+        VkDescriptorSet instanceSet{VK_NULL_HANDLE};
+
+        uint32_t drawCount = 0;
+        uint32_t instanceCount = 0;
+        // the counters hold a finished cull once the frame fence is waited
+        bool submitted = false;
+    };
+
+    // fits a pyramid for a 65536 pixel wide depth buffer
+    static constexpr uint32_t MAX_PYRAMID_LEVELS = 16;
+
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    // moves every new pyramid to the general layout
+    BufferManager* bufferManager;
+    VkDeviceSize nonCoherentAtomSize;
+    VkSampleCountFlagBits depthSamples = VK_SAMPLE_COUNT_1_BIT;
+    uint32_t maxInstances;
+    uint32_t maxDraws;
+
+    // offsets into the per-frame buffers, 256-byte aligned for the descriptors
+    VkDeviceSize drawsOffset;
+    VkDeviceSize commandsOffset;
+    VkDeviceSize instanceDrawOffset;
+    VkDeviceSize hostSize;
+    VkDeviceSize lateListOffset;
+    VkDeviceSize deviceSize;
+
+    std::vector<FrameResources> frames;
+
+    // depth pyramid, always in the general layout
+    VkImage pyramidImage{VK_NULL_HANDLE};
+    VkDeviceMemory pyramidMemory{VK_NULL_HANDLE};
+    VkImageView pyramidView{VK_NULL_HANDLE};
+    std::vector<VkImageView> levelViews;
+    // render extent of this frame, the part of the depth buffer drawn to
+    VkExtent2D renderExtent{};
+    // built at least once since the depth buffer was (re)created
+    bool pyramidValid = false;
+    VkSampler sampler{VK_NULL_HANDLE};
+
+    VkDescriptorSetLayout cullLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout reduceLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    // one set per pyramid level, reallocated with the pyramid
+    VkDescriptorPool reducePool{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> reduceSets;
+
+    VkPipelineLayout cullPipelineLayout{VK_NULL_HANDLE};
+    VkPipelineLayout reducePipelineLayout{VK_NULL_HANDLE};
+    VkPipeline cullPipeline{VK_NULL_HANDLE};
+    VkPipeline reducePipeline{VK_NULL_HANDLE};
+    // level 0 from a multisampled depth buffer
+    VkPipeline reduceMsaaPipeline{VK_NULL_HANDLE};
+
+    Push push{};
+    Stats stats;
+
+    void createDescriptors(
+        InstanceDescriptorManager* instanceDescriptorManager
+    );
+
+    VkPipeline createComputePipeline(
+        const std::string& path,
+        VkPipelineLayout layout,
+        VkPipelineCache pipelineCache
+    );
+
+    void destroyPyramid();
+
+    /// Part of a pyramid level covering the first extent pixels of the depth buffer
+    static VkExtent2D levelExtent(
+        VkExtent2D extent,
+        uint32_t level
+    );
+
+    static void barrier(
+        VkCommandBuffer cmd,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess
+    );
+
+public:
+    /**
+     * @param instanceDescriptorManager Source of the instances, and the set 2 layout of the visible ones.
+     * @param maxInstances Instances per frame, as in InstanceDescriptorManager.
+     * @param maxDraws Draws per frame after merging batches.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    OcclusionCuller(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        BufferManager* bufferManager,
+        VkDeviceSize nonCoherentAtomSize,
+        InstanceDescriptorManager* instanceDescriptorManager,
+        VkPipelineCache pipelineCache,
+        uint32_t framesInFlight,
+        uint32_t maxInstances,
+        uint32_t maxDraws
+    );
+
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    /**
+     * @brief Recreates the depth pyramid for a depth buffer.
+     *
+     * The first frame after this culls against the frustum only. Call with
+     * the device idle, on creation and whenever the depth buffer is recreated.
+     *
+     * @param depthView Depth-aspect view, sampled in the read-only depth layout.
+     * @param depthSamples Sample count of the depth buffer.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    void setDepth(
+        VkImageView depthView,
+        VkExtent2D extent,
+        VkSampleCountFlagBits depthSamples
+    );
+
+    /**
+     * @brief Reads back the counters of the last cull of this frame slot and resets it.
+     *
+     * Call once per frame after waiting for the frame fence, before addDraw.
+     *
+     * @param renderExtent Part of the depth buffer the frame draws to, at most its extent.
+     */
+    void beginFrame(
+        uint32_t currentFrame,
+        const glm::mat4& viewProjection,
+        VkExtent2D renderExtent
+    );
+
+    /**
+     * @brief Adds a draw of instanceCount instances uploaded at firstInstance.
+     *
+     * Draws are numbered in the order they are added, recordDraw uses the
+     * same index in both phases.
+     *
+     * @throws std::runtime_error past maxDraws draws or maxInstances instances.
+     */
+    void addDraw(
+        uint32_t currentFrame,
+        uint32_t indexCount,
+        uint32_t firstIndex,
+        uint32_t firstInstance,
+        uint32_t instanceCount,
+        const glm::vec3& boundsCenter,
+        float boundsRadius
+    );
+
+    /**
+     * @brief Makes the draws of this frame visible to the GPU, after the last addDraw.
+     */
+    void flush(
+        uint32_t currentFrame
+    );
+
+    /**
+     * @brief Records a cull phase, outside a render pass.
+     *
+     * Early goes before the Early part of the render pass, Late after
+     * recordPyramid. The dispatches are indirect, so both may be recorded
+     * before the draws are added.
+     */
+    void recordCull(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        Phase phase
+    );
+
+    /**
+     * @brief Rebuilds the pyramid from the depth of the Early part, after it ends.
+     */
+    void recordPyramid(
+        VkCommandBuffer cmd
+    );
+
+    /**
+     * @brief Draws the instances of a draw that passed the cull of a phase.
+     *
+     * Expects a Mesh pipeline, the mesh buffers and getInstanceSet as set 2 to be bound.
+     */
+    void recordDraw(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        Phase phase,
+        uint32_t drawIndex
+    ) const;
+
+    VkDescriptorSet getInstanceSet(uint32_t currentFrame) const { return frames[currentFrame].instanceSet; }
+    Stats getStats() const { return stats; }
+};
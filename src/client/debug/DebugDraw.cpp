@@ -0,0 +1,320 @@
+#include "DebugDraw.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+DebugDraw::DebugDraw(
+    VkDevice device,
+    BufferManager* bufferManager,
+    VkDeviceSize nonCoherentAtomSize,
+    uint32_t framesInFlight,
+    uint32_t maxLines
+) :
+    device(device),
+    nonCoherentAtomSize(nonCoherentAtomSize),
+    maxLines((std::max(maxLines, 1u) + 7) & ~7u),
+    drawCounts(framesInFlight, 0)
+{
+    // 8 lines of 32 bytes: 256, the largest minStorageBufferOffsetAlignment allowed
+    sliceSize = sizeof(DebugLine) * this->maxLines;
+    lines.reserve(this->maxLines);
+
+//* ring buffer, one slice per frame in flight
+    bufferManager->createBuffer(
+        sliceSize * framesInFlight,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        buffer
+    );
+
+    bufferManager->allocateBufferMemory(
+        buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+        memoryInfo
+    );
+
+    vkBindBufferMemory(device, buffer, memoryInfo.memory, 0);
+
+    vkMapMemory(
+        device,
+        memoryInfo.memory,
+        0,
+        sliceSize * framesInFlight,
+        0,
+        &mapped
+    );
+
+//* set 1 of the DebugLine pipeline layout
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create debug line descriptor set layout");
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create debug line descriptor pool");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate debug line descriptor set");
+
+    // one slice wide, the frame picks its slice with the dynamic offset
+    VkDescriptorBufferInfo bufferInfo{buffer, 0, sliceSize};
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+DebugDraw::~DebugDraw()
+{
+    if (mapped)
+        vkUnmapMemory(device, memoryInfo.memory);
+
+    if (buffer)
+        vkDestroyBuffer(device, buffer, nullptr);
+
+    if (memoryInfo.memory)
+        vkFreeMemory(device, memoryInfo.memory, nullptr);
+
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    if (descriptorSetLayout)
+        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+uint32_t DebugDraw::packColor(
+    const glm::vec4& color
+) {
+    auto channel = [](float value)
+    {
+        return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    };
+
+    return channel(color.r) | channel(color.g) << 8 | channel(color.b) << 16 | channel(color.a) << 24;
+}
+
+void DebugDraw::line(
+    const glm::vec3& from,
+    const glm::vec3& to,
+    const glm::vec4& color
+) {
+    if (lines.size() == maxLines)
+    {
+        dropped++;
+        return;
+    }
+
+    lines.push_back({ from, packColor(color), to, 0 });
+}
+
+void DebugDraw::aabb(
+    const glm::vec3& min,
+    const glm::vec3& max,
+    const glm::vec4& color
+) {
+    // corner i takes max on the axes whose bit is set
+    glm::vec3 corners[8];
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        corners[i] = glm::vec3(
+            (i & 1) ? max.x : min.x,
+            (i & 2) ? max.y : min.y,
+            (i & 4) ? max.z : min.z
+        );
+    }
+
+    // every edge joins two corners one bit apart
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        for (uint32_t bit = 1; bit < 8; bit <<= 1)
+        {
+            if (!(i & bit))
+                line(corners[i], corners[i | bit], color);
+        }
+    }
+}
+
+void DebugDraw::sphere(
+    const glm::vec3& center,
+    float radius,
+    const glm::vec4& color,
+    uint32_t segments
+) {
+    segments = std::max(segments, 3u);
+    const float step = 6.28318530718f / static_cast<float>(segments);
+
+    glm::vec3 previous[3];
+    for (uint32_t s = 0; s <= segments; s++)
+    {
+        float c = std::cos(step * s) * radius;
+        float n = std::sin(step * s) * radius;
+
+        // circles in the XY, YZ and ZX planes
+        glm::vec3 points[3] = {
+            center + glm::vec3(c, n, 0.0f),
+            center + glm::vec3(0.0f, c, n),
+            center + glm::vec3(n, 0.0f, c)
+        };
+
+        if (s > 0)
+        {
+            for (uint32_t axis = 0; axis < 3; axis++)
+                line(previous[axis], points[axis], color);
+        }
+
+        for (uint32_t axis = 0; axis < 3; axis++)
+            previous[axis] = points[axis];
+    }
+}
+
+void DebugDraw::frustum(
+    const glm::mat4& viewProjection,
+    const glm::vec4& color
+) {
+    glm::mat4 inverse = glm::inverse(viewProjection);
+
+    glm::vec3 corners[8];
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        glm::vec4 clip(
+            (i & 1) ? 1.0f : -1.0f,
+            (i & 2) ? 1.0f : -1.0f,
+            (i & 4) ? 1.0f : 0.0f,
+            1.0f
+        );
+        glm::vec4 world = inverse * clip;
+        corners[i] = glm::vec3(world) / world.w;
+    }
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        for (uint32_t bit = 1; bit < 8; bit <<= 1)
+        {
+            if (!(i & bit))
+                line(corners[i], corners[i | bit], color);
+        }
+    }
+}
+
+void DebugDraw::gridCell(
+    const glm::ivec3& cell,
+    float cellSize,
+    const glm::vec4& color
+) {
+    glm::vec3 min = glm::vec3(cell) * cellSize;
+    aabb(min, min + glm::vec3(cellSize), color);
+}
+
+void DebugDraw::grid(
+    const glm::vec3& origin,
+    float cellSize,
+    uint32_t cellsX,
+    uint32_t cellsZ,
+    const glm::vec4& color
+) {
+    const float sizeX = cellSize * cellsX;
+    const float sizeZ = cellSize * cellsZ;
+
+    for (uint32_t x = 0; x <= cellsX; x++)
+    {
+        glm::vec3 from = origin + glm::vec3(cellSize * x, 0.0f, 0.0f);
+        line(from, from + glm::vec3(0.0f, 0.0f, sizeZ), color);
+    }
+
+    for (uint32_t z = 0; z <= cellsZ; z++)
+    {
+        glm::vec3 from = origin + glm::vec3(0.0f, 0.0f, cellSize * z);
+        line(from, from + glm::vec3(sizeX, 0.0f, 0.0f), color);
+    }
+}
+
+void DebugDraw::flush(
+    uint32_t currentFrame
+) {
+    const uint32_t count = static_cast<uint32_t>(lines.size());
+    const VkDeviceSize offset = sliceSize * currentFrame;
+
+    if (count > 0)
+    {
+        std::memcpy(static_cast<char*>(mapped) + offset, lines.data(), count * sizeof(DebugLine));
+
+        if (!memoryInfo.isCoherent)
+        {
+            VkDeviceSize size = count * sizeof(DebugLine);
+
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = memoryInfo.memory;
+            range.offset = offset & ~(nonCoherentAtomSize - 1);
+            range.size = ((offset + size + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1)) - range.offset;
+
+            vkFlushMappedMemoryRanges(device, 1, &range);
+        }
+    }
+
+    drawCounts[currentFrame] = count;
+    stats.lines = count;
+    stats.dropped = dropped;
+
+    lines.clear();
+    dropped = 0;
+}
+
+void DebugDraw::recordDraw(
+    VkCommandBuffer cmd,
+    VkPipelineLayout lineLayout,
+    uint32_t currentFrame
+) const {
+    if (drawCounts[currentFrame] == 0)
+        return;
+
+    uint32_t dynamicOffset = static_cast<uint32_t>(sliceSize * currentFrame);
+
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        lineLayout,
+        1,
+        1,
+        &descriptorSet,
+        1,
+        &dynamicOffset
+    );
+
+    // 2 vertices, one instance per line
+    vkCmdDraw(cmd, 2, drawCounts[currentFrame], 0, 0);
+}
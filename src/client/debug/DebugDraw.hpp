@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../CoreVulkan.hpp"
+#include "../BufferManager.hpp"
+
+/**
+ * @brief Immediate-mode debug lines, drawn with one instanced call per frame.
+ *
+ * Anything may add lines, boxes, spheres, frusta or grid cells during the
+ * frame; they are kept on the CPU until flush copies them into the slice
+ * of the frame in a host-visible ring buffer (one slice per frame in
+ * flight, selected with a dynamic offset). recordDraw then draws every
+ * line as one instance of a 2 vertex line list with the Lines pipeline.
+ *
+ * Lines past the capacity of a frame are dropped and counted. Not
+ * thread-safe, add lines from the render thread.
+ */
+class DebugDraw
+{
+public:
+    struct Stats {
+        uint32_t lines = 0;
+        // over capacity last frame
+        uint32_t dropped = 0;
+    };
+
+private:
+    // std430 layout of DebugLine in debug_line.vert.glsl
+    struct DebugLine {
+        glm::vec3 from;
+        uint32_t color;
+        glm::vec3 to;
+        uint32_t pad;
+    };
+
+    VkDevice device;
+    VkDeviceSize nonCoherentAtomSize;
+    uint32_t maxLines;
+    // bytes per frame, a multiple of 256 so every slice is a valid dynamic offset
+    VkDeviceSize sliceSize;
+
+    VkBuffer buffer{VK_NULL_HANDLE};
+    BufferManager::AllocatedMemoryINFO memoryInfo{};
+    void* mapped = nullptr;
+
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+    std::vector<DebugLine> lines;
+    std::vector<uint32_t> drawCounts;
+    uint32_t dropped = 0;
+    Stats stats;
+
+public:
+    /**
+     * @param maxLines Lines per frame, rounded up to a multiple of 8.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    DebugDraw(
+        VkDevice device,
+        BufferManager* bufferManager,
+        VkDeviceSize nonCoherentAtomSize,
+        uint32_t framesInFlight,
+        uint32_t maxLines
+    );
+
+    ~DebugDraw();
+
+    DebugDraw(const DebugDraw&) = delete;
+    DebugDraw& operator=(const DebugDraw&) = delete;
+
+    /**
+     * @brief RGBA8 as read by unpackUnorm4x8.
+     */
+    static uint32_t packColor(
+        const glm::vec4& color
+    );
+
+    void line(
+        const glm::vec3& from,
+        const glm::vec3& to,
+        const glm::vec4& color
+    );
+
+    /**
+     * @brief Axis-aligned box, 12 lines.
+     */
+    void aabb(
+        const glm::vec3& min,
+        const glm::vec3& max,
+        const glm::vec4& color
+    );
+
+    /**
+     * @brief Three great circles around the axes, 3 * segments lines.
+     */
+    void sphere(
+        const glm::vec3& center,
+        float radius,
+        const glm::vec4& color,
+        uint32_t segments = 16
+    );
+
+    /**
+     * @brief Edges of the volume a view-projection matrix sees, 12 lines.
+     *
+     * Unprojects the corners of the Vulkan clip volume (depth 0 to 1).
+     */
+    void frustum(
+        const glm::mat4& viewProjection,
+        const glm::vec4& color
+    );
+
+    /**
+     * @brief One cell of a uniform spatial grid, the box [cell, cell + 1) * cellSize.
+     */
+    void gridCell(
+        const glm::ivec3& cell,
+        float cellSize,
+        const glm::vec4& color
+    );
+
+    /**
+     * @brief Flat grid of cellsX * cellsZ cells on the XZ plane starting at origin.
+     */
+    void grid(
+        const glm::vec3& origin,
+        float cellSize,
+        uint32_t cellsX,
+        uint32_t cellsZ,
+        const glm::vec4& color
+    );
+
+    /**
+     * @brief Moves the lines added since the last flush into the slice of this frame.
+     *
+     * Call once per frame after waiting for the frame fence.
+     */
+    void flush(
+        uint32_t currentFrame
+    );
+
+    /**
+     * @brief Draws the lines flushed for this frame.
+     *
+     * Expects the Lines pipeline and the global set (set 0) to be bound.
+     */
+    void recordDraw(
+        VkCommandBuffer cmd,
+        VkPipelineLayout lineLayout,
+        uint32_t currentFrame
+    ) const;
+
+    Stats getStats() const { return stats; }
+    VkDescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+};
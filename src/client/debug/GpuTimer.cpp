@@ -0,0 +1,145 @@
+#include "GpuTimer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+GpuTimer::GpuTimer(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    uint32_t queueFamily,
+    uint32_t framesInFlight,
+    uint32_t scopeCount,
+    uint32_t maxRanges
+) :
+    device(device),
+    scopeCount(scopeCount),
+    maxRanges(maxRanges),
+    frames(framesInFlight),
+    milliseconds(scopeCount, 0.0)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    if (!supported)
+        return;
+
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = 2 * maxRanges;
+
+    for (FrameQueries& frame : frames)
+    {
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create timestamp query pool!");
+
+        frame.rangeScopes.reserve(maxRanges);
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    for (FrameQueries& frame : frames)
+    {
+        if (frame.queryPool)
+            vkDestroyQueryPool(device, frame.queryPool, nullptr);
+    }
+}
+
+void GpuTimer::beginFrame(
+    uint32_t currentFrame
+) {
+    FrameQueries& frame = frames[currentFrame];
+    if (!supported || !frame.recorded)
+        return;
+
+    uint32_t queryCount = static_cast<uint32_t>(2 * frame.rangeScopes.size());
+    if (queryCount > 0)
+    {
+        std::vector<uint64_t> timestamps(queryCount);
+
+        // the fence was waited, anything not ready was never written
+        VkResult result = vkGetQueryPoolResults(
+            device,
+            frame.queryPool,
+            0,
+            queryCount,
+            timestamps.size() * sizeof(uint64_t),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+
+        if (result == VK_SUCCESS)
+        {
+            std::fill(milliseconds.begin(), milliseconds.end(), 0.0);
+
+            for (size_t i = 0; i < frame.rangeScopes.size(); i++)
+            {
+                uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & timestampMask;
+                milliseconds[frame.rangeScopes[i]] += ticks * timestampPeriod * 1e-6;
+            }
+        }
+    }
+
+    frame.rangeScopes.clear();
+    frame.recorded = false;
+}
+
+void GpuTimer::recordReset(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame
+) {
+    FrameQueries& frame = frames[currentFrame];
+    if (!supported)
+        return;
+
+    vkCmdResetQueryPool(cmd, frame.queryPool, 0, 2 * maxRanges);
+    frame.rangeScopes.clear();
+    frame.recorded = true;
+}
+
+void GpuTimer::begin(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    uint32_t scope
+) {
+    FrameQueries& frame = frames[currentFrame];
+    if (!supported || !frame.recorded || scope >= scopeCount || frame.rangeScopes.size() == maxRanges)
+        return;
+
+    uint32_t query = static_cast<uint32_t>(2 * frame.rangeScopes.size());
+    frame.rangeScopes.push_back(scope);
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, query);
+}
+
+void GpuTimer::end(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    uint32_t scope
+) {
+    FrameQueries& frame = frames[currentFrame];
+    if (!supported)
+        return;
+
+    // the last range of scope, ranges of different scopes may nest
+    for (size_t i = frame.rangeScopes.size(); i-- > 0;)
+    {
+        if (frame.rangeScopes[i] != scope)
+            continue;
+
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, static_cast<uint32_t>(2 * i + 1));
+        return;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+
+#include "../CoreVulkan.hpp"
+
+/**
+ * @brief GPU time of recorded command ranges, from timestamp queries.
+ *
+ * Every frame in flight has its own query pool. A range is a pair of
+ * timestamps written by begin and end; a scope may be timed several times
+ * in a frame (both occlusion culling phases, say) and its ranges are
+ * summed. Results are read once the frame slot comes around again, after
+ * its fence, so they lag by the frames in flight and never stall.
+ *
+ * Queues without timestamp support leave every call a no-op and every
+ * scope at zero.
+ */
+class GpuTimer
+{
+private:
+    struct FrameQueries {
+        VkQueryPool queryPool{VK_NULL_HANDLE};
+        // scope of every range written this frame, query 2 * i and 2 * i + 1
+        std::vector<uint32_t> rangeScopes;
+        // the pool was reset in a submitted command buffer
+        bool recorded = false;
+    };
+
+    VkDevice device;
+    uint32_t scopeCount;
+    uint32_t maxRanges;
+    bool supported = false;
+    // nanoseconds per tick
+    double timestampPeriod = 0.0;
+    uint64_t timestampMask = 0;
+
+    std::vector<FrameQueries> frames;
+    std::vector<double> milliseconds;
+
+public:
+    /**
+     * @param queueFamily Family of the queue the timed command buffers are submitted to.
+     * @param scopeCount Scopes are numbered from 0 to scopeCount - 1.
+     * @param maxRanges Ranges per frame, later ones are not timed.
+     *
+     * @throws std::runtime_error if a query pool creation fails.
+     */
+    GpuTimer(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        uint32_t queueFamily,
+        uint32_t framesInFlight,
+        uint32_t scopeCount,
+        uint32_t maxRanges = 32
+    );
+
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    /**
+     * @brief Reads back the ranges of the last frame recorded in this slot.
+     *
+     * Call once per frame after waiting for the frame fence.
+     */
+    void beginFrame(
+        uint32_t currentFrame
+    );
+
+    /**
+     * @brief Resets the queries of the frame, first thing in its command buffer.
+     *
+     * Must be recorded outside a render pass.
+     */
+    void recordReset(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    );
+
+    /**
+     * @brief Starts a range of scope, once every command before it has started.
+     */
+    void begin(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        uint32_t scope
+    );
+
+    /**
+     * @brief Ends the last range begun for scope, once every command before it has finished.
+     */
+    void end(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        uint32_t scope
+    );
+
+    bool isSupported() const { return supported; }
+    /// Summed ranges of scope in the last frame read back
+    double getMilliseconds(uint32_t scope) const { return milliseconds[scope]; }
+};
\ No newline at end of file
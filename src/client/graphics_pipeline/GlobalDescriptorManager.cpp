@@ -1,6 +1,8 @@
 #include "GlobalDescriptorManager.hpp"
 #include "../camera/CameraBufferManager.hpp"
 #include "../camera/UniformBufferGlobal.hpp"
+#include "../lighting/ClusteredLighting.hpp"
+#include "../lighting/CascadedShadowMaps.hpp"
 
 #include <array>
 #include <stdexcept>
@@ -8,34 +10,48 @@
 GlobalDescriptorManager::GlobalDescriptorManager(
     VkDevice device,
     CameraBufferManager* cameraBufferManager,
+    ClusteredLighting* clusteredLighting,
+    CascadedShadowMaps* shadowMaps,
     uint32_t maxFramesInFlight
 )
 : device(device)
 {
-    // Layout (set 0)
-    VkDescriptorSetLayoutBinding ubgBinding{};
-    ubgBinding.binding = 0;
-    ubgBinding.descriptorCount = 1;
-    ubgBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    ubgBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    // Layout (set 0): camera, then lights, cluster light counts and cluster light indices, then sun and cascades
+    std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    // the shadow pass reads the cascade matrices in its vertex shader
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[4].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &ubgBinding;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
 
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
         throw std::runtime_error("Failed to create global descriptor set layout");
 
     // Pool
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = maxFramesInFlight;
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = 2 * maxFramesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 3 * maxFramesInFlight;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = maxFramesInFlight;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
     poolInfo.maxSets = maxFramesInFlight;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
@@ -65,15 +81,30 @@ GlobalDescriptorManager::GlobalDescriptorManager(
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof(UniformBufferGlobal);
 
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = descriptorSets[i];
-        write.dstBinding = 0;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        write.descriptorCount = 1;
-        write.pBufferInfo = &bufferInfo;
-
-        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        std::array<VkDescriptorBufferInfo, 5> bufferInfos = {
+            bufferInfo,
+            clusteredLighting->getLightBufferInfo(i),
+            clusteredLighting->getClusterGridInfo(i),
+            clusteredLighting->getClusterLightIndexInfo(i),
+            shadowMaps->getShadowDataInfo(i)
+        };
+        VkDescriptorImageInfo shadowMapInfo = shadowMaps->getShadowMapInfo();
+
+        std::array<VkWriteDescriptorSet, 6> writes{};
+        for (uint32_t binding = 0; binding < writes.size(); binding++)
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = descriptorSets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorType = bindings[binding].descriptorType;
+            writes[binding].descriptorCount = 1;
+            if (binding < bufferInfos.size())
+                writes[binding].pBufferInfo = &bufferInfos[binding];
+            else
+                writes[binding].pImageInfo = &shadowMapInfo;
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
     }
 }
 
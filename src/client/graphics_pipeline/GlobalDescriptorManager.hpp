@@ -4,6 +4,8 @@
 #include <vector>
 
 class CameraBufferManager;
+class ClusteredLighting;
+class CascadedShadowMaps;
 
 /**
  * @brief Manages the global descriptor set (set 0) used across all frames.
@@ -13,13 +15,19 @@ class CameraBufferManager;
  * - Creating a descriptor pool sized per frame-in-flight.
  * - Allocating one descriptor set per frame.
  * - Binding the camera's global uniform buffer to each frame's descriptor set.
+ * - Binding the lights and light clusters of each frame.
+ * - Binding the sun and its shadow cascades.
  *
  * The global descriptor set typically contains per-frame data shared by
  * all rendered objects, such as view and projection matrices.
  *
  * This manager assumes:
  * - One uniform buffer per frame.
- * - A fixed layout containing a single uniform buffer binding at binding 0.
+ * - A fixed layout: the uniform buffer at binding 0, the lights, the
+ *   cluster light counts and the cluster light indices of ClusteredLighting
+ *   as storage buffers at bindings 1 to 3, the sun and cascade matrices of
+ *   CascadedShadowMaps as a uniform buffer at binding 4 and its cascades as
+ *   a combined image sampler at binding 5.
  *
  * Descriptor sets are created during construction and remain valid
  * for the lifetime of this object.
@@ -42,7 +50,13 @@ public:
      *
      * 1. Creates a descriptor set layout containing:
      *      - Binding 0: VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
-     *        Accessible in the vertex shader stage.
+     *        Accessible in the vertex and fragment shader stages.
+     *      - Bindings 1-3: VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+     *        Lights and light clusters, accessible in the fragment shader stage.
+     *      - Binding 4: VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+     *        Sun and cascade matrices, accessible in the vertex and fragment shader stages.
+     *      - Binding 5: VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+     *        Shadow cascades, accessible in the fragment shader stage.
      *
      * 2. Creates a descriptor pool sized to allocate one descriptor set
      *    per frame-in-flight.
@@ -50,13 +64,16 @@ public:
      * 3. Allocates descriptor sets.
      *
      * 4. Updates each descriptor set with the corresponding uniform buffer
-     *    obtained from CameraBufferManager.
+     *    obtained from CameraBufferManager and the light buffers of
+     *    ClusteredLighting and the shadow data of CascadedShadowMaps.
      *
      * Each frame-in-flight receives its own descriptor set, allowing
      * safe CPU/GPU parallelism without descriptor contention.
      *
      * @param device Vulkan logical device used for descriptor operations.
      * @param cameraBufferManager Provides per-frame uniform buffers.
+     * @param clusteredLighting Provides per-frame light and cluster buffers.
+     * @param shadowMaps Provides the per-frame sun data and the shadow cascades.
      * @param maxFramesInFlight Number of concurrent frames supported.
      *
      * @throws std::runtime_error if layout creation, pool creation,
@@ -65,6 +82,8 @@ public:
     GlobalDescriptorManager(
         VkDevice device,
         CameraBufferManager* cameraBufferManager,
+        ClusteredLighting* clusteredLighting,
+        CascadedShadowMaps* shadowMaps,
         uint32_t maxFramesInFlight
     );
 
@@ -1,33 +1,39 @@
 #include "GraphicsPipeline.hpp"
+#include "RenderPass.hpp"
+#include <chrono>
+#include <iostream>
 #include <stdexcept>
 
 GraphicsPipeline::GraphicsPipeline(
     VkDevice device,
     VkExtent2D swapchainExtent,
     VkRenderPass renderPass,
+    VkRenderPass shadowRenderPass,
     VkDescriptorSetLayout globalLayout,
     VkDescriptorSetLayout materialLayout,
     VkDescriptorSetLayout instanceLayout,
+    VkDescriptorSetLayout materialParamsLayout,
     VkDescriptorSetLayout particleLayout,
-    VkSampleCountFlagBits msaaSamples
+    VkDescriptorSetLayout depthInputLayout,
+    VkDescriptorSetLayout debugLineLayout,
+    VkSampleCountFlagBits msaaSamples,
+    bool bindlessMaterials,
+    bool dynamicRenderState,
+    VkPipelineCache pipelineCache,
+    JobSystem* jobSystem,
+    uint32_t framesInFlight
 ) :
-    device(device)
+    device(device),
+    renderPass(renderPass),
+    shadowRenderPass(shadowRenderPass),
+    msaaSamples(msaaSamples),
+    bindlessMaterials(bindlessMaterials),
+    dynamicRenderState(dynamicRenderState),
+    pipelineCache(pipelineCache),
+    jobSystem(jobSystem),
+    framesInFlight(framesInFlight)
 {
-    // Load shaders
-    ShaderLoader* shaderLoader = new ShaderLoader(device, "shaders/triangle.vert.glsl.spv", "shaders/triangle.frag.glsl.spv");
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = shaderLoader->getVertModule();
-    vertShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = shaderLoader->getFragModule();
-    fragShaderStageInfo.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    auto start = std::chrono::steady_clock::now();
 
 //* create layouts
     pipelineLayouts[GraphicsPipeline::LayoutType::Mesh] = createPipelineLayout(
@@ -35,7 +41,8 @@ GraphicsPipeline::GraphicsPipeline(
         {
             globalLayout,
             materialLayout,
-            instanceLayout
+            instanceLayout,
+            materialParamsLayout
         }
     );
 
@@ -43,125 +50,390 @@ GraphicsPipeline::GraphicsPipeline(
         static_cast<uint32_t>(sizeof(ParticleData)),
         {
             globalLayout,
-            particleLayout
+            particleLayout,
+            depthInputLayout
         }
     );
 
-//* create info
-    VkVertexInputBindingDescription bindingDescription
-    {
-        .binding = 0,
-        .stride = sizeof(Vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-    };
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {{
-        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos) },
-        { 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Vertex, color) },
-        { 2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, texCoord) }
-    }};
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = createVertexInputState(
-        bindingDescription,
-        attributeDescriptions
+    pipelineLayouts[GraphicsPipeline::LayoutType::DebugLine] = createPipelineLayout(
+        0,
+        {
+            globalLayout,
+            debugLineLayout
+        }
     );
+
     viewport = {0.0f, 0.0f, static_cast<float>(swapchainExtent.width), static_cast<float>(swapchainExtent.height), 0.0f, 1.0f};
     scissor = { {0, 0}, swapchainExtent };
-    VkPipelineViewportStateCreateInfo viewportState = createViewportState(viewport, scissor);
-    VkPipelineMultisampleStateCreateInfo multisampling = createMultisampleState(msaaSamples);
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-    VkPipelineDynamicStateCreateInfo dynamicState = createDynamicState(dynamicStates);
-    VkPipelineDepthStencilStateCreateInfo depthStencil = createDepthStencilState();
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {
-        .blendEnable = VK_FALSE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .colorBlendOp = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .alphaBlendOp = VK_BLEND_OP_ADD,
-        .colorWriteMask = (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
-    };
-    VkPipelineColorBlendStateCreateInfo colorBlending = createColorBlendState(colorBlendAttachment);
-
-    graphicsPipelines[PipelineType::Triangles_NoCull] =
-        createPipeline(
-            renderPass,
-            pipelineLayouts[LayoutType::Mesh],
-            shaderStages,
-            vertexInputInfo,
-            createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
-            viewportState,
-            createRasterizerState(VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL),
-            multisampling,
-            depthStencil,
-            colorBlending,
-            dynamicState
-        );
 
-    graphicsPipelines[PipelineType::Triangles_BackCull] =
-        createPipeline(
-            renderPass,
-            pipelineLayouts[LayoutType::Mesh],
-            shaderStages,
-            vertexInputInfo,
-            createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
-            viewportState,
-            createRasterizerState(VK_CULL_MODE_BACK_BIT, VK_POLYGON_MODE_FILL),
-            multisampling,
-            depthStencil,
-            colorBlending,
-            dynamicState
-        );
+//* startup pipelines, compiled concurrently
+    compileAsync(keyOf(PipelineType::Triangles_NoCull));
 
-    graphicsPipelines[PipelineType::Triangles_FrontCull] =
-        createPipeline(
-            renderPass,
-            pipelineLayouts[LayoutType::Mesh],
-            shaderStages,
-            vertexInputInfo,
-            createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST),
-            viewportState,
-            createRasterizerState(VK_CULL_MODE_FRONT_BIT, VK_POLYGON_MODE_FILL),
-            multisampling,
-            depthStencil,
-            colorBlending,
-            dynamicState
-        );
+    std::vector<std::pair<std::shared_ptr<CompileJob>, ShaderLoader*>> fixedJobs;
+    for (PipelineType type : {PipelineType::Particles, PipelineType::Lines})
+    {
+        ShaderLoader* shaderLoader = loadFixedProgram(type);
+        fixedJobs.emplace_back(submitFixed(type, shaderLoader), shaderLoader);
+    }
+
+    for (auto& [job, shaderLoader] : fixedJobs)
+    {
+        jobSystem->wait(job->counter);
+        delete shaderLoader;
+
+        graphicsPipelines[job->type] = finishCompile(*job);
+        if (graphicsPipelines[job->type] == VK_NULL_HANDLE)
+            throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    getVariant(keyOf(PipelineType::Triangles_NoCull));
+
+    stats.startupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+//* everything else finishes while rendering starts
+    for (PipelineType type : {PipelineType::Triangles_BackCull, PipelineType::Triangles_FrontCull})
+        compileAsync(keyOf(type));
+
+    // ready before the pre-pass is first turned on
+    for (PipelineType type : {PipelineType::Triangles_NoCull, PipelineType::Triangles_BackCull, PipelineType::Triangles_FrontCull})
+        compileAsync(depthPrepassKey(keyOf(type)));
+
+    // the cascades draw from the first frame, every cull mode maps to this one
+    compileAsync(shadowKey(keyOf(PipelineType::Triangles_NoCull)));
+
+    for (uint32_t features = 1; features <= (MaterialDesc::FeatureAlphaTest | MaterialDesc::FeatureEmissive); features++)
+    {
+        MaterialDesc::PipelineKey key;
+        key.features = features;
+        compileAsync(key);
+    }
+}
+
+GraphicsPipeline::~GraphicsPipeline() {
+    // jobs reference this object and the shader modules
+    for (auto& pair : compiling) {
+        jobSystem->wait(pair.second->counter);
+        if (pair.second->pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pair.second->pipeline, nullptr);
+        }
+        if (pair.second->cache != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(device, pair.second->cache, nullptr);
+        }
+    }
+
+    for (auto& job : reloads) {
+        jobSystem->wait(job->counter);
+        if (job->pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, job->pipeline, nullptr);
+        }
+        if (job->cache != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(device, job->cache, nullptr);
+        }
+    }
+
+    for (auto& retired : retiredPipelines) {
+        vkDestroyPipeline(device, retired.pipeline, nullptr);
+    }
+
+    for (ShaderLoader* shaderLoader : retiredPrograms) {
+        delete shaderLoader;
+    }
+
+    for (auto& pair : variants) {
+        if (pair.second != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pair.second, nullptr);
+        }
+    }
+
+    for (auto& pair : graphicsPipelines) {
+        if (pair.second != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pair.second, nullptr);
+        }
+    }
+
+    for (auto& pair : shaderPrograms) {
+        delete pair.second;
+    }
+
+    for (auto& pair : pipelineLayouts) {
+        if (pair.second != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device, pair.second, nullptr);
+        }
+    }
+}
+
+std::shared_ptr<GraphicsPipeline::CompileJob> GraphicsPipeline::submitCompile(
+    std::function<VkPipeline(VkPipelineCache)> build
+) {
+    auto job = std::make_shared<CompileJob>();
+
+    // seeded with everything compiled so far, workers never share a cache
+    size_t dataSize = 0;
+    std::vector<char> data;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) == VK_SUCCESS && dataSize > 0)
+    {
+        data.resize(dataSize);
+        if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+            dataSize = 0;
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = dataSize;
+    cacheInfo.pInitialData = dataSize > 0 ? data.data() : nullptr;
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &job->cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    jobSystem->submit(
+        [job, build]()
+        {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                job->pipeline = build(job->cache);
+            } catch (const std::exception& e) {
+                job->error = e.what();
+            }
+            job->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        },
+        &job->counter
+    );
+
+    return job;
+}
+
+VkPipeline GraphicsPipeline::finishCompile(
+    CompileJob& job
+) {
+    if (vkMergePipelineCaches(device, pipelineCache, 1, &job.cache) != VK_SUCCESS) {
+        std::cerr << "failed to merge pipeline cache" << std::endl;
+    }
+    vkDestroyPipelineCache(device, job.cache, nullptr);
+    job.cache = VK_NULL_HANDLE;
+
+    stats.compileSeconds += job.seconds;
+
+    if (!job.error.empty())
+    {
+        std::cerr << "failed to compile pipeline " << job.key.shader << ": " << job.error << std::endl;
+        return VK_NULL_HANDLE;
+    }
+
+    stats.compiled++;
+
+    VkPipeline pipeline = job.pipeline;
+    job.pipeline = VK_NULL_HANDLE;
+    return pipeline;
+}
+
+void GraphicsPipeline::compileAsync(
+    const MaterialDesc::PipelineKey& key
+) {
+    const MaterialDesc::PipelineKey pipelineKey = staticKey(key);
+    if (variants.count(pipelineKey) || compiling.count(pipelineKey))
+        return;
+
+    // module loading mutates shaderPrograms, keep it on this thread
+    ShaderLoader* shaderLoader = getShaderProgram(pipelineKey.shader);
+
+    std::shared_ptr<CompileJob> job = submitCompile(
+        [this, pipelineKey, shaderLoader](VkPipelineCache cache)
+        {
+            return createVariant(pipelineKey, shaderLoader, cache);
+        }
+    );
+    job->key = pipelineKey;
+    compiling.emplace(pipelineKey, job);
+}
+
+void GraphicsPipeline::collectCompiled()
+{
+    for (auto it = compiling.begin(); it != compiling.end();)
+    {
+        if (!it->second->counter.done())
+        {
+            ++it;
+            continue;
+        }
 
+        VkPipeline pipeline = finishCompile(*it->second);
+        if (pipeline != VK_NULL_HANDLE)
+            variants.emplace(it->first, pipeline);
 
-    graphicsPipelines[PipelineType::Lines] =
-        createPipeline(
-            renderPass,
-            pipelineLayouts[LayoutType::Mesh],
-            shaderStages,
-            vertexInputInfo,
-            createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_LINE_LIST),
-            viewportState,
-            createRasterizerState(VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL),
-            multisampling,
-            depthStencil,
-            colorBlending,
-            dynamicState
+        it = compiling.erase(it);
+    }
+
+    frameIndex++;
+
+    // in order, so the newest reload of a pipeline is applied last
+    size_t write = 0;
+    for (size_t i = 0; i < reloads.size(); i++)
+    {
+        std::shared_ptr<CompileJob>& job = reloads[i];
+
+        // a first build of the same key still running would overwrite it
+        if (!job->counter.done() || (!job->fixed && compiling.count(job->key)))
+        {
+            reloads[write++] = std::move(job);
+            continue;
+        }
+
+        VkPipeline pipeline = finishCompile(*job);
+        if (pipeline == VK_NULL_HANDLE)
+            continue;
+
+        VkPipeline& slot = job->fixed ? graphicsPipelines[job->type] : variants[job->key];
+        if (slot != VK_NULL_HANDLE)
+            retiredPipelines.push_back({frameIndex, slot});
+        slot = pipeline;
+    }
+    reloads.resize(write);
+
+    // frames recorded before the swap have all passed their fence by now
+    for (auto it = retiredPipelines.begin(); it != retiredPipelines.end();)
+    {
+        if (frameIndex - it->frame <= framesInFlight)
+        {
+            ++it;
+            continue;
+        }
+
+        vkDestroyPipeline(device, it->pipeline, nullptr);
+        it = retiredPipelines.erase(it);
+    }
+
+    if (compiling.empty() && reloads.empty())
+    {
+        for (ShaderLoader* shaderLoader : retiredPrograms)
+            delete shaderLoader;
+        retiredPrograms.clear();
+    }
+}
+
+void GraphicsPipeline::reloadProgram(
+    const std::string& shader
+) {
+    PipelineType fixedType;
+    const bool fixed = fixedTypeOf(shader, fixedType);
+    if (!fixed && !shaderPrograms.count(shader))
+        return;
+
+    ShaderLoader* shaderLoader = nullptr;
+    try {
+        shaderLoader = fixed
+            ? loadFixedProgram(fixedType)
+            : loadMeshProgram(shader);
+    } catch (const std::exception& e) {
+        std::cerr << "failed to reload shader " << shader << ": " << e.what() << std::endl;
+        return;
+    }
+
+    if (fixed)
+    {
+        reloads.push_back(submitFixed(fixedType, shaderLoader));
+
+        // nothing keeps the modules of fixed types, they only live for the job
+        retiredPrograms.push_back(shaderLoader);
+        return;
+    }
+
+    retiredPrograms.push_back(shaderPrograms[shader]);
+    shaderPrograms[shader] = shaderLoader;
+
+    std::vector<MaterialDesc::PipelineKey> keys;
+    for (auto& pair : variants)
+        if (pair.first.shader == shader)
+            keys.push_back(pair.first);
+    for (auto& pair : compiling)
+        if (pair.first.shader == shader)
+            keys.push_back(pair.first);
+
+    for (const MaterialDesc::PipelineKey& key : keys)
+    {
+        std::shared_ptr<CompileJob> job = submitCompile(
+            [this, key, shaderLoader](VkPipelineCache cache)
+            {
+                return createVariant(key, shaderLoader, cache);
+            }
         );
+        job->key = key;
+        reloads.push_back(job);
+    }
+}
+
+GraphicsPipeline::CompileStats GraphicsPipeline::getCompileStats() const
+{
+    CompileStats out = stats;
+    out.pending = static_cast<uint32_t>(compiling.size());
+    return out;
+}
+
+bool GraphicsPipeline::fixedTypeOf(
+    const std::string& shader,
+    PipelineType& type
+) {
+    if (shader == "particle")
+        type = PipelineType::Particles;
+    else if (shader == "debug_line")
+        type = PipelineType::Lines;
+    else
+        return false;
+
+    return true;
+}
 
-    //* fix for points
-    delete shaderLoader;
-    shaderLoader = new ShaderLoader(
+ShaderLoader* GraphicsPipeline::loadFixedProgram(
+    PipelineType type
+) const {
+    if (type == PipelineType::Lines)
+        return new ShaderLoader(device, "shaders/debug_line.vert.glsl.spv", "shaders/debug_line.frag.glsl.spv");
+
+    // a multisampled depth attachment is read through subpassInputMS
+    return new ShaderLoader(
         device,
         "shaders/particle.vert.glsl.spv",
-        "shaders/particle.frag.glsl.spv"
+        msaaSamples != VK_SAMPLE_COUNT_1_BIT ? "shaders/particle_msaa.frag.glsl.spv" : "shaders/particle.frag.glsl.spv"
     );
+}
 
-    // update shader stages
+std::shared_ptr<GraphicsPipeline::CompileJob> GraphicsPipeline::submitFixed(
+    PipelineType type,
+    ShaderLoader* shaderLoader
+) {
+    std::shared_ptr<CompileJob> job = submitCompile(
+        [this, type, shaderLoader](VkPipelineCache cache)
+        {
+            return type == PipelineType::Lines
+                ? createDebugLinePipeline(shaderLoader, cache)
+                : createParticlePipeline(shaderLoader, cache);
+        }
+    );
+    job->key.shader = type == PipelineType::Lines ? "debug_line" : "particle";
+    job->fixed = true;
+    job->type = type;
+    return job;
+}
+
+VkPipeline GraphicsPipeline::createParticlePipeline(
+    ShaderLoader* shaderLoader,
+    VkPipelineCache cache
+) {
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
     vertShaderStageInfo.module = shaderLoader->getVertModule();
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = shaderLoader->getFragModule();
+    fragShaderStageInfo.pName = "main";
 
-    shaderStages[0] = vertShaderStageInfo;
-    shaderStages[1] = fragShaderStageInfo;
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-    // empty Vertex Input
+    // empty Vertex Input, corners come from gl_VertexIndex
     VkPipelineVertexInputStateCreateInfo emptyVertexInput{};
     emptyVertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     emptyVertexInput.vertexBindingDescriptionCount = 0;
@@ -169,61 +441,431 @@ GraphicsPipeline::GraphicsPipeline(
     emptyVertexInput.vertexAttributeDescriptionCount = 0;
     emptyVertexInput.pVertexAttributeDescriptions = nullptr;
 
-    // blending for particles
+    VkViewport particleViewport = viewport;
+    VkRect2D particleScissor = scissor;
+    VkPipelineViewportStateCreateInfo viewportState = createViewportState(particleViewport, particleScissor);
+    VkPipelineMultisampleStateCreateInfo multisampling = createMultisampleState(msaaSamples);
+
+    // premultiplied alpha: alpha, additive and premultiplied emitters in one sorted draw
     VkPipelineColorBlendAttachmentState particleBlendAttachment{
         .blendEnable = VK_TRUE,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
         .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .colorBlendOp = VK_BLEND_OP_ADD,
         .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .alphaBlendOp = VK_BLEND_OP_ADD,
         .colorWriteMask = (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
     };
 
     VkPipelineColorBlendStateCreateInfo particleColorBlending = createColorBlendState(particleBlendAttachment);
 
-    // depth: test yes, write no
-    VkPipelineDepthStencilStateCreateInfo particleDepth = depthStencil;
+    // depth: test yes, write no, the attachment is read-only in this subpass
+    VkPipelineDepthStencilStateCreateInfo particleDepth = createDepthStencilState();
     particleDepth.depthWriteEnable = VK_FALSE;
 
-    dynamicStates.push_back(VK_DYNAMIC_STATE_LINE_WIDTH);
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState = createDynamicState(dynamicStates);
 
-    dynamicState = createDynamicState(
-        dynamicStates
+    // one 4 vertex strip per instance
+    return createPipeline(
+        cache,
+        renderPass,
+        pipelineLayouts.at(LayoutType::Particle),
+        shaderStages,
+        emptyVertexInput,
+        createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP),
+        viewportState,
+        createRasterizerState(VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL),
+        multisampling,
+        particleDepth,
+        particleColorBlending,
+        dynamicState,
+        RenderPass::TRANSPARENT_SUBPASS
     );
+}
 
-    graphicsPipelines[PipelineType::Points] =
-        createPipeline(
-            renderPass,
-            pipelineLayouts[LayoutType::Particle],
-            shaderStages,
-            emptyVertexInput,
-            createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_POINT_LIST),
-            viewportState,
-            createRasterizerState(VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL),
-            multisampling,
-            particleDepth,
-            particleColorBlending,
-            dynamicState
-        );
+VkPipeline GraphicsPipeline::createDebugLinePipeline(
+    ShaderLoader* shaderLoader,
+    VkPipelineCache cache
+) {
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = shaderLoader->getVertModule();
+    vertShaderStageInfo.pName = "main";
 
-    //shaders is not required anymore
-    delete(shaderLoader);
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = shaderLoader->getFragModule();
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+
+    // empty Vertex Input, the ends come from the line buffer
+    VkPipelineVertexInputStateCreateInfo emptyVertexInput{};
+    emptyVertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkViewport lineViewport = viewport;
+    VkRect2D lineScissor = scissor;
+    VkPipelineViewportStateCreateInfo viewportState = createViewportState(lineViewport, lineScissor);
+    VkPipelineMultisampleStateCreateInfo multisampling = createMultisampleState(msaaSamples);
+
+    // straight alpha, translucent lines stay readable over the scene
+    VkPipelineColorBlendAttachmentState lineBlendAttachment{
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
+    };
+
+    VkPipelineColorBlendStateCreateInfo lineColorBlending = createColorBlendState(lineBlendAttachment);
+
+    // depth: test yes, write no, the attachment is read-only in this subpass
+    VkPipelineDepthStencilStateCreateInfo lineDepth = createDepthStencilState();
+    lineDepth.depthWriteEnable = VK_FALSE;
+
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState = createDynamicState(dynamicStates);
+
+    // one 2 vertex line per instance
+    return createPipeline(
+        cache,
+        renderPass,
+        pipelineLayouts.at(LayoutType::DebugLine),
+        shaderStages,
+        emptyVertexInput,
+        createInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_LINE_LIST),
+        viewportState,
+        createRasterizerState(VK_CULL_MODE_NONE, VK_POLYGON_MODE_FILL),
+        multisampling,
+        lineDepth,
+        lineColorBlending,
+        dynamicState,
+        RenderPass::TRANSPARENT_SUBPASS
+    );
 }
 
-GraphicsPipeline::~GraphicsPipeline() {
-    for (auto& pair : graphicsPipelines) {
-        if (pair.second != VK_NULL_HANDLE) {
-            vkDestroyPipeline(device, pair.second, nullptr);
-        }
+MaterialDesc::PipelineKey GraphicsPipeline::keyOf(
+    PipelineType type
+) {
+    MaterialDesc::PipelineKey key;
+
+    switch (type)
+    {
+        case PipelineType::Triangles_NoCull:
+            break;
+        case PipelineType::Triangles_BackCull:
+            key.state.cullMode = VK_CULL_MODE_BACK_BIT;
+            break;
+        case PipelineType::Triangles_FrontCull:
+            key.state.cullMode = VK_CULL_MODE_FRONT_BIT;
+            break;
+        case PipelineType::Lines:
+        case PipelineType::Particles:
+            throw std::runtime_error("fixed pipeline type is not a mesh variant!");
     }
 
-    for (auto& pair : pipelineLayouts) {
-        if (pair.second != VK_NULL_HANDLE) {
-            vkDestroyPipelineLayout(device, pair.second, nullptr);
+    return key;
+}
+
+bool GraphicsPipeline::usesDepthPrepass(
+    const MaterialDesc::PipelineKey& key
+) {
+    return key.state.blend == MaterialDesc::BlendMode::Opaque &&
+        key.state.depthTest &&
+        key.state.depthWrite &&
+        key.state.depthCompare == VK_COMPARE_OP_LESS &&
+        (key.features & MaterialDesc::FeatureAlphaTest) == 0;
+}
+
+MaterialDesc::PipelineKey GraphicsPipeline::depthPrepassKey(
+    const MaterialDesc::PipelineKey& key
+) {
+    // same rasterization, so both passes produce the same depth
+    MaterialDesc::PipelineKey out;
+    out.shader = DEPTH_PREPASS_SHADER;
+    out.state.topology = key.state.topology;
+    out.state.cullMode = key.state.cullMode;
+    out.state.polygonMode = key.state.polygonMode;
+    return out;
+}
+
+MaterialDesc::PipelineKey GraphicsPipeline::afterDepthPrepassKey(
+    const MaterialDesc::PipelineKey& key
+) {
+    MaterialDesc::PipelineKey out = key;
+    out.state.depthWrite = false;
+    out.state.depthCompare = VK_COMPARE_OP_EQUAL;
+    return out;
+}
+
+bool GraphicsPipeline::castsShadow(
+    const MaterialDesc::PipelineKey& key
+) {
+    return key.state.blend == MaterialDesc::BlendMode::Opaque &&
+        (key.features & MaterialDesc::FeatureAlphaTest) == 0;
+}
+
+MaterialDesc::PipelineKey GraphicsPipeline::shadowKey(
+    const MaterialDesc::PipelineKey& key
+) {
+    // back faces too: open meshes still block the sun, the depth bias handles acne
+    MaterialDesc::PipelineKey out;
+    out.shader = SHADOW_SHADER;
+    out.state.topology = key.state.topology;
+    out.state.polygonMode = key.state.polygonMode;
+    return out;
+}
+
+VkPipeline GraphicsPipeline::getPipeline(
+    PipelineType type
+) {
+    if (type == PipelineType::Particles || type == PipelineType::Lines)
+        return graphicsPipelines.at(type);
+
+    return getVariant(keyOf(type));
+}
+
+MaterialDesc::PipelineKey GraphicsPipeline::staticKey(
+    const MaterialDesc::PipelineKey& key
+) const {
+    if (!dynamicRenderState)
+        return key;
+
+    MaterialDesc::PipelineKey out = key;
+    out.state.cullMode = VK_CULL_MODE_NONE;
+    out.state.depthTest = true;
+    out.state.depthWrite = true;
+    out.state.depthCompare = VK_COMPARE_OP_LESS;
+
+    // only the topology class is baked into the pipeline
+    switch (key.state.topology)
+    {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            out.state.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            out.state.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+            break;
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP_WITH_ADJACENCY:
+            out.state.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            break;
+        default:
+            break;
+    }
+
+    return out;
+}
+
+VkPipeline GraphicsPipeline::getVariant(
+    const MaterialDesc::PipelineKey& key
+) {
+    const MaterialDesc::PipelineKey pipelineKey = staticKey(key);
+
+    auto it = variants.find(pipelineKey);
+    if (it != variants.end())
+        return it->second;
+
+    // needed now: wait for its background compile instead of building it twice
+    auto job = compiling.find(pipelineKey);
+    if (job != compiling.end())
+    {
+        std::shared_ptr<CompileJob> pending = job->second;
+        compiling.erase(job);
+
+        jobSystem->wait(pending->counter);
+        VkPipeline pipeline = finishCompile(*pending);
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            variants.emplace(pipelineKey, pipeline);
+            return pipeline;
         }
     }
+
+    // failed in the background too: rethrows the error here
+    VkPipeline pipeline = createVariant(pipelineKey, getShaderProgram(pipelineKey.shader), pipelineCache);
+    variants.emplace(pipelineKey, pipeline);
+    stats.compiled++;
+    return pipeline;
+}
+
+void GraphicsPipeline::setDynamicState(
+    VkCommandBuffer cmd,
+    const MaterialDesc::RenderState& state
+) const {
+    if (!dynamicRenderState)
+        return;
+
+    vkCmdSetPrimitiveTopology(cmd, state.topology);
+    vkCmdSetCullMode(cmd, state.cullMode);
+    vkCmdSetDepthTestEnable(cmd, state.depthTest ? VK_TRUE : VK_FALSE);
+    vkCmdSetDepthWriteEnable(cmd, state.depthWrite ? VK_TRUE : VK_FALSE);
+    vkCmdSetDepthCompareOp(cmd, state.depthCompare);
+}
+
+ShaderLoader* GraphicsPipeline::getShaderProgram(
+    const std::string& shader
+) {
+    auto it = shaderPrograms.find(shader);
+    if (it != shaderPrograms.end())
+        return it->second;
+
+    ShaderLoader* shaderLoader = loadMeshProgram(shader);
+    shaderPrograms.emplace(shader, shaderLoader);
+    return shaderLoader;
+}
+
+ShaderLoader* GraphicsPipeline::loadMeshProgram(
+    const std::string& shader
+) const {
+    if (shader == DEPTH_PREPASS_SHADER || shader == SHADOW_SHADER)
+        return new ShaderLoader(device, "shaders/" + shader + ".vert.glsl.spv", "");
+
+    return new ShaderLoader(
+        device,
+        "shaders/" + shader + ".vert.glsl.spv",
+        "shaders/" + shader + (bindlessMaterials ? "_bindless.frag.glsl.spv" : ".frag.glsl.spv")
+    );
+}
+
+VkPipeline GraphicsPipeline::createVariant(
+    const MaterialDesc::PipelineKey& key,
+    ShaderLoader* shaderLoader,
+    VkPipelineCache cache
+) {
+    // constant_id 0 of the fragment shader holds the feature mask
+    VkSpecializationMapEntry featuresEntry{0, 0, sizeof(uint32_t)};
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = 1;
+    specialization.pMapEntries = &featuresEntry;
+    specialization.dataSize = sizeof(key.features);
+    specialization.pData = &key.features;
+
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = shaderLoader->getVertModule();
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = shaderLoader->getFragModule();
+    shaderStages[1].pName = "main";
+    shaderStages[1].pSpecializationInfo = &specialization;
+
+    // the pre-pass and shadow programs have no fragment stage and only read the position stream
+    const bool shadow = key.shader == SHADOW_SHADER;
+    const bool depthOnly = key.shader == DEPTH_PREPASS_SHADER || shadow;
+
+    VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
+    std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = Vertex::getAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = createVertexInputState(
+        bindingDescription,
+        attributeDescriptions
+    );
+    if (depthOnly)
+    {
+        bindingDescription.stride = sizeof(glm::vec3);
+        vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    }
+
+    // local copies, several workers build variants at once
+    VkViewport variantViewport = viewport;
+    VkRect2D variantScissor = scissor;
+    VkPipelineViewportStateCreateInfo viewportState = createViewportState(variantViewport, variantScissor);
+    std::vector<VkDynamicState> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    if (dynamicRenderState)
+    {
+        dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE);
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP);
+    }
+    // scaled with the texel size of each cascade
+    if (shadow)
+        dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_BIAS);
+    VkPipelineDynamicStateCreateInfo dynamicState = createDynamicState(dynamicStates);
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = createDepthStencilState();
+    depthStencil.depthTestEnable = key.state.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = key.state.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = key.state.depthCompare;
+
+    VkPipelineColorBlendAttachmentState blendAttachment{
+        .blendEnable = VK_FALSE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT)
+    };
+    switch (key.state.blend)
+    {
+        case MaterialDesc::BlendMode::AlphaBlend:
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            break;
+        case MaterialDesc::BlendMode::Additive:
+            blendAttachment.blendEnable = VK_TRUE;
+            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            break;
+        case MaterialDesc::BlendMode::Opaque:
+            break;
+    }
+    if (depthOnly)
+        blendAttachment.colorWriteMask = 0;
+    VkPipelineColorBlendStateCreateInfo colorBlending = createColorBlendState(blendAttachment);
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = createRasterizerState(key.state.cullMode, key.state.polygonMode);
+    if (shadow)
+    {
+        rasterizer.depthBiasEnable = VK_TRUE;
+        // the shadow pass has a depth attachment only
+        colorBlending.attachmentCount = 0;
+    }
+
+    return createPipeline(
+        cache,
+        shadow ? shadowRenderPass : renderPass,
+        pipelineLayouts.at(LayoutType::Mesh),
+        shaderStages,
+        vertexInputInfo,
+        createInputAssemblyState(key.state.topology),
+        viewportState,
+        rasterizer,
+        createMultisampleState(shadow ? VK_SAMPLE_COUNT_1_BIT : msaaSamples),
+        depthStencil,
+        colorBlending,
+        dynamicState,
+        shadow ? 0 : RenderPass::OPAQUE_SUBPASS,
+        depthOnly ? 1 : 2
+    );
 }
 
 VkPipelineLayout GraphicsPipeline::createPipelineLayout(
@@ -259,7 +901,7 @@ VkPipelineLayout GraphicsPipeline::createPipelineLayout(
 
 VkPipelineVertexInputStateCreateInfo GraphicsPipeline::createVertexInputState(
     VkVertexInputBindingDescription& bindingDescription,
-    std::array<VkVertexInputAttributeDescription, 3>& attributeDescriptions
+    std::array<VkVertexInputAttributeDescription, 4>& attributeDescriptions
 ) {
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -376,6 +1018,7 @@ VkPipelineDynamicStateCreateInfo GraphicsPipeline::createDynamicState(
 }
 
 VkPipeline GraphicsPipeline::createPipeline(
+    VkPipelineCache cache,
     const VkRenderPass renderPass,
     const VkPipelineLayout& pipelineLayout,
     const VkPipelineShaderStageCreateInfo* shaderStages,
@@ -386,13 +1029,15 @@ VkPipeline GraphicsPipeline::createPipeline(
     const VkPipelineMultisampleStateCreateInfo& multisampling,
     const VkPipelineDepthStencilStateCreateInfo& depthStencil,
     const VkPipelineColorBlendStateCreateInfo& colorBlend,
-    const VkPipelineDynamicStateCreateInfo& dynamicState
+    const VkPipelineDynamicStateCreateInfo& dynamicState,
+    uint32_t subpass,
+    uint32_t stageCount
 ) {
     VkPipeline graphicsPipeline;
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    pipelineInfo.stageCount = stageCount;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInput;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -404,9 +1049,9 @@ VkPipeline GraphicsPipeline::createPipeline(
     pipelineInfo.layout = pipelineLayout;
     pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = subpass;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
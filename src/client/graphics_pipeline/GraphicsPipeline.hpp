@@ -5,27 +5,127 @@
 #include "../batch/instance/InstanceData.hpp"
 #include "../particle/ParticleData.hpp"
 #include "../batch/mesh/Vertex.hpp"
+#include "../batch/material/MaterialDesc.hpp"
+#include "jobs/JobSystem.hpp"
 #include <array>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 
+/**
+ * @brief Owns the pipeline layouts and every graphics pipeline.
+ *
+ * Mesh pipelines are variants described by a MaterialDesc::PipelineKey
+ * (shader program, render state, feature flags) and built on first use.
+ * Feature flags become specialization constants, so one SPIR-V module per
+ * program covers every combination and is loaded only once.
+ *
+ * With dynamicRenderState (Vulkan 1.3 extended dynamic state) cull mode,
+ * depth test/write/compare and the topology within its class are left out
+ * of the pipeline: keys differing only by them share one pipeline, and
+ * setDynamicState applies them while recording.
+ *
+ * The depth pre-pass draws with variants of the DEPTH_PREPASS_SHADER
+ * program: a vertex stage reading the position stream of the mesh, no
+ * fragment stage and no color writes. depthPrepassKey and
+ * afterDepthPrepassKey map a material key to its pre-pass and main pass
+ * keys.
+ *
+ * The shadow cascades draw with variants of the SHADOW_SHADER program,
+ * depth-only as well but in the single-sampled shadow render pass, with
+ * no culling and a depth bias set per cascade. shadowKey maps a material
+ * key to it, castsShadow tells which materials cast.
+ *
+ * Pipelines compile on the JobSystem workers, each job into its own
+ * VkPipelineCache seeded from the shared one and merged back into it by
+ * the render thread. The constructor only waits for the default mesh
+ * variant and the fixed pipelines (particles, debug lines); the other mesh
+ * types and feature combinations finish in the background and are picked
+ * up by collectCompiled. A variant needed before its job is done is
+ * waited on.
+ *
+ * reloadProgram rebuilds every pipeline of a program from fresh SPIR-V the
+ * same way; the old pipelines keep drawing until the new ones are ready
+ * and are destroyed once the frames that may still use them are done.
+ */
 class GraphicsPipeline {
 public:
+    // vertex-only mesh program of the depth pre-pass variants
+    static constexpr const char* DEPTH_PREPASS_SHADER = "depth_prepass";
+    // vertex-only mesh program of the shadow cascade variants
+    static constexpr const char* SHADOW_SHADER = "shadow";
+
     enum class PipelineType {
         Triangles_NoCull,
         Triangles_BackCull,
         Triangles_FrontCull,
+        // debug lines, one instance per line, transparent subpass
         Lines,
-        Points
+        // camera-facing particle quads, transparent subpass
+        Particles
     };
 
     enum class LayoutType {
         Mesh,
-        Particle
+        Particle,
+        DebugLine
+    };
+
+    struct CompileStats {
+        uint32_t compiled = 0;
+        uint32_t pending = 0;
+        // summed over workers
+        double compileSeconds = 0.0;
+        // constructor time spent waiting for the startup pipelines
+        double startupSeconds = 0.0;
     };
 private:
+    /**
+     * @brief One pipeline compiled on a worker.
+     */
+    struct CompileJob {
+        MaterialDesc::PipelineKey key;
+        VkPipelineCache cache{VK_NULL_HANDLE};
+        VkPipeline pipeline{VK_NULL_HANDLE};
+        double seconds = 0.0;
+        std::string error;
+        JobSystem::JobCounter counter;
+        // replaces graphicsPipelines[type] instead of a variant
+        bool fixed = false;
+        PipelineType type{};
+    };
+
+    struct RetiredPipeline {
+        uint64_t frame;
+        VkPipeline pipeline;
+    };
+
     VkDevice device;
+    VkRenderPass renderPass;
+    VkRenderPass shadowRenderPass;
+    VkSampleCountFlagBits msaaSamples;
+    bool bindlessMaterials;
+    bool dynamicRenderState;
+    // shared with every GraphicsPipeline, outlives this one
+    VkPipelineCache pipelineCache;
+    JobSystem* jobSystem;
+    uint32_t framesInFlight;
+    uint64_t frameIndex = 0;
 
     std::unordered_map<PipelineType, VkPipeline> graphicsPipelines;
+    // built on first use, keyed by the key with its dynamic state stripped
+    std::unordered_map<MaterialDesc::PipelineKey, VkPipeline, MaterialDesc::PipelineKeyHasher> variants;
+    // shader program name -> modules, shared by every variant of the program
+    std::unordered_map<std::string, ShaderLoader*> shaderPrograms;
+    // variants being compiled, by static key (render thread only)
+    std::unordered_map<MaterialDesc::PipelineKey, std::shared_ptr<CompileJob>, MaterialDesc::PipelineKeyHasher> compiling;
+    // rebuilds of existing pipelines, applied by collectCompiled
+    std::vector<std::shared_ptr<CompileJob>> reloads;
+    // replaced pipelines, destroyed framesInFlight frames after retiring
+    std::vector<RetiredPipeline> retiredPipelines;
+    // replaced shader modules, deleted once no compile job can use them
+    std::vector<ShaderLoader*> retiredPrograms;
+    CompileStats stats;
     std::unordered_map<LayoutType, VkPipelineLayout> pipelineLayouts;
     VkViewport viewport{};
     VkRect2D scissor{};
@@ -38,7 +138,7 @@ private:
 
     VkPipelineVertexInputStateCreateInfo createVertexInputState(
         VkVertexInputBindingDescription& bindingDescription,
-        std::array<VkVertexInputAttributeDescription, 3>& attributeDescriptions
+        std::array<VkVertexInputAttributeDescription, 4>& attributeDescriptions
     );
     VkPipelineInputAssemblyStateCreateInfo createInputAssemblyState(
         VkPrimitiveTopology topology
@@ -62,7 +162,82 @@ private:
         VkPipelineColorBlendAttachmentState& colorBlendAttachment
     );
 
+    ShaderLoader* getShaderProgram(
+        const std::string& shader
+    );
+
+    /**
+     * @brief Loads the modules of a mesh program; the pre-pass and shadow ones have no fragment shader.
+     */
+    ShaderLoader* loadMeshProgram(
+        const std::string& shader
+    ) const;
+
+    /**
+     * @brief Key of the pipeline drawing with key once dynamic state is applied.
+     */
+    MaterialDesc::PipelineKey staticKey(
+        const MaterialDesc::PipelineKey& key
+    ) const;
+
+    /**
+     * @brief Builds a variant. Thread-safe, does not touch the caches of this object.
+     */
+    VkPipeline createVariant(
+        const MaterialDesc::PipelineKey& key,
+        ShaderLoader* shaderLoader,
+        VkPipelineCache cache
+    );
+
+    /**
+     * @brief Fixed type drawn by a shader program, false for mesh programs.
+     */
+    static bool fixedTypeOf(
+        const std::string& shader,
+        PipelineType& type
+    );
+
+    /**
+     * @brief Modules of a fixed type; the particle fragment shader matches the depth sample count.
+     */
+    ShaderLoader* loadFixedProgram(
+        PipelineType type
+    ) const;
+
+    VkPipeline createParticlePipeline(
+        ShaderLoader* shaderLoader,
+        VkPipelineCache cache
+    );
+
+    VkPipeline createDebugLinePipeline(
+        ShaderLoader* shaderLoader,
+        VkPipelineCache cache
+    );
+
+    /**
+     * @brief Compiles a fixed type on a worker, the job does not own shaderLoader.
+     */
+    std::shared_ptr<CompileJob> submitFixed(
+        PipelineType type,
+        ShaderLoader* shaderLoader
+    );
+
+    /**
+     * @brief Runs build on a worker with a job-local pipeline cache.
+     */
+    std::shared_ptr<CompileJob> submitCompile(
+        std::function<VkPipeline(VkPipelineCache)> build
+    );
+
+    /**
+     * @brief Merges the cache of a finished job and returns its pipeline, null if it failed.
+     */
+    VkPipeline finishCompile(
+        CompileJob& job
+    );
+
     VkPipeline createPipeline(
+        VkPipelineCache cache,
         const VkRenderPass renderPass,
         const VkPipelineLayout& pipelineLayout,
         const VkPipelineShaderStageCreateInfo* shaderStages,
@@ -73,7 +248,10 @@ private:
         const VkPipelineMultisampleStateCreateInfo& multisampling,
         const VkPipelineDepthStencilStateCreateInfo& depthStencil,
         const VkPipelineColorBlendStateCreateInfo& colorBlend,
-        const VkPipelineDynamicStateCreateInfo& dynamicState
+        const VkPipelineDynamicStateCreateInfo& dynamicState,
+        uint32_t subpass,
+        // 1 for depth-only pipelines without a fragment stage
+        uint32_t stageCount = 2
     );
 
 public:
@@ -82,16 +260,139 @@ public:
         VkDevice device,
         VkExtent2D swapchainExtent,
         VkRenderPass renderPass,
+        // depth-only cascade pass, see CascadedShadowMaps
+        VkRenderPass shadowRenderPass,
         VkDescriptorSetLayout globalLayout,
         VkDescriptorSetLayout materialLayout,
         VkDescriptorSetLayout instanceLayout,
+        VkDescriptorSetLayout materialParamsLayout,
         VkDescriptorSetLayout particleLayout,
-        VkSampleCountFlagBits msaaSamples
+        // depth input attachment of the transparent subpass (soft particles)
+        VkDescriptorSetLayout depthInputLayout,
+        // per-frame line ring buffer, see DebugDraw
+        VkDescriptorSetLayout debugLineLayout,
+        VkSampleCountFlagBits msaaSamples,
+        // materialLayout is the bindless texture array, sampled by materialIndex
+        bool bindlessMaterials,
+        // requires Vulkan 1.3, see CoreVulkan::supportsExtendedDynamicState
+        bool dynamicRenderState,
+        VkPipelineCache pipelineCache,
+        JobSystem* jobSystem,
+        // frames that may still reference a pipeline after it is replaced
+        uint32_t framesInFlight
     );
 
     ~GraphicsPipeline();
 
-    VkPipeline getPipeline(PipelineType type) const { return graphicsPipelines.at(type); }
+    /**
+     * @brief Variant key of a mesh pipeline type; Lines and Particles have none.
+     */
+    static MaterialDesc::PipelineKey keyOf(
+        PipelineType type
+    );
+
+    /**
+     * @brief Whether batches drawn with key can have their depth laid down by the pre-pass.
+     *
+     * Only opaque, depth-writing materials without alpha test: the pre-pass
+     * does not run the fragment shader, so it cannot discard.
+     */
+    static bool usesDepthPrepass(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Depth-only pre-pass variant drawing the same geometry as key.
+     */
+    static MaterialDesc::PipelineKey depthPrepassKey(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief key shading only the fragments the pre-pass left visible: depth EQUAL, no depth writes.
+     */
+    static MaterialDesc::PipelineKey afterDepthPrepassKey(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Whether batches drawn with key are drawn into the shadow cascades.
+     *
+     * Opaque materials without alpha test, for the same reason as the pre-pass.
+     */
+    static bool castsShadow(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Shadow cascade variant drawing the same geometry as key, both faces.
+     */
+    static MaterialDesc::PipelineKey shadowKey(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Pipeline of a type, mesh types are variants built on first use.
+     *
+     * Mesh types need setDynamicState(cmd, keyOf(type).state) after binding.
+     */
+    VkPipeline getPipeline(
+        PipelineType type
+    );
+
+    /**
+     * @brief Pipeline of a variant, compiled on first request.
+     *
+     * Uses the Mesh layout, so descriptor sets bound for one variant stay
+     * valid for every other. Render thread only.
+     *
+     * @throws std::runtime_error if the shaders cannot be loaded or the pipeline creation fails.
+     */
+    VkPipeline getVariant(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Starts compiling a variant in the background, if it is not built or queued yet.
+     *
+     * @throws std::runtime_error if the shader program cannot be loaded.
+     */
+    void compileAsync(
+        const MaterialDesc::PipelineKey& key
+    );
+
+    /**
+     * @brief Takes over the variants whose background compile finished.
+     *
+     * Also applies finished reloads and destroys retired pipelines.
+     * Render thread only, once per frame, after waiting for the frame fence.
+     */
+    void collectCompiled();
+
+    /**
+     * @brief Rebuilds every pipeline of a shader program from its SPIR-V on disk.
+     *
+     * Unknown programs are ignored. If the modules cannot be loaded or a
+     * pipeline fails to compile the error is printed and the current
+     * pipeline stays in use.
+     */
+    void reloadProgram(
+        const std::string& shader
+    );
+
+    /**
+     * @brief Records the dynamic part of a render state; no-op without dynamicRenderState.
+     *
+     * Call after binding a variant pipeline and before drawing with it.
+     */
+    void setDynamicState(
+        VkCommandBuffer cmd,
+        const MaterialDesc::RenderState& state
+    ) const;
+
+    size_t getVariantCount() const { return variants.size(); }
+    CompileStats getCompileStats() const;
+    bool hasDynamicRenderState() const { return dynamicRenderState; }
     VkPipelineLayout getLayout(LayoutType type) const { return pipelineLayouts.at(type); }
     const VkViewport& getViewport() const  { return viewport; }
     const VkRect2D& getScissor() const { return scissor; }
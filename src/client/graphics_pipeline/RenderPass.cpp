@@ -48,13 +48,14 @@ RenderPass::RenderPass(
             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
         );
     } else {
+        // the scene color itself, copied to the swapchain image after the pass
         attachments.emplace_back(
             swapchainImageFormat,
             msaaSamples,
             VK_ATTACHMENT_LOAD_OP_CLEAR,
             VK_ATTACHMENT_STORE_OP_STORE,
             VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
         );
     }
 
@@ -68,7 +69,7 @@ RenderPass::RenderPass(
         VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
     );
 
-    // Resolve
+    // Resolve into the scene color, copied to the swapchain image after the pass
     if (useMSAA) {
         attachments.emplace_back(
             swapchainImageFormat,
@@ -76,31 +77,61 @@ RenderPass::RenderPass(
             VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             VK_ATTACHMENT_STORE_OP_STORE,
             VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
         );
     }
 
-    // Subpass base
+    // Subpass base: opaque geometry writes color and depth
     SubpassDesc mainSubpass{};
     mainSubpass.colorAttachments = {0};
     mainSubpass.depthAttachment = 1;
+
+    // transparent: depth tested read-only and readable by the fragment shader
+    SubpassDesc transparentSubpass{};
+    transparentSubpass.colorAttachments = {0};
+    transparentSubpass.depthAttachment = 1;
+    transparentSubpass.inputAttachments = {1};
+    transparentSubpass.readOnlyDepth = true;
     if (useMSAA) {
-        mainSubpass.resolveAttachments = {2};
+        transparentSubpass.resolveAttachments = {2};
     }
 
-
     subpasses.push_back(mainSubpass);
+    subpasses.push_back(transparentSubpass);
 
     // Dependency base
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    // compute: the late part overwrites the depth the pyramid was built from
+    // transfer: the scene color was copied out by the previous frame
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
     dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     dependencies.push_back(dependency);
 
+    VkSubpassDependency transparentDependency{};
+    transparentDependency.srcSubpass = OPAQUE_SUBPASS;
+    transparentDependency.dstSubpass = TRANSPARENT_SUBPASS;
+    transparentDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    transparentDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    transparentDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    transparentDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    transparentDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    dependencies.push_back(transparentDependency);
+
+    // the depth of the early part is sampled by compute before the late part resumes,
+    // the scene color is copied to the swapchain image once the pass ends
+    VkSubpassDependency exitDependency{};
+    exitDependency.srcSubpass = TRANSPARENT_SUBPASS;
+    exitDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    exitDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    exitDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    exitDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    exitDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    dependencies.push_back(exitDependency);
+
     // mods providers
     for (auto* p : providers) {
         p->contribute(attachments, subpasses, dependencies);
@@ -126,6 +157,14 @@ RenderPass::RenderPass(
             if (idx >= attachmentCount)
                 throw std::runtime_error("Invalid resolve attachment index in subpass");
         }
+
+        for (auto idx : sp.inputAttachments) {
+            if (idx >= attachmentCount)
+                throw std::runtime_error("Invalid input attachment index in subpass");
+
+            if (sp.depthAttachment == idx && !sp.readOnlyDepth)
+                throw std::runtime_error("Depth attachment read as input must be read-only");
+        }
     }
 
     for (const auto& s : subpasses) {
@@ -148,7 +187,58 @@ RenderPass::RenderPass(
         }
     }
 
-// convert to vulkan
+// one compatible render pass per part, they only differ by load/store ops and layouts
+    for (Part part : {Part::Full, Part::Early, Part::Late}) {
+        std::vector<AttachmentDesc> partAttachments = attachments;
+
+        if (part == Part::Early) {
+            // keep color and depth for the late part, the depth is sampled in between
+            partAttachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            partAttachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            partAttachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            if (useMSAA) {
+                partAttachments[2].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        } else if (part == Part::Late) {
+            partAttachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            partAttachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+            partAttachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            partAttachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        }
+
+        renderPasses[static_cast<size_t>(part)] = create(partAttachments, subpasses, dependencies);
+    }
+
+// overlay: draws on the swapchain image the scene was copied to, then presents
+    std::vector<AttachmentDesc> overlayAttachments;
+    overlayAttachments.emplace_back(
+        swapchainImageFormat,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_ATTACHMENT_LOAD_OP_LOAD,
+        VK_ATTACHMENT_STORE_OP_STORE,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+    );
+
+    SubpassDesc overlaySubpass{};
+    overlaySubpass.colorAttachments = {0};
+
+    VkSubpassDependency overlayDependency{};
+    overlayDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    overlayDependency.dstSubpass = 0;
+    overlayDependency.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    overlayDependency.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    overlayDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    overlayDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    overlayRenderPass = create(overlayAttachments, {overlaySubpass}, {overlayDependency});
+}
+
+VkRenderPass RenderPass::create(
+    const std::vector<AttachmentDesc>& attachments,
+    const std::vector<SubpassDesc>& subpasses,
+    const std::vector<VkSubpassDependency>& dependencies
+) const {
     // attachments
     std::vector<VkAttachmentDescription> vkAttachments;
     vkAttachments.reserve(attachments.size());
@@ -170,9 +260,11 @@ RenderPass::RenderPass(
     vkSubpasses.reserve(subpasses.size());
     std::vector<std::vector<VkAttachmentReference>> colorRefs;
     std::vector<std::vector<VkAttachmentReference>> resolveRefs;
+    std::vector<std::vector<VkAttachmentReference>> inputRefs;
     std::vector<VkAttachmentReference> depthRefs;
     colorRefs.reserve(subpasses.size());
     resolveRefs.reserve(subpasses.size());
+    inputRefs.reserve(subpasses.size());
     depthRefs.reserve(subpasses.size());
 
 
@@ -190,10 +282,25 @@ RenderPass::RenderPass(
 
         // depth attachment ref
         if (s.depthAttachment.has_value()) {
-            depthRefs.push_back({*s.depthAttachment, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL});
+            depthRefs.push_back({
+                *s.depthAttachment,
+                s.readOnlyDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            });
             sp.pDepthStencilAttachment = &depthRefs.back();
         }
 
+        // input attachment ref, the depth one shares the read-only layout
+        inputRefs.emplace_back();
+        for (auto idx : s.inputAttachments) {
+            inputRefs.back().push_back({
+                idx,
+                s.depthAttachment == idx ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            });
+        }
+
+        sp.inputAttachmentCount = static_cast<uint32_t>(inputRefs.back().size());
+        sp.pInputAttachments = inputRefs.back().data();
+
         // color attachment resolve ref
         if (!s.resolveAttachments.empty()) {
             resolveRefs.emplace_back();
@@ -215,9 +322,12 @@ RenderPass::RenderPass(
     info.dependencyCount = static_cast<uint32_t>(dependencies.size());
     info.pDependencies = dependencies.data();
 
-    if (vkCreateRenderPass(device, &info, nullptr, &renderPass) != VK_SUCCESS) {
+    VkRenderPass vkRenderPass;
+    if (vkCreateRenderPass(device, &info, nullptr, &vkRenderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass");
     }
+
+    return vkRenderPass;
 }
 
 bool RenderPass::equalDependency(
@@ -258,7 +368,12 @@ void RenderPass::deduplicateDependencies(
 
 
 RenderPass::~RenderPass() {
-    if (this->renderPass != VK_NULL_HANDLE) {
-        vkDestroyRenderPass(device, this->renderPass, nullptr);
+    if (overlayRenderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device, overlayRenderPass, nullptr);
+    }
+    for (VkRenderPass renderPass : renderPasses) {
+        if (renderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device, renderPass, nullptr);
+        }
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../CoreVulkan.hpp"
+#include <array>
 
 /**
  * @brief High-level manager for Vulkan render pass creation.
@@ -9,7 +10,18 @@
  * a declarative description of attachments, subpasses and dependencies.
  *
  * The class provides:
- * - A validated default render pass layout (color + depth + resolve).
+ * - A validated default render pass layout (color + depth + resolve) in two
+ *   subpasses: OPAQUE_SUBPASS writes depth, TRANSPARENT_SUBPASS tests
+ *   against it read-only and may read it as an input attachment (soft
+ *   particles). The color is resolved at the end of the transparent one
+ *   into the scene color, left ready to be copied (TRANSFER_SRC).
+ * - An overlay pass on the swapchain image the scene color was copied and
+ *   scaled into (TRANSFER_DST), for ImGui at the display resolution, which
+ *   presents.
+ * - Two more parts of the same pass for two-phase occlusion culling: Early
+ *   keeps color and depth (the depth ready to be sampled by compute) and
+ *   Late resumes from them. All parts are compatible, framebuffers and
+ *   pipelines built for one work with the others.
  * - Extension points via IRenderPassProvider for engine subsystems.
  * - Defensive validation against invalid attachment/subpass combinations.
  *
@@ -24,11 +36,29 @@
  * to setup the "target" for rendering, and the state of the images you will be rendering to.
  */
 class RenderPass {
+public:
+    /**
+     * @brief Which part of the frame a VkRenderPass covers.
+     */
+    enum class Part {
+        // clears, draws and presents
+        Full,
+        // clears, stores color and depth for Late
+        Early,
+        // loads what Early stored, presents
+        Late
+    };
+
 private:
     VkDevice device;
-    VkRenderPass renderPass{VK_NULL_HANDLE};
+    std::array<VkRenderPass, 3> renderPasses{};
+    VkRenderPass overlayRenderPass{VK_NULL_HANDLE};
 
 public:
+    static constexpr uint32_t OPAQUE_SUBPASS = 0;
+    // last subpass: particles and debug lines, overlays such as ImGui go in the overlay pass
+    static constexpr uint32_t TRANSPARENT_SUBPASS = 1;
+
     /**
      * @brief High-level description of a render pass attachment.
      *
@@ -65,11 +95,16 @@ public:
      * - All referenced indices must be valid.
      * - Resolve attachments must correspond to MSAA color attachments.
      * - Resolve attachments must be SAMPLE_COUNT_1.
+     *
+     * An input attachment that is also the depth attachment requires
+     * readOnlyDepth, both references then use the read-only depth layout.
      */
     struct SubpassDesc {
         std::vector<uint32_t> colorAttachments;
         std::optional<uint32_t> depthAttachment;
         std::vector<uint32_t> resolveAttachments;
+        std::vector<uint32_t> inputAttachments;
+        bool readOnlyDepth = false;
     };
 
     /**
@@ -118,18 +153,34 @@ public:
         std::vector<VkSubpassDependency>& deps
     );
 
+private:
+    /**
+     * @brief Converts validated descriptions into a VkRenderPass.
+     *
+     * @throws std::runtime_error if the render pass creation fails.
+     */
+    VkRenderPass create(
+        const std::vector<AttachmentDesc>& attachments,
+        const std::vector<SubpassDesc>& subpasses,
+        const std::vector<VkSubpassDependency>& dependencies
+    ) const;
+
+public:
     /**
      * @brief Constructs a render pass with optional provider extensions.
      *
      * The base render pass includes:
      * - MSAA color attachment
      * - Depth attachment
-     * - Resolve attachment to swapchain image
+     * - Resolve attachment to the scene color
+     * - The opaque and transparent subpasses and the dependency between them
      *
-     * Providers are applied before validation and Vulkan object creation.
+     * One VkRenderPass is created per Part from the same description, plus
+     * the overlay pass. Providers are applied before validation and Vulkan
+     * object creation, the overlay pass is not extended.
      *
      * @param device Logical Vulkan device.
-     * @param swapchainImageFormat Format of the swapchain images.
+     * @param swapchainImageFormat Format of the swapchain images, and of the scene color.
      * @param msaaSamples Sample count used for MSAA color/depth attachments.
      * @param depthFormat Format of the depth attachment.
      * @param providers List of render pass extension providers.
@@ -143,12 +194,17 @@ public:
     );
 
     /**
-     * @brief Destroys the Vulkan render pass.
+     * @brief Destroys the Vulkan render passes.
      */
     ~RenderPass();
 
     /**
-     * @return Underlying VkRenderPass handle.
+     * @return Underlying VkRenderPass handle of a part, Full by default.
+     */
+    VkRenderPass get(Part part = Part::Full) const { return renderPasses[static_cast<size_t>(part)]; }
+
+    /**
+     * @return The overlay pass: one subpass, the swapchain image as its only attachment.
      */
-    VkRenderPass get() const { return renderPass; }
+    VkRenderPass getOverlay() const { return overlayRenderPass; }
 };
\ No newline at end of file
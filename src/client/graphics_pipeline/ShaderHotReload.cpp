@@ -0,0 +1,204 @@
+#include "ShaderHotReload.hpp"
+
+#ifdef SHADER_HOT_RELOAD
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace {
+    bool endsWith(const std::string& text, const std::string& suffix)
+    {
+        return text.size() >= suffix.size() &&
+            text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+ShaderHotReload::ShaderHotReload(
+    const std::string& sourceDir,
+    const std::string& outputDir,
+    JobSystem* jobSystem
+) :
+    sourceDir(sourceDir),
+    outputDir(outputDir),
+    jobSystem(jobSystem)
+{
+    glslang::InitializeProcess();
+
+    // the build already compiled what is there now
+    scan();
+    lastScan = std::chrono::steady_clock::now();
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    for (auto& compile : compiles)
+        jobSystem->wait(compile->counter);
+
+    glslang::FinalizeProcess();
+}
+
+std::string ShaderHotReload::programOf(
+    const std::string& fileName
+) {
+    for (const char* suffix : {"_bindless.frag.glsl", "_msaa.frag.glsl", ".vert.glsl", ".frag.glsl", ".comp.glsl"})
+    {
+        if (endsWith(fileName, suffix))
+            return fileName.substr(0, fileName.size() - std::char_traits<char>::length(suffix));
+    }
+    return fileName;
+}
+
+std::vector<std::string> ShaderHotReload::scan()
+{
+    std::vector<std::string> changed;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(sourceDir, error))
+    {
+        const std::string fileName = entry.path().filename().string();
+        if (!entry.is_regular_file() || !endsWith(fileName, ".glsl"))
+            continue;
+
+        std::filesystem::file_time_type time = entry.last_write_time(error);
+        if (error)
+            continue;
+
+        auto it = timestamps.find(fileName);
+        if (it == timestamps.end())
+        {
+            timestamps.emplace(fileName, time);
+        }
+        else if (it->second != time)
+        {
+            it->second = time;
+            changed.push_back(fileName);
+        }
+    }
+
+    if (error)
+        std::cerr << "failed to scan shaders in " << sourceDir << ": " << error.message() << std::endl;
+
+    return changed;
+}
+
+std::vector<uint32_t> ShaderHotReload::compile(
+    const std::filesystem::path& sourcePath
+) {
+    const std::string fileName = sourcePath.filename().string();
+
+    EShLanguage stage;
+    if (endsWith(fileName, ".vert.glsl"))
+        stage = EShLangVertex;
+    else if (endsWith(fileName, ".frag.glsl"))
+        stage = EShLangFragment;
+    else if (endsWith(fileName, ".comp.glsl"))
+        stage = EShLangCompute;
+    else
+        throw std::runtime_error("unknown shader stage");
+
+    std::ifstream file(sourcePath, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open shader source");
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string source = buffer.str();
+    const char* sourceText = source.c_str();
+
+    // same target as the glslangValidator build step
+    glslang::TShader shader(stage);
+    shader.setStrings(&sourceText, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const EShMessages messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 100, false, messages))
+        throw std::runtime_error(shader.getInfoLog());
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+        throw std::runtime_error(program.getInfoLog());
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(stage), spirv);
+    return spirv;
+}
+
+std::vector<std::string> ShaderHotReload::poll()
+{
+    std::vector<std::string> programs;
+
+    // finished compiles, in submission order so the newest edit wins
+    size_t write = 0;
+    for (size_t i = 0; i < compiles.size(); i++)
+    {
+        std::shared_ptr<Compile>& compile = compiles[i];
+        if (!compile->counter.done())
+        {
+            compiles[write++] = std::move(compile);
+            continue;
+        }
+
+        if (!compile->error.empty())
+        {
+            std::cerr << "failed to compile shader " << compile->fileName << ":\n" << compile->error << std::endl;
+            continue;
+        }
+
+        const std::filesystem::path spvPath = outputDir / (compile->fileName + ".spv");
+        std::ofstream file(spvPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "failed to write shader " << spvPath << std::endl;
+            continue;
+        }
+        file.write(
+            reinterpret_cast<const char*>(compile->spirv.data()),
+            static_cast<std::streamsize>(compile->spirv.size() * sizeof(uint32_t))
+        );
+
+        std::string program = programOf(compile->fileName);
+        if (std::find(programs.begin(), programs.end(), program) == programs.end())
+            programs.push_back(std::move(program));
+    }
+    compiles.resize(write);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastScan < scanInterval)
+        return programs;
+    lastScan = now;
+
+    for (const std::string& fileName : scan())
+    {
+        auto compile = std::make_shared<Compile>();
+        compile->fileName = fileName;
+
+        const std::filesystem::path sourcePath = sourceDir / fileName;
+        jobSystem->submit(
+            [compile, sourcePath]()
+            {
+                try {
+                    compile->spirv = ShaderHotReload::compile(sourcePath);
+                } catch (const std::exception& e) {
+                    compile->error = e.what();
+                }
+            },
+            &compile->counter
+        );
+
+        compiles.push_back(compile);
+    }
+
+    return programs;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifdef SHADER_HOT_RELOAD
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "jobs/JobSystem.hpp"
+
+/**
+ * @brief Recompiles edited GLSL sources while the client runs.
+ *
+ * The source directory is scanned for changed *.glsl files a few times
+ * per second. Each change is compiled to SPIR-V by glslang on a JobSystem
+ * worker; the render thread writes the result over the build output in
+ * outputDir, where ShaderLoader reads it, and reports the program to
+ * reload (see GraphicsPipeline::reloadProgram).
+ *
+ * Sources that fail to compile print the glslang log and leave the
+ * previous SPIR-V in place, so the running pipelines stay untouched.
+ *
+ * Only built with the SHADER_HOT_RELOAD CMake option.
+ */
+class ShaderHotReload
+{
+private:
+    struct Compile {
+        std::string fileName;
+        std::vector<uint32_t> spirv;
+        std::string error;
+        JobSystem::JobCounter counter;
+    };
+
+    std::filesystem::path sourceDir;
+    std::filesystem::path outputDir;
+    JobSystem* jobSystem;
+
+    std::unordered_map<std::string, std::filesystem::file_time_type> timestamps;
+    std::vector<std::shared_ptr<Compile>> compiles;
+
+    std::chrono::steady_clock::time_point lastScan;
+    std::chrono::milliseconds scanInterval{250};
+
+    /**
+     * @brief Records the timestamps of every source, returns the changed ones.
+     */
+    std::vector<std::string> scan();
+
+    /**
+     * @brief Compiles one source to SPIR-V. Runs on a worker.
+     *
+     * @throws std::runtime_error with the glslang log on failure.
+     */
+    static std::vector<uint32_t> compile(
+        const std::filesystem::path& sourcePath
+    );
+
+public:
+    /**
+     * @param sourceDir Directory of the *.vert.glsl / *.frag.glsl sources.
+     * @param outputDir Directory ShaderLoader reads <source>.spv from.
+     */
+    ShaderHotReload(
+        const std::string& sourceDir,
+        const std::string& outputDir,
+        JobSystem* jobSystem
+    );
+
+    /**
+     * @brief Waits for running compiles.
+     */
+    ~ShaderHotReload();
+
+    ShaderHotReload(const ShaderHotReload&) = delete;
+    ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+    /**
+     * @brief Starts compiles for changed sources and writes the finished ones.
+     *
+     * Render thread only, once per frame.
+     *
+     * @return Programs whose SPIR-V was rewritten, without duplicates.
+     */
+    std::vector<std::string> poll();
+
+    /**
+     * @brief Program a source belongs to, "triangle" for triangle_bindless.frag.glsl.
+     */
+    static std::string programOf(
+        const std::string& fileName
+    );
+};
+
+#endif
@@ -39,10 +39,23 @@ ShaderLoader::ShaderLoader(
     device(device)
 {
     auto vertCode = readFile(vertPath);
-    auto fragCode = readFile(fragPath);
-
     this->vertModule = createShaderModule(vertCode);
-    this->fragModule = createShaderModule(fragCode);
+
+    if (!fragPath.empty()) {
+        auto fragCode = readFile(fragPath);
+        this->fragModule = createShaderModule(fragCode);
+    }
+}
+
+ShaderLoader::ShaderLoader(
+    VkDevice device,
+    const std::string& compPath
+) :
+    device(device)
+{
+    auto compCode = readFile(compPath);
+
+    this->compModule = createShaderModule(compCode);
 }
 
 ShaderLoader::~ShaderLoader() {
@@ -52,4 +65,7 @@ ShaderLoader::~ShaderLoader() {
     if (this->fragModule != VK_NULL_HANDLE) {
         vkDestroyShaderModule(device, this->fragModule, nullptr);
     }
+    if (this->compModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(device, this->compModule, nullptr);
+    }
 }
\ No newline at end of file
@@ -26,6 +26,13 @@ private:
     Automatically destroyed in the destructor.
     */
     VkShaderModule fragModule = VK_NULL_HANDLE;
+    /**
+    @brief Vulkan shader module handle for the compute shader.
+
+    Only created by the compute constructor, the graphics modules are
+    left null in that case.
+    */
+    VkShaderModule compModule = VK_NULL_HANDLE;
 
     /**
     @brief Reads the contents of a binary file into a byte buffer.
@@ -55,10 +62,18 @@ public:
     Creates shader modules from SPIR-V files.
 
     @param vertPath Path to the vertex shader SPIR-V file.
-    @param fragPath Path to the fragment shader SPIR-V file.
+    @param fragPath Path to the fragment shader SPIR-V file, empty for a
+                    depth-only program without a fragment stage.
     */
     ShaderLoader(VkDevice device, const std::string& vertPath, const std::string& fragPath);
 
+    /**
+    Creates the shader module of a compute program.
+
+    @param compPath Path to the compute shader SPIR-V file.
+    */
+    ShaderLoader(VkDevice device, const std::string& compPath);
+
     /**
     Cleans up the shader modules.
     */
@@ -66,4 +81,5 @@ public:
 
     VkShaderModule getVertModule() const { return vertModule; }
     VkShaderModule getFragModule() const { return fragModule; }
+    VkShaderModule getCompModule() const { return compModule; }
 };
\ No newline at end of file
@@ -5,7 +5,8 @@ ImageColor::ImageColor(
     VkDevice device,
     VkFormat swapchainImageFormat,
     VkExtent2D swapchainExtent,
-    VkSampleCountFlagBits msaaSamples
+    VkSampleCountFlagBits msaaSamples,
+    VkImageUsageFlags usage
 )
 : device(device)
 {
@@ -18,7 +19,7 @@ ImageColor::ImageColor(
         msaaSamples,
         swapchainImageFormat,
         VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        usage,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         colorImage,
         colorImageMemory
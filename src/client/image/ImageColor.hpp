@@ -5,21 +5,22 @@
 #include "../BufferManager.hpp"
 
 /**
- * @brief Manages an MSAA color attachment image.
+ * @brief Manages a color attachment image.
  *
  * ImageColor encapsulates the creation and lifetime of a color image
- * used as a multisampled color attachment in a render pass.
+ * used as a color attachment in a render pass.
  *
  * Typical usage:
- * - Bound as the color attachment in a render pass
- * - Resolved into a single-sampled swapchain image
+ * - Bound as the multisampled color attachment in a render pass and
+ *   resolved into a single-sampled image (transient, the default usage)
+ * - The single-sampled scene color the render pass resolves into, then
+ *   copied to the swapchain image (TRANSFER_SRC usage)
  *
  * This image is:
  * - Device-local
- * - Transient (implementation may discard contents after use)
  * - Not directly sampled by shaders
  *
- * The class exists to keep MSAA attachment management isolated
+ * The class exists to keep attachment management isolated
  * from swapchain and render pass logic.
  */
 class ImageColor
@@ -32,25 +33,27 @@ private:
 
 public:
     /**
-     * @brief Creates a multisampled color attachment image.
+     * @brief Creates a color attachment image.
      *
      * The image is created with:
      * - The same format and extent as the swapchain
      * - The specified MSAA sample count
-     * - TRANSIENT + COLOR_ATTACHMENT usage flags
+     * - TRANSIENT + COLOR_ATTACHMENT usage flags unless told otherwise
      *
      * @param physicalDevice Physical device used for memory selection.
      * @param device Logical Vulkan device.
      * @param swapchainImageFormat Format of the swapchain images.
      * @param swapchainExtent Resolution of the swapchain.
      * @param msaaSamples Sample count for multisampling.
+     * @param usage Image usage flags.
      */
     ImageColor(
         VkPhysicalDevice physicalDevice,
         VkDevice device,
         VkFormat swapchainImageFormat,
         VkExtent2D swapchainExtent,
-        VkSampleCountFlagBits msaaSamples
+        VkSampleCountFlagBits msaaSamples,
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
     );
 
     const VkImage& getColorImage() const { return colorImage; }
@@ -0,0 +1,820 @@
+#include "CascadedShadowMaps.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../graphics_pipeline/GraphicsPipeline.hpp"
+#include "../batch/material/Material.hpp"
+#include "../batch/mesh/Mesh.hpp"
+
+namespace {
+    // the largest minStorageBufferOffsetAlignment allowed
+    VkDeviceSize alignOffset(VkDeviceSize size)
+    {
+        return (size + 255) & ~VkDeviceSize(255);
+    }
+}
+
+CascadedShadowMaps::CascadedShadowMaps(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    BufferManager* bufferManager,
+    VkDeviceSize nonCoherentAtomSize,
+    VkDescriptorSetLayout instanceLayout,
+    uint32_t framesInFlight,
+    uint32_t maxInstances,
+    uint32_t resolution
+) :
+    device(device),
+    nonCoherentAtomSize(nonCoherentAtomSize),
+    resolution(std::max(resolution, 1u)),
+    maxInstances(std::max(maxInstances, 1u)),
+    frames(framesInFlight)
+{
+//* depth format drawn, copied and compared against
+    const VkFormatFeatureFlags required =
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+
+    depthFormat = VK_FORMAT_UNDEFINED;
+    VkFormatProperties formatProperties{};
+    for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM})
+    {
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        if ((formatProperties.optimalTilingFeatures & required) == required)
+        {
+            depthFormat = format;
+            break;
+        }
+    }
+
+    if (depthFormat == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error("no sampled depth format for the shadow maps");
+
+    // linear comparisons filter 2x2 texels for free where supported
+    VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+        ? VK_FILTER_LINEAR
+        : VK_FILTER_NEAREST;
+
+//* render passes and layers
+    clearPass = createRenderPass(VK_ATTACHMENT_LOAD_OP_CLEAR);
+    loadPass = createRenderPass(VK_ATTACHMENT_LOAD_OP_LOAD);
+
+    createLayers(
+        physicalDevice,
+        CASCADE_COUNT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        shadowImage,
+        shadowMemory,
+        layerViews.data(),
+        framebuffers.data()
+    );
+
+    createLayers(
+        physicalDevice,
+        CACHED_CASCADE_COUNT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        cacheImage,
+        cacheMemory,
+        cacheLayerViews.data(),
+        cacheFramebuffers.data()
+    );
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = shadowImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, CASCADE_COUNT};
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &shadowView) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create shadow map view");
+
+    // sampled from the first frame on, every layer is drawn before its first read
+    VkCommandBuffer cmd = bufferManager->beginImmediate();
+
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = shadowImage;
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, CASCADE_COUNT};
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &imageBarrier
+    );
+
+    bufferManager->endImmediate();
+
+//* comparison sampler, outside the cascade counts as lit
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = filter;
+    samplerInfo.minFilter = filter;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create shadow map sampler");
+
+//* per-frame buffers
+    instancesOffset = alignOffset(sizeof(GpuShadowData));
+    bufferSize = instancesOffset + sizeof(InstanceData) * this->maxInstances;
+
+    for (FrameResources& frame : frames)
+    {
+        bufferManager->createBuffer(
+            bufferSize,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            frame.buffer
+        );
+
+        bufferManager->allocateBufferMemory(
+            frame.buffer,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+            frame.memory
+        );
+
+        vkBindBufferMemory(device, frame.buffer, frame.memory.memory, 0);
+        vkMapMemory(device, frame.memory.memory, 0, bufferSize, 0, &frame.mapped);
+        std::memset(frame.mapped, 0, sizeof(GpuShadowData));
+    }
+
+//* caster instances, set 2 of the Mesh layout
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create shadow caster descriptor pool");
+
+    for (FrameResources& frame : frames)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &instanceLayout;
+
+        if (vkAllocateDescriptorSets(device, &allocInfo, &frame.instanceSet) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate shadow caster descriptor set");
+
+        VkDescriptorBufferInfo bufferInfo{frame.buffer, instancesOffset, sizeof(InstanceData) * this->maxInstances};
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.instanceSet;
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+}
+
+CascadedShadowMaps::~CascadedShadowMaps()
+{
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    for (FrameResources& frame : frames)
+    {
+        if (frame.mapped)
+            vkUnmapMemory(device, frame.memory.memory);
+
+        if (frame.buffer)
+            vkDestroyBuffer(device, frame.buffer, nullptr);
+
+        if (frame.memory.memory)
+            vkFreeMemory(device, frame.memory.memory, nullptr);
+    }
+
+    if (sampler)
+        vkDestroySampler(device, sampler, nullptr);
+
+    for (VkFramebuffer framebuffer : framebuffers)
+    {
+        if (framebuffer)
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+
+    for (VkFramebuffer framebuffer : cacheFramebuffers)
+    {
+        if (framebuffer)
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+
+    for (VkImageView view : layerViews)
+    {
+        if (view)
+            vkDestroyImageView(device, view, nullptr);
+    }
+
+    for (VkImageView view : cacheLayerViews)
+    {
+        if (view)
+            vkDestroyImageView(device, view, nullptr);
+    }
+
+    if (shadowView)
+        vkDestroyImageView(device, shadowView, nullptr);
+
+    for (VkImage image : {shadowImage, cacheImage})
+    {
+        if (image)
+            vkDestroyImage(device, image, nullptr);
+    }
+
+    for (VkDeviceMemory memory : {shadowMemory, cacheMemory})
+    {
+        if (memory)
+            vkFreeMemory(device, memory, nullptr);
+    }
+
+    for (VkRenderPass renderPass : {clearPass, loadPass})
+    {
+        if (renderPass)
+            vkDestroyRenderPass(device, renderPass, nullptr);
+    }
+}
+
+VkRenderPass CascadedShadowMaps::createRenderPass(
+    VkAttachmentLoadOp loadOp
+) {
+    // layouts are left to the barriers of recordShadows
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = loadOp;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthRef{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 0;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    VkRenderPassCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    info.attachmentCount = 1;
+    info.pAttachments = &depthAttachment;
+    info.subpassCount = 1;
+    info.pSubpasses = &subpass;
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(device, &info, nullptr, &renderPass) != VK_SUCCESS)
+        throw std::runtime_error("failed to create shadow render pass!");
+
+    return renderPass;
+}
+
+void CascadedShadowMaps::createLayers(
+    VkPhysicalDevice physicalDevice,
+    uint32_t layers,
+    VkImageUsageFlags usage,
+    VkImage& image,
+    VkDeviceMemory& memory,
+    VkImageView* views,
+    VkFramebuffer* layerFramebuffers
+) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {resolution, resolution, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = layers;
+    imageInfo.format = depthFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create shadow map image");
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = CoreVulkan::findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate shadow map memory");
+
+    vkBindImageMemory(device, image, memory, 0);
+
+    for (uint32_t layer = 0; layer < layers; layer++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = depthFormat;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, layer, 1};
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &views[layer]) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create shadow map layer view");
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = clearPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &views[layer];
+        framebufferInfo.width = resolution;
+        framebufferInfo.height = resolution;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &layerFramebuffers[layer]) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create shadow map framebuffer");
+    }
+}
+
+void CascadedShadowMaps::fitCascade(
+    Cascade& cascade,
+    const glm::vec3& center,
+    float radius,
+    const glm::mat4& lightRotation
+) {
+    float texelSize = 2.0f * radius / static_cast<float>(resolution);
+
+    // whole texels only: the map slides under the scene instead of resampling it
+    glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+    // the view looks down -z, the near plane is pulled back towards the sun for casters outside the sphere
+    glm::mat4 projection = glm::orthoRH_ZO(
+        lightCenter.x - radius,
+        lightCenter.x + radius,
+        lightCenter.y - radius,
+        lightCenter.y + radius,
+        -lightCenter.z - radius - casterDistance,
+        -lightCenter.z + radius
+    );
+
+    cascade.viewProj = projection * lightRotation;
+    cascade.texelSize = texelSize;
+    cascade.center = center;
+    cascade.radius = radius;
+}
+
+uint32_t CascadedShadowMaps::gatherCasters(
+    RenderBatchManager& renderBatchManager,
+    const glm::mat4& viewProj,
+    RenderBatchManager::Mobility mobility
+) {
+    const size_t firstDraw = draws.size();
+
+    renderBatchManager.forEachBatch(
+        [&](const RenderBatchManager::RenderBatch& batch)
+        {
+            const Material* material = batch.getDrawMaterial();
+            if (!GraphicsPipeline::castsShadow(material->getPipelineKey()))
+                return;
+
+            uint32_t firstInstance = static_cast<uint32_t>(instances.size());
+            uint32_t instanceCount = renderBatchManager.cullInstances(batch, viewProj, mobility, instances);
+            if (instanceCount == 0)
+                return;
+
+            if (instances.size() > maxInstances)
+            {
+                stats.dropped += instanceCount;
+                instances.resize(firstInstance);
+                return;
+            }
+
+            const Mesh* mesh = batch.getDrawMesh();
+            const Mesh::Lod& lod = mesh->getLod(batch.getKey().lod);
+            const MaterialDesc::RenderState& state = material->getPipelineKey().state;
+
+            // the material only matters through the shadow variant: same mesh LOD and variant merge into one draw
+            if (draws.size() > firstDraw)
+            {
+                Draw& last = draws.back();
+                const MaterialDesc::RenderState& lastState = last.pipelineKey->state;
+                if (last.mesh == mesh &&
+                    last.firstIndex == lod.firstIndex &&
+                    last.indexCount == lod.indexCount &&
+                    lastState.topology == state.topology &&
+                    lastState.polygonMode == state.polygonMode)
+                {
+                    last.instanceCount += instanceCount;
+                    return;
+                }
+            }
+
+            draws.push_back({
+                mesh,
+                &material->getPipelineKey(),
+                lod.indexCount,
+                lod.firstIndex,
+                firstInstance,
+                instanceCount
+            });
+        }
+    );
+
+    return static_cast<uint32_t>(draws.size() - firstDraw);
+}
+
+void CascadedShadowMaps::update(
+    uint32_t currentFrame,
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    float zNear,
+    float zFar,
+    RenderBatchManager& renderBatchManager
+) {
+    FrameResources& frame = frames[currentFrame];
+
+    draws.clear();
+    instances.clear();
+    stats.renderedCascades = 0;
+    stats.cachedCascades = 0;
+    stats.dropped = 0;
+
+    glm::vec3 sun = glm::length(sunDirection) > 0.0f ? glm::normalize(sunDirection) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+    // one rotation for every cascade, only changing with the sun, so snapping in it is stable
+    glm::vec3 up = std::abs(sun.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -sun, up);
+
+    glm::mat4 inverseView = glm::inverse(view);
+    // squared slope of the frustum corners
+    float tanX = 1.0f / projection[0][0];
+    float tanY = 1.0f / std::abs(projection[1][1]);
+    float k2 = tanX * tanX + tanY * tanY;
+
+    float farDistance = std::max(std::min(zFar, shadowDistance), zNear * 2.0f);
+    uint64_t staticGeneration = renderBatchManager.getStaticGeneration();
+
+    float sliceNear = zNear;
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+    {
+        Cascade& cascade = cascades[i];
+        CascadeWork& cascadeWork = work[i];
+        cascadeWork = CascadeWork{};
+
+        float fraction = static_cast<float>(i + 1) / CASCADE_COUNT;
+        float logSplit = zNear * std::pow(farDistance / zNear, fraction);
+        float uniformSplit = zNear + (farDistance - zNear) * fraction;
+        float sliceFar = uniformSplit + (logSplit - uniformSplit) * std::clamp(splitLambda, 0.0f, 1.0f);
+        cascade.split = sliceFar;
+
+        // smallest sphere around the slice, on the view axis; its radius ignores the camera rotation
+        float centerDepth = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + k2), sliceFar);
+        float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + sliceFar * sliceFar * k2);
+        // rounded up so float noise never changes the texel size
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+        sliceNear = sliceFar;
+
+        if (i < FIRST_CACHED_CASCADE)
+        {
+            fitCascade(cascade, center, radius, lightRotation);
+
+            cascadeWork.renderLive = true;
+            cascadeWork.firstLiveDraw = static_cast<uint32_t>(draws.size());
+            cascadeWork.liveDrawCount = gatherCasters(renderBatchManager, cascade.viewProj, RenderBatchManager::Mobility::Any);
+            stats.renderedCascades++;
+            continue;
+        }
+
+        // redrawn once the slice leaves the cached sphere or what it shows changed
+        bool covered = cascade.valid && glm::length(center - cascade.center) + radius <= cascade.radius;
+        if (!covered || cascade.staticGeneration != staticGeneration || cascade.sunDirection != sun)
+        {
+            fitCascade(cascade, center, radius * (1.0f + std::max(cacheMargin, 0.0f)), lightRotation);
+            cascade.valid = true;
+            cascade.staticGeneration = staticGeneration;
+            cascade.sunDirection = sun;
+
+            cascadeWork.renderStatic = true;
+            cascadeWork.firstStaticDraw = static_cast<uint32_t>(draws.size());
+            cascadeWork.staticDrawCount = gatherCasters(renderBatchManager, cascade.viewProj, RenderBatchManager::Mobility::Static);
+            stats.renderedCascades++;
+            stats.staticRedraws++;
+        }
+        else
+        {
+            stats.cachedCascades++;
+        }
+
+        cascadeWork.firstLiveDraw = static_cast<uint32_t>(draws.size());
+        cascadeWork.liveDrawCount = gatherCasters(renderBatchManager, cascade.viewProj, RenderBatchManager::Mobility::Dynamic);
+        cascadeWork.renderLive = cascadeWork.liveDrawCount > 0;
+        // nothing to do when the sampled layer already is the unchanged cache
+        cascadeWork.copyStatic = cascadeWork.renderStatic || cascadeWork.renderLive || cascade.liveHasDynamic;
+        cascade.liveHasDynamic = cascadeWork.renderLive;
+    }
+
+    stats.draws = static_cast<uint32_t>(draws.size());
+    stats.instances = static_cast<uint32_t>(instances.size());
+
+//* upload
+    GpuShadowData* data = static_cast<GpuShadowData*>(frame.mapped);
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+    {
+        data->cascadeViewProj[i] = cascades[i].viewProj;
+        data->cascadeSplits[i] = cascades[i].split;
+        data->cascadeTexelSizes[i] = cascades[i].texelSize;
+    }
+    data->sunDirection = glm::vec4(sun, 0.0f);
+    data->sunColor = glm::vec4(sunColor * std::max(sunIntensity, 0.0f), 1.0f);
+
+    std::memcpy(
+        static_cast<char*>(frame.mapped) + instancesOffset,
+        instances.data(),
+        sizeof(InstanceData) * instances.size()
+    );
+
+    if (!frame.memory.isCoherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = frame.memory.memory;
+        range.offset = 0;
+        // the mapping ends at bufferSize, which need not be a multiple of the atom
+        VkDeviceSize written = instancesOffset + sizeof(InstanceData) * instances.size();
+        VkDeviceSize aligned = (written + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+        range.size = aligned < bufferSize ? aligned : VK_WHOLE_SIZE;
+
+        vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+}
+
+void CascadedShadowMaps::layerBarrier(
+    VkCommandBuffer cmd,
+    VkImage image,
+    uint32_t layer,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess
+) {
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = srcAccess;
+    imageBarrier.dstAccessMask = dstAccess;
+    imageBarrier.oldLayout = oldLayout;
+    imageBarrier.newLayout = newLayout;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = image;
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, layer, 1};
+
+    vkCmdPipelineBarrier(
+        cmd,
+        srcStage,
+        dstStage,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &imageBarrier
+    );
+}
+
+void CascadedShadowMaps::recordPass(
+    VkCommandBuffer cmd,
+    GraphicsPipeline* graphicsPipeline,
+    VkRenderPass renderPass,
+    VkFramebuffer framebuffer,
+    uint32_t cascade,
+    uint32_t firstDraw,
+    uint32_t drawCount
+) {
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {1.0f, 0};
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = {resolution, resolution};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    if (drawCount > 0)
+    {
+        VkViewport viewport{0.0f, 0.0f, static_cast<float>(resolution), static_cast<float>(resolution), 0.0f, 1.0f};
+        VkRect2D scissor{{0, 0}, {resolution, resolution}};
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        VkPipelineLayout layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::Mesh);
+        Push push{cascade};
+        vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push), &push);
+
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        const MaterialDesc::PipelineKey* lastPipelineKey = nullptr;
+        const Mesh* lastMesh = nullptr;
+
+        for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++)
+        {
+            const Draw& draw = draws[i];
+
+            if (draw.pipelineKey != lastPipelineKey)
+            {
+                lastPipelineKey = draw.pipelineKey;
+
+                MaterialDesc::PipelineKey passKey = GraphicsPipeline::shadowKey(*draw.pipelineKey);
+                VkPipeline pipeline = graphicsPipeline->getVariant(passKey);
+                if (pipeline != boundPipeline)
+                {
+                    boundPipeline = pipeline;
+                    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                    vkCmdSetDepthBias(cmd, depthBiasConstant, 0.0f, depthBiasSlope);
+                }
+
+                graphicsPipeline->setDynamicState(cmd, passKey.state);
+            }
+
+            if (draw.mesh != lastMesh)
+            {
+                lastMesh = draw.mesh;
+
+                VkBuffer vertexBuffer = draw.mesh->getPositionBuffer();
+                VkDeviceSize offsets[] = { 0 };
+                vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, offsets);
+                vkCmdBindIndexBuffer(cmd, draw.mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            }
+
+            vkCmdDrawIndexed(cmd, draw.indexCount, draw.instanceCount, draw.firstIndex, 0, draw.firstInstance);
+        }
+    }
+
+    vkCmdEndRenderPass(cmd);
+}
+
+void CascadedShadowMaps::recordShadows(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame,
+    GraphicsPipeline* graphicsPipeline,
+    VkDescriptorSet globalSet
+) {
+    const FrameResources& frame = frames[currentFrame];
+    VkPipelineLayout layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::Mesh);
+
+    // the material sets are not read by the shadow program
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &globalSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2, 1, &frame.instanceSet, 0, nullptr);
+
+    const VkPipelineStageFlags depthStages =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    const VkAccessFlags depthAccess =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+    {
+        const CascadeWork& cascadeWork = work[i];
+
+        if (cascadeWork.renderStatic)
+        {
+            uint32_t cacheLayer = i - FIRST_CACHED_CASCADE;
+
+            // the previous contents are dropped, the last copy out of the layer must be done
+            layerBarrier(
+                cmd, cacheImage, cacheLayer,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                depthStages, depthAccess
+            );
+
+            recordPass(cmd, graphicsPipeline, clearPass, cacheFramebuffers[cacheLayer], i,
+                cascadeWork.firstStaticDraw, cascadeWork.staticDrawCount);
+
+            layerBarrier(
+                cmd, cacheImage, cacheLayer,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT
+            );
+        }
+
+        if (cascadeWork.copyStatic)
+        {
+            // the sampled layer starts over from the static casters
+            layerBarrier(
+                cmd, shadowImage, i,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT
+            );
+
+            VkImageCopy region{};
+            region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, i - FIRST_CACHED_CASCADE, 1};
+            region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, i, 1};
+            region.extent = {resolution, resolution, 1};
+
+            vkCmdCopyImage(
+                cmd,
+                cacheImage,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                shadowImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1,
+                &region
+            );
+
+            if (cascadeWork.renderLive)
+            {
+                layerBarrier(
+                    cmd, shadowImage, i,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    depthStages, depthAccess
+                );
+
+                // dynamic casters over the copy
+                recordPass(cmd, graphicsPipeline, loadPass, framebuffers[i], i,
+                    cascadeWork.firstLiveDraw, cascadeWork.liveDrawCount);
+            }
+            else
+            {
+                layerBarrier(
+                    cmd, shadowImage, i,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+                );
+                continue;
+            }
+        }
+        else if (cascadeWork.renderLive)
+        {
+            // every caster, the last frame's depth is dropped
+            layerBarrier(
+                cmd, shadowImage, i,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                depthStages, depthAccess
+            );
+
+            recordPass(cmd, graphicsPipeline, clearPass, framebuffers[i], i,
+                cascadeWork.firstLiveDraw, cascadeWork.liveDrawCount);
+        }
+        else
+        {
+            // cached and untouched, still readable from the last frame
+            continue;
+        }
+
+        layerBarrier(
+            cmd, shadowImage, i,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT
+        );
+    }
+}
+
+VkDescriptorBufferInfo CascadedShadowMaps::getShadowDataInfo(
+    uint32_t currentFrame
+) const {
+    return {frames[currentFrame].buffer, 0, sizeof(GpuShadowData)};
+}
+
+VkDescriptorImageInfo CascadedShadowMaps::getShadowMapInfo() const
+{
+    return {sampler, shadowView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+}
\ No newline at end of file
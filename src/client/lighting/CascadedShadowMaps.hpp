@@ -0,0 +1,312 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../CoreVulkan.hpp"
+#include "../BufferManager.hpp"
+#include "../batch/RenderBatchManager.hpp"
+#include "../batch/instance/InstanceData.hpp"
+#include "../batch/material/MaterialDesc.hpp"
+
+class GraphicsPipeline;
+class Mesh;
+
+/**
+ * @brief Directional sun light and its cascaded shadow maps.
+ *
+ * The view is split into CASCADE_COUNT depth ranges, between uniform and
+ * logarithmic spacing, each covered by one layer of a depth array drawn
+ * from the sun with an orthographic projection. A cascade is fitted to the
+ * bounding sphere of its slice of the view frustum, whose radius does not
+ * change when the camera turns, and its origin is snapped to whole texels
+ * of the map: moving the camera slides the shadows by texels instead of
+ * making their edges shimmer.
+ *
+ * Casters are culled per cascade through RenderBatchManager::cullInstances
+ * and drawn with the depth-only GraphicsPipeline::shadowKey variants, into
+ * instance ranges of a buffer owned here and bound as set 2.
+ *
+ * The cascades from FIRST_CACHED_CASCADE on cover the most geometry and
+ * change the least. They are fitted with cacheMargin of slack and their
+ * static casters (RenderInstance::isStatic) are drawn into a separate cache
+ * layer, redrawn only when the view slice leaves the cached sphere, the sun
+ * moves or RenderBatchManager::getStaticGeneration changes. Other frames
+ * copy the cache layer into the sampled one and draw just the dynamic
+ * casters over it, or touch nothing when there are none.
+ *
+ * The sun and the cascade matrices are binding 4 of the global set, the
+ * cascades binding 5 as a sampler2DArrayShadow (see GlobalDescriptorManager).
+ */
+class CascadedShadowMaps
+{
+public:
+    // mirrored in shadow.vert.glsl and the mesh fragment shaders
+    static constexpr uint32_t CASCADE_COUNT = 4;
+    // cascades from this one on keep their static casters between frames
+    static constexpr uint32_t FIRST_CACHED_CASCADE = 2;
+    static constexpr uint32_t CACHED_CASCADE_COUNT = CASCADE_COUNT - FIRST_CACHED_CASCADE;
+
+    struct Stats {
+        // cascades whose casters were all drawn this frame
+        uint32_t renderedCascades = 0;
+        // cached cascades reused, at most their dynamic casters drawn
+        uint32_t cachedCascades = 0;
+        // cache layers redrawn since startup
+        uint64_t staticRedraws = 0;
+        uint32_t draws = 0;
+        uint32_t instances = 0;
+        // casters past the instance buffer, left out of the shadows
+        uint32_t dropped = 0;
+    };
+
+    // towards the sun, normalized on update
+    glm::vec3 sunDirection{0.4f, 0.25f, 1.0f};
+    glm::vec3 sunColor{1.0f, 0.93f, 0.8f};
+    // 0 turns the sun off in the shading, the cascades are still drawn
+    float sunIntensity = 0.8f;
+    // shadows end there or at the far plane, whichever is closer
+    float shadowDistance = 50.0f;
+    // 0 splits the distance uniformly, 1 logarithmically
+    float splitLambda = 0.75f;
+    // casters this far towards the sun from a cascade still shadow it
+    float casterDistance = 20.0f;
+    // extra radius of the cached cascades, how far the view moves before they are redrawn
+    float cacheMargin = 0.25f;
+    // constant in depth format units, slope per unit of depth slope
+    float depthBiasConstant = 1.25f;
+    float depthBiasSlope = 1.75f;
+
+private:
+    // std140 layout of ShadowData in shadow.vert.glsl and the mesh fragment shaders
+    struct GpuShadowData {
+        glm::mat4 cascadeViewProj[CASCADE_COUNT];
+        // far view depth of every cascade
+        glm::vec4 cascadeSplits;
+        // world size of a texel of every cascade, for the normal offset
+        glm::vec4 cascadeTexelSizes;
+        glm::vec4 sunDirection;
+        // rgb * intensity
+        glm::vec4 sunColor;
+    };
+
+    struct Push {
+        uint32_t cascade;
+    };
+
+    struct Draw {
+        const Mesh* mesh;
+        // key of the material, mapped through GraphicsPipeline::shadowKey when recording
+        const MaterialDesc::PipelineKey* pipelineKey;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    struct Cascade {
+        glm::mat4 viewProj{1.0f};
+        float split = 0.0f;
+        float texelSize = 0.0f;
+        // sphere the map covers
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+
+        // cached cascades: what the cache layer was drawn for
+        bool valid = false;
+        uint64_t staticGeneration = 0;
+        glm::vec3 sunDirection{0.0f};
+        // the sampled layer holds dynamic casters over the cache
+        bool liveHasDynamic = false;
+    };
+
+    /**
+     * @brief What a cascade records this frame.
+     */
+    struct CascadeWork {
+        // static casters redrawn into the cache layer
+        bool renderStatic = false;
+        // cache layer copied into the sampled one
+        bool copyStatic = false;
+        // sampled layer drawn: cleared with every caster, or over the copy with the dynamic ones
+        bool renderLive = false;
+        uint32_t firstStaticDraw = 0;
+        uint32_t staticDrawCount = 0;
+        uint32_t firstLiveDraw = 0;
+        uint32_t liveDrawCount = 0;
+    };
+
+    struct FrameResources {
+        // shadow data, then the caster instances
+        VkBuffer buffer{VK_NULL_HANDLE};
+        BufferManager::AllocatedMemoryINFO memory{};
+        void* mapped = nullptr;
+        VkDescriptorSet instanceSet{VK_NULL_HANDLE};
+    };
+
+    VkDevice device;
+    VkDeviceSize nonCoherentAtomSize;
+    uint32_t resolution;
+    uint32_t maxInstances;
+    VkFormat depthFormat;
+
+    VkDeviceSize instancesOffset;
+    VkDeviceSize bufferSize;
+
+    // sampled cascades, one layer each
+    VkImage shadowImage{VK_NULL_HANDLE};
+    VkDeviceMemory shadowMemory{VK_NULL_HANDLE};
+    VkImageView shadowView{VK_NULL_HANDLE};
+    std::array<VkImageView, CASCADE_COUNT> layerViews{};
+    std::array<VkFramebuffer, CASCADE_COUNT> framebuffers{};
+
+    // static casters of the cached cascades
+    VkImage cacheImage{VK_NULL_HANDLE};
+    VkDeviceMemory cacheMemory{VK_NULL_HANDLE};
+    std::array<VkImageView, CACHED_CASCADE_COUNT> cacheLayerViews{};
+    std::array<VkFramebuffer, CACHED_CASCADE_COUNT> cacheFramebuffers{};
+
+    // same attachment, cleared or drawn over; compatible, so the pipelines use either
+    VkRenderPass clearPass{VK_NULL_HANDLE};
+    VkRenderPass loadPass{VK_NULL_HANDLE};
+    VkSampler sampler{VK_NULL_HANDLE};
+
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    std::vector<FrameResources> frames;
+
+    std::array<Cascade, CASCADE_COUNT> cascades{};
+    std::array<CascadeWork, CASCADE_COUNT> work{};
+    // casters of the frame being recorded
+    std::vector<Draw> draws;
+    std::vector<InstanceData> instances;
+
+    Stats stats;
+
+    VkRenderPass createRenderPass(
+        VkAttachmentLoadOp loadOp
+    );
+
+    /**
+     * @brief Creates a depth array of layers and one single-layer view and framebuffer per layer.
+     */
+    void createLayers(
+        VkPhysicalDevice physicalDevice,
+        uint32_t layers,
+        VkImageUsageFlags usage,
+        VkImage& image,
+        VkDeviceMemory& memory,
+        VkImageView* views,
+        VkFramebuffer* layerFramebuffers
+    );
+
+    /**
+     * @brief Centers a cascade on a sphere, snapped to its texels in the light space of lightRotation.
+     */
+    void fitCascade(
+        Cascade& cascade,
+        const glm::vec3& center,
+        float radius,
+        const glm::mat4& lightRotation
+    );
+
+    /**
+     * @brief Culls the casters of every batch against viewProj and appends their draws.
+     *
+     * @return Number of draws appended.
+     */
+    uint32_t gatherCasters(
+        RenderBatchManager& renderBatchManager,
+        const glm::mat4& viewProj,
+        RenderBatchManager::Mobility mobility
+    );
+
+    /**
+     * @brief Draws a range of draws into one layer, inside its own render pass.
+     */
+    void recordPass(
+        VkCommandBuffer cmd,
+        GraphicsPipeline* graphicsPipeline,
+        VkRenderPass renderPass,
+        VkFramebuffer framebuffer,
+        uint32_t cascade,
+        uint32_t firstDraw,
+        uint32_t drawCount
+    );
+
+    static void layerBarrier(
+        VkCommandBuffer cmd,
+        VkImage image,
+        uint32_t layer,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess
+    );
+
+public:
+    /**
+     * @param instanceLayout Layout of the mesh instance set, the casters are bound as set 2.
+     * @param maxInstances Caster instances per frame over every cascade, the rest are dropped.
+     * @param resolution Width and height of every cascade in texels.
+     *
+     * @throws std::runtime_error if no depth format can be sampled or any Vulkan object creation fails.
+     */
+    CascadedShadowMaps(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        BufferManager* bufferManager,
+        VkDeviceSize nonCoherentAtomSize,
+        VkDescriptorSetLayout instanceLayout,
+        uint32_t framesInFlight,
+        uint32_t maxInstances,
+        uint32_t resolution
+    );
+
+    ~CascadedShadowMaps();
+
+    CascadedShadowMaps(const CascadedShadowMaps&) = delete;
+    CascadedShadowMaps& operator=(const CascadedShadowMaps&) = delete;
+
+    /**
+     * @brief Fits the cascades to the view, culls their casters and uploads them with the sun.
+     *
+     * Call once per frame after waiting for the frame fence, once the
+     * instances have their final transforms and LODs for the frame.
+     *
+     * @param projection Perspective projection of the frame, the cascades follow its frustum.
+     * @param zNear Near plane distance of the projection.
+     * @param zFar Far plane distance of the projection.
+     */
+    void update(
+        uint32_t currentFrame,
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        float zNear,
+        float zFar,
+        RenderBatchManager& renderBatchManager
+    );
+
+    /**
+     * @brief Draws the cascades update decided on, outside a render pass and before the mesh draws.
+     *
+     * Binds sets 0 and 2 of the Mesh layout; the mesh walk binds its own afterwards.
+     */
+    void recordShadows(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        GraphicsPipeline* graphicsPipeline,
+        VkDescriptorSet globalSet
+    );
+
+    /// Render pass of the GraphicsPipeline::shadowKey variants
+    VkRenderPass getRenderPass() const { return clearPass; }
+    /// Sun and cascade matrices of a frame slot, binding 4 of the global set
+    VkDescriptorBufferInfo getShadowDataInfo(uint32_t currentFrame) const;
+    /// Every cascade with a comparison sampler, binding 5 of the global set
+    VkDescriptorImageInfo getShadowMapInfo() const;
+
+    Stats getStats() const { return stats; }
+};
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "ClusteredLighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "../graphics_pipeline/ShaderLoader.hpp"
+
+namespace {
+    // the largest minStorageBufferOffsetAlignment allowed
+    VkDeviceSize alignOffset(VkDeviceSize size)
+    {
+        return (size + 255) & ~VkDeviceSize(255);
+    }
+}
+
+ClusteredLighting::ClusteredLighting(
+    VkDevice device,
+    BufferManager* bufferManager,
+    VkDeviceSize nonCoherentAtomSize,
+    VkPipelineCache pipelineCache,
+    uint32_t framesInFlight,
+    uint32_t maxLights
+) :
+    device(device),
+    nonCoherentAtomSize(nonCoherentAtomSize),
+    maxLights(std::max(maxLights, 1u)),
+    frames(framesInFlight)
+{
+//* per-frame buffers
+    lightsOffset = alignOffset(sizeof(CullStats));
+    hostSize = lightsOffset + sizeof(GpuLight) * this->maxLights;
+
+    indicesOffset = alignOffset(sizeof(uint32_t) * CLUSTER_COUNT);
+    deviceSize = indicesOffset + sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER;
+
+    for (FrameResources& frame : frames)
+    {
+        bufferManager->createBuffer(hostSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, frame.hostBuffer);
+
+        bufferManager->allocateBufferMemory(
+            frame.hostBuffer,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+            frame.hostMemory
+        );
+
+        vkBindBufferMemory(device, frame.hostBuffer, frame.hostMemory.memory, 0);
+        vkMapMemory(device, frame.hostMemory.memory, 0, hostSize, 0, &frame.mapped);
+        std::memset(frame.mapped, 0, sizeof(CullStats));
+
+        bufferManager->createBuffer(deviceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, frame.deviceBuffer);
+        bufferManager->allocateBufferMemory(frame.deviceBuffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.deviceMemory);
+        vkBindBufferMemory(device, frame.deviceBuffer, frame.deviceMemory, 0);
+    }
+
+    createDescriptors();
+
+//* compute pipeline
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(Push);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cullLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create light culling pipeline layout!");
+
+    cullPipeline = createComputePipeline("shaders/light_cull.comp.glsl.spv", cullPipelineLayout, pipelineCache);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+    if (cullPipeline)
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+
+    if (cullPipelineLayout)
+        vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    if (cullLayout)
+        vkDestroyDescriptorSetLayout(device, cullLayout, nullptr);
+
+    for (FrameResources& frame : frames)
+    {
+        if (frame.mapped)
+            vkUnmapMemory(device, frame.hostMemory.memory);
+
+        if (frame.hostBuffer)
+            vkDestroyBuffer(device, frame.hostBuffer, nullptr);
+
+        if (frame.hostMemory.memory)
+            vkFreeMemory(device, frame.hostMemory.memory, nullptr);
+
+        if (frame.deviceBuffer)
+            vkDestroyBuffer(device, frame.deviceBuffer, nullptr);
+
+        if (frame.deviceMemory)
+            vkFreeMemory(device, frame.deviceMemory, nullptr);
+    }
+}
+
+void ClusteredLighting::createDescriptors()
+{
+    const uint32_t framesInFlight = static_cast<uint32_t>(frames.size());
+
+    // 0 stats, 1 lights, 2 cluster light counts, 3 cluster light indices
+    VkDescriptorSetLayoutBinding bindings[4]{};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create light culling descriptor set layout");
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 4 * framesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create light culling descriptor pool");
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, cullLayout);
+    std::vector<VkDescriptorSet> sets(framesInFlight);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate light culling descriptor sets");
+
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(4 * framesInFlight);
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        FrameResources& frame = frames[i];
+        frame.cullSet = sets[i];
+
+        VkDescriptorBufferInfo infos[4] = {
+            {frame.hostBuffer, 0, sizeof(CullStats)},
+            getLightBufferInfo(i),
+            getClusterGridInfo(i),
+            getClusterLightIndexInfo(i)
+        };
+
+        for (uint32_t binding = 0; binding < 4; binding++)
+        {
+            bufferInfos.push_back(infos[binding]);
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = frame.cullSet;
+            write.dstBinding = binding;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = 1;
+            write.pBufferInfo = &bufferInfos.back();
+            writes.push_back(write);
+        }
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+VkPipeline ClusteredLighting::createComputePipeline(
+    const std::string& path,
+    VkPipelineLayout layout,
+    VkPipelineCache pipelineCache
+) {
+    ShaderLoader shaderLoader(device, path);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderLoader.getCompModule();
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create light culling compute pipeline!");
+
+    return pipeline;
+}
+
+uint32_t ClusteredLighting::addLight(
+    const Light& light
+) {
+    uint32_t id = nextLightId++;
+    lights[id] = light;
+    return id;
+}
+
+void ClusteredLighting::setLight(
+    uint32_t id,
+    const Light& light
+) {
+    auto it = lights.find(id);
+    if (it == lights.end())
+        throw std::runtime_error("unknown light");
+
+    it->second = light;
+}
+
+const Light& ClusteredLighting::getLight(
+    uint32_t id
+) const {
+    auto it = lights.find(id);
+    if (it == lights.end())
+        throw std::runtime_error("unknown light");
+
+    return it->second;
+}
+
+void ClusteredLighting::removeLight(
+    uint32_t id
+) {
+    lights.erase(id);
+}
+
+void ClusteredLighting::update(
+    uint32_t currentFrame,
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    float zNear,
+    float zFar
+) {
+    FrameResources& frame = frames[currentFrame];
+    CullStats* cullStats = static_cast<CullStats*>(frame.mapped);
+
+    if (frame.submitted)
+    {
+        if (!frame.hostMemory.isCoherent)
+        {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = frame.hostMemory.memory;
+            range.offset = 0;
+            range.size = (sizeof(CullStats) + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+
+        stats.lights = frame.lightCount;
+        stats.litClusters = cullStats->litClusters;
+        stats.maxClusterLights = cullStats->maxClusterLights;
+        stats.overflowClusters = cullStats->overflowClusters;
+    }
+
+    *cullStats = CullStats{};
+
+    GpuLight* gpuLights = reinterpret_cast<GpuLight*>(static_cast<char*>(frame.mapped) + lightsOffset);
+    uint32_t lightCount = 0;
+
+    for (const auto& [id, light] : lights)
+    {
+        if (lightCount == maxLights)
+            break;
+
+        GpuLight& gpuLight = gpuLights[lightCount++];
+        gpuLight.positionRange = glm::vec4(light.position, std::max(light.range, 1e-4f));
+        gpuLight.colorIntensity = glm::vec4(light.color, light.intensity);
+
+        float outerAngle = std::clamp(light.outerAngle, 0.0f, glm::radians(89.0f));
+        float innerAngle = std::clamp(light.innerAngle, 0.0f, outerAngle);
+        glm::vec3 direction = glm::length(light.direction) > 0.0f ? glm::normalize(light.direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+        gpuLight.directionOuterCos = glm::vec4(direction, std::cos(outerAngle));
+        // equal cosines would divide by zero in the smoothstep of the cone edge
+        gpuLight.innerCos = std::max(std::cos(innerAngle), gpuLight.directionOuterCos.w + 1e-4f);
+        gpuLight.type = light.type == LightType::Spot ? 1u : 0u;
+    }
+
+    if (!frame.hostMemory.isCoherent)
+    {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = frame.hostMemory.memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+
+        vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    frame.lightCount = lightCount;
+    frame.submitted = true;
+
+    push.view = view;
+    push.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][0], projection[2][1]);
+    push.zNear = zNear;
+    push.zFar = zFar;
+    push.lightCount = lightCount;
+}
+
+void ClusteredLighting::recordCulling(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame
+) {
+    const FrameResources& frame = frames[currentFrame];
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+    vkCmdPushConstants(cmd, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+    // one thread per cluster
+    vkCmdDispatch(cmd, (CLUSTER_COUNT + 63) / 64, 1, 1);
+
+    // the cluster lists to the mesh fragment shaders, the stats to the CPU once the frame is done
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1,
+        &memoryBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+}
+
+VkDescriptorBufferInfo ClusteredLighting::getLightBufferInfo(
+    uint32_t currentFrame
+) const {
+    return {frames[currentFrame].hostBuffer, lightsOffset, sizeof(GpuLight) * maxLights};
+}
+
+VkDescriptorBufferInfo ClusteredLighting::getClusterGridInfo(
+    uint32_t currentFrame
+) const {
+    return {frames[currentFrame].deviceBuffer, 0, sizeof(uint32_t) * CLUSTER_COUNT};
+}
+
+VkDescriptorBufferInfo ClusteredLighting::getClusterLightIndexInfo(
+    uint32_t currentFrame
+) const {
+    return {frames[currentFrame].deviceBuffer, indicesOffset, sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER};
+}
\ No newline at end of file
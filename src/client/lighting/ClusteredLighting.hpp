@@ -0,0 +1,210 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "../CoreVulkan.hpp"
+#include "../BufferManager.hpp"
+#include "Light.hpp"
+
+/**
+ * @brief Point and spot lights of the mesh pass, culled into a 3D grid of view clusters.
+ *
+ * The view frustum is cut into GRID_X x GRID_Y screen tiles and GRID_Z
+ * depth slices, exponentially spaced between the near and far planes so
+ * clusters keep roughly the same shape at every distance. Each frame a
+ * compute pass (light_cull.comp.glsl) tests every light's range, and the
+ * cone of spot lights, against the bounds of every cluster and writes the
+ * indices of the lights reaching it. The mesh fragment shaders find the
+ * cluster of the fragment and only shade with its lights.
+ *
+ * The lights, the light count of every cluster and the light indices are
+ * bindings 1 to 3 of the global set (see GlobalDescriptorManager), one set
+ * of buffers per frame in flight. Every cluster owns MAX_LIGHTS_PER_CLUSTER
+ * index slots; lights past that are dropped from it and counted in the
+ * stats, which are read back once the frame slot comes around again.
+ */
+class ClusteredLighting
+{
+public:
+    // mirrored in light_cull.comp.glsl and the mesh fragment shaders
+    static constexpr uint32_t GRID_X = 16;
+    static constexpr uint32_t GRID_Y = 9;
+    static constexpr uint32_t GRID_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+    struct Stats {
+        uint32_t lights = 0;
+        // clusters reached by at least one light
+        uint32_t litClusters = 0;
+        uint32_t maxClusterLights = 0;
+        // clusters reached by more than MAX_LIGHTS_PER_CLUSTER lights
+        uint32_t overflowClusters = 0;
+    };
+
+    // light reaching every surface, added to the clustered lights
+    glm::vec3 ambient{0.3f};
+
+private:
+    // std430 layout of Light in light_cull.comp.glsl and the mesh fragment shaders
+    struct GpuLight {
+        glm::vec4 positionRange;
+        glm::vec4 colorIntensity;
+        glm::vec4 directionOuterCos;
+        float innerCos;
+        uint32_t type;
+        uint32_t pad[2];
+    };
+
+    // layout of CullStats in light_cull.comp.glsl
+    struct CullStats {
+        uint32_t maxClusterLights;
+        uint32_t overflowClusters;
+        uint32_t litClusters;
+        uint32_t pad;
+    };
+
+    struct Push {
+        glm::mat4 view;
+        // P[0][0], P[1][1], P[2][0], P[2][1] of the perspective projection
+        glm::vec4 projection;
+        float zNear;
+        float zFar;
+        uint32_t lightCount;
+        uint32_t pad;
+    };
+
+    struct FrameResources {
+        // cull stats, then the lights, written by the CPU
+        VkBuffer hostBuffer{VK_NULL_HANDLE};
+        BufferManager::AllocatedMemoryINFO hostMemory{};
+        void* mapped = nullptr;
+        // light count of every cluster, then the light indices
+        VkBuffer deviceBuffer{VK_NULL_HANDLE};
+        VkDeviceMemory deviceMemory{VK_NULL_HANDLE};
+
+        VkDescriptorSet cullSet{VK_NULL_HANDLE};
+
+        uint32_t lightCount = 0;
+        // the stats hold a finished cull once the frame fence is waited
+        bool submitted = false;
+    };
+
+    VkDevice device;
+    VkDeviceSize nonCoherentAtomSize;
+    uint32_t maxLights;
+
+    // offsets into the per-frame buffers, 256-byte aligned for the descriptors
+    VkDeviceSize lightsOffset;
+    VkDeviceSize hostSize;
+    VkDeviceSize indicesOffset;
+    VkDeviceSize deviceSize;
+
+    std::vector<FrameResources> frames;
+
+    std::unordered_map<uint32_t, Light> lights;
+    uint32_t nextLightId = 1;
+
+    VkDescriptorSetLayout cullLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkPipelineLayout cullPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline cullPipeline{VK_NULL_HANDLE};
+
+    Push push{};
+    Stats stats;
+
+    void createDescriptors();
+
+    VkPipeline createComputePipeline(
+        const std::string& path,
+        VkPipelineLayout layout,
+        VkPipelineCache pipelineCache
+    );
+
+public:
+    /**
+     * @param maxLights Lights uploaded per frame, the rest are ignored.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    ClusteredLighting(
+        VkDevice device,
+        BufferManager* bufferManager,
+        VkDeviceSize nonCoherentAtomSize,
+        VkPipelineCache pipelineCache,
+        uint32_t framesInFlight,
+        uint32_t maxLights
+    );
+
+    ~ClusteredLighting();
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    /**
+     * @brief Adds a light, returns its id.
+     */
+    uint32_t addLight(
+        const Light& light
+    );
+
+    /**
+     * @brief Replaces the parameters of a light.
+     *
+     * @throws std::runtime_error if the id is unknown.
+     */
+    void setLight(
+        uint32_t id,
+        const Light& light
+    );
+
+    /**
+     * @throws std::runtime_error if the id is unknown.
+     */
+    const Light& getLight(
+        uint32_t id
+    ) const;
+
+    void removeLight(
+        uint32_t id
+    );
+
+    /**
+     * @brief Reads back the stats of the last cull of this frame slot and uploads the lights.
+     *
+     * Call once per frame after waiting for the frame fence.
+     *
+     * @param view Camera view matrix of the frame.
+     * @param projection Perspective projection of the frame, the clusters follow its frustum.
+     * @param zNear Near plane distance of the projection.
+     * @param zFar Far plane distance of the projection, the last slice ends there.
+     */
+    void update(
+        uint32_t currentFrame,
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        float zNear,
+        float zFar
+    );
+
+    /**
+     * @brief Assigns the lights to the clusters, outside a render pass and before the mesh draws.
+     */
+    void recordCulling(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    );
+
+    /// Lights of a frame slot, binding 1 of the global set
+    VkDescriptorBufferInfo getLightBufferInfo(uint32_t currentFrame) const;
+    /// Light count of every cluster, binding 2 of the global set
+    VkDescriptorBufferInfo getClusterGridInfo(uint32_t currentFrame) const;
+    /// MAX_LIGHTS_PER_CLUSTER light index slots per cluster, binding 3 of the global set
+    VkDescriptorBufferInfo getClusterLightIndexInfo(uint32_t currentFrame) const;
+
+    Stats getStats() const { return stats; }
+    size_t getLightCount() const { return lights.size(); }
+};
\ No newline at end of file
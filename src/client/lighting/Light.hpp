@@ -0,0 +1,35 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/**
+ * @brief Shape of the volume a light reaches.
+ */
+enum class LightType {
+    // every direction, out to the range
+    Point,
+    // a cone around the direction, out to the range
+    Spot
+};
+
+/**
+ * @brief A light of the clustered forward pass, see ClusteredLighting.
+ *
+ * The light fades to nothing at its range, which is also the volume the
+ * light culling tests: a tight range keeps it in fewer clusters.
+ */
+struct Light {
+    LightType type = LightType::Point;
+
+    glm::vec3 position{0.0f};
+    // world units
+    float range = 1.0f;
+
+    glm::vec3 color{1.0f};
+    float intensity = 1.0f;
+
+    // spot only: axis of the cone, normalized on upload
+    glm::vec3 direction{0.0f, 0.0f, -1.0f};
+    // spot only: half angles in radians, full intensity inside the inner one
+    float innerAngle = 0.3f;
+    float outerAngle = 0.5f;
+};
\ No newline at end of file
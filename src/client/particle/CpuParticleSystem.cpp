@@ -0,0 +1,275 @@
+#include "CpuParticleSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+void CpuParticleSystem::Pool::reserve(
+    uint32_t size
+) {
+    // kernels touch whole groups of 8 past the last particle
+    size_t padded = (static_cast<size_t>(size) + 15) & ~size_t(7);
+    if (age.size() >= padded)
+        return;
+
+    padded = std::max(padded, age.size() * 2);
+    for (std::vector<float>* array : { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &age, &invLifetime })
+        array->resize(padded, 0.0f);
+}
+
+ParticleSoA CpuParticleSystem::Pool::view()
+{
+    return {
+        positionX.data(), positionY.data(), positionZ.data(),
+        velocityX.data(), velocityY.data(), velocityZ.data(),
+        age.data(), invLifetime.data()
+    };
+}
+
+CpuParticleSystem::CpuParticleSystem(
+    ParticleInstanceDescriptorManager* particleInstanceDescriptorManager,
+    JobSystem* jobSystem,
+    uint32_t framesInFlight,
+    bool useSimd
+) :
+    particleInstanceDescriptorManager(particleInstanceDescriptorManager),
+    jobSystem(jobSystem),
+    capacity(particleInstanceDescriptorManager->getMaxParticles()),
+    drawCounts(framesInFlight, 0),
+    sortKeys(capacity),
+    sortScratch(capacity),
+    random(std::random_device{}())
+{
+    simd = ParticleKernels::select(useSimd, simulate, write);
+}
+
+void CpuParticleSystem::emit(
+    Pool& pool,
+    uint32_t spawnCount
+) {
+    const ParticleEmitter& emitter = pool.emitter;
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    pool.reserve(pool.count + spawnCount);
+
+    for (uint32_t i = pool.count; i < pool.count + spawnCount; i++)
+    {
+        pool.positionX[i] = emitter.position.x + unit(random) * emitter.radius;
+        pool.positionY[i] = emitter.position.y + unit(random) * emitter.radius;
+        pool.positionZ[i] = emitter.position.z + unit(random) * emitter.radius;
+        pool.velocityX[i] = emitter.velocity.x + unit(random) * emitter.velocitySpread;
+        pool.velocityY[i] = emitter.velocity.y + unit(random) * emitter.velocitySpread;
+        pool.velocityZ[i] = emitter.velocity.z + unit(random) * emitter.velocitySpread;
+        pool.age[i] = 0.0f;
+        pool.invLifetime[i] = 1.0f / std::max(0.001f, emitter.lifetime + unit(random) * emitter.lifetimeSpread);
+    }
+
+    pool.count += spawnCount;
+}
+
+void CpuParticleSystem::compact(
+    Pool& pool,
+    uint32_t from,
+    uint32_t to,
+    uint32_t count
+) {
+    for (std::vector<float>* array : { &pool.positionX, &pool.positionY, &pool.positionZ, &pool.velocityX, &pool.velocityY, &pool.velocityZ, &pool.age, &pool.invLifetime })
+        std::memmove(array->data() + to, array->data() + from, count * sizeof(float));
+}
+
+void CpuParticleSystem::writeSortKeys(
+    const ParticleData* out,
+    uint32_t base,
+    uint32_t count
+) {
+    for (uint32_t i = base; i < base + count; i++)
+    {
+        float depth = std::max(glm::dot(viewDepthRow, glm::vec4(glm::vec3(out[i].positionSize), 1.0f)), 1e-6f);
+
+        // positive floats order like their bits, the top 16 are kept and inverted
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        sortKeys[i] = { 0xFFFFu - (bits >> 16), i };
+    }
+}
+
+void CpuParticleSystem::sortDrawOrder(
+    uint32_t currentFrame,
+    uint32_t count
+) {
+    ParticleSortKey* source = sortKeys.data();
+    ParticleSortKey* target = sortScratch.data();
+
+    // LSD radix sort, stable, low byte then high byte
+    for (uint32_t shift = 0; shift < 16; shift += 8)
+    {
+        uint32_t offsets[256] = {};
+        for (uint32_t i = 0; i < count; i++)
+            offsets[(source[i].key >> shift) & 0xFF]++;
+
+        uint32_t sum = 0;
+        for (uint32_t& offset : offsets)
+        {
+            uint32_t bucket = offset;
+            offset = sum;
+            sum += bucket;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+            target[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+
+        std::swap(source, target);
+    }
+
+    // sequential copy, the mapped memory may be write-combined
+    std::memcpy(particleInstanceDescriptorManager->getMappedOrder(currentFrame), source, count * sizeof(ParticleSortKey));
+    particleInstanceDescriptorManager->flushOrder(currentFrame, count);
+}
+
+void CpuParticleSystem::update(
+    uint32_t currentFrame,
+    float deltaTime,
+    const glm::mat4& view
+) {
+    auto start = std::chrono::steady_clock::now();
+
+    viewDepthRow = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+//* sync pools with the emitters
+    for (auto& pair : pools)
+        pair.second.active = emitters.count(pair.first) != 0;
+
+    uint32_t total = 0;
+    for (auto& pair : pools)
+        total += pair.second.count;
+
+//* emit, serial so the random sequence stays on one thread
+    for (auto& pair : emitters)
+    {
+        Pool& pool = pools[pair.first];
+        pool.active = true;
+        pool.emitter = pair.second.emitter;
+
+        // never more than the instance buffer holds, the rest is dropped
+        uint32_t spawnCount = std::min(takeSpawnCount(pair.second, deltaTime), capacity - total);
+        if (spawnCount > 0)
+            emit(pool, spawnCount);
+        total += spawnCount;
+    }
+
+//* one job per chunk: simulate, compact, write to the instance buffer, sort keys
+    chunks.clear();
+    for (auto it = pools.begin(); it != pools.end(); )
+    {
+        Pool& pool = it->second;
+        if (pool.count == 0 && !pool.active)
+        {
+            it = pools.erase(it);
+            continue;
+        }
+
+        const ParticleEmitter& emitter = pool.emitter;
+        pool.step.deltaTime = deltaTime;
+        pool.step.damping = std::max(0.0f, 1.0f - emitter.drag * deltaTime);
+        pool.step.acceleration = emitter.acceleration;
+        pool.step.colorStart = toBlendSpace(emitter.colorStart, emitter.blendMode);
+        pool.step.colorDelta = toBlendSpace(emitter.colorEnd, emitter.blendMode) - pool.step.colorStart;
+        pool.step.sizeStart = emitter.sizeStart;
+        pool.step.sizeDelta = emitter.sizeEnd - emitter.sizeStart;
+
+        for (uint32_t begin = 0; begin < pool.count; begin += CHUNK_SIZE)
+            chunks.push_back({ &pool, begin, std::min(begin + CHUNK_SIZE, pool.count), 0 });
+
+        ++it;
+    }
+
+    ParticleData* out = particleInstanceDescriptorManager->getMapped(currentFrame);
+    drawCursor.store(0, std::memory_order_relaxed);
+
+    JobSystem::JobCounter counter;
+    for (Chunk& chunk : chunks)
+    {
+        jobSystem->submit(
+            [this, &chunk, out]() {
+                ParticleSoA particles = chunk.pool->view();
+                chunk.alive = simulate(particles, chunk.begin, chunk.end, chunk.pool->step);
+
+                uint32_t base = drawCursor.fetch_add(chunk.alive, std::memory_order_relaxed);
+                if (base < capacity)
+                {
+                    uint32_t count = std::min(chunk.alive, capacity - base);
+                    write(particles, chunk.begin, count, chunk.pool->step, out + base);
+                    writeSortKeys(out, base, count);
+                }
+            },
+            &counter
+        );
+    }
+
+    jobSystem->wait(counter);
+
+//* close the gaps left behind each chunk
+    Pool* pool = nullptr;
+    for (const Chunk& chunk : chunks)
+    {
+        if (chunk.pool != pool)
+        {
+            pool = chunk.pool;
+            pool->count = 0;
+        }
+
+        if (chunk.begin != pool->count && chunk.alive > 0)
+            compact(*pool, chunk.begin, pool->count, chunk.alive);
+        pool->count += chunk.alive;
+    }
+
+    aliveCount = std::min(drawCursor.load(std::memory_order_relaxed), capacity);
+    drawCounts[currentFrame] = aliveCount;
+    particleInstanceDescriptorManager->flush(currentFrame, 0, aliveCount);
+
+    sortDrawOrder(currentFrame, aliveCount);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    simulateMs = simulateMs == 0.0 ? ms : simulateMs * 0.9 + ms * 0.1;
+}
+
+void CpuParticleSystem::recordSimulation(
+    VkCommandBuffer,
+    uint32_t
+) {
+}
+
+void CpuParticleSystem::recordDraw(
+    VkCommandBuffer cmd,
+    VkPipelineLayout particlePipelineLayout,
+    uint32_t currentFrame
+) {
+    if (drawCounts[currentFrame] == 0)
+        return;
+
+    VkDescriptorSet particleSet = particleInstanceDescriptorManager->getDescriptorSets()[currentFrame];
+
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        particlePipelineLayout,
+        1,
+        1,
+        &particleSet,
+        0,
+        nullptr
+    );
+
+    // one 4 vertex strip per particle
+    vkCmdDraw(cmd, 4, drawCounts[currentFrame], 0, 0);
+}
+
+ParticleSystem::Stats CpuParticleSystem::getStats() const
+{
+    Stats stats;
+    stats.backend = simd ? "CPU AVX2" : "CPU";
+    stats.emitters = emitters.size();
+    stats.alive = aliveCount;
+    stats.simulateMs = simulateMs;
+    return stats;
+}
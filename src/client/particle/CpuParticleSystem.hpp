@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../CoreVulkan.hpp"
+#include "ParticleInstanceDescriptorManager.hpp"
+#include "ParticleKernels.hpp"
+#include "ParticleSystem.hpp"
+#include "jobs/JobSystem.hpp"
+
+/**
+ * @brief Particle pool simulated on the CPU, for when compute is undesirable.
+ *
+ * Every emitter owns a structure-of-arrays pool. Each frame the render
+ * thread appends the new particles, then the pools are cut into chunks of
+ * a few thousand particles and every chunk is one job: the chunk is aged,
+ * moved and compacted in place, and its survivors are written straight
+ * into the mapped ParticleInstanceDescriptorManager buffer of the frame at
+ * an offset claimed with an atomic counter. The render thread waits for
+ * the jobs and closes the gaps the chunks left in their pools.
+ *
+ * Each job also computes a 16 bit view depth key per particle it wrote;
+ * the render thread radix sorts the keys (two 8 bit passes, farthest
+ * first) into the draw order buffer. 16 bits of a float keep the exponent
+ * and 7 mantissa bits, plenty for blending order.
+ *
+ * The kernels are AVX2 when the CPU supports it (see ParticleKernels).
+ * Particles follow the current parameters of their emitter, colors and
+ * sizes fade over their age like on the GPU.
+ */
+class CpuParticleSystem : public ParticleSystem
+{
+private:
+    // particles per job, a multiple of 8 so chunks never share a group of lanes
+    static constexpr uint32_t CHUNK_SIZE = 16384;
+
+    struct Pool {
+        ParticleEmitter emitter;
+        // false once the emitter is removed, the pool drains and is erased
+        bool active = true;
+        uint32_t count = 0;
+
+        std::vector<float> positionX;
+        std::vector<float> positionY;
+        std::vector<float> positionZ;
+        std::vector<float> velocityX;
+        std::vector<float> velocityY;
+        std::vector<float> velocityZ;
+        std::vector<float> age;
+        std::vector<float> invLifetime;
+
+        ParticleStep step;
+
+        /**
+         * @brief Grows every array to hold size particles plus a group of padding.
+         */
+        void reserve(
+            uint32_t size
+        );
+
+        ParticleSoA view();
+    };
+
+    struct Chunk {
+        Pool* pool;
+        uint32_t begin;
+        uint32_t end;
+        // survivors, written by the job
+        uint32_t alive;
+    };
+
+    ParticleInstanceDescriptorManager* particleInstanceDescriptorManager;
+    JobSystem* jobSystem;
+    uint32_t capacity;
+
+    ParticleKernels::SimulateFn simulate;
+    ParticleKernels::WriteFn write;
+    bool simd;
+
+    std::unordered_map<uint32_t, Pool> pools;
+    std::vector<Chunk> chunks;
+    std::atomic<uint32_t> drawCursor{0};
+    std::vector<uint32_t> drawCounts;
+
+    // keys by draw slot, and the radix sort ping-pong buffer
+    std::vector<ParticleSortKey> sortKeys;
+    std::vector<ParticleSortKey> sortScratch;
+    // third row of the view matrix, negated: dot gives the view depth
+    glm::vec4 viewDepthRow{0.0f};
+
+    std::mt19937 random;
+    uint32_t aliveCount = 0;
+    double simulateMs = 0.0;
+
+    void emit(
+        Pool& pool,
+        uint32_t spawnCount
+    );
+
+    void compact(
+        Pool& pool,
+        uint32_t from,
+        uint32_t to,
+        uint32_t count
+    );
+
+    /**
+     * @brief Keys of count particles written at out[base], farthest first. Thread-safe.
+     */
+    void writeSortKeys(
+        const ParticleData* out,
+        uint32_t base,
+        uint32_t count
+    );
+
+    /**
+     * @brief Sorts the first count keys and writes them to the frame's draw order.
+     */
+    void sortDrawOrder(
+        uint32_t currentFrame,
+        uint32_t count
+    );
+
+public:
+    /**
+     * @param particleInstanceDescriptorManager Per-frame particle buffers the
+     *        Particles pipeline reads; its size is the particle capacity.
+     * @param useSimd Allows the AVX2 kernels, false forces the scalar ones.
+     */
+    CpuParticleSystem(
+        ParticleInstanceDescriptorManager* particleInstanceDescriptorManager,
+        JobSystem* jobSystem,
+        uint32_t framesInFlight,
+        bool useSimd
+    );
+
+    CpuParticleSystem(const CpuParticleSystem&) = delete;
+    CpuParticleSystem& operator=(const CpuParticleSystem&) = delete;
+
+    /**
+     * @brief Emits, simulates and writes this frame's particles.
+     *
+     * Blocks until the simulation jobs are done.
+     */
+    void update(
+        uint32_t currentFrame,
+        float deltaTime,
+        const glm::mat4& view
+    ) override;
+
+    /**
+     * @brief Nothing to record, the particles were written by update.
+     */
+    void recordSimulation(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    ) override;
+
+    /**
+     * @brief Draws the particles written for this frame back to front, one quad instance each.
+     */
+    void recordDraw(
+        VkCommandBuffer cmd,
+        VkPipelineLayout particlePipelineLayout,
+        uint32_t currentFrame
+    ) override;
+
+    Stats getStats() const override;
+};
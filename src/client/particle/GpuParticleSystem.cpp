@@ -0,0 +1,493 @@
+#include "GpuParticleSystem.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+GpuParticleSystem::GpuParticleSystem(
+    VkDevice device,
+    BufferManager* bufferManager,
+    VkDeviceSize nonCoherentAtomSize,
+    VkDescriptorSetLayout particleLayout,
+    VkPipelineCache pipelineCache,
+    uint32_t framesInFlight,
+    uint32_t capacity,
+    uint32_t maxEmitters
+) :
+    device(device),
+    capacity(capacity),
+    sortCapacity(SORT_BLOCK),
+    maxEmitters(maxEmitters),
+    nonCoherentAtomSize(nonCoherentAtomSize)
+{
+    if (capacity == 0 || maxEmitters == 0)
+        throw std::runtime_error("particle system needs room for particles and emitters");
+
+//* persistent GPU state
+    createDeviceBuffer(
+        bufferManager,
+        sizeof(GpuState),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        stateBuffer,
+        stateMemory
+    );
+    createDeviceBuffer(bufferManager, sizeof(GpuParticle) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, particleBuffer, particleMemory);
+    createDeviceBuffer(bufferManager, sizeof(uint32_t) * capacity * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, aliveBuffer, aliveMemory);
+    createDeviceBuffer(bufferManager, sizeof(uint32_t) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, deadBuffer, deadMemory);
+    createDeviceBuffer(bufferManager, sizeof(ParticleData) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, drawBuffer, drawMemory);
+
+    while (sortCapacity < capacity)
+        sortCapacity <<= 1;
+    createDeviceBuffer(bufferManager, sizeof(ParticleSortKey) * sortCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sortBuffer, sortMemory);
+
+    // empty pool: no alive or dead particles, every slot still fresh
+    VkCommandBuffer cmd = bufferManager->beginImmediate();
+    vkCmdFillBuffer(cmd, stateBuffer, 0, VK_WHOLE_SIZE, 0);
+    bufferManager->endImmediate();
+
+//* emitter parameters, written by the CPU every frame
+    VkDeviceSize emitterSize = sizeof(GpuEmitter) * maxEmitters;
+
+    emitterBuffers.resize(framesInFlight);
+    emitterMemory.resize(framesInFlight);
+    emitterMapped.resize(framesInFlight);
+
+    for (uint32_t i = 0; i < framesInFlight; i++)
+    {
+        bufferManager->createBuffer(
+            emitterSize,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            emitterBuffers[i]
+        );
+
+        bufferManager->allocateBufferMemory(
+            emitterBuffers[i],
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, // required
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // preferred
+            emitterMemory[i]
+        );
+
+        vkBindBufferMemory(device, emitterBuffers[i], emitterMemory[i].memory, 0);
+
+        vkMapMemory(
+            device,
+            emitterMemory[i].memory,
+            0,
+            emitterSize,
+            0,
+            &emitterMapped[i]
+        );
+    }
+
+    createDescriptors(particleLayout, framesInFlight);
+
+//* compute pipelines
+    pipelineLayout = createComputeLayout(sizeof(Push));
+    sortPipelineLayout = createComputeLayout(sizeof(SortPush));
+
+    simulatePipeline = createComputePipeline("shaders/particle_simulate.comp.glsl.spv", pipelineLayout, pipelineCache);
+    emitPipeline = createComputePipeline("shaders/particle_emit.comp.glsl.spv", pipelineLayout, pipelineCache);
+    finishPipeline = createComputePipeline("shaders/particle_finish.comp.glsl.spv", pipelineLayout, pipelineCache);
+    sortPipeline = createComputePipeline("shaders/particle_sort.comp.glsl.spv", sortPipelineLayout, pipelineCache);
+
+    push.capacity = capacity;
+}
+
+GpuParticleSystem::~GpuParticleSystem()
+{
+    for (VkPipeline pipeline : {simulatePipeline, emitPipeline, finishPipeline, sortPipeline})
+    {
+        if (pipeline)
+            vkDestroyPipeline(device, pipeline, nullptr);
+    }
+
+    for (VkPipelineLayout layout : {pipelineLayout, sortPipelineLayout})
+    {
+        if (layout)
+            vkDestroyPipelineLayout(device, layout, nullptr);
+    }
+
+    if (descriptorPool)
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+
+    if (computeLayout)
+        vkDestroyDescriptorSetLayout(device, computeLayout, nullptr);
+
+    for (size_t i = 0; i < emitterBuffers.size(); i++)
+    {
+        if (emitterMapped[i])
+            vkUnmapMemory(device, emitterMemory[i].memory);
+
+        if (emitterBuffers[i])
+            vkDestroyBuffer(device, emitterBuffers[i], nullptr);
+
+        if (emitterMemory[i].memory)
+            vkFreeMemory(device, emitterMemory[i].memory, nullptr);
+    }
+
+    VkBuffer buffers[] = { stateBuffer, particleBuffer, aliveBuffer, deadBuffer, drawBuffer, sortBuffer };
+    VkDeviceMemory memories[] = { stateMemory, particleMemory, aliveMemory, deadMemory, drawMemory, sortMemory };
+    for (size_t i = 0; i < 6; i++)
+    {
+        if (buffers[i])
+            vkDestroyBuffer(device, buffers[i], nullptr);
+
+        if (memories[i])
+            vkFreeMemory(device, memories[i], nullptr);
+    }
+}
+
+void GpuParticleSystem::createDeviceBuffer(
+    BufferManager* bufferManager,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkBuffer& buffer,
+    VkDeviceMemory& memory
+) {
+    bufferManager->createBuffer(size, usage, buffer);
+    bufferManager->allocateBufferMemory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory);
+    vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+void GpuParticleSystem::createDescriptors(
+    VkDescriptorSetLayout particleLayout,
+    uint32_t framesInFlight
+) {
+    // 0 state, 1 pool, 2 alive lists, 3 dead list, 4 draw buffer, 5 emitters, 6 sorted pairs
+    VkDescriptorSetLayoutBinding bindings[7]{};
+    for (uint32_t i = 0; i < 7; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 7;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &computeLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create particle compute descriptor set layout");
+
+    // one compute set per frame in flight plus the draw set
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 7 * framesInFlight + 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = framesInFlight + 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create particle descriptor pool");
+
+    std::vector<VkDescriptorSetLayout> layouts(framesInFlight, computeLayout);
+    layouts.push_back(particleLayout);
+
+    std::vector<VkDescriptorSet> sets(layouts.size());
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate particle descriptor sets");
+
+    drawSet = sets.back();
+    sets.pop_back();
+    computeSets = sets;
+
+    // 0 particles, 1 draw order
+    VkDescriptorBufferInfo drawInfos[2] = {
+        {drawBuffer, 0, VK_WHOLE_SIZE},
+        {sortBuffer, 0, VK_WHOLE_SIZE}
+    };
+
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(7 * framesInFlight);
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        VkBuffer buffers[] = { stateBuffer, particleBuffer, aliveBuffer, deadBuffer, drawBuffer, emitterBuffers[frame], sortBuffer };
+        for (uint32_t i = 0; i < 7; i++)
+        {
+            bufferInfos.push_back({buffers[i], 0, VK_WHOLE_SIZE});
+
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = computeSets[frame];
+            write.dstBinding = i;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            write.descriptorCount = 1;
+            write.pBufferInfo = &bufferInfos.back();
+            writes.push_back(write);
+        }
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        VkWriteDescriptorSet drawWrite{};
+        drawWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        drawWrite.dstSet = drawSet;
+        drawWrite.dstBinding = i;
+        drawWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        drawWrite.descriptorCount = 1;
+        drawWrite.pBufferInfo = &drawInfos[i];
+        writes.push_back(drawWrite);
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+VkPipelineLayout GpuParticleSystem::createComputeLayout(
+    uint32_t pushConstantSize
+) {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &computeLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    VkPipelineLayout layout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create particle pipeline layout!");
+
+    return layout;
+}
+
+VkPipeline GpuParticleSystem::createComputePipeline(
+    const std::string& path,
+    VkPipelineLayout layout,
+    VkPipelineCache pipelineCache
+) {
+    ShaderLoader shaderLoader(device, path);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderLoader.getCompModule();
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create particle compute pipeline!");
+
+    return pipeline;
+}
+
+void GpuParticleSystem::update(
+    uint32_t currentFrame,
+    float deltaTime,
+    const glm::mat4& view
+) {
+    GpuEmitter* gpuEmitters = static_cast<GpuEmitter*>(emitterMapped[currentFrame]);
+
+    uint32_t emitterCount = 0;
+    uint32_t spawnTotal = 0;
+
+    for (auto& pair : emitters)
+    {
+        const ParticleEmitter& emitter = pair.second.emitter;
+        uint32_t spawnCount = takeSpawnCount(pair.second, deltaTime);
+
+        // never more than the pool holds, the rest is dropped
+        spawnCount = std::min(spawnCount, capacity - spawnTotal);
+        if (spawnCount == 0 || emitterCount == maxEmitters)
+            continue;
+
+        GpuEmitter& gpu = gpuEmitters[emitterCount++];
+        gpu.positionRadius = glm::vec4(emitter.position, emitter.radius);
+        gpu.velocitySpread = glm::vec4(emitter.velocity, emitter.velocitySpread);
+        gpu.accelerationDrag = glm::vec4(emitter.acceleration, emitter.drag);
+        gpu.colorStart = toBlendSpace(emitter.colorStart, emitter.blendMode);
+        gpu.colorEnd = toBlendSpace(emitter.colorEnd, emitter.blendMode);
+        gpu.sizeLifetime = glm::vec4(emitter.sizeStart, emitter.sizeEnd, emitter.lifetime, emitter.lifetimeSpread);
+        gpu.firstSpawn = spawnTotal;
+        gpu.spawnCount = spawnCount;
+
+        spawnTotal += spawnCount;
+    }
+
+    if (emitterCount > 0 && !emitterMemory[currentFrame].isCoherent)
+    {
+        VkDeviceSize size = sizeof(GpuEmitter) * emitterCount;
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = emitterMemory[currentFrame].memory;
+        range.offset = 0;
+        range.size = (size + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+
+        vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    // the list written last frame is read this frame
+    push.current = 1 - push.current;
+    push.deltaTime = deltaTime;
+    push.emitterCount = emitterCount;
+    push.spawnTotal = spawnTotal;
+    push.seed++;
+
+    sortPush.viewDepthRow = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+}
+
+void GpuParticleSystem::barrier(
+    VkCommandBuffer cmd,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess
+) {
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = srcAccess;
+    memoryBarrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuParticleSystem::recordSimulation(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame
+) {
+    // last frame: finish wrote the dispatch, the draw read the draw buffer
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+    );
+
+    VkDescriptorSet set = computeSets[currentFrame];
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+    vkCmdDispatchIndirect(cmd, stateBuffer, offsetof(GpuState, dispatch));
+
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    );
+
+    if (push.spawnTotal > 0)
+    {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+        vkCmdDispatch(cmd, (push.spawnTotal + 63) / 64, 1, 1);
+
+        barrier(
+            cmd,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        );
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, finishPipeline);
+    vkCmdDispatch(cmd, 1, 1, 1);
+
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+    );
+
+    recordSort(cmd, currentFrame);
+
+    barrier(
+        cmd,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    );
+}
+
+void GpuParticleSystem::recordSort(
+    VkCommandBuffer cmd,
+    uint32_t currentFrame
+) {
+    // set 0 is rebound, the push constant range differs from pipelineLayout
+    VkDescriptorSet set = computeSets[currentFrame];
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, sortPipelineLayout, 0, 1, &set, 0, nullptr);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, sortPipeline);
+
+    auto step = [&](uint32_t k, uint32_t j)
+    {
+        sortPush.k = k;
+        sortPush.j = j;
+        vkCmdPushConstants(cmd, sortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortPush), &sortPush);
+        vkCmdDispatchIndirect(cmd, stateBuffer, offsetof(GpuState, sortDispatch));
+
+        barrier(
+            cmd,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+        );
+    };
+
+    // keys and every merge up to one block
+    step(0, 0);
+
+    // recorded for the capacity, steps past the frame's sortCount return at once
+    for (uint32_t k = SORT_BLOCK * 2; k <= sortCapacity; k <<= 1)
+    {
+        for (uint32_t j = k / 2; j >= SORT_BLOCK; j >>= 1)
+            step(k, j);
+
+        step(k, SORT_BLOCK / 2);
+    }
+}
+
+void GpuParticleSystem::recordDraw(
+    VkCommandBuffer cmd,
+    VkPipelineLayout particlePipelineLayout,
+    uint32_t currentFrame
+) {
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        particlePipelineLayout,
+        1,
+        1,
+        &drawSet,
+        0,
+        nullptr
+    );
+
+    vkCmdDrawIndirect(cmd, stateBuffer, offsetof(GpuState, draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+ParticleSystem::Stats GpuParticleSystem::getStats() const
+{
+    Stats stats;
+    stats.backend = "GPU";
+    stats.emitters = emitters.size();
+    return stats;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../CoreVulkan.hpp"
+#include "../BufferManager.hpp"
+#include "../graphics_pipeline/ShaderLoader.hpp"
+#include "ParticleData.hpp"
+#include "ParticleSystem.hpp"
+
+/**
+ * @brief Particle pool that lives and is simulated entirely on the GPU.
+ *
+ * The pool, two alive lists, the dead list and the draw buffer are
+ * device-local storage buffers that persist across frames. Every frame
+ * three compute passes run before the render pass:
+ *
+ * - simulate: ages and moves the particles of the current alive list;
+ *   survivors are appended to the next list and the draw buffer with an
+ *   atomic counter, so both stay compact, the dead go to the dead list.
+ *   Dispatched indirectly with the count of the previous frame.
+ * - emit: takes free slots from the dead list and appends the new
+ *   particles of every emitter the same way.
+ * - finish: one invocation writing the indirect draw and sort dispatch of
+ *   this frame and the simulate dispatch of the next one.
+ * - sort: a bitonic sort of (view depth key, index) pairs over the next
+ *   power of two of the alive count, farthest first. Blocks of 512 pairs
+ *   sort in shared memory, the larger merge steps run one dispatch each;
+ *   steps beyond this frame's count return at once, so the CPU records
+ *   them for the whole capacity without knowing the count.
+ *
+ * The CPU only uploads the emitter parameters (one small buffer per frame
+ * in flight) and never reads anything back. The draw buffer has the
+ * ParticleData layout and the sorted pairs the ParticleSortKey layout;
+ * both are bound as set 1 of the Particle pipeline layout, so the
+ * Particles pipeline draws them like the CPU ones.
+ */
+class GpuParticleSystem : public ParticleSystem
+{
+private:
+    // std430 layout of Particle in the compute shaders
+    struct GpuParticle {
+        glm::vec4 positionAge;
+        glm::vec4 velocityLifetime;
+        glm::vec4 accelerationDrag;
+        uint32_t colorStart;
+        uint32_t colorEnd;
+        float sizeStart;
+        float sizeEnd;
+    };
+
+    // std430 layout of Emitter in particle_emit.comp.glsl
+    struct GpuEmitter {
+        glm::vec4 positionRadius;
+        glm::vec4 velocitySpread;
+        glm::vec4 accelerationDrag;
+        glm::vec4 colorStart;
+        glm::vec4 colorEnd;
+        glm::vec4 sizeLifetime;
+        uint32_t firstSpawn;
+        uint32_t spawnCount;
+        uint32_t pad[2];
+    };
+
+    // layout of ParticleState, the indirect commands come first
+    struct GpuState {
+        VkDrawIndirectCommand draw;
+        VkDispatchIndirectCommand dispatch;
+        int32_t deadCount;
+        uint32_t freshCount;
+        uint32_t aliveCount[2];
+        VkDispatchIndirectCommand sortDispatch;
+        uint32_t sortCount;
+    };
+
+    struct Push {
+        float deltaTime;
+        uint32_t current;
+        uint32_t capacity;
+        uint32_t emitterCount;
+        uint32_t spawnTotal;
+        uint32_t seed;
+    };
+
+    // push constants of particle_sort.comp.glsl
+    struct SortPush {
+        glm::vec4 viewDepthRow;
+        uint32_t k;
+        uint32_t j;
+    };
+
+    // pairs sorted in shared memory by one workgroup
+    static constexpr uint32_t SORT_BLOCK = 512;
+
+    VkDevice device;
+    uint32_t capacity;
+    // power of two >= capacity and SORT_BLOCK
+    uint32_t sortCapacity;
+    uint32_t maxEmitters;
+
+    VkBuffer stateBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory stateMemory{VK_NULL_HANDLE};
+    VkBuffer particleBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory particleMemory{VK_NULL_HANDLE};
+    VkBuffer aliveBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory aliveMemory{VK_NULL_HANDLE};
+    VkBuffer deadBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory deadMemory{VK_NULL_HANDLE};
+    VkBuffer drawBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory drawMemory{VK_NULL_HANDLE};
+    VkBuffer sortBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory sortMemory{VK_NULL_HANDLE};
+
+    // emitter parameters, one host-visible buffer per frame in flight
+    std::vector<VkBuffer> emitterBuffers;
+    std::vector<BufferManager::AllocatedMemoryINFO> emitterMemory;
+    std::vector<void*> emitterMapped;
+    VkDeviceSize nonCoherentAtomSize;
+
+    VkDescriptorSetLayout computeLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    std::vector<VkDescriptorSet> computeSets;
+    // set 1 of the Particle pipeline layout
+    VkDescriptorSet drawSet{VK_NULL_HANDLE};
+
+    VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline simulatePipeline{VK_NULL_HANDLE};
+    VkPipeline emitPipeline{VK_NULL_HANDLE};
+    VkPipeline finishPipeline{VK_NULL_HANDLE};
+    VkPipelineLayout sortPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline sortPipeline{VK_NULL_HANDLE};
+
+    Push push{};
+    SortPush sortPush{};
+
+    void createDeviceBuffer(
+        BufferManager* bufferManager,
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        VkBuffer& buffer,
+        VkDeviceMemory& memory
+    );
+
+    void createDescriptors(
+        VkDescriptorSetLayout particleLayout,
+        uint32_t framesInFlight
+    );
+
+    VkPipelineLayout createComputeLayout(
+        uint32_t pushConstantSize
+    );
+
+    VkPipeline createComputePipeline(
+        const std::string& path,
+        VkPipelineLayout layout,
+        VkPipelineCache pipelineCache
+    );
+
+    /**
+     * @brief Records the sort of this frame's draw order, after finish.
+     */
+    void recordSort(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    );
+
+    static void barrier(
+        VkCommandBuffer cmd,
+        VkPipelineStageFlags srcStage,
+        VkAccessFlags srcAccess,
+        VkPipelineStageFlags dstStage,
+        VkAccessFlags dstAccess
+    );
+
+public:
+    /**
+     * @param particleLayout Set 1 layout of the Particle pipeline layout.
+     * @param capacity Maximum number of live particles.
+     * @param maxEmitters Maximum number of emitters spawning in one frame.
+     *
+     * @throws std::runtime_error if any Vulkan object creation fails.
+     */
+    GpuParticleSystem(
+        VkDevice device,
+        BufferManager* bufferManager,
+        VkDeviceSize nonCoherentAtomSize,
+        VkDescriptorSetLayout particleLayout,
+        VkPipelineCache pipelineCache,
+        uint32_t framesInFlight,
+        uint32_t capacity,
+        uint32_t maxEmitters
+    );
+
+    ~GpuParticleSystem();
+
+    GpuParticleSystem(const GpuParticleSystem&) = delete;
+    GpuParticleSystem& operator=(const GpuParticleSystem&) = delete;
+
+    /**
+     * @brief Writes the emitters of this frame into its emitter buffer.
+     *
+     * Call once per frame after waiting for the frame fence.
+     */
+    void update(
+        uint32_t currentFrame,
+        float deltaTime,
+        const glm::mat4& view
+    ) override;
+
+    /**
+     * @brief Records the simulate, emit, finish and sort passes.
+     *
+     * Must be recorded outside a render pass, before recordDraw.
+     */
+    void recordSimulation(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    ) override;
+
+    /**
+     * @brief Draws every live particle back to front with one indirect draw.
+     */
+    void recordDraw(
+        VkCommandBuffer cmd,
+        VkPipelineLayout particlePipelineLayout,
+        uint32_t currentFrame
+    ) override;
+
+    Stats getStats() const override;
+
+    uint32_t getCapacity() const { return capacity; }
+};
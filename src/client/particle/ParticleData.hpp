@@ -1,7 +1,18 @@
 #pragma once
+#include <cstdint>
 #include <glm/glm.hpp>
 
 struct ParticleData {
     glm::vec4 positionSize; // xyz = pos, w = size
-    glm::vec4 color;
-};
\ No newline at end of file
+    glm::vec4 color;        // premultiplied, see ParticleBlendMode
+};
+
+/**
+ * @brief Draw order entry, the particle shader draws particles[index] for each entry in turn.
+ *
+ * Entries are sorted by ascending key, farthest particle first.
+ */
+struct ParticleSortKey {
+    uint32_t key;
+    uint32_t index;
+};
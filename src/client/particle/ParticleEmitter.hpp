@@ -0,0 +1,54 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/**
+ * @brief How the particles of an emitter combine with what is behind them.
+ *
+ * All modes draw in the same sorted pass with premultiplied alpha blending:
+ * colors are converted once per emitter (see ParticleSystem::toBlendSpace),
+ * additive particles simply keep no alpha.
+ */
+enum class ParticleBlendMode {
+    // color.rgb over the background by color.a
+    Alpha,
+    // color.rgb * color.a added to the background
+    Additive,
+    // color.rgb is already multiplied by color.a
+    Premultiplied
+};
+
+/**
+ * @brief Parameters of a particle emitter, the only particle data the CPU sends.
+ *
+ * Sizes are the width of the camera-facing quad in world units. Colors and
+ * sizes fade linearly from their start to their end value over the life of
+ * each particle.
+ */
+struct ParticleEmitter {
+    glm::vec3 position{0.0f};
+    // particles spawn inside this sphere
+    float radius = 0.0f;
+
+    glm::vec3 velocity{0.0f};
+    // random velocity added on each axis, in units per second
+    float velocitySpread = 0.0f;
+
+    glm::vec3 acceleration{0.0f, -9.81f, 0.0f};
+    // fraction of the velocity lost per second
+    float drag = 0.0f;
+
+    glm::vec4 colorStart{1.0f};
+    glm::vec4 colorEnd{1.0f, 1.0f, 1.0f, 0.0f};
+
+    float sizeStart = 0.1f;
+    float sizeEnd = 0.0f;
+
+    ParticleBlendMode blendMode = ParticleBlendMode::Alpha;
+
+    // seconds
+    float lifetime = 1.0f;
+    float lifetimeSpread = 0.0f;
+
+    // particles per second
+    float rate = 0.0f;
+};
@@ -12,51 +12,36 @@ ParticleInstanceDescriptorManager::ParticleInstanceDescriptorManager(
     maxParticles(maxParticlesPerFrame)
 {
     VkDeviceSize bufferSize = sizeof(ParticleData) * maxParticles;
+    VkDeviceSize orderSize = sizeof(ParticleSortKey) * maxParticles;
 
     buffers.resize(maxFramesInFlight);
     memoryInfo.resize(maxFramesInFlight);
     mapped.resize(maxFramesInFlight);
+    orderBuffers.resize(maxFramesInFlight);
+    orderMemoryInfo.resize(maxFramesInFlight);
+    orderMapped.resize(maxFramesInFlight);
 
     for (uint32_t i = 0; i < maxFramesInFlight; i++)
     {
-        bufferManager->createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-            buffers[i]
-        );
-
-        BufferManager::AllocatedMemoryINFO info;
-        bufferManager->allocateBufferMemory(
-            buffers[i],
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            memoryInfo[i]
-        );
-
-        vkBindBufferMemory(device, buffers[i], memoryInfo[i].memory, 0);
-
-        vkMapMemory(
-            device,
-            memoryInfo[i].memory,
-            0,
-            bufferSize,
-            0,
-            &mapped[i]
-        );
+        createMappedBuffer(bufferManager, bufferSize, buffers[i], memoryInfo[i], mapped[i]);
+        createMappedBuffer(bufferManager, orderSize, orderBuffers[i], orderMemoryInfo[i], orderMapped[i]);
     }
 
-    // Descriptor Set Layout
-    VkDescriptorSetLayoutBinding binding{};
-    binding.binding = 0;
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    binding.descriptorCount = 1;
-    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    binding.pImmutableSamplers = nullptr;
+    // Descriptor Set Layout: 0 particles, 1 draw order
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
 
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &binding;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
 
     if (vkCreateDescriptorSetLayout(
             device,
@@ -70,7 +55,7 @@ ParticleInstanceDescriptorManager::ParticleInstanceDescriptorManager(
     // Descriptor Pool
     VkDescriptorPoolSize poolSize{};
     poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    poolSize.descriptorCount = maxFramesInFlight;
+    poolSize.descriptorCount = 2 * maxFramesInFlight;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -112,20 +97,23 @@ ParticleInstanceDescriptorManager::ParticleInstanceDescriptorManager(
     // Update descriptor sets
     for (uint32_t i = 0; i < maxFramesInFlight; i++)
     {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = buffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = bufferSize;
-
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = descriptorSets[i];
-        write.dstBinding = 0;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        write.descriptorCount = 1;
-        write.pBufferInfo = &bufferInfo;
-
-        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        VkDescriptorBufferInfo bufferInfos[2] = {
+            {buffers[i], 0, bufferSize},
+            {orderBuffers[i], 0, orderSize}
+        };
+
+        VkWriteDescriptorSet writes[2]{};
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = descriptorSets[i];
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[binding].descriptorCount = 1;
+            writes[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
     }
 }
 
@@ -138,31 +126,89 @@ void ParticleInstanceDescriptorManager::update(
     if (baseParticle + particles.size() > maxParticles)
         throw std::runtime_error("Particle buffer overflow");
 
-    VkDeviceSize offset = baseParticle * sizeof(ParticleData);
-    VkDeviceSize size   = particles.size() * sizeof(ParticleData);
-
     std::memcpy(
-        static_cast<char*>(mapped[frameIndex]) + offset,
+        getMapped(frameIndex) + baseParticle,
         particles.data(),
-        size
+        particles.size() * sizeof(ParticleData)
     );
 
-    if (!memoryInfo[frameIndex].isCoherent)
-    {
-        VkDeviceSize atomSize = nonCoherentAtomSize;
+    flush(frameIndex, baseParticle, static_cast<uint32_t>(particles.size()));
+}
 
-        VkDeviceSize alignedOffset = offset & ~(atomSize - 1);
-        VkDeviceSize alignedSize =
-            ((offset + size + atomSize - 1) & ~(atomSize - 1)) - alignedOffset;
+void ParticleInstanceDescriptorManager::flush(
+    uint32_t frameIndex,
+    uint32_t baseParticle,
+    uint32_t count
+)
+{
+    if (count > 0)
+        flushRange(memoryInfo[frameIndex], baseParticle * sizeof(ParticleData), count * sizeof(ParticleData));
+}
 
-        VkMappedMemoryRange range{};
-        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range.memory = memoryInfo[frameIndex].memory;
-        range.offset = alignedOffset;
-        range.size   = alignedSize;
+void ParticleInstanceDescriptorManager::flushOrder(
+    uint32_t frameIndex,
+    uint32_t count
+)
+{
+    if (count > 0)
+        flushRange(orderMemoryInfo[frameIndex], 0, count * sizeof(ParticleSortKey));
+}
 
-        vkFlushMappedMemoryRanges(device, 1, &range);
-    }
+void ParticleInstanceDescriptorManager::createMappedBuffer(
+    BufferManager* bufferManager,
+    VkDeviceSize size,
+    VkBuffer& buffer,
+    BufferManager::AllocatedMemoryINFO& memory,
+    void*& data
+)
+{
+    bufferManager->createBuffer(
+        size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        buffer
+    );
+
+    bufferManager->allocateBufferMemory(
+        buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        memory
+    );
+
+    vkBindBufferMemory(device, buffer, memory.memory, 0);
+
+    vkMapMemory(
+        device,
+        memory.memory,
+        0,
+        size,
+        0,
+        &data
+    );
+}
+
+void ParticleInstanceDescriptorManager::flushRange(
+    const BufferManager::AllocatedMemoryINFO& memory,
+    VkDeviceSize offset,
+    VkDeviceSize size
+)
+{
+    if (memory.isCoherent)
+        return;
+
+    VkDeviceSize atomSize = nonCoherentAtomSize;
+
+    VkDeviceSize alignedOffset = offset & ~(atomSize - 1);
+    VkDeviceSize alignedSize =
+        ((offset + size + atomSize - 1) & ~(atomSize - 1)) - alignedOffset;
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = memory.memory;
+    range.offset = alignedOffset;
+    range.size   = alignedSize;
+
+    vkFlushMappedMemoryRanges(device, 1, &range);
 }
 
 ParticleInstanceDescriptorManager::~ParticleInstanceDescriptorManager()
@@ -177,6 +223,15 @@ ParticleInstanceDescriptorManager::~ParticleInstanceDescriptorManager()
 
         if (memoryInfo[i].memory)
             vkFreeMemory(device, memoryInfo[i].memory, nullptr);
+
+        if (orderMapped[i])
+            vkUnmapMemory(device, orderMemoryInfo[i].memory);
+
+        if (orderBuffers[i])
+            vkDestroyBuffer(device, orderBuffers[i], nullptr);
+
+        if (orderMemoryInfo[i].memory)
+            vkFreeMemory(device, orderMemoryInfo[i].memory, nullptr);
     }
 
     if (descriptorPool)
@@ -4,6 +4,14 @@
 #include "../BufferManager.hpp"
 #include "ParticleData.hpp"
 
+/**
+ * @brief Per-frame particle buffers of set 1 of the Particle pipeline layout.
+ *
+ * Binding 0 holds the particles (ParticleData), binding 1 the order they are
+ * drawn in (ParticleSortKey). Both are host-visible and written by the CPU.
+ * getLayout() is also the layout GpuParticleSystem allocates its own set 1
+ * from, pointing at its device-local buffers.
+ */
 class ParticleInstanceDescriptorManager {
 private:
     VkDevice device;
@@ -16,9 +24,27 @@ private:
     std::vector<BufferManager::AllocatedMemoryINFO> memoryInfo;
     std::vector<void*> mapped;
 
+    std::vector<VkBuffer> orderBuffers;
+    std::vector<BufferManager::AllocatedMemoryINFO> orderMemoryInfo;
+    std::vector<void*> orderMapped;
+
     VkDescriptorPool descriptorPool{};
     VkDescriptorSetLayout descriptorSetLayout{};
     std::vector<VkDescriptorSet> descriptorSets;
+
+    void createMappedBuffer(
+        BufferManager* bufferManager,
+        VkDeviceSize size,
+        VkBuffer& buffer,
+        BufferManager::AllocatedMemoryINFO& memory,
+        void*& data
+    );
+
+    void flushRange(
+        const BufferManager::AllocatedMemoryINFO& memory,
+        VkDeviceSize offset,
+        VkDeviceSize size
+    );
 public:
     ParticleInstanceDescriptorManager(
         VkDevice device,
@@ -36,6 +62,47 @@ public:
         const std::vector<ParticleData>& particles
     );
 
+    /**
+     * @brief Mapped buffer of a frame, for writers that fill it in place.
+     *
+     * Call flush for the written range afterwards.
+     */
+    ParticleData* getMapped(
+        uint32_t frameIndex
+    ) const {
+        return static_cast<ParticleData*>(mapped[frameIndex]);
+    }
+
+    /**
+     * @brief Makes particles written through getMapped visible to the GPU.
+     *
+     * No-op on host-coherent memory.
+     */
+    void flush(
+        uint32_t frameIndex,
+        uint32_t baseParticle,
+        uint32_t count
+    );
+
+    /**
+     * @brief Mapped draw order of a frame, call flushOrder for the written entries.
+     */
+    ParticleSortKey* getMappedOrder(
+        uint32_t frameIndex
+    ) const {
+        return static_cast<ParticleSortKey*>(orderMapped[frameIndex]);
+    }
+
+    /**
+     * @brief Makes the first count draw order entries visible to the GPU.
+     */
+    void flushOrder(
+        uint32_t frameIndex,
+        uint32_t count
+    );
+
+    uint32_t getMaxParticles() const { return maxParticles; }
+
     const std::vector<VkDescriptorSet>& getDescriptorSets() const {
         return descriptorSets;
     }
@@ -0,0 +1,97 @@
+#include "ParticleKernels.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+uint32_t ParticleKernels::simulateScalar(
+    const ParticleSoA& p,
+    uint32_t begin,
+    uint32_t end,
+    const ParticleStep& step
+) {
+    const float dt = step.deltaTime;
+
+    uint32_t write = begin;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        float age = p.age[i] + dt;
+        if (age * p.invLifetime[i] >= 1.0f)
+            continue;
+
+        float vx = (p.velocityX[i] + step.acceleration.x * dt) * step.damping;
+        float vy = (p.velocityY[i] + step.acceleration.y * dt) * step.damping;
+        float vz = (p.velocityZ[i] + step.acceleration.z * dt) * step.damping;
+
+        p.positionX[write] = p.positionX[i] + vx * dt;
+        p.positionY[write] = p.positionY[i] + vy * dt;
+        p.positionZ[write] = p.positionZ[i] + vz * dt;
+        p.velocityX[write] = vx;
+        p.velocityY[write] = vy;
+        p.velocityZ[write] = vz;
+        p.age[write] = age;
+        p.invLifetime[write] = p.invLifetime[i];
+        write++;
+    }
+
+    return write - begin;
+}
+
+void ParticleKernels::writeScalar(
+    const ParticleSoA& p,
+    uint32_t begin,
+    uint32_t count,
+    const ParticleStep& step,
+    ParticleData* out
+) {
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t j = begin + i;
+        float t = p.age[j] * p.invLifetime[j];
+
+        out[i].positionSize = glm::vec4(
+            p.positionX[j],
+            p.positionY[j],
+            p.positionZ[j],
+            step.sizeStart + step.sizeDelta * t
+        );
+        out[i].color = step.colorStart + step.colorDelta * t;
+    }
+}
+
+bool ParticleKernels::cpuHasAvx2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    // the OS must save the YMM registers too
+    bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (!osAvx)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool ParticleKernels::select(
+    bool allowSimd,
+    SimulateFn& simulate,
+    WriteFn& write
+) {
+    if (allowSimd && cpuHasAvx2())
+    {
+        simulate = simulateAvx2;
+        write = writeAvx2;
+        return true;
+    }
+
+    simulate = simulateScalar;
+    write = writeScalar;
+    return false;
+}
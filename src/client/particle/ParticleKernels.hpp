@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "ParticleData.hpp"
+
+/**
+ * @brief Structure-of-arrays view of a CPU particle pool.
+ *
+ * Every array holds at least the pool size rounded up to a multiple of
+ * eight, the kernels read and write whole groups of eight.
+ */
+struct ParticleSoA {
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* velocityX;
+    float* velocityY;
+    float* velocityZ;
+    float* age;
+    float* invLifetime;
+};
+
+/**
+ * @brief One simulation step of an emitter's particles.
+ */
+struct ParticleStep {
+    float deltaTime;
+    // velocity scale of this step, 1 - drag * deltaTime clamped to 0
+    float damping;
+    glm::vec3 acceleration;
+    glm::vec4 colorStart;
+    glm::vec4 colorDelta;
+    float sizeStart;
+    float sizeDelta;
+};
+
+/**
+ * @brief Particle integration and output kernels, scalar and AVX2.
+ *
+ * The AVX2 variants live in their own translation unit built with AVX2
+ * code generation; select() picks them only when the running CPU has
+ * AVX2, so the rest of the client stays baseline x86-64.
+ */
+namespace ParticleKernels
+{
+    /**
+     * @brief Ages and moves particles [begin, end) and compacts the survivors in place.
+     *
+     * @return Number of survivors, now stored from begin on.
+     */
+    using SimulateFn = uint32_t (*)(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t end,
+        const ParticleStep& step
+    );
+
+    /**
+     * @brief Writes count particles from begin as ParticleData, with faded color and size.
+     */
+    using WriteFn = void (*)(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t count,
+        const ParticleStep& step,
+        ParticleData* out
+    );
+
+    uint32_t simulateScalar(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t end,
+        const ParticleStep& step
+    );
+
+    void writeScalar(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t count,
+        const ParticleStep& step,
+        ParticleData* out
+    );
+
+    // fall back to the scalar kernels when not built for x86
+    uint32_t simulateAvx2(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t end,
+        const ParticleStep& step
+    );
+
+    void writeAvx2(
+        const ParticleSoA& particles,
+        uint32_t begin,
+        uint32_t count,
+        const ParticleStep& step,
+        ParticleData* out
+    );
+
+    bool cpuHasAvx2();
+
+    /**
+     * @brief Fastest kernels the CPU supports, scalar if allowSimd is false.
+     *
+     * @return true if the AVX2 kernels were selected.
+     */
+    bool select(
+        bool allowSimd,
+        SimulateFn& simulate,
+        WriteFn& write
+    );
+}
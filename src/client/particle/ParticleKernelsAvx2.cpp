@@ -0,0 +1,212 @@
+// Built with AVX2 code generation, see CMakeLists.txt. Only called after
+// ParticleKernels::cpuHasAvx2, nothing here may run on other CPUs.
+#include "ParticleKernels.hpp"
+
+#if defined(__AVX2__)
+
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+    // lane indices that move the set lanes of a mask to the front
+    struct LeftPackTable {
+        alignas(32) std::array<std::array<int32_t, 8>, 256> lanes;
+
+        LeftPackTable()
+        {
+            for (uint32_t mask = 0; mask < 256; mask++)
+            {
+                uint32_t next = 0;
+                for (int32_t lane = 0; lane < 8; lane++)
+                {
+                    if (mask & (1u << lane))
+                        lanes[mask][next++] = lane;
+                }
+                while (next < 8)
+                    lanes[mask][next++] = 0;
+            }
+        }
+    };
+
+    // built on first use: static initialization would run AVX2 code on any CPU
+    const LeftPackTable& leftPack()
+    {
+        static const LeftPackTable table;
+        return table;
+    }
+
+    inline void storePacked(
+        float* dst,
+        __m256 value,
+        __m256i permutation
+    ) {
+        _mm256_storeu_ps(dst, _mm256_permutevar8x32_ps(value, permutation));
+    }
+
+    // rows of 8 attributes for 8 particles become 8 particles of 8 attributes
+    inline void transpose8(
+        __m256 rows[8]
+    ) {
+        __m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+        __m256 t1 = _mm256_unpackhi_ps(rows[0], rows[1]);
+        __m256 t2 = _mm256_unpacklo_ps(rows[2], rows[3]);
+        __m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+        __m256 t4 = _mm256_unpacklo_ps(rows[4], rows[5]);
+        __m256 t5 = _mm256_unpackhi_ps(rows[4], rows[5]);
+        __m256 t6 = _mm256_unpacklo_ps(rows[6], rows[7]);
+        __m256 t7 = _mm256_unpackhi_ps(rows[6], rows[7]);
+
+        __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        rows[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        rows[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        rows[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        rows[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        rows[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        rows[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        rows[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        rows[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
+}
+
+uint32_t ParticleKernels::simulateAvx2(
+    const ParticleSoA& p,
+    uint32_t begin,
+    uint32_t end,
+    const ParticleStep& step
+) {
+    const __m256 dt = _mm256_set1_ps(step.deltaTime);
+    const __m256 damping = _mm256_set1_ps(step.damping);
+    const __m256 ax = _mm256_set1_ps(step.acceleration.x * step.deltaTime);
+    const __m256 ay = _mm256_set1_ps(step.acceleration.y * step.deltaTime);
+    const __m256 az = _mm256_set1_ps(step.acceleration.z * step.deltaTime);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i endIndex = _mm256_set1_epi32(static_cast<int32_t>(end));
+    const LeftPackTable& table = leftPack();
+
+    uint32_t write = begin;
+    for (uint32_t i = begin; i < end; i += 8)
+    {
+        __m256 age = _mm256_add_ps(_mm256_loadu_ps(p.age + i), dt);
+        __m256 invLifetime = _mm256_loadu_ps(p.invLifetime + i);
+
+        // alive while age < lifetime, lanes past end hold padding
+        __m256 alive = _mm256_cmp_ps(_mm256_mul_ps(age, invLifetime), one, _CMP_LT_OQ);
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(i)), laneIndex);
+        alive = _mm256_and_ps(alive, _mm256_castsi256_ps(_mm256_cmpgt_epi32(endIndex, index)));
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(alive));
+        if (mask == 0)
+            continue;
+
+        __m256 vx = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(p.velocityX + i), ax), damping);
+        __m256 vy = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(p.velocityY + i), ay), damping);
+        __m256 vz = _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(p.velocityZ + i), az), damping);
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(p.positionX + i), _mm256_mul_ps(vx, dt));
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(p.positionY + i), _mm256_mul_ps(vy, dt));
+        __m256 pz = _mm256_add_ps(_mm256_loadu_ps(p.positionZ + i), _mm256_mul_ps(vz, dt));
+
+        // survivors to the front; the 8-wide store only overwrites lanes
+        // at or before i + 7, which were all loaded already
+        __m256i permutation = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.lanes[mask].data()));
+        storePacked(p.positionX + write, px, permutation);
+        storePacked(p.positionY + write, py, permutation);
+        storePacked(p.positionZ + write, pz, permutation);
+        storePacked(p.velocityX + write, vx, permutation);
+        storePacked(p.velocityY + write, vy, permutation);
+        storePacked(p.velocityZ + write, vz, permutation);
+        storePacked(p.age + write, age, permutation);
+        storePacked(p.invLifetime + write, invLifetime, permutation);
+
+        write += static_cast<uint32_t>(std::bitset<8>(mask).count());
+    }
+
+    return write - begin;
+}
+
+void ParticleKernels::writeAvx2(
+    const ParticleSoA& p,
+    uint32_t begin,
+    uint32_t count,
+    const ParticleStep& step,
+    ParticleData* out
+) {
+    static_assert(sizeof(ParticleData) == 8 * sizeof(float), "one particle per transposed row");
+
+    const __m256 sizeStart = _mm256_set1_ps(step.sizeStart);
+    const __m256 sizeDelta = _mm256_set1_ps(step.sizeDelta);
+    const __m256 colorStart[4] = {
+        _mm256_set1_ps(step.colorStart.r), _mm256_set1_ps(step.colorStart.g),
+        _mm256_set1_ps(step.colorStart.b), _mm256_set1_ps(step.colorStart.a)
+    };
+    const __m256 colorDelta[4] = {
+        _mm256_set1_ps(step.colorDelta.r), _mm256_set1_ps(step.colorDelta.g),
+        _mm256_set1_ps(step.colorDelta.b), _mm256_set1_ps(step.colorDelta.a)
+    };
+
+    for (uint32_t i = 0; i < count; i += 8)
+    {
+        uint32_t j = begin + i;
+        __m256 t = _mm256_mul_ps(_mm256_loadu_ps(p.age + j), _mm256_loadu_ps(p.invLifetime + j));
+
+        __m256 rows[8] = {
+            _mm256_loadu_ps(p.positionX + j),
+            _mm256_loadu_ps(p.positionY + j),
+            _mm256_loadu_ps(p.positionZ + j),
+            _mm256_add_ps(sizeStart, _mm256_mul_ps(sizeDelta, t)),
+            _mm256_add_ps(colorStart[0], _mm256_mul_ps(colorDelta[0], t)),
+            _mm256_add_ps(colorStart[1], _mm256_mul_ps(colorDelta[1], t)),
+            _mm256_add_ps(colorStart[2], _mm256_mul_ps(colorDelta[2], t)),
+            _mm256_add_ps(colorStart[3], _mm256_mul_ps(colorDelta[3], t))
+        };
+        transpose8(rows);
+
+        float* dst = reinterpret_cast<float*>(out + i);
+        if (count - i >= 8)
+        {
+            for (uint32_t k = 0; k < 8; k++)
+                _mm256_storeu_ps(dst + k * 8, rows[k]);
+        }
+        else
+        {
+            // the output ends here, never write past it
+            alignas(32) float tail[8 * 8];
+            for (uint32_t k = 0; k < 8; k++)
+                _mm256_store_ps(tail + k * 8, rows[k]);
+            std::memcpy(dst, tail, (count - i) * sizeof(ParticleData));
+        }
+    }
+}
+
+#else
+
+uint32_t ParticleKernels::simulateAvx2(
+    const ParticleSoA& particles,
+    uint32_t begin,
+    uint32_t end,
+    const ParticleStep& step
+) {
+    return simulateScalar(particles, begin, end, step);
+}
+
+void ParticleKernels::writeAvx2(
+    const ParticleSoA& particles,
+    uint32_t begin,
+    uint32_t count,
+    const ParticleStep& step,
+    ParticleData* out
+) {
+    writeScalar(particles, begin, count, step, out);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "ParticleSystem.hpp"
+
+#include <stdexcept>
+
+uint32_t ParticleSystem::takeSpawnCount(
+    EmitterState& state,
+    float deltaTime
+) {
+    state.pending += state.emitter.rate * deltaTime;
+
+    uint32_t whole = static_cast<uint32_t>(state.pending);
+    state.pending -= static_cast<float>(whole);
+
+    uint32_t spawnCount = whole + state.burst;
+    state.burst = 0;
+    return spawnCount;
+}
+
+glm::vec4 ParticleSystem::toBlendSpace(
+    const glm::vec4& color,
+    ParticleBlendMode blendMode
+) {
+    switch (blendMode)
+    {
+        case ParticleBlendMode::Alpha:
+            return glm::vec4(glm::vec3(color) * color.a, color.a);
+        case ParticleBlendMode::Additive:
+            // nothing behind is hidden, the color is only added
+            return glm::vec4(glm::vec3(color) * color.a, 0.0f);
+        case ParticleBlendMode::Premultiplied:
+            break;
+    }
+
+    return color;
+}
+
+uint32_t ParticleSystem::addEmitter(
+    const ParticleEmitter& emitter
+) {
+    uint32_t id = nextEmitterId++;
+    emitters[id].emitter = emitter;
+    return id;
+}
+
+void ParticleSystem::setEmitter(
+    uint32_t id,
+    const ParticleEmitter& emitter
+) {
+    auto it = emitters.find(id);
+    if (it == emitters.end())
+        throw std::runtime_error("unknown particle emitter");
+
+    it->second.emitter = emitter;
+}
+
+void ParticleSystem::removeEmitter(
+    uint32_t id
+) {
+    emitters.erase(id);
+}
+
+void ParticleSystem::burst(
+    uint32_t id,
+    uint32_t count
+) {
+    auto it = emitters.find(id);
+    if (it != emitters.end())
+        it->second.burst += count;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "../CoreVulkan.hpp"
+#include "ParticleEmitter.hpp"
+
+/**
+ * @brief Emitters and the per-frame interface shared by the particle backends.
+ *
+ * GpuParticleSystem simulates on compute shaders, CpuParticleSystem on the
+ * JobSystem workers for platforms or modes where compute is undesirable.
+ * Both take the same emitters and draw camera-facing quads with the
+ * Particles pipeline, back to front through a per-frame sorted draw order.
+ */
+class ParticleSystem
+{
+protected:
+    struct EmitterState {
+        ParticleEmitter emitter;
+        // fraction of a particle carried to the next frame
+        float pending = 0.0f;
+        uint32_t burst = 0;
+    };
+
+    std::unordered_map<uint32_t, EmitterState> emitters;
+    uint32_t nextEmitterId = 1;
+
+    /**
+     * @brief Particles an emitter spawns this frame, bursts included.
+     */
+    static uint32_t takeSpawnCount(
+        EmitterState& state,
+        float deltaTime
+    );
+
+    /**
+     * @brief Premultiplied color the Particles pipeline blends as the given mode.
+     */
+    static glm::vec4 toBlendSpace(
+        const glm::vec4& color,
+        ParticleBlendMode blendMode
+    );
+
+public:
+    struct Stats {
+        const char* backend = "";
+        size_t emitters = 0;
+        // not read back from the GPU, 0 there
+        uint32_t alive = 0;
+        // CPU simulation and upload time, smoothed
+        double simulateMs = 0.0;
+    };
+
+    virtual ~ParticleSystem() = default;
+
+    /**
+     * @brief Starts an emitter, returns its id.
+     */
+    uint32_t addEmitter(
+        const ParticleEmitter& emitter
+    );
+
+    /**
+     * @brief Replaces the parameters of an emitter.
+     *
+     * @throws std::runtime_error if the id is unknown.
+     */
+    void setEmitter(
+        uint32_t id,
+        const ParticleEmitter& emitter
+    );
+
+    /**
+     * @brief Stops an emitter, its particles live out their lifetime.
+     */
+    void removeEmitter(
+        uint32_t id
+    );
+
+    /**
+     * @brief Spawns count extra particles from an emitter next frame.
+     */
+    void burst(
+        uint32_t id,
+        uint32_t count
+    );
+
+    /**
+     * @brief Advances the emitters of this frame.
+     *
+     * Call once per frame after waiting for the frame fence.
+     *
+     * @param view Camera view matrix of the frame, particles are sorted by its depth.
+     */
+    virtual void update(
+        uint32_t currentFrame,
+        float deltaTime,
+        const glm::mat4& view
+    ) = 0;
+
+    /**
+     * @brief Records work needed before the render pass, outside of it.
+     */
+    virtual void recordSimulation(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame
+    ) = 0;
+
+    /**
+     * @brief Draws every live particle, farthest first.
+     *
+     * Expects the Particles pipeline, the global set (set 0) and the depth
+     * input set (set 2) to be bound.
+     */
+    virtual void recordDraw(
+        VkCommandBuffer cmd,
+        VkPipelineLayout particlePipelineLayout,
+        uint32_t currentFrame
+    ) = 0;
+
+    virtual Stats getStats() const = 0;
+
+    size_t getEmitterCount() const { return emitters.size(); }
+};
@@ -97,6 +97,56 @@ void CommandManager::beginRenderPass(
     vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void CommandManager::recordUpscale(
+    VkCommandBuffer cmd,
+    VkImage sceneImage,
+    VkImage swapchainImage,
+    VkExtent2D renderExtent,
+    VkExtent2D extent,
+    VkFilter filter
+) {
+    // the acquire semaphore is waited at the transfer stage, the old contents are dropped
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = swapchainImage;
+    imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &imageBarrier
+    );
+
+    VkImageBlit blit{};
+    blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    blit.srcOffsets[0] = {0, 0, 0};
+    blit.srcOffsets[1] = {static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1};
+    blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    blit.dstOffsets[0] = {0, 0, 0};
+    blit.dstOffsets[1] = {static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1};
+
+    vkCmdBlitImage(
+        cmd,
+        sceneImage,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        swapchainImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &blit,
+        filter
+    );
+}
+
 void CommandManager::setViewportAndScissor(
     VkCommandBuffer cmd,
     GraphicsPipeline* graphicsPipeline,
@@ -122,49 +172,27 @@ void CommandManager::setViewportAndScissor(
     vkCmdSetScissor(cmd, 0, 1, &scissor);
 }
 
-void CommandManager::recordCommandBuffer(
-    uint32_t imageIndex,
+void CommandManager::recordMeshes(
+    VkCommandBuffer cmd,
     uint32_t currentFrame,
-    VkRenderPass renderPass,
     GraphicsPipeline* graphicsPipeline,
-    const std::vector<VkFramebuffer>& framebuffers,
-    VkExtent2D extent,
     GlobalDescriptorManager* globalDescriptorManager,
     InstanceDescriptorManager* instanceDescriptorManager,
-    ParticleInstanceDescriptorManager* particleInstanceDescriptorManager,
+    BindlessTextureManager* bindlessTextureManager,
+    MaterialParameterBuffer* materialParameterBuffer,
     RenderBatchManager* renderBatchManager,
-    const std::vector<IClearValueProvider*>& clearProviders,
+    OcclusionCuller* occlusionCuller,
+    OcclusionCuller::Phase phase,
+    MeshPass pass,
     const std::vector<IViewportProvider*>& viewportProviders,
-    const std::vector<IScissorProvider*>& scissorProviders,
-    const std::vector<ICommandBufferRecorder*>& extraRecorders
+    const std::vector<IScissorProvider*>& scissorProviders
 ) {
-#ifndef NDEBUG
-    assert(imageIndex < commandBuffers.size());
-    assert(imageIndex < framebuffers.size());
-#endif
-
-    VkCommandBuffer cmd = commandBuffers[imageIndex];
-    beginCommandBuffer(cmd);
-
-    std::vector<VkClearValue> clearValues;
-    buildClearValues(
-        clearProviders,
-        clearValues
-    );
-
-    beginRenderPass(
-        cmd,
-        renderPass,
-        framebuffers[imageIndex],
-        extent,
-        clearValues
-    );
-
     // Bind pipeline
+    VkPipeline boundPipeline = graphicsPipeline->getPipeline(GraphicsPipeline::PipelineType::Triangles_NoCull);
     vkCmdBindPipeline(
         cmd,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
-        graphicsPipeline->getPipeline(GraphicsPipeline::PipelineType::Triangles_NoCull)
+        boundPipeline
     );
 
     setViewportAndScissor(
@@ -177,26 +205,198 @@ void CommandManager::recordCommandBuffer(
     // browse batches
     VkPipelineLayout layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::Mesh);
     VkDescriptorSet globalSet = globalDescriptorManager->getDescriptorSets()[currentFrame];
-    VkDescriptorSet instanceSet = instanceDescriptorManager->getDescriptorSets()[currentFrame];
+    // with culling the vertex shaders read the instances that passed it
+    VkDescriptorSet instanceSet = occlusionCuller
+        ? occlusionCuller->getInstanceSet(currentFrame)
+        : instanceDescriptorManager->getDescriptorSets()[currentFrame];
+    VkDescriptorSet paramsSet = materialParameterBuffer->getDescriptorSets()[currentFrame];
+
+    // Bind descriptor sets 2 (instances) & 3 (material params), batches address them through the instance data
+    VkDescriptorSet frameSets[] = {
+        instanceSet,
+        paramsSet
+    };
+
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        layout,
+        2, // set index
+        2,
+        frameSets,
+        0,
+        nullptr
+    );
+
+    // Bindless: sets 0 & 1 are bound once, the material comes from the instance data
+    if (bindlessTextureManager)
+    {
+        VkDescriptorSet descriptorSets[] = {
+            globalSet,
+            bindlessTextureManager->getDescriptorSet()
+        };
+
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            layout,
+            0,
+            2,
+            descriptorSets,
+            0,
+            nullptr
+        );
+    }
+    else if (pass == MeshPass::DepthPrepass)
+    {
+        // no material sets in the pre-pass, set 0 is bound once
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            layout,
+            0,
+            1,
+            &globalSet,
+            0,
+            nullptr
+        );
+    }
+
     Mesh* lastMesh = nullptr;
     Material* lastMaterial = nullptr;
+    const MaterialDesc::PipelineKey* lastPipelineKey = nullptr;
+    size_t lastPipelineHash = 0;
     uint32_t currentOffset = 0;
+    // the late phase and the walk after the pre-pass draw what the first walk uploaded, in the same order
+    bool upload =
+        (!occlusionCuller || phase == OcclusionCuller::Phase::Early) &&
+        pass != MeshPass::AfterDepthPrepass;
+    uint32_t drawIndex = 0;
+    // batches of the current pipeline are left to the main walk
+    bool skipDraw = false;
+
+    // consecutive batches drawing the same mesh LOD are merged into one draw
+    const Mesh* pendingMesh = nullptr;
+    const Mesh::Lod* pendingLod = nullptr;
+    uint32_t pendingFirstInstance = 0;
+    uint32_t pendingInstanceCount = 0;
+
+    auto flushDraw = [&]()
+    {
+        if (pendingInstanceCount == 0)
+            return;
+
+        if (occlusionCuller)
+        {
+            // instance count decided by the cull of this phase
+            if (upload)
+            {
+                occlusionCuller->addDraw(
+                    currentFrame,
+                    pendingLod->indexCount,
+                    pendingLod->firstIndex,
+                    pendingFirstInstance,
+                    pendingInstanceCount,
+                    pendingMesh->getBoundsCenter(),
+                    pendingMesh->getBoundsRadius()
+                );
+            }
+
+            if (!skipDraw)
+                occlusionCuller->recordDraw(cmd, currentFrame, phase, drawIndex);
+            drawIndex++;
+        }
+        else if (!skipDraw)
+        {
+            // Draw instanciado, selected LOD range of the shared index buffer
+            vkCmdDrawIndexed(
+                cmd,
+                pendingLod->indexCount,
+                pendingInstanceCount,
+                pendingLod->firstIndex,
+                0,
+                pendingFirstInstance
+            );
+        }
+
+        pendingInstanceCount = 0;
+    };
+
     renderBatchManager->forEachBatch(
         [&](const RenderBatchManager::RenderBatch& batch)
         {
             const RenderBatchManager::BatchKey& key = batch.getKey();
-            const std::shared_ptr<Mesh>&  mesh = key.mesh;
-            const std::shared_ptr<Material>& material = key.material;
+            Mesh* mesh = batch.getDrawMesh();
+            Material* material = batch.getDrawMaterial();
             const std::vector<InstanceData>& instancesData = batch.getinstancesData();
+            const Mesh::Lod& lod = mesh->getLod(key.lod);
 
             uint32_t instanceCount = static_cast<uint32_t>(instancesData.size());
+            const MaterialDesc::PipelineKey& pipelineKey = material->getPipelineKey();
+            bool samePipeline =
+                lastPipelineKey &&
+                material->getPipelineHash() == lastPipelineHash &&
+                pipelineKey == *lastPipelineKey;
+
+            // anything other than more instances of the pending draw ends it
+            bool merge =
+                bindlessTextureManager &&
+                samePipeline &&
+                mesh == lastMesh &&
+                pendingLod &&
+                pendingLod->firstIndex == lod.firstIndex &&
+                pendingLod->indexCount == lod.indexCount;
+
+            if (!merge)
+                flushDraw();
+
+            // Bind material pipeline, batches are sorted by it so switches are rare.
+            // Keys differing only by dynamic state share a pipeline and just reset that state.
+            if (!samePipeline)
+            {
+                lastPipelineKey = &pipelineKey;
+                lastPipelineHash = material->getPipelineHash();
+
+                // the pre-pass lays down the depth of the materials that allow it, the main walk tests it for EQUAL
+                MaterialDesc::PipelineKey passKey = pipelineKey;
+                skipDraw = false;
+                if (pass != MeshPass::Color && GraphicsPipeline::usesDepthPrepass(pipelineKey))
+                {
+                    passKey = pass == MeshPass::DepthPrepass
+                        ? GraphicsPipeline::depthPrepassKey(pipelineKey)
+                        : GraphicsPipeline::afterDepthPrepassKey(pipelineKey);
+                }
+                else if (pass == MeshPass::DepthPrepass)
+                {
+                    skipDraw = true;
+                }
+
+                if (!skipDraw)
+                {
+                    VkPipeline pipeline = graphicsPipeline->getVariant(passKey);
+                    if (pipeline != boundPipeline)
+                    {
+                        boundPipeline = pipeline;
+                        vkCmdBindPipeline(
+                            cmd,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipeline
+                        );
+                    }
+
+                    graphicsPipeline->setDynamicState(cmd, passKey.state);
+                }
+            }
 
             // Bind mesh
-            if (mesh.get() != lastMesh)
+            if (mesh != lastMesh)
             {
-                lastMesh = mesh.get();
+                lastMesh = mesh;
 
-                VkBuffer vertexBuffer = mesh->getVertexBuffer();
+                // the pre-pass pipelines read the position stream only
+                VkBuffer vertexBuffer = pass == MeshPass::DepthPrepass
+                    ? mesh->getPositionBuffer()
+                    : mesh->getVertexBuffer();
                 VkDeviceSize offsets[] = { 0 };
                 vkCmdBindVertexBuffers(
                     cmd,
@@ -215,9 +415,9 @@ void CommandManager::recordCommandBuffer(
             }
 
             // Bind descriptor sets (set 0 & 1)
-            if (material.get() != lastMaterial)
+            if (!bindlessTextureManager && pass != MeshPass::DepthPrepass && material != lastMaterial)
             {
-                lastMaterial = material.get();
+                lastMaterial = material;
                 VkDescriptorSet descriptorSets[] = {
                     globalSet,
                     material->getDescriptorSet()
@@ -235,48 +435,186 @@ void CommandManager::recordCommandBuffer(
                 );
             }
 
-            // Update storage buffer of the current frame.
-            instanceDescriptorManager->update(
-                currentFrame,
-                currentOffset,
-                instancesData
-            );
+            // Update storage buffer of the current frame, contiguous with the pending draw.
+            if (upload)
+            {
+                instanceDescriptorManager->update(
+                    currentFrame,
+                    currentOffset,
+                    instancesData
+                );
+            }
 
-            // Bind descriptor set 2 (instances)
-            vkCmdBindDescriptorSets(
-                cmd,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                layout,
-                2, // set index
-                1,
-                &instanceSet,
-                0,
-                nullptr
-            );
+            if (pendingInstanceCount == 0)
+            {
+                pendingMesh = mesh;
+                pendingLod = &lod;
+                pendingFirstInstance = currentOffset;
+            }
+            pendingInstanceCount += instanceCount;
 
-            // Draw instanciado
-            vkCmdDrawIndexed(
+            currentOffset += instanceCount;
+        }
+    );
+
+    flushDraw();
+}
+
+void CommandManager::recordCommandBuffer(
+    uint32_t imageIndex,
+    uint32_t currentFrame,
+    const RenderPass* renderPass,
+    GraphicsPipeline* graphicsPipeline,
+    const std::vector<VkFramebuffer>& framebuffers,
+    VkFramebuffer sceneFramebuffer,
+    VkImage sceneImage,
+    VkImage swapchainImage,
+    VkExtent2D renderExtent,
+    VkExtent2D extent,
+    VkFilter upscaleFilter,
+    GlobalDescriptorManager* globalDescriptorManager,
+    InstanceDescriptorManager* instanceDescriptorManager,
+    BindlessTextureManager* bindlessTextureManager,
+    MaterialParameterBuffer* materialParameterBuffer,
+    ParticleSystem* particleSystem,
+    DepthInputDescriptorManager* depthInputDescriptorManager,
+    DebugDraw* debugDraw,
+    RenderBatchManager* renderBatchManager,
+    OcclusionCuller* occlusionCuller,
+    ClusteredLighting* clusteredLighting,
+    CascadedShadowMaps* shadowMaps,
+    bool depthPrepass,
+    GpuTimer* gpuTimer,
+    const std::vector<IClearValueProvider*>& clearProviders,
+    const std::vector<IViewportProvider*>& viewportProviders,
+    const std::vector<IScissorProvider*>& scissorProviders,
+    const std::vector<ICommandBufferRecorder*>& extraRecorders
+) {
+#ifndef NDEBUG
+    assert(imageIndex < commandBuffers.size());
+    assert(imageIndex < framebuffers.size());
+#endif
+
+    VkCommandBuffer cmd = commandBuffers[imageIndex];
+    beginCommandBuffer(cmd);
+
+    std::vector<VkClearValue> clearValues;
+    buildClearValues(
+        clearProviders,
+        clearValues
+    );
+
+    gpuTimer->recordReset(cmd, currentFrame);
+    gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Frame));
+
+    // the mesh fragment shaders sample every cascade
+    gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Shadows));
+    shadowMaps->recordShadows(cmd, currentFrame, graphicsPipeline, globalDescriptorManager->getDescriptorSets()[currentFrame]);
+    gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Shadows));
+
+    gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Scene));
+
+    // particles are simulated before the pass that draws them
+    particleSystem->recordSimulation(cmd, currentFrame);
+
+    // the mesh fragment shaders only read the lights of their cluster
+    gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::LightCulling));
+    clusteredLighting->recordCulling(cmd, currentFrame);
+    gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::LightCulling));
+
+    // opaque batches of a cull phase, after their depth-only pass when it is on
+    auto drawOpaque = [&](OcclusionCuller::Phase phase)
+    {
+        auto walk = [&](MeshPass pass)
+        {
+            recordMeshes(
                 cmd,
-                mesh->getIndexCount(),
-                instanceCount,
-                0,
-                0,
-                currentOffset
+                currentFrame,
+                graphicsPipeline,
+                globalDescriptorManager,
+                instanceDescriptorManager,
+                bindlessTextureManager,
+                materialParameterBuffer,
+                renderBatchManager,
+                occlusionCuller,
+                phase,
+                pass,
+                viewportProviders,
+                scissorProviders
             );
+        };
 
-            currentOffset += instanceCount;
+        if (depthPrepass)
+        {
+            gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::DepthPrepass));
+            walk(MeshPass::DepthPrepass);
+            gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::DepthPrepass));
         }
-    );
 
-//* === TEST PARTICLE ===
-    currentOffset = 0;
-    layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::Particle);
+        gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Opaque));
+        walk(depthPrepass ? MeshPass::AfterDepthPrepass : MeshPass::Color);
+        gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Opaque));
+    };
+
+    if (occlusionCuller)
+    {
+        // early phase: what was visible last frame, against the previous pyramid
+        occlusionCuller->recordCull(cmd, currentFrame, OcclusionCuller::Phase::Early);
+
+        beginRenderPass(
+            cmd,
+            renderPass->get(RenderPass::Part::Early),
+            sceneFramebuffer,
+            renderExtent,
+            clearValues
+        );
+
+        drawOpaque(OcclusionCuller::Phase::Early);
+        occlusionCuller->flush(currentFrame);
+
+        // the transparent subpass is empty here, it keeps the parts compatible
+        vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdEndRenderPass(cmd);
+
+        // late phase: re-test the occluded ones against the depth just drawn
+        occlusionCuller->recordPyramid(cmd);
+        occlusionCuller->recordCull(cmd, currentFrame, OcclusionCuller::Phase::Late);
+
+        beginRenderPass(
+            cmd,
+            renderPass->get(RenderPass::Part::Late),
+            sceneFramebuffer,
+            renderExtent,
+            clearValues
+        );
+
+        drawOpaque(OcclusionCuller::Phase::Late);
+    }
+    else
+    {
+        beginRenderPass(
+            cmd,
+            renderPass->get(),
+            sceneFramebuffer,
+            renderExtent,
+            clearValues
+        );
+
+        drawOpaque(OcclusionCuller::Phase::Early);
+    }
+
+//* === PARTICLES ===
+    // transparent subpass, the depth written above is read-only and an input attachment
+    vkCmdNextSubpass(cmd, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkPipelineLayout layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::Particle);
+    VkDescriptorSet globalSet = globalDescriptorManager->getDescriptorSets()[currentFrame];
 
     // Bind particle pipeline
     vkCmdBindPipeline(
         cmd,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
-        graphicsPipeline->getPipeline(GraphicsPipeline::PipelineType::Points)
+        graphicsPipeline->getPipeline(GraphicsPipeline::PipelineType::Particles)
     );
 
     // replicate viewport/scissor
@@ -287,17 +625,6 @@ void CommandManager::recordCommandBuffer(
         scissorProviders
     );
 
-    ParticleData p{};
-    p.positionSize = glm::vec4(0.0f, 1.0f, 0.0f, 60.0f);
-    p.color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
-
-    std::vector<ParticleData> particles { p };
-    particleInstanceDescriptorManager->update(
-        currentFrame,
-        currentOffset,
-        particles
-    );
-
     // set 0 = global UBO
     vkCmdBindDescriptorSets(
         cmd,
@@ -310,21 +637,71 @@ void CommandManager::recordCommandBuffer(
         nullptr
     );
 
-    VkDescriptorSet particleSet = particleInstanceDescriptorManager->getDescriptorSets()[currentFrame];
-
+    // set 2 = scene depth, for the soft fade
+    VkDescriptorSet depthSet = depthInputDescriptorManager->getDescriptorSet();
     vkCmdBindDescriptorSets(
         cmd,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         layout,
+        2,
         1,
+        &depthSet,
+        0,
+        nullptr
+    );
+
+    // set 1 = particles and draw order of this frame
+    particleSystem->recordDraw(cmd, layout, currentFrame);
+
+//* === DEBUG LINES ===
+    layout = graphicsPipeline->getLayout(GraphicsPipeline::LayoutType::DebugLine);
+
+    vkCmdBindPipeline(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        graphicsPipeline->getPipeline(GraphicsPipeline::PipelineType::Lines)
+    );
+
+    // set 0 = global UBO, rebound: the push constant ranges differ
+    vkCmdBindDescriptorSets(
+        cmd,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        layout,
+        0,
         1,
-        &particleSet,
+        &globalSet,
         0,
         nullptr
     );
 
-    // Draw 1 vertex, 1 instance
-    vkCmdDraw(cmd, 1, particles.size(), 0, 0);
+    // set 1 = this frame's slice of the line ring buffer
+    debugDraw->recordDraw(cmd, layout, currentFrame);
+
+    vkCmdEndRenderPass(cmd);
+
+    gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Scene));
+
+//* === UPSCALE ===
+    gpuTimer->begin(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Upscale));
+    recordUpscale(
+        cmd,
+        sceneImage,
+        swapchainImage,
+        renderExtent,
+        extent,
+        upscaleFilter
+    );
+    gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Upscale));
+
+//* === OVERLAY ===
+    // loads the upscaled scene, nothing to clear
+    beginRenderPass(
+        cmd,
+        renderPass->getOverlay(),
+        framebuffers[imageIndex],
+        extent,
+        {}
+    );
 
 //* Extra recorders (ImGui, debug, etc)
     for (auto* r : extraRecorders) {
@@ -333,6 +710,8 @@ void CommandManager::recordCommandBuffer(
 
     vkCmdEndRenderPass(cmd);
 
+    gpuTimer->end(cmd, currentFrame, static_cast<uint32_t>(TimerScope::Frame));
+
     if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
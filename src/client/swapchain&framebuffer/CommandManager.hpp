@@ -3,10 +3,19 @@
 #include <bits/stdc++.h>
 #include "../CoreVulkan.hpp"
 #include "../graphics_pipeline/GraphicsPipeline.hpp"
+#include "../graphics_pipeline/RenderPass.hpp"
 #include "../batch/RenderBatchManager.hpp"
 #include "../batch/instance/InstanceDescriptorManager.hpp"
+#include "../batch/material/BindlessTextureManager.hpp"
+#include "../batch/material/MaterialParameterBuffer.hpp"
 #include "../graphics_pipeline/GlobalDescriptorManager.hpp"
-#include "../particle/ParticleInstanceDescriptorManager.hpp"
+#include "../particle/ParticleSystem.hpp"
+#include "DepthInputDescriptorManager.hpp"
+#include "../debug/DebugDraw.hpp"
+#include "../culling/OcclusionCuller.hpp"
+#include "../lighting/ClusteredLighting.hpp"
+#include "../lighting/CascadedShadowMaps.hpp"
+#include "../debug/GpuTimer.hpp"
 
 /**
  * @brief Manages Vulkan command buffers and their recording lifecycle.
@@ -25,6 +34,26 @@
  */
 class CommandManager {
 public:
+    /**
+     * @brief GpuTimer scopes written by recordCommandBuffer.
+     */
+    enum class TimerScope : uint32_t {
+        // the whole command buffer
+        Frame,
+        // lights assigned to the view clusters
+        LightCulling,
+        // sun cascades, not part of Scene: they do not scale with the render resolution
+        Shadows,
+        DepthPrepass,
+        // opaque batches, after the pre-pass when it is on
+        Opaque,
+        // everything drawn at the render resolution, what DynamicResolution budgets
+        Scene,
+        // the scene copied and scaled to the swapchain image
+        Upscale,
+        Count
+    };
+
     /**
      * @brief Interface for injecting custom Vulkan commands into a command buffer.
      *
@@ -69,6 +98,18 @@ public:
     };
 
 private:
+    /**
+     * @brief Walk of the opaque batches.
+     */
+    enum class MeshPass {
+        // materials with their own pipelines
+        Color,
+        // position-only depth of the materials usesDepthPrepass accepts
+        DepthPrepass,
+        // Color after a DepthPrepass: those materials test depth for EQUAL without writing it
+        AfterDepthPrepass
+    };
+
     VkDevice device;
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
@@ -136,6 +177,22 @@ private:
         const std::vector<VkClearValue>& clearValues
     );
 
+    /**
+     * @brief Copies the rendered part of the scene color to the swapchain image, scaled to fill it.
+     *
+     * The scene color is in the transfer source layout the render pass left
+     * it in; the swapchain image ends in the transfer destination layout the
+     * overlay pass starts from.
+     */
+    void recordUpscale(
+        VkCommandBuffer cmd,
+        VkImage sceneImage,
+        VkImage swapchainImage,
+        VkExtent2D renderExtent,
+        VkExtent2D extent,
+        VkFilter filter
+    );
+
     /**
      * @brief Sets the viewport and scissor rectangles for rendering.
      *
@@ -155,6 +212,39 @@ private:
         const std::vector<IScissorProvider*>& scissorProviders
     );
 
+    /**
+     * @brief Records the opaque batches, inside the opaque subpass.
+     *
+     * Walks the batches in order, binding pipelines, meshes and material
+     * sets as they change. Without a culler every draw is a direct indexed
+     * draw of the instances uploaded here. With one, the Early phase uploads
+     * the instances and adds every draw to the culler, and both phases draw
+     * the instances that passed their cull with an indirect draw; the Late
+     * phase walks the same batches without uploading anything.
+     *
+     * Only the first walk of a phase uploads: with the pre-pass on, the
+     * AfterDepthPrepass walk draws the same ranges as the DepthPrepass one.
+     *
+     * @param occlusionCuller Culler of this frame, null to draw every instance.
+     * @param phase Cull phase drawn, ignored without a culler.
+     * @param pass Depth-only, plain, or shading after the depth-only walk.
+     */
+    void recordMeshes(
+        VkCommandBuffer cmd,
+        uint32_t currentFrame,
+        GraphicsPipeline* graphicsPipeline,
+        GlobalDescriptorManager* globalDescriptorManager,
+        InstanceDescriptorManager* instanceDescriptorManager,
+        BindlessTextureManager* bindlessTextureManager,
+        MaterialParameterBuffer* materialParameterBuffer,
+        RenderBatchManager* renderBatchManager,
+        OcclusionCuller* occlusionCuller,
+        OcclusionCuller::Phase phase,
+        MeshPass pass,
+        const std::vector<IViewportProvider*>& viewportProviders,
+        const std::vector<IScissorProvider*>& scissorProviders
+    );
+
 public:
     /**
      * @brief Allocates one primary command buffer per framebuffer.
@@ -186,30 +276,74 @@ public:
      *
      * Resets and records the primary command buffer corresponding to the
      * specified swapchain image index. The recording process typically:
+     * - Records the GPU particle simulation and the light culling
      * - Begins the render pass
      * - Configures dynamic viewport and scissor states
      * - Binds the graphics pipeline and descriptor sets
-     * - Records draw calls via RenderBatchManager
-     * - Executes optional extra command recorders
-     * - Ends the render pass
+     * - Records draw calls via RenderBatchManager, after a depth-only walk
+     *   of the same batches when the depth pre-pass is on
+     * - With occlusion culling, splits the opaque subpass in the Early and
+     *   Late parts of the render pass around the depth pyramid and late cull
+     * - Moves to the transparent subpass and draws the particles and debug lines
+     * - Ends the render pass, the scene color is copied to the swapchain image
+     *   and scaled to fill it
+     * - Executes optional extra command recorders in the overlay pass
+     *
+     * The scene is drawn in the top-left renderExtent of its attachments,
+     * the viewport and scissor providers are expected to match it.
      *
      * @param imageIndex Index of the swapchain image whose command buffer
      *                   will be recorded.
-     * @param renderPass Render pass used to begin the rendering process.
+     * @param renderPass Render pass used to begin the rendering process, the
+     *                   Full part or, with a culler, the Early and Late parts,
+     *                   then the overlay pass.
      * @param graphicsPipeline Pointer to the graphics pipeline used for drawing.
-     * @param framebuffers Swapchain framebuffers associated with each image.
+     * @param framebuffers Overlay framebuffers associated with each swapchain image.
+     * @param sceneFramebuffer Framebuffer of the scene attachments.
+     * @param sceneImage Scene color, the render pass resolves into it.
+     * @param swapchainImage Swapchain image of imageIndex.
+     * @param renderExtent Render area of the scene, at most extent.
      * @param extent Current swapchain extent (width and height).
+     * @param upscaleFilter Filter of the copy to the swapchain image.
      * @param globalDescriptorSet Descriptor set containing global resources
      *                            (e.g., camera, lighting).
+     * @param bindlessTextureManager Global material texture array, bound once
+     *                               for the whole pass; null to bind one
+     *                               descriptor set per material. In bindless
+     *                               mode consecutive batches of the same mesh
+     *                               LOD and material pipeline are merged into
+     *                               a single draw.
+     * @param materialParameterBuffer Material parameters (set 3), bound once;
+     *                                batches switch pipeline only when their
+     *                                material pipeline changes.
+     * @param particleSystem Particles, GPU or CPU simulated; records its
+     *                       simulation before the render pass and its
+     *                       draw in the transparent subpass.
+     * @param depthInputDescriptorManager Depth of the opaque subpass as an
+     *                                    input attachment (particle set 2).
+     * @param debugDraw Debug lines flushed for this frame, drawn after the
+     *                  particles with one instanced call.
      * @param renderBatchManager Manager responsible for issuing draw calls.
+     * @param occlusionCuller Two-phase occlusion culling of the batches, begun
+     *                        for this frame; null to draw every instance.
+     * @param clusteredLighting Lights of this frame, assigned to the clusters
+     *                          the mesh fragment shaders read before the
+     *                          render pass.
+     * @param shadowMaps Sun cascades updated for this frame, drawn before
+     *                   the scene; the mesh fragment shaders sample them.
+     * @param depthPrepass Lay down the depth of opaque materials with a
+     *                     position-only pass first, so the main walk shades
+     *                     each pixel once (depth EQUAL, no writes).
+     * @param gpuTimer Timer the TimerScope ranges are written to.
      * @param clearProviders Providers that supply VkClearValue entries for
-     *                       the render pass attachments.
+     *                       the scene render pass attachments.
      * @param viewportProviders Providers responsible for configuring dynamic
      *                          VkViewport states.
      * @param scissorProviders Providers responsible for configuring dynamic
      *                         VkRect2D scissor states.
      * @param extraRecorders Optional additional recorders that inject custom
-     *                       commands into the command buffer.
+     *                       commands into the command buffer, in the overlay
+     *                       pass at the swapchain resolution.
      *
      * @note Assumes that the command buffer was allocated as a primary buffer
      *       and is compatible with the provided render pass.
@@ -217,14 +351,28 @@ public:
     void recordCommandBuffer(
         uint32_t imageIndex,
         uint32_t currentFrame,
-        VkRenderPass renderPass,
+        const RenderPass* renderPass,
         GraphicsPipeline* graphicsPipeline,
         const std::vector<VkFramebuffer>& framebuffers,
+        VkFramebuffer sceneFramebuffer,
+        VkImage sceneImage,
+        VkImage swapchainImage,
+        VkExtent2D renderExtent,
         VkExtent2D extent,
+        VkFilter upscaleFilter,
         GlobalDescriptorManager* globalDescriptorManager,
         InstanceDescriptorManager* instanceDescriptorManager,
-        ParticleInstanceDescriptorManager* particleInstanceDescriptorManager,
+        BindlessTextureManager* bindlessTextureManager,
+        MaterialParameterBuffer* materialParameterBuffer,
+        ParticleSystem* particleSystem,
+        DepthInputDescriptorManager* depthInputDescriptorManager,
+        DebugDraw* debugDraw,
         RenderBatchManager* renderBatchManager,
+        OcclusionCuller* occlusionCuller,
+        ClusteredLighting* clusteredLighting,
+        CascadedShadowMaps* shadowMaps,
+        bool depthPrepass,
+        GpuTimer* gpuTimer,
         const std::vector<IClearValueProvider*>& clearProviders,
         const std::vector<IViewportProvider*>& viewportProviders,
         const std::vector<IScissorProvider*>& scissorProviders,
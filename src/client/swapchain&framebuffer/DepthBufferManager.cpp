@@ -11,6 +11,9 @@ DepthBufferManager::DepthBufferManager(
 ) :
         device(device)
 {
+    // input attachment views may only have one aspect
+    VkImageAspectFlags inputAspect = aspect;
+
     if (CoreVulkan::hasStencilComponent(depthFormat)) {
         aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
     }
@@ -24,7 +27,7 @@ DepthBufferManager::DepthBufferManager(
         msaaSamples,
         depthFormat,
         VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         this->depthImage,
         this->depthImageMemory
@@ -37,10 +40,22 @@ DepthBufferManager::DepthBufferManager(
         aspect,
         1
     );
+
+    depthInputView = createImageView(
+        device,
+        depthImage,
+        depthFormat,
+        inputAspect,
+        1
+    );
 }
 
 DepthBufferManager::~DepthBufferManager()
 {
+    if (this->depthInputView != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, this->depthInputView, nullptr);
+        this->depthInputView = VK_NULL_HANDLE;
+    }
     if (this->depthImageView != VK_NULL_HANDLE) {
         vkDestroyImageView(device, this->depthImageView, nullptr);
         this->depthImageView = VK_NULL_HANDLE;
@@ -23,6 +23,8 @@ private:
     VkImage depthImage;
     VkDeviceMemory depthImageMemory;
     VkImageView depthImageView;
+    // depth aspect only, read by later subpasses as an input attachment and by the depth pyramid
+    VkImageView depthInputView;
 
 public:
     /**
@@ -31,7 +33,9 @@ public:
      * The image is created with:
      * - The same extent as the swapchain
      * - The specified MSAA sample count
-     * - VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+     * - VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+     *   VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT (soft particles) and
+     *   VK_IMAGE_USAGE_SAMPLED_BIT (occlusion culling depth pyramid)
      *
      * If the chosen depth format contains a stencil component,
      * VK_IMAGE_ASPECT_STENCIL_BIT is automatically added to the
@@ -61,4 +65,5 @@ public:
     VkImage getDepthImage() const { return depthImage; }
     VkDeviceMemory getDepthImageMemory() const { return depthImageMemory; }
     VkImageView getDepthImageView() const { return depthImageView; }
+    VkImageView getDepthInputView() const { return depthInputView; }
 };
\ No newline at end of file
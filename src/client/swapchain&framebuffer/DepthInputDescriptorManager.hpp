@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../CoreVulkan.hpp"
+
+/**
+ * @brief Descriptor set exposing the depth buffer as an input attachment.
+ *
+ * Set 2 of the Particle pipeline layout: binding 0 is the depth attachment
+ * of the opaque subpass, read by the soft particle fragment shader in the
+ * transparent subpass. The depth buffer is recreated with the swapchain,
+ * so update must be called with its new view each time.
+ */
+class DepthInputDescriptorManager
+{
+private:
+    VkDevice device;
+
+    VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+public:
+    /**
+     * @throws std::runtime_error if layout creation, pool creation,
+     *         or descriptor allocation fails.
+     */
+    explicit DepthInputDescriptorManager(
+        VkDevice device
+    );
+
+    ~DepthInputDescriptorManager();
+
+    DepthInputDescriptorManager(const DepthInputDescriptorManager&) = delete;
+    DepthInputDescriptorManager& operator=(const DepthInputDescriptorManager&) = delete;
+
+    /**
+     * @brief Points the set at a depth view, see DepthBufferManager::getDepthInputView.
+     *
+     * The set must not be in use by a pending command buffer.
+     */
+    void update(
+        VkImageView depthInputView
+    );
+
+    VkDescriptorSetLayout getLayout() const { return descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+};
@@ -0,0 +1,69 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(
+    VkPhysicalDevice physicalDevice
+) :
+    physicalDevice(physicalDevice)
+{}
+
+void DynamicResolution::setDisplay(
+    VkExtent2D extent,
+    VkFormat format
+) {
+    displayExtent = extent;
+
+    VkFormatProperties properties{};
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    upscaleFilter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+        ? VK_FILTER_LINEAR
+        : VK_FILTER_NEAREST;
+
+    updateRenderExtent();
+}
+
+void DynamicResolution::update(
+    double sceneMilliseconds
+) {
+    if (enabled && sceneMilliseconds > 0.0)
+    {
+        // the time follows the pixel count, the square of the scale
+        double ratio = targetMilliseconds / sceneMilliseconds;
+        if (std::abs(ratio - 1.0) > DEAD_BAND)
+        {
+            float estimate = scale * static_cast<float>(std::sqrt(ratio));
+            scale += (estimate - scale) * GAIN;
+        }
+    }
+
+    updateRenderExtent();
+}
+
+void DynamicResolution::updateRenderExtent() {
+    scale = std::max(minScale, std::min(scale, std::min(maxScale, 1.0f)));
+
+    renderExtent = {
+        std::clamp(static_cast<uint32_t>(std::lround(displayExtent.width * scale)), 1u, std::max(displayExtent.width, 1u)),
+        std::clamp(static_cast<uint32_t>(std::lround(displayExtent.height * scale)), 1u, std::max(displayExtent.height, 1u))
+    };
+}
+
+bool DynamicResolution::overrideViewport(
+    VkViewport& viewport
+) {
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(renderExtent.width);
+    viewport.height = static_cast<float>(renderExtent.height);
+    return true;
+}
+
+bool DynamicResolution::overrideScissor(
+    VkRect2D& scissor
+) {
+    scissor.offset = {0, 0};
+    scissor.extent = renderExtent;
+    return true;
+}
\ No newline at end of file
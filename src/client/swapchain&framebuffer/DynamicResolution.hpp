@@ -0,0 +1,82 @@
+#pragma once
+
+#include "../CoreVulkan.hpp"
+#include "CommandManager.hpp"
+
+/**
+ * @brief Scales the resolution the scene is rendered at to hold a GPU time budget.
+ *
+ * The scene attachments keep the display size. The scene is drawn in the
+ * top-left getRenderExtent of them (render area, viewport and scissor)
+ * and CommandManager scales that rectangle up to the swapchain image, so
+ * nothing is reallocated when the scale changes.
+ *
+ * With the controller on, update moves the scale every frame so the GPU
+ * time of the scene approaches targetMilliseconds. The time is taken as
+ * proportional to the pixel count; the step is damped and skipped within
+ * a dead band around the target so the resolution settles instead of
+ * hunting, since the time read back lags by the frames in flight. With
+ * the controller off the scale stays where it was set.
+ *
+ * Registered as viewport and scissor provider of the command recording.
+ */
+class DynamicResolution final
+    : public CommandManager::IViewportProvider,
+      public CommandManager::IScissorProvider
+{
+public:
+    // adjust scale to the GPU time of the scene
+    bool enabled = false;
+    float targetMilliseconds = 1000.0f / 60.0f;
+    // bounds of scale, at most 1: the attachments have the display size
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // render extent over display extent, on both axes
+    float scale = 1.0f;
+
+private:
+    // relative distance from the target the controller ignores
+    static constexpr double DEAD_BAND = 0.1;
+    // fraction of the way to the estimated scale taken each frame
+    static constexpr float GAIN = 0.2f;
+
+    VkPhysicalDevice physicalDevice;
+    VkExtent2D displayExtent{};
+    VkExtent2D renderExtent{};
+    VkFilter upscaleFilter = VK_FILTER_NEAREST;
+
+    void updateRenderExtent();
+
+public:
+    explicit DynamicResolution(
+        VkPhysicalDevice physicalDevice
+    );
+
+    /**
+     * @brief Sets the swapchain extent and format, on creation and swapchain recreation.
+     *
+     * The upscale is linear when the format can be blitted with linear filtering.
+     */
+    void setDisplay(
+        VkExtent2D extent,
+        VkFormat format
+    );
+
+    /**
+     * @brief Moves the scale toward the budget and updates the render extent.
+     *
+     * Call once per frame before recording.
+     *
+     * @param sceneMilliseconds GPU time of the scene in a recent frame, 0 if unknown.
+     */
+    void update(
+        double sceneMilliseconds
+    );
+
+    bool overrideViewport(VkViewport& viewport) override;
+    bool overrideScissor(VkRect2D& scissor) override;
+
+    VkExtent2D getRenderExtent() const { return renderExtent; }
+    VkExtent2D getDisplayExtent() const { return displayExtent; }
+    VkFilter getUpscaleFilter() const { return upscaleFilter; }
+};
\ No newline at end of file
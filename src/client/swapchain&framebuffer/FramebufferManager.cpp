@@ -4,47 +4,60 @@
 FramebufferManager::FramebufferManager(
     VkDevice device,
     VkRenderPass renderPass,
+    VkRenderPass overlayRenderPass,
     std::vector<VkImageView> swapchainImageViews,
     const VkImageView colorImageView,
+    const VkImageView sceneImageView,
     const VkImageView depthImageView,
     const VkExtent2D swapChainExtent,
     bool useMSAA
 ) :
     device(device)
 {
-    this->swapchainFramebuffers.resize(swapchainImageViews.size());
+    #ifndef NDEBUG
+        assert(renderPass != VK_NULL_HANDLE);
+        assert(overlayRenderPass != VK_NULL_HANDLE);
+        assert(colorImageView != VK_NULL_HANDLE);
+        assert(sceneImageView != VK_NULL_HANDLE);
+        assert(depthImageView != VK_NULL_HANDLE);
+        assert(!swapchainImageViews.empty());
+    #endif
 
-    for (size_t i = 0; i < swapchainImageViews.size(); ++i) {
+    // Scene
+    std::vector<VkImageView> attachments;
+    if (useMSAA) {
+        attachments = {
+            colorImageView, // MSAA color
+            depthImageView, // depth/stencil
+            sceneImageView  // resolve
+        };
+    } else {
+        attachments = {
+            sceneImageView, // scene color
+            depthImageView // depth/stencil
+        };
+    }
 
-        std::vector<VkImageView> attachments;
-        if (useMSAA) {
-            attachments = {
-                colorImageView, // MSAA color
-                depthImageView, // depth/stencil
-                swapchainImageViews[i]  // resolve / present
-            };
-        } else {
-            attachments = {
-                swapchainImageViews[i], // resolve / present
-                depthImageView // depth/stencil
-            };
-        }
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = swapChainExtent.width;
+    framebufferInfo.height = swapChainExtent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &this->sceneFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create framebuffer!");
+    }
 
-        #ifndef NDEBUG
-            assert(renderPass != VK_NULL_HANDLE);
-            assert(colorImageView != VK_NULL_HANDLE);
-            assert(depthImageView != VK_NULL_HANDLE);
-            assert(!swapchainImageViews.empty());
-        #endif
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-        framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = swapChainExtent.width;
-        framebufferInfo.height = swapChainExtent.height;
-        framebufferInfo.layers = 1;
+    // Overlay, one per swapchain image
+    this->swapchainFramebuffers.resize(swapchainImageViews.size());
+
+    for (size_t i = 0; i < swapchainImageViews.size(); ++i) {
+        framebufferInfo.renderPass = overlayRenderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &swapchainImageViews[i];
 
         if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &this->swapchainFramebuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create framebuffer!");
@@ -58,4 +71,7 @@ FramebufferManager::~FramebufferManager() {
         framebuffer = VK_NULL_HANDLE;
     }
     swapchainFramebuffers.clear();
+
+    vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
+    sceneFramebuffer = VK_NULL_HANDLE;
 }
@@ -6,13 +6,16 @@
 #include <cstring>
 
 /**
- * @brief Manages framebuffer creation for each swapchain image.
+ * @brief Manages the scene framebuffer and one overlay framebuffer per swapchain image.
  *
- * FramebufferManager creates one VkFramebuffer per swapchain image,
- * binding together:
+ * The scene framebuffer binds together:
  * - The multisampled color attachment
  * - The depth (and optional stencil) attachment
- * - The resolve / presentation swapchain image
+ * - The resolve target, the scene color
+ *
+ * The scene images are shared by every frame, so a single scene
+ * framebuffer is used. Each overlay framebuffer binds a swapchain image
+ * for the overlay pass (see RenderPass::getOverlay).
  *
  * The framebuffer configuration must exactly match the attachments
  * declared in the associated render pass.
@@ -24,29 +27,34 @@ class FramebufferManager
 {
 private:
     VkDevice device;
+    VkFramebuffer sceneFramebuffer{VK_NULL_HANDLE};
     std::vector<VkFramebuffer> swapchainFramebuffers;
 
 public:
     /**
-     * @brief Creates a framebuffer for each swapchain image.
+     * @brief Creates the scene framebuffer and a framebuffer for each swapchain image.
      *
-     * Attachment order must match the render pass attachment order:
-     * 0 - Multisampled color attachment
+     * Scene attachment order must match the render pass attachment order:
+     * 0 - Multisampled color attachment (the scene color without MSAA)
      * 1 - Depth (or depth-stencil) attachment
-     * 2 - Resolve / swapchain image
+     * 2 - Resolve / scene color
      *
      * @param device Logical Vulkan device.
-     * @param renderPass Render pass compatible with the attachments.
+     * @param renderPass Render pass compatible with the scene attachments.
+     * @param overlayRenderPass Overlay pass, compatible with a swapchain image.
      * @param swapchainImageViews Image views of the swapchain images.
      * @param colorImageView Multisampled color image view.
+     * @param sceneImageView Single-sampled scene color image view.
      * @param depthImageView Depth (or depth-stencil) image view.
      * @param swapChainExtent Framebuffer dimensions.
      */
     FramebufferManager(
         VkDevice device,
         VkRenderPass renderPass,
+        VkRenderPass overlayRenderPass,
         std::vector<VkImageView> swapchainImageViews,
         const VkImageView colorImageView,
+        const VkImageView sceneImageView,
         const VkImageView depthImageView,
         const VkExtent2D swapChainExtent,
         bool useMSAA
@@ -57,5 +65,7 @@ public:
      */
     ~FramebufferManager();
 
+    /// Overlay framebuffers, one per swapchain image
     const std::vector<VkFramebuffer>& getFramebuffers() const { return this->swapchainFramebuffers; }
+    VkFramebuffer getSceneFramebuffer() const { return this->sceneFramebuffer; }
 };
\ No newline at end of file
@@ -99,7 +99,8 @@ void SwapchainManager::createSwapchainInternal(
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // the scene is upscaled into the image before the overlay pass draws on it
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
     // swapChainSupport
     uint32_t queueFamilyIndices[] = {queueFamilies.graphicsFamily.value(), queueFamilies.presentFamily.value()};
@@ -136,6 +137,9 @@ void SwapchainManager::createSwapchainInternal(
 
     // fix invalid imageUsage
     createInfo.imageUsage &= swapChainSupport.capabilities.supportedUsageFlags;
+    if (!(createInfo.imageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        throw std::runtime_error("swapchain images can't be blitted to!");
+    }
 
     // invalid compositeAlpha
     auto supported = swapChainSupport.capabilities.supportedCompositeAlpha;
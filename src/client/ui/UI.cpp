@@ -1,6 +1,7 @@
 // UI.cpp
 #include "UI.hpp"
 #include "../CoreVulkan.hpp"
+#include "../graphics_pipeline/RenderPass.hpp"
 
 UI::UI():
     window(nullptr),
@@ -51,7 +52,8 @@ void UI::initSwapchainResources(
     VkQueue GraphicsQueue,
     VkRenderPass renderPass,
     uint32_t imageCount,
-    VkSampleCountFlagBits msaaSamples
+    VkSampleCountFlagBits msaaSamples,
+    VkPipelineCache pipelineCache
 ) {
     // 4. Init Vulkan backend
     ImGui_ImplVulkan_InitInfo init_info = {};
@@ -60,9 +62,11 @@ void UI::initSwapchainResources(
     init_info.Device = device;
     init_info.QueueFamily = graphicsQueueFamilyIndices.graphicsFamily.value();
     init_info.Queue = GraphicsQueue;
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    // warm after the first init, swapchain recreation reuses the compiled pipeline
+    init_info.PipelineCache = pipelineCache;
     init_info.DescriptorPool = this->descriptorPool;
     init_info.RenderPass = renderPass;
+    // the overlay pass, on top of the upscaled scene at the display resolution
     init_info.Subpass = 0;
     init_info.MinImageCount = imageCount;
     init_info.ImageCount = imageCount;
@@ -83,7 +87,8 @@ void UI::init(
     VkQueue GraphicsQueue,
     VkRenderPass renderPass,
     uint32_t imageCount,
-    VkSampleCountFlagBits msaaSamples
+    VkSampleCountFlagBits msaaSamples,
+    VkPipelineCache pipelineCache
 )
 {
     this->window = window;
@@ -97,7 +102,8 @@ void UI::init(
         GraphicsQueue,
         renderPass,
         imageCount,
-        msaaSamples
+        msaaSamples,
+        pipelineCache
     );
 }
 
@@ -107,11 +113,165 @@ void UI::newFrame() {
     ImGui::NewFrame();
 }
 
-void UI::build() {
+void UI::build(
+    const ResourceManager::CacheStats& stats,
+    const GraphicsPipeline::CompileStats& pipelineStats,
+    const ParticleSystem::Stats& particleStats,
+    const DebugDraw::Stats& debugStats,
+    const OcclusionCuller::Stats& cullStats,
+    ClusteredLighting& lighting,
+    CascadedShadowMaps& shadows,
+    const GpuTimer& gpuTimer,
+    bool& depthPrepass,
+    VkSampleCountFlagBits& msaaSamples,
+    VkSampleCountFlagBits maxMsaaSamples,
+    DynamicResolution& dynamicResolution,
+    double startupSeconds
+) {
     // Example window
     ImGui::Begin("Demo Window");
     ImGui::Text("Hello from ImGui inside Vulkan!");
     ImGui::End();
+
+    const double MiB = 1024.0 * 1024.0;
+
+    ImGui::Begin("Resources");
+    ImGui::Text("Cache: %llu hits, %llu misses, %llu evictions",
+        static_cast<unsigned long long>(stats.hits),
+        static_cast<unsigned long long>(stats.misses),
+        static_cast<unsigned long long>(stats.evictions));
+    ImGui::Text("Retained: %.1f / %.1f MiB", stats.retainedBytes / MiB, stats.memoryBudget / MiB);
+    ImGui::Text("Textures: %.1f / %.1f MiB, %llu mip streams",
+        stats.textureBytes / MiB,
+        stats.textureStreamingBudget / MiB,
+        static_cast<unsigned long long>(stats.mipStreams));
+
+    // per worker, decode and RGBA expansion only
+    ImGui::Text("Decode: %.1f MiB at %.1f MB/s",
+        stats.decodedBytes / MiB,
+        stats.decodeSeconds > 0.0 ? stats.decodedBytes / stats.decodeSeconds / 1e6 : 0.0);
+    ImGui::Text("Staging ring: %.1f / %.1f MiB", stats.stagingRingUsed / MiB, stats.stagingRingCapacity / MiB);
+    ImGui::End();
+
+    ImGui::Begin("Pipelines");
+    ImGui::Text("Startup: %.1f ms to first frame, %.1f ms waiting for pipelines",
+        startupSeconds * 1000.0,
+        pipelineStats.startupSeconds * 1000.0);
+    ImGui::Text("Compiled: %u, %u pending, %.1f ms on workers",
+        pipelineStats.compiled,
+        pipelineStats.pending,
+        pipelineStats.compileSeconds * 1000.0);
+    ImGui::End();
+
+    ImGui::Begin("Particles");
+    ImGui::Text("Backend: %s, %zu emitters", particleStats.backend, particleStats.emitters);
+    // the GPU backend never reads its counts back
+    if (particleStats.simulateMs > 0.0) {
+        ImGui::Text("Alive: %u", particleStats.alive);
+        ImGui::Text("Simulate: %.2f ms, %.0f particles/ms",
+            particleStats.simulateMs,
+            particleStats.alive / particleStats.simulateMs);
+    }
+    ImGui::End();
+
+    ImGui::Begin("Debug Draw");
+    ImGui::Text("Lines: %u in one draw", debugStats.lines);
+    if (debugStats.dropped > 0)
+        ImGui::Text("Dropped: %u over capacity", debugStats.dropped);
+    ImGui::End();
+
+    ImGui::Begin("Occlusion Culling");
+    ImGui::Text("Instances: %u in %u draws", cullStats.instances, cullStats.draws);
+    ImGui::Text("Early: %u outside the frustum, %u occluded",
+        cullStats.frustumCulled,
+        cullStats.earlyOccluded);
+    // the late phase draws what the new pyramid no longer hides
+    ImGui::Text("Late: %u still occluded, %u disoccluded",
+        cullStats.lateOccluded,
+        cullStats.earlyOccluded - cullStats.lateOccluded);
+    ImGui::Text("Drawn: %u",
+        cullStats.instances - cullStats.frustumCulled - cullStats.lateOccluded);
+    ImGui::End();
+
+    ClusteredLighting::Stats lightStats = lighting.getStats();
+    ImGui::Begin("Lighting");
+    ImGui::ColorEdit3("Ambient", &lighting.ambient.x);
+    ImGui::Text("Lights: %zu, grid %ux%ux%u",
+        lighting.getLightCount(),
+        ClusteredLighting::GRID_X,
+        ClusteredLighting::GRID_Y,
+        ClusteredLighting::GRID_Z);
+    ImGui::Text("Lit clusters: %u of %u, at most %u lights",
+        lightStats.litClusters,
+        ClusteredLighting::CLUSTER_COUNT,
+        lightStats.maxClusterLights);
+    // their extra lights are dropped
+    if (lightStats.overflowClusters > 0)
+        ImGui::Text("Over %u lights: %u clusters", ClusteredLighting::MAX_LIGHTS_PER_CLUSTER, lightStats.overflowClusters);
+
+    CascadedShadowMaps::Stats shadowStats = shadows.getStats();
+    ImGui::Separator();
+    // moving the sun redraws the cached cascades
+    ImGui::DragFloat3("Sun direction", &shadows.sunDirection.x, 0.01f, -1.0f, 1.0f);
+    ImGui::ColorEdit3("Sun color", &shadows.sunColor.x);
+    ImGui::SliderFloat("Sun intensity", &shadows.sunIntensity, 0.0f, 4.0f);
+    ImGui::SliderFloat("Cache margin", &shadows.cacheMargin, 0.0f, 1.0f);
+    ImGui::Text("Cascades: %u drawn, %u cached, %llu cache redraws",
+        shadowStats.renderedCascades,
+        shadowStats.cachedCascades,
+        static_cast<unsigned long long>(shadowStats.staticRedraws));
+    ImGui::Text("Casters: %u draws, %u instances", shadowStats.draws, shadowStats.instances);
+    if (shadowStats.dropped > 0)
+        ImGui::Text("Dropped casters: %u", shadowStats.dropped);
+    ImGui::End();
+
+    ImGui::Begin("GPU Timing");
+    ImGui::Checkbox("Depth pre-pass", &depthPrepass);
+    if (gpuTimer.isSupported()) {
+        auto ms = [&](CommandManager::TimerScope scope) {
+            return gpuTimer.getMilliseconds(static_cast<uint32_t>(scope));
+        };
+        ImGui::Text("Frame: %.3f ms", ms(CommandManager::TimerScope::Frame));
+        ImGui::Text("Light culling: %.3f ms", ms(CommandManager::TimerScope::LightCulling));
+        ImGui::Text("Shadows: %.3f ms", ms(CommandManager::TimerScope::Shadows));
+        ImGui::Text("Depth pre-pass: %.3f ms", ms(CommandManager::TimerScope::DepthPrepass));
+        ImGui::Text("Opaque: %.3f ms", ms(CommandManager::TimerScope::Opaque));
+        ImGui::Text("Scene: %.3f ms", ms(CommandManager::TimerScope::Scene));
+        ImGui::Text("Upscale: %.3f ms", ms(CommandManager::TimerScope::Upscale));
+    } else {
+        ImGui::Text("Timestamps not supported by the graphics queue");
+    }
+    ImGui::End();
+
+    ImGui::Begin("Resolution");
+    // applied before the next frame, the render pass and pipelines are rebuilt
+    if (ImGui::BeginCombo("MSAA", (std::to_string(msaaSamples) + "x").c_str())) {
+        for (uint32_t samples = VK_SAMPLE_COUNT_1_BIT; samples <= maxMsaaSamples; samples <<= 1) {
+            bool selected = samples == msaaSamples;
+            if (ImGui::Selectable((std::to_string(samples) + "x").c_str(), selected))
+                msaaSamples = static_cast<VkSampleCountFlagBits>(samples);
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+    if (dynamicResolution.enabled) {
+        ImGui::SliderFloat("Scene budget (ms)", &dynamicResolution.targetMilliseconds, 1.0f, 50.0f, "%.1f");
+        ImGui::SliderFloat("Min scale", &dynamicResolution.minScale, 0.25f, dynamicResolution.maxScale, "%.2f");
+        ImGui::SliderFloat("Max scale", &dynamicResolution.maxScale, dynamicResolution.minScale, 1.0f, "%.2f");
+    } else {
+        ImGui::SliderFloat("Scale", &dynamicResolution.scale, dynamicResolution.minScale, 1.0f, "%.2f");
+    }
+
+    VkExtent2D renderExtent = dynamicResolution.getRenderExtent();
+    VkExtent2D displayExtent = dynamicResolution.getDisplayExtent();
+    ImGui::Text("Render: %ux%u of %ux%u (%.0f%%)",
+        renderExtent.width,
+        renderExtent.height,
+        displayExtent.width,
+        displayExtent.height,
+        dynamicResolution.scale * 100.0f);
+    ImGui::End();
 }
 
 void UI::cleanup() {
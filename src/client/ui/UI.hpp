@@ -5,6 +5,14 @@
 #include "backends/imgui_impl_vulkan.h"
 #include "../CoreVulkan.hpp"
 #include "../swapchain&framebuffer/CommandManager.hpp"
+#include "../batch/ResourceManager.hpp"
+#include "../particle/ParticleSystem.hpp"
+#include "../debug/DebugDraw.hpp"
+#include "../culling/OcclusionCuller.hpp"
+#include "../lighting/ClusteredLighting.hpp"
+#include "../lighting/CascadedShadowMaps.hpp"
+#include "../debug/GpuTimer.hpp"
+#include "../swapchain&framebuffer/DynamicResolution.hpp"
 
 class UI {
 private:
@@ -26,7 +34,8 @@ public:
         VkQueue GraphicsQueue,
         VkRenderPass renderPass,
         uint32_t imageCount,
-        VkSampleCountFlagBits msaaSamples
+        VkSampleCountFlagBits msaaSamples,
+        VkPipelineCache pipelineCache
     );
     void init(
         GLFWwindow* window,
@@ -37,11 +46,31 @@ public:
         VkQueue GraphicsQueue,
         VkRenderPass renderPass,
         uint32_t imageCount,
-        VkSampleCountFlagBits msaaSamples
+        VkSampleCountFlagBits msaaSamples,
+        VkPipelineCache pipelineCache
     );
 
     void newFrame(); // start UI frame
-    void build(); // build your UI widgets
+    // build your UI widgets
+    void build(
+        const ResourceManager::CacheStats& stats,
+        const GraphicsPipeline::CompileStats& pipelineStats,
+        const ParticleSystem::Stats& particleStats,
+        const DebugDraw::Stats& debugStats,
+        const OcclusionCuller::Stats& cullStats,
+        // ambient set by the Lighting window
+        ClusteredLighting& lighting,
+        // sun set by the Lighting window
+        CascadedShadowMaps& shadows,
+        const GpuTimer& gpuTimer,
+        // toggled by the GPU Timing window
+        bool& depthPrepass,
+        // set by the Resolution window
+        VkSampleCountFlagBits& msaaSamples,
+        VkSampleCountFlagBits maxMsaaSamples,
+        DynamicResolution& dynamicResolution,
+        double startupSeconds
+    );
     void cleanup();
 };
 
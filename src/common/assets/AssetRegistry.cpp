@@ -0,0 +1,54 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "AssetRegistry.hpp"
+
+#include <mutex>
+#include <stdexcept>
+
+AssetRegistry::AssetId AssetRegistry::intern(
+    const std::string& path
+) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(path);
+        if (it != ids.end())
+            return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    // another thread may have registered it between the two locks
+    auto [it, inserted] = ids.emplace(path, static_cast<AssetId>(paths.size()));
+    if (inserted)
+    {
+        if (paths.size() >= InvalidId)
+            throw std::runtime_error("asset registry is full");
+        paths.push_back(path);
+    }
+
+    return it->second;
+}
+
+AssetRegistry::AssetId AssetRegistry::find(
+    const std::string& path
+) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(path);
+    return it != ids.end() ? it->second : InvalidId;
+}
+
+const std::string& AssetRegistry::getPath(
+    AssetId id
+) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (id >= paths.size())
+        throw std::out_of_range("unknown asset id");
+    return paths[id];
+}
+
+size_t AssetRegistry::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return paths.size();
+}
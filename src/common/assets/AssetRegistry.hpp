@@ -0,0 +1,67 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Interns asset paths into dense 32-bit ids.
+ *
+ * Ids are assigned in registration order starting at 0 and never change
+ * or get reused, so they can index plain arrays and be stored in
+ * network messages or save files alongside the registry contents.
+ *
+ * Thread-safe. Lookups take a shared lock; only the first registration
+ * of a path takes the exclusive lock.
+ */
+class AssetRegistry
+{
+public:
+    using AssetId = uint32_t;
+
+    static constexpr AssetId InvalidId = std::numeric_limits<AssetId>::max();
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, AssetId> ids;
+
+    // deque keeps references returned by getPath valid while growing
+    std::deque<std::string> paths;
+
+public:
+    AssetRegistry() = default;
+
+    AssetRegistry(const AssetRegistry&) = delete;
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    /**
+     * @brief Returns the id of a path, registering it on first use.
+     */
+    AssetId intern(
+        const std::string& path
+    );
+
+    /**
+     * @brief Returns the id of a path, or InvalidId if it was never interned.
+     */
+    AssetId find(
+        const std::string& path
+    ) const;
+
+    /**
+     * @brief Returns the path of an interned id.
+     *
+     * The reference stays valid for the lifetime of the registry.
+     */
+    const std::string& getPath(
+        AssetId id
+    ) const;
+
+    size_t size() const;
+};
@@ -0,0 +1,120 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(
+    const std::string& path
+) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("failed to open file " + path);
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        close();
+        throw std::runtime_error("failed to read the size of " + path);
+    }
+
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0)
+        return;
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle)
+    {
+        close();
+        throw std::runtime_error("failed to map file " + path);
+    }
+
+    bytes = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes)
+    {
+        close();
+        throw std::runtime_error("failed to map file " + path);
+    }
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    bytes = nullptr;
+    length = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(
+    const std::string& path
+) {
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        throw std::runtime_error("failed to open file " + path);
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0)
+    {
+        close();
+        throw std::runtime_error("failed to read the size of " + path);
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0)
+        return;
+
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("failed to map file " + path);
+    }
+
+    // decoders read front to back
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const uint8_t*>(mapping);
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<uint8_t*>(bytes), length);
+    if (descriptor >= 0)
+        ::close(descriptor);
+
+    bytes = nullptr;
+    length = 0;
+    descriptor = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
@@ -0,0 +1,54 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Decoders read the bytes in place, so the file is never copied into a
+ * heap buffer and pages are only faulted in as they are parsed. The
+ * mapping stays valid until the object is destroyed; empty files map
+ * to a null pointer with size 0.
+ *
+ * Uses mmap on POSIX and file mappings on Windows.
+ */
+class MappedFile
+{
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+
+    void close();
+
+public:
+    /**
+     * @brief Maps the file for reading.
+     *
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(
+        const std::string& path
+    );
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    uint8_t operator[](size_t index) const { return bytes[index]; }
+};
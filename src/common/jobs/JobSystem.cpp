@@ -0,0 +1,179 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "JobSystem.hpp"
+
+#include <limits>
+
+namespace {
+    // index of the worker owning the current thread, UINT32_MAX outside the pool
+    thread_local uint32_t currentWorker = std::numeric_limits<uint32_t>::max();
+    thread_local const JobSystem* currentSystem = nullptr;
+}
+
+JobSystem::JobSystem(
+    uint32_t workerCount
+) {
+    if (workerCount == 0) {
+        uint32_t hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+        workers.push_back(std::make_unique<Worker>());
+
+    threads.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running.store(false, std::memory_order_release);
+    }
+    sleepCondition.notify_all();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+void JobSystem::submit(
+    Job job,
+    JobCounter* counter
+) {
+    if (counter)
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t target = (currentSystem == this)
+        ? currentWorker
+        : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->jobs.emplace_back(std::move(job), counter);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedJobs.fetch_add(1, std::memory_order_release);
+    }
+    sleepCondition.notify_one();
+
+    // waiting threads help with the new job
+    if (waiters.load() > 0)
+        waitCondition.notify_all();
+}
+
+bool JobSystem::popJob(
+    uint32_t preferred,
+    Job& job,
+    JobCounter*& counter
+) {
+    const uint32_t count = static_cast<uint32_t>(workers.size());
+
+    // own queue, newest first
+    if (preferred < count) {
+        Worker& own = *workers[preferred];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back().first);
+            counter = own.jobs.back().second;
+            own.jobs.pop_back();
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // steal, oldest first
+    uint32_t start = preferred < count ? preferred + 1 : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Worker& victim = *workers[(start + i) % count];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.jobs.empty())
+            continue;
+
+        job = std::move(victim.jobs.front().first);
+        counter = victim.jobs.front().second;
+        victim.jobs.pop_front();
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void JobSystem::execute(
+    Job& job,
+    JobCounter* counter
+) {
+    // keeps the captured state, and maybe the counter, alive past the decrement
+    Job current = std::move(job);
+    job = nullptr;
+    current();
+
+    if (!counter)
+        return;
+
+    // seq_cst pairs with the waiters increment in wait, a sleeping waiter is always seen
+    if (counter->pending.fetch_sub(1) == 1 && waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        waitCondition.notify_all();
+    }
+}
+
+void JobSystem::workerLoop(
+    uint32_t workerIndex
+) {
+    currentWorker = workerIndex;
+    currentSystem = this;
+
+    Job job;
+    JobCounter* counter = nullptr;
+
+    while (true) {
+        if (popJob(workerIndex, job, counter)) {
+            execute(job, counter);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this] {
+            return queuedJobs.load(std::memory_order_acquire) > 0 ||
+                   !running.load(std::memory_order_acquire);
+        });
+
+        if (!running.load(std::memory_order_acquire) &&
+            queuedJobs.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+void JobSystem::wait(
+    JobCounter& counter
+) {
+    uint32_t preferred = (currentSystem == this)
+        ? currentWorker
+        : std::numeric_limits<uint32_t>::max();
+
+    Job job;
+    JobCounter* jobCounter = nullptr;
+
+    while (!counter.done()) {
+        if (popJob(preferred, job, jobCounter)) {
+            execute(job, jobCounter);
+            continue;
+        }
+
+        waiters.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            waitCondition.wait(lock, [this, &counter] {
+                return counter.done() || queuedJobs.load(std::memory_order_acquire) > 0;
+            });
+        }
+        waiters.fetch_sub(1);
+    }
+}
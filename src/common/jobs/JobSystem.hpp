@@ -0,0 +1,137 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Work-stealing thread pool shared by the client and the server.
+ *
+ * Every worker owns a deque of jobs. A worker pops its own jobs from the
+ * back (LIFO, cache friendly for jobs spawning sub-jobs) and, when empty,
+ * steals from the front of the other workers' deques.
+ *
+ * Jobs submitted from a worker thread go to that worker's deque; jobs
+ * submitted from any other thread are distributed round-robin.
+ *
+ * Jobs must not throw. Wrap fallible work and report errors through the
+ * captured state instead.
+ */
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    /**
+     * @brief Tracks completion of a group of jobs.
+     *
+     * Incremented on submission and decremented when a job finishes.
+     * A counter must outlive every job that references it.
+     */
+    struct JobCounter {
+        std::atomic<uint32_t> pending{0};
+
+        bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+    };
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::pair<Job, JobCounter*>> jobs;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    // threads blocked in wait, woken by new jobs and finished counters
+    std::condition_variable waitCondition;
+    std::atomic<uint32_t> waiters{0};
+    std::atomic<uint32_t> queuedJobs{0};
+    std::atomic<uint32_t> nextWorker{0};
+    std::atomic<bool> running{true};
+
+    void workerLoop(
+        uint32_t workerIndex
+    );
+
+    /**
+     * @brief Pops a job from the preferred worker or steals one.
+     *
+     * @param preferred Worker queue to try first, or UINT32_MAX for none.
+     * @param job (out) Job to execute.
+     * @param counter (out) Counter attached to the job.
+     *
+     * @return true if a job was found.
+     */
+    bool popJob(
+        uint32_t preferred,
+        Job& job,
+        JobCounter*& counter
+    );
+
+    /**
+     * @brief Runs a job, then decrements its counter.
+     *
+     * The closure is released only after the decrement: it may own the
+     * state the counter lives in.
+     */
+    void execute(
+        Job& job,
+        JobCounter* counter
+    );
+
+public:
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param workerCount Number of workers. 0 picks hardware_concurrency - 1
+     *                    (at least one) so the calling thread keeps a core.
+     */
+    explicit JobSystem(
+        uint32_t workerCount = 0
+    );
+
+    /**
+     * @brief Finishes queued jobs and joins all workers.
+     */
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * @brief Queues a job for execution on a worker.
+     *
+     * @param job Work to run.
+     * @param counter Optional counter incremented now and decremented on completion.
+     */
+    void submit(
+        Job job,
+        JobCounter* counter = nullptr
+    );
+
+    /**
+     * @brief Blocks until the counter reaches zero.
+     *
+     * The calling thread executes queued jobs while it waits, so waiting
+     * from a worker or from the main thread never deadlocks the pool.
+     * With nothing queued it sleeps until a job is submitted or a
+     * counter reaches zero.
+     */
+    void wait(
+        JobCounter& counter
+    );
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+};
@@ -0,0 +1,274 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "BlockCompressor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+uint16_t packRgb565(const float c[3])
+{
+    int r = static_cast<int>(std::lround(std::clamp(c[0], 0.0f, 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::clamp(c[1], 0.0f, 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::clamp(c[2], 0.0f, 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(uint16_t packed, int out[3])
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+/**
+ * Color part shared by BC1 and BC3, always in 4-color mode.
+ */
+void encodeColorBlock(const uint8_t* rgba, uint8_t* out)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += rgba[i * 4 + c];
+    for (int c = 0; c < 3; c++)
+        mean[c] /= 16.0f;
+
+    // covariance of the block colors
+    float cov[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        float r = rgba[i * 4 + 0] - mean[0];
+        float g = rgba[i * 4 + 1] - mean[1];
+        float b = rgba[i * 4 + 2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // principal axis by power iteration
+    float axis[3] = {0.577f, 0.577f, 0.577f};
+    for (int iter = 0; iter < 4; iter++)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float len = std::max({std::fabs(x), std::fabs(y), std::fabs(z)});
+        if (len < 1e-6f)
+            break;
+        axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+    }
+
+    float lengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t =
+            (rgba[i * 4 + 0] - mean[0]) * axis[0] +
+            (rgba[i * 4 + 1] - mean[1]) * axis[1] +
+            (rgba[i * 4 + 2] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    // inset by 1/16 of the range, the extremes are rarely hit exactly
+    float inset = (maxT - minT) / 16.0f;
+    minT = (minT + inset) / lengthSq;
+    maxT = (maxT - inset) / lengthSq;
+
+    float hi[3];
+    float lo[3];
+    for (int c = 0; c < 3; c++)
+    {
+        hi[c] = mean[c] + axis[c] * maxT;
+        lo[c] = mean[c] + axis[c] * minT;
+    }
+
+    uint16_t c0 = packRgb565(hi);
+    uint16_t c1 = packRgb565(lo);
+
+    // c0 > c1 selects 4-color mode
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int e0[3];
+        int e1[3];
+        unpackRgb565(c0, e0);
+        unpackRgb565(c1, e1);
+
+        int palette[4][3];
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = e0[c];
+            palette[1][c] = e1[c];
+            palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+            palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            int bestDist = INT32_MAX;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = rgba[i * 4 + 0] - palette[p][0];
+                int dg = rgba[i * 4 + 1] - palette[p][1];
+                int db = rgba[i * 4 + 2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+
+    out[0] = static_cast<uint8_t>(c0);
+    out[1] = static_cast<uint8_t>(c0 >> 8);
+    out[2] = static_cast<uint8_t>(c1);
+    out[3] = static_cast<uint8_t>(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+/**
+ * BC4-style alpha block, 8-value mode between the block min and max.
+ */
+void encodeAlphaBlock(const uint8_t* rgba, uint8_t* out)
+{
+    int a0 = 0;
+    int a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max<int>(a0, rgba[i * 4 + 3]);
+        a1 = std::min<int>(a1, rgba[i * 4 + 3]);
+    }
+
+    out[0] = static_cast<uint8_t>(a0);
+    out[1] = static_cast<uint8_t>(a1);
+
+    uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        int palette[8];
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+        for (int i = 0; i < 16; i++)
+        {
+            int a = rgba[i * 4 + 3];
+            int best = 0;
+            int bestDist = 256;
+            for (int p = 0; p < 8; p++)
+            {
+                int dist = std::abs(a - palette[p]);
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint64_t>(best) << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+} // namespace
+
+void BlockCompressor::encodeBC1Block(
+    const uint8_t* rgba,
+    uint8_t* out
+) {
+    encodeColorBlock(rgba, out);
+}
+
+void BlockCompressor::encodeBC3Block(
+    const uint8_t* rgba,
+    uint8_t* out
+) {
+    encodeAlphaBlock(rgba, out);
+    encodeColorBlock(rgba, out + 8);
+}
+
+std::vector<uint8_t> BlockCompressor::compress(
+    const uint8_t* rgba,
+    uint32_t width,
+    uint32_t height,
+    TextureFormat format
+) {
+    bool bc3;
+    switch (format)
+    {
+        case TextureFormat::BC1_RGBA_UNORM:
+        case TextureFormat::BC1_RGBA_SRGB:
+            bc3 = false;
+            break;
+        case TextureFormat::BC3_UNORM:
+        case TextureFormat::BC3_SRGB:
+            bc3 = true;
+            break;
+        default:
+            throw std::runtime_error("no CPU encoder for the requested block format");
+    }
+
+    const uint32_t blockBytes = TextureContainer::blockSize(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    std::vector<uint8_t> out(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            for (uint32_t y = 0; y < 4; y++)
+            {
+                uint32_t sy = std::min(by * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t sx = std::min(bx * 4 + x, width - 1);
+                    const uint8_t* src = rgba + (static_cast<size_t>(sy) * width + sx) * 4;
+                    std::copy(src, src + 4, block + (y * 4 + x) * 4);
+                }
+            }
+
+            uint8_t* dst = out.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+            if (bc3)
+                encodeBC3Block(block, dst);
+            else
+                encodeBC1Block(block, dst);
+        }
+    }
+
+    return out;
+}
+
+bool BlockCompressor::isOpaque(
+    const uint8_t* rgba,
+    uint32_t width,
+    uint32_t height
+) {
+    const size_t count = static_cast<size_t>(width) * height;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (rgba[i * 4 + 3] != 255)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureContainer.hpp"
+
+/**
+ * @brief CPU encoder for BC1 and BC3 blocks, used at cook time.
+ *
+ * Endpoints come from a range fit along the principal axis of the block
+ * colors, inset slightly to reduce the error at the extremes. Quality is
+ * close to common real-time encoders; speed is what matters here since
+ * every texture of the game goes through it.
+ *
+ * BC7 can be loaded and sampled but has no encoder: cook BC7 with an
+ * external tool and ship the resulting KTX2 or DDS.
+ */
+class BlockCompressor
+{
+public:
+    /**
+     * @brief Encodes an opaque 4x4 RGBA8 block (64 bytes, row-major) to 8 bytes of BC1.
+     */
+    static void encodeBC1Block(
+        const uint8_t* rgba,
+        uint8_t* out
+    );
+
+    /**
+     * @brief Encodes a 4x4 RGBA8 block (64 bytes, row-major) to 16 bytes of BC3.
+     */
+    static void encodeBC3Block(
+        const uint8_t* rgba,
+        uint8_t* out
+    );
+
+    /**
+     * @brief Compresses a full RGBA8 image. Edge blocks repeat the last row/column.
+     *
+     * @param format BC1 or BC3 variant; the color space only tags the data.
+     *
+     * @throws std::runtime_error for formats without an encoder.
+     */
+    static std::vector<uint8_t> compress(
+        const uint8_t* rgba,
+        uint32_t width,
+        uint32_t height,
+        TextureFormat format
+    );
+
+    /// True when every pixel has alpha 255, BC1 is then enough
+    static bool isOpaque(
+        const uint8_t* rgba,
+        uint32_t width,
+        uint32_t height
+    );
+};
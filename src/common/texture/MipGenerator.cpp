@@ -0,0 +1,371 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "MipGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <xmmintrin.h>
+    #define MIP_GENERATOR_SSE 1
+#endif
+
+namespace {
+
+constexpr float PI = 3.14159265358979f;
+
+// Kaiser window: radius in destination texels and shape parameter
+constexpr float KAISER_RADIUS = 3.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+
+struct SrgbTables {
+    float decode[256];
+    // linear value halfway between consecutive sRGB codes
+    float midpoints[255];
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (int i = 0; i < 255; i++)
+        {
+            float c = (i + 0.5f) / 255.0f;
+            midpoints[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+};
+
+const SrgbTables& srgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+uint8_t encodeSrgb(float linear)
+{
+    const SrgbTables& tables = srgbTables();
+    return static_cast<uint8_t>(std::upper_bound(tables.midpoints, tables.midpoints + 255, linear) - tables.midpoints);
+}
+
+uint8_t encodeLinear(float value)
+{
+    return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+// dst += src * weight, over one RGBA texel
+inline void madd4(float* dst, const float* src, float weight)
+{
+#ifdef MIP_GENERATOR_SSE
+    __m128 acc = _mm_loadu_ps(dst);
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src), _mm_set1_ps(weight)));
+    _mm_storeu_ps(dst, acc);
+#else
+    for (int c = 0; c < 4; c++)
+        dst[c] += src[c] * weight;
+#endif
+}
+
+float besselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 16; k++)
+    {
+        float half = x / (2.0f * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+float kaiser(float t)
+{
+    float x = t / KAISER_RADIUS;
+    if (std::fabs(x) >= 1.0f)
+        return 0.0f;
+
+    float sinc = t == 0.0f ? 1.0f : std::sin(PI * t) / (PI * t);
+    return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - x * x)) / besselI0(KAISER_ALPHA);
+}
+
+/**
+ * Normalized 1D filter taps for every destination texel.
+ */
+struct Taps {
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> count;
+    std::vector<uint32_t> indices;
+    std::vector<float> weights;
+};
+
+Taps buildKaiserTaps(uint32_t srcSize, uint32_t dstSize)
+{
+    Taps taps;
+    const float scale = static_cast<float>(srcSize) / dstSize;
+    const float support = KAISER_RADIUS * scale;
+
+    for (uint32_t i = 0; i < dstSize; i++)
+    {
+        const float center = (i + 0.5f) * scale;
+        const int begin = static_cast<int>(std::floor(center - support));
+        const int end = static_cast<int>(std::ceil(center + support));
+
+        taps.first.push_back(static_cast<uint32_t>(taps.weights.size()));
+        size_t start = taps.weights.size();
+        float total = 0.0f;
+
+        for (int j = begin; j <= end; j++)
+        {
+            float w = kaiser((j + 0.5f - center) / scale);
+            if (w == 0.0f)
+                continue;
+
+            int clamped = std::clamp(j, 0, static_cast<int>(srcSize) - 1);
+            taps.indices.push_back(static_cast<uint32_t>(clamped));
+            taps.weights.push_back(w);
+            total += w;
+        }
+
+        for (size_t k = start; k < taps.weights.size(); k++)
+            taps.weights[k] /= total;
+
+        taps.count.push_back(static_cast<uint32_t>(taps.weights.size() - start));
+    }
+
+    return taps;
+}
+
+Taps buildBoxTaps(uint32_t srcSize, uint32_t dstSize)
+{
+    Taps taps;
+    for (uint32_t i = 0; i < dstSize; i++)
+    {
+        taps.first.push_back(static_cast<uint32_t>(taps.weights.size()));
+        taps.indices.push_back(std::min(i * 2, srcSize - 1));
+        taps.indices.push_back(std::min(i * 2 + 1, srcSize - 1));
+        taps.weights.push_back(0.5f);
+        taps.weights.push_back(0.5f);
+        taps.count.push_back(2);
+    }
+    return taps;
+}
+
+/**
+ * One level of the chain, reduced from the rows of the previous one as they arrive.
+ *
+ * Source rows are filtered horizontally into a ring holding only the rows
+ * the vertical taps of the next pending destination row can still read.
+ */
+struct RowReducer {
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    Taps horizontal;
+    Taps vertical;
+    // last source row every destination row reads
+    std::vector<uint32_t> lastTap;
+
+    uint32_t capacity = 0;
+    std::vector<float> ring;
+    uint32_t received = 0;
+    uint32_t emitted = 0;
+    // destination row returned by next()
+    std::vector<float> row;
+
+    RowReducer(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, MipGenerator::Filter filter) :
+        dstWidth(dstWidth),
+        dstHeight(dstHeight)
+    {
+        const bool kaiser = filter == MipGenerator::Filter::Kaiser;
+        horizontal = kaiser ? buildKaiserTaps(srcWidth, dstWidth) : buildBoxTaps(srcWidth, dstWidth);
+        vertical = kaiser ? buildKaiserTaps(srcHeight, dstHeight) : buildBoxTaps(srcHeight, dstHeight);
+
+        // taps are sorted, so the first pending row bounds the rows kept
+        for (uint32_t y = 0; y < dstHeight; y++)
+        {
+            const uint32_t first = vertical.indices[vertical.first[y]];
+            const uint32_t last = vertical.indices[vertical.first[y] + vertical.count[y] - 1];
+            lastTap.push_back(last);
+            capacity = std::max(capacity, last - first + 1);
+        }
+
+        ring.resize(static_cast<size_t>(capacity) * dstWidth * 4);
+        row.resize(static_cast<size_t>(dstWidth) * 4);
+    }
+
+    void push(const float* src)
+    {
+        float* out = ring.data() + static_cast<size_t>(received % capacity) * dstWidth * 4;
+        std::fill(out, out + static_cast<size_t>(dstWidth) * 4, 0.0f);
+
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+            const uint32_t first = horizontal.first[x];
+            for (uint32_t k = 0; k < horizontal.count[x]; k++)
+                madd4(out + x * 4, src + horizontal.indices[first + k] * 4, horizontal.weights[first + k]);
+        }
+
+        received++;
+    }
+
+    // fills row with the next destination row once every source row it reads arrived
+    bool next()
+    {
+        if (emitted == dstHeight || lastTap[emitted] >= received)
+            return false;
+
+        std::fill(row.begin(), row.end(), 0.0f);
+
+        const uint32_t first = vertical.first[emitted];
+        for (uint32_t k = 0; k < vertical.count[emitted]; k++)
+        {
+            const float* src = ring.data() + static_cast<size_t>(vertical.indices[first + k] % capacity) * dstWidth * 4;
+            const float weight = vertical.weights[first + k];
+            for (uint32_t x = 0; x < dstWidth; x++)
+                madd4(row.data() + x * 4, src + x * 4, weight);
+        }
+
+        emitted++;
+        return true;
+    }
+};
+
+void encodeRow(
+    const float* src,
+    uint32_t width,
+    bool srgb,
+    uint8_t* dst
+) {
+    for (size_t i = 0; i < static_cast<size_t>(width) * 4; i += 4)
+    {
+        for (int c = 0; c < 3; c++)
+            dst[i + c] = srgb ? encodeSrgb(src[i + c]) : encodeLinear(src[i + c]);
+        dst[i + 3] = encodeLinear(src[i + 3]);
+    }
+}
+
+// hands a finished row of level `level` to the reducer of the next one, down the whole chain
+void feedRow(
+    std::vector<RowReducer>& reducers,
+    size_t level,
+    const float* row,
+    const TextureContainer& layout,
+    bool srgb,
+    uint8_t* dst
+) {
+    if (level >= reducers.size())
+        return;
+
+    RowReducer& reducer = reducers[level];
+    reducer.push(row);
+
+    const TextureContainer::Mip& mip = layout.mips[level + 1];
+    while (reducer.next())
+    {
+        uint8_t* encoded = dst + mip.offset + static_cast<size_t>(reducer.emitted - 1) * mip.width * 4;
+        encodeRow(reducer.row.data(), mip.width, srgb, encoded);
+        feedRow(reducers, level + 1, reducer.row.data(), layout, srgb, dst);
+    }
+}
+
+} // namespace
+
+TextureContainer MipGenerator::layout(
+    uint32_t width,
+    uint32_t height,
+    bool srgb
+) {
+    TextureContainer texture;
+    texture.format = srgb ? TextureFormat::RGBA8_SRGB : TextureFormat::RGBA8_UNORM;
+    texture.width = width;
+    texture.height = height;
+
+    const uint32_t mipCount = TextureContainer::fullMipCount(width, height);
+
+    uint64_t offset = 0;
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        TextureContainer::Mip mip;
+        mip.offset = offset;
+        mip.width = std::max(width >> level, 1u);
+        mip.height = std::max(height >> level, 1u);
+        mip.size = TextureContainer::mipSize(texture.format, mip.width, mip.height);
+        texture.mips.push_back(mip);
+
+        offset += mip.size;
+    }
+
+    return texture;
+}
+
+uint64_t MipGenerator::chainSize(
+    const TextureContainer& layout
+) {
+    return layout.mips.empty() ? 0 : layout.mips.back().offset + layout.mips.back().size;
+}
+
+TextureContainer MipGenerator::generate(
+    const uint8_t* rgba,
+    uint32_t width,
+    uint32_t height,
+    bool srgb,
+    Filter filter
+) {
+    TextureContainer texture = layout(width, height, srgb);
+    texture.data.resize(static_cast<size_t>(chainSize(texture)));
+    generateInto(rgba, texture, texture.data.data(), filter);
+    return texture;
+}
+
+void MipGenerator::generateInto(
+    const uint8_t* rgba,
+    const TextureContainer& layout,
+    uint8_t* dst,
+    Filter filter
+) {
+    const bool srgb = layout.format == TextureFormat::RGBA8_SRGB;
+    const uint32_t width = layout.width;
+    const uint32_t height = layout.height;
+
+    // level 0 may already be in place
+    if (rgba != dst)
+        std::memcpy(dst, rgba, static_cast<size_t>(layout.mips[0].size));
+
+    if (layout.mips.size() == 1)
+        return;
+
+    std::vector<RowReducer> reducers;
+    reducers.reserve(layout.mips.size() - 1);
+    for (size_t mip = 1; mip < layout.mips.size(); mip++)
+    {
+        reducers.emplace_back(
+            layout.mips[mip - 1].width,
+            layout.mips[mip - 1].height,
+            layout.mips[mip].width,
+            layout.mips[mip].height,
+            filter
+        );
+    }
+
+    // level 0 is decoded one row at a time, every level below is built as its rows complete
+    const SrgbTables& tables = srgbTables();
+    std::vector<float> row(static_cast<size_t>(width) * 4);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const uint8_t* src = rgba + static_cast<size_t>(y) * width * 4;
+        for (size_t i = 0; i < row.size(); i += 4)
+        {
+            for (int c = 0; c < 3; c++)
+                row[i + c] = srgb ? tables.decode[src[i + c]] : src[i + c] / 255.0f;
+            row[i + 3] = src[i + 3] / 255.0f;
+        }
+
+        feedRow(reducers, 0, row.data(), layout, srgb, dst);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureContainer.hpp"
+
+/**
+ * @brief Builds full RGBA8 mip chains on the CPU.
+ *
+ * Filtering happens in linear light: sRGB color channels are decoded
+ * before averaging and re-encoded afterwards, alpha is always linear.
+ * Every level is reduced from the previous one at float precision, so
+ * rounding does not accumulate down the chain. The chain is built row by
+ * row: each level only keeps the few rows its filter spans, so the
+ * temporary memory stays a small fraction of level 0 at any size.
+ *
+ * - Box: 2x2 average, SSE2 when available. Fast enough to run at load
+ *   time on the job system.
+ * - Kaiser: windowed-sinc, sharper distant mips. Used by the cooker.
+ */
+class MipGenerator
+{
+public:
+    enum class Filter {
+        Box,
+        Kaiser
+    };
+
+    /**
+     * @brief Generates every level down to 1x1.
+     *
+     * @param rgba Level 0, RGBA8 row-major.
+     * @param width Level 0 width.
+     * @param height Level 0 height.
+     * @param srgb Whether the color channels are sRGB encoded.
+     * @param filter Downsampling filter.
+     * @return RGBA8_SRGB or RGBA8_UNORM container with the whole chain.
+     */
+    static TextureContainer generate(
+        const uint8_t* rgba,
+        uint32_t width,
+        uint32_t height,
+        bool srgb,
+        Filter filter = Filter::Box
+    );
+
+    /**
+     * @brief Mip offsets and sizes of the chain generate would build, without data.
+     *
+     * Levels are tightly packed from offset 0, like TextureContainer::addMip.
+     */
+    static TextureContainer layout(
+        uint32_t width,
+        uint32_t height,
+        bool srgb
+    );
+
+    /// Bytes of the whole chain described by a layout
+    static uint64_t chainSize(
+        const TextureContainer& layout
+    );
+
+    /**
+     * @brief Generates the chain into caller memory, e.g. a mapped staging buffer.
+     *
+     * @param rgba Level 0, RGBA8 row-major. May be dst itself, then it is not copied.
+     * @param layout Result of layout(); its data is not touched.
+     * @param dst chainSize(layout) bytes. Never read back when rgba is
+     *            elsewhere: it may be uncached memory, but rgba should not be.
+     * @param filter Downsampling filter.
+     */
+    static void generateInto(
+        const uint8_t* rgba,
+        const TextureContainer& layout,
+        uint8_t* dst,
+        Filter filter = Filter::Box
+    );
+};
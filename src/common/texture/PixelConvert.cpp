@@ -0,0 +1,88 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "PixelConvert.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <tmmintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+    #define PIXEL_CONVERT_SSSE3 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PIXEL_CONVERT_NEON 1
+#endif
+
+namespace {
+
+#ifdef PIXEL_CONVERT_SSSE3
+
+// SSSE3 is not part of the x86-64 baseline, so it is picked at runtime
+bool hasSsse3()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("ssse3")))
+#endif
+size_t rgbToRgbaSsse3(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount)
+{
+    // 4 pixels per 16 byte load, the shuffle zeroes the alpha lanes
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    // each load reads 4 bytes past its pixels, keep it inside the source
+    size_t i = 0;
+    for (; i + 6 <= pixelCount; i += 4)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+        __m128i out = _mm_or_si128(_mm_shuffle_epi8(in, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), out);
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void PixelConvert::rgbToRgba(
+    const uint8_t* rgb,
+    uint8_t* rgba,
+    size_t pixelCount
+) {
+    size_t i = 0;
+
+#if defined(PIXEL_CONVERT_SSSE3)
+    static const bool ssse3 = hasSsse3();
+    if (ssse3)
+        i = rgbToRgbaSsse3(rgb, rgba, pixelCount);
+#elif defined(PIXEL_CONVERT_NEON)
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        uint8x16x3_t in = vld3q_u8(rgb + i * 3);
+        uint8x16x4_t out;
+        out.val[0] = in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = in.val[2];
+        out.val[3] = vdupq_n_u8(0xFF);
+        vst4q_u8(rgba + i * 4, out);
+    }
+#endif
+
+    for (; i < pixelCount; i++)
+    {
+        std::memcpy(rgba + i * 4, rgb + i * 3, 3);
+        rgba[i * 4 + 3] = 0xFF;
+    }
+}
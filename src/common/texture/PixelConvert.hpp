@@ -0,0 +1,30 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Channel layout conversions for decoded images.
+ *
+ * Vectorized with SSSE3, picked at runtime on x86, or NEON on ARM; a
+ * scalar loop handles the remainder and other targets.
+ */
+class PixelConvert
+{
+public:
+    /**
+     * @brief Expands packed RGB8 to RGBA8 with opaque alpha.
+     *
+     * @param rgb pixelCount * 3 source bytes.
+     * @param rgba pixelCount * 4 destination bytes, must not overlap rgb.
+     * @param pixelCount Number of pixels.
+     */
+    static void rgbToRgba(
+        const uint8_t* rgb,
+        uint8_t* rgba,
+        size_t pixelCount
+    );
+};
@@ -0,0 +1,95 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+TextureAtlas::Grid TextureAtlas::gridFor(
+    uint32_t tileCount
+) {
+    Grid grid;
+    grid.columns = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(tileCount)))));
+    grid.rows = std::max(1u, (tileCount + grid.columns - 1) / grid.columns);
+    return grid;
+}
+
+TextureAtlas::Region TextureAtlas::region(
+    uint32_t tileCount,
+    uint32_t tileSize,
+    uint32_t index
+) {
+    const Grid grid = gridFor(tileCount);
+    const float width = static_cast<float>(grid.columns * tileSize);
+    const float height = static_cast<float>(grid.rows * tileSize);
+
+    Region region;
+    region.scaleX = (tileSize - 1.0f) / width;
+    region.scaleY = (tileSize - 1.0f) / height;
+    region.offsetX = ((index % grid.columns) * tileSize + 0.5f) / width;
+    region.offsetY = ((index / grid.columns) * tileSize + 0.5f) / height;
+    return region;
+}
+
+TextureContainer TextureAtlas::build(
+    const std::vector<const uint8_t*>& tiles,
+    uint32_t tileSize,
+    bool srgb,
+    MipGenerator::Filter filter
+) {
+    if (tiles.empty())
+        throw std::runtime_error("texture atlas has no tiles");
+
+    if (tileSize == 0 || (tileSize & (tileSize - 1)) != 0)
+        throw std::runtime_error("texture atlas tiles must be a power of two");
+
+    const Grid grid = gridFor(static_cast<uint32_t>(tiles.size()));
+    const uint32_t mipCount = TextureContainer::fullMipCount(tileSize, tileSize);
+
+    // one RGBA8 buffer per level, cells without a tile stay transparent
+    std::vector<std::vector<uint8_t>> levels(mipCount);
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        const uint32_t cell = tileSize >> level;
+        levels[level].assign(static_cast<size_t>(grid.columns) * cell * grid.rows * cell * 4, 0);
+    }
+
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        const TextureContainer chain = MipGenerator::generate(tiles[i], tileSize, tileSize, srgb, filter);
+        const uint32_t column = static_cast<uint32_t>(i) % grid.columns;
+        const uint32_t row = static_cast<uint32_t>(i) / grid.columns;
+
+        for (uint32_t level = 0; level < mipCount; level++)
+        {
+            const TextureContainer::Mip& mip = chain.mips[level];
+            const uint32_t cell = tileSize >> level;
+            const size_t atlasRowBytes = static_cast<size_t>(grid.columns) * cell * 4;
+            const size_t cellRowBytes = static_cast<size_t>(cell) * 4;
+
+            uint8_t* dst = levels[level].data()
+                + static_cast<size_t>(row) * cell * atlasRowBytes
+                + static_cast<size_t>(column) * cellRowBytes;
+            const uint8_t* src = chain.data.data() + mip.offset;
+
+            for (uint32_t y = 0; y < cell; y++)
+                std::memcpy(dst + y * atlasRowBytes, src + y * cellRowBytes, cellRowBytes);
+        }
+    }
+
+    TextureContainer atlas;
+    atlas.format = srgb ? TextureFormat::RGBA8_SRGB : TextureFormat::RGBA8_UNORM;
+    atlas.width = grid.columns * tileSize;
+    atlas.height = grid.rows * tileSize;
+
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        const uint32_t cell = tileSize >> level;
+        atlas.addMip(grid.columns * cell, grid.rows * cell, levels[level].data(), levels[level].size());
+    }
+
+    return atlas;
+}
@@ -0,0 +1,76 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MipGenerator.hpp"
+#include "TextureContainer.hpp"
+
+/**
+ * @brief Packs same-size square tiles into one RGBA8 texture.
+ *
+ * Tiles are laid out row-major on a grid of columns x rows cells. Each
+ * tile gets its own mip chain before packing, so downsampling never
+ * mixes neighbouring tiles; the chain stops when a tile is 1x1.
+ *
+ * The layout depends only on the tile count and size, so the UV region
+ * of a tile is known before any pixel is loaded. Regions are inset by
+ * half a texel so bilinear filtering stays inside the tile at level 0.
+ * UVs are expected in [0, 1]: an atlas cannot repeat a single tile.
+ */
+class TextureAtlas
+{
+public:
+    /**
+     * @brief Maps mesh UVs into a tile: uv * scale + offset.
+     */
+    struct Region {
+        float scaleX = 1.0f;
+        float scaleY = 1.0f;
+        float offsetX = 0.0f;
+        float offsetY = 0.0f;
+    };
+
+    struct Grid {
+        uint32_t columns;
+        uint32_t rows;
+    };
+
+    /// Near-square grid holding tileCount cells
+    static Grid gridFor(
+        uint32_t tileCount
+    );
+
+    /**
+     * @brief UV region of one tile.
+     *
+     * @param tileCount Number of tiles in the atlas.
+     * @param tileSize Tile width and height in texels.
+     * @param index Tile index, in the order given to build.
+     */
+    static Region region(
+        uint32_t tileCount,
+        uint32_t tileSize,
+        uint32_t index
+    );
+
+    /**
+     * @brief Builds the atlas and its mip chain.
+     *
+     * @param tiles RGBA8 row-major tiles, all tileSize x tileSize.
+     * @param tileSize Power of two tile width and height.
+     * @param srgb Whether the color channels are sRGB encoded.
+     * @param filter Downsampling filter of the per-tile mips.
+     *
+     * @throws std::runtime_error if there are no tiles or tileSize is not a power of two.
+     */
+    static TextureContainer build(
+        const std::vector<const uint8_t*>& tiles,
+        uint32_t tileSize,
+        bool srgb,
+        MipGenerator::Filter filter = MipGenerator::Filter::Box
+    );
+};
@@ -0,0 +1,551 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include "TextureContainer.hpp"
+#include "../io/MappedFile.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const uint8_t KTX2_IDENTIFIER[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+// identifier + 9 header fields + index (4 x u32, 2 x u64)
+constexpr size_t KTX2_HEADER_SIZE = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+constexpr size_t KTX2_LEVEL_SIZE = 3 * 8;
+
+constexpr size_t DDS_HEADER_SIZE = 4 + 124;
+constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+constexpr uint32_t DDS_PIXELFORMAT_FOURCC = 0x4;
+constexpr uint32_t DDS_HEADER_MIPMAPCOUNT = 0x20000;
+
+// Khronos data format descriptor constants
+constexpr uint8_t KHR_DF_MODEL_RGBSDA = 1;
+constexpr uint8_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint8_t KHR_DF_MODEL_BC3 = 130;
+constexpr uint8_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+constexpr uint8_t KHR_DF_TRANSFER_SRGB = 2;
+constexpr uint8_t KHR_DF_CHANNEL_ALPHA = 15;
+constexpr uint8_t KHR_DF_CHANNEL_BC1A_ALPHAPRESENT = 1;
+constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+uint32_t fourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) |
+        (static_cast<uint32_t>(b) << 8) |
+        (static_cast<uint32_t>(c) << 16) |
+        (static_cast<uint32_t>(d) << 24);
+}
+
+uint32_t readU32(const MappedFile& bytes, size_t offset)
+{
+    if (offset + 4 > bytes.size())
+        throw std::runtime_error("texture file is truncated");
+
+    return static_cast<uint32_t>(bytes[offset]) |
+        (static_cast<uint32_t>(bytes[offset + 1]) << 8) |
+        (static_cast<uint32_t>(bytes[offset + 2]) << 16) |
+        (static_cast<uint32_t>(bytes[offset + 3]) << 24);
+}
+
+uint64_t readU64(const MappedFile& bytes, size_t offset)
+{
+    return static_cast<uint64_t>(readU32(bytes, offset)) |
+        (static_cast<uint64_t>(readU32(bytes, offset + 4)) << 32);
+}
+
+void writeU8(std::vector<uint8_t>& out, uint8_t value)
+{
+    out.push_back(value);
+}
+
+void writeU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void writeU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void writeU64(std::vector<uint8_t>& out, uint64_t value)
+{
+    writeU32(out, static_cast<uint32_t>(value));
+    writeU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+void patchU32(std::vector<uint8_t>& out, size_t offset, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void patchU64(std::vector<uint8_t>& out, size_t offset, uint64_t value)
+{
+    patchU32(out, offset, static_cast<uint32_t>(value));
+    patchU32(out, offset + 4, static_cast<uint32_t>(value >> 32));
+}
+
+TextureFormat formatFromVk(uint32_t vkFormat)
+{
+    switch (static_cast<TextureFormat>(vkFormat))
+    {
+        case TextureFormat::RGBA8_UNORM:
+        case TextureFormat::RGBA8_SRGB:
+        case TextureFormat::BC1_RGBA_UNORM:
+        case TextureFormat::BC1_RGBA_SRGB:
+        case TextureFormat::BC3_UNORM:
+        case TextureFormat::BC3_SRGB:
+        case TextureFormat::BC7_UNORM:
+        case TextureFormat::BC7_SRGB:
+            return static_cast<TextureFormat>(vkFormat);
+        default:
+            return TextureFormat::Undefined;
+    }
+}
+
+TextureFormat formatFromDxgi(uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+        case 28: return TextureFormat::RGBA8_UNORM;
+        case 29: return TextureFormat::RGBA8_SRGB;
+        case 71: return TextureFormat::BC1_RGBA_UNORM;
+        case 72: return TextureFormat::BC1_RGBA_SRGB;
+        case 77: return TextureFormat::BC3_UNORM;
+        case 78: return TextureFormat::BC3_SRGB;
+        case 98: return TextureFormat::BC7_UNORM;
+        case 99: return TextureFormat::BC7_SRGB;
+        default: return TextureFormat::Undefined;
+    }
+}
+
+/**
+ * Basic data format descriptor block, required by the KTX2 spec.
+ */
+std::vector<uint8_t> buildDataFormatDescriptor(TextureFormat format)
+{
+    struct Sample {
+        uint16_t bitOffset;
+        uint8_t bitLength;
+        uint8_t channel;
+        uint32_t upper;
+    };
+
+    const bool srgb = TextureContainer::isSrgb(format);
+    const bool compressed = TextureContainer::isBlockCompressed(format);
+
+    uint8_t model = KHR_DF_MODEL_RGBSDA;
+    std::vector<Sample> samples;
+
+    switch (format)
+    {
+        case TextureFormat::BC1_RGBA_UNORM:
+        case TextureFormat::BC1_RGBA_SRGB:
+            model = KHR_DF_MODEL_BC1A;
+            samples = { {0, 64, KHR_DF_CHANNEL_BC1A_ALPHAPRESENT, 0xFFFFFFFFu} };
+            break;
+        case TextureFormat::BC3_UNORM:
+        case TextureFormat::BC3_SRGB:
+            model = KHR_DF_MODEL_BC3;
+            samples = {
+                {0, 64, KHR_DF_CHANNEL_ALPHA, 0xFFFFFFFFu},
+                {64, 64, 0, 0xFFFFFFFFu}
+            };
+            break;
+        case TextureFormat::BC7_UNORM:
+        case TextureFormat::BC7_SRGB:
+            model = KHR_DF_MODEL_BC7;
+            samples = { {0, 128, 0, 0xFFFFFFFFu} };
+            break;
+        default:
+            samples = {
+                {0, 8, 0, 255},
+                {8, 8, 1, 255},
+                {16, 8, 2, 255},
+                {24, 8, KHR_DF_CHANNEL_ALPHA, 255}
+            };
+            break;
+    }
+
+    const uint16_t blockBytes = static_cast<uint16_t>(24 + 16 * samples.size());
+
+    std::vector<uint8_t> dfd;
+    writeU32(dfd, 4u + blockBytes);
+
+    writeU32(dfd, 0);                                   // vendor 0 (Khronos), type 0 (basic)
+    writeU16(dfd, 2);                                   // version 1.3
+    writeU16(dfd, blockBytes);
+    writeU8(dfd, model);
+    writeU8(dfd, KHR_DF_PRIMARIES_BT709);
+    writeU8(dfd, srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR);
+    writeU8(dfd, 0);                                    // straight alpha
+    writeU8(dfd, compressed ? 3 : 0);                   // texel block dimensions - 1
+    writeU8(dfd, compressed ? 3 : 0);
+    writeU8(dfd, 0);
+    writeU8(dfd, 0);
+    writeU8(dfd, static_cast<uint8_t>(TextureContainer::blockSize(format)));
+    for (int i = 0; i < 7; i++)
+        writeU8(dfd, 0);
+
+    for (const Sample& s : samples)
+    {
+        // sRGB transfer does not apply to alpha
+        uint8_t qualifiers = (srgb && s.channel == KHR_DF_CHANNEL_ALPHA) ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0;
+
+        writeU16(dfd, s.bitOffset);
+        writeU8(dfd, static_cast<uint8_t>(s.bitLength - 1));
+        writeU8(dfd, static_cast<uint8_t>(s.channel | qualifiers));
+        writeU32(dfd, 0);                               // sample position
+        writeU32(dfd, 0);                               // lower
+        writeU32(dfd, s.upper);
+    }
+
+    return dfd;
+}
+
+} // namespace
+
+bool TextureContainer::isBlockCompressed(
+    TextureFormat format
+) {
+    switch (format)
+    {
+        case TextureFormat::BC1_RGBA_UNORM:
+        case TextureFormat::BC1_RGBA_SRGB:
+        case TextureFormat::BC3_UNORM:
+        case TextureFormat::BC3_SRGB:
+        case TextureFormat::BC7_UNORM:
+        case TextureFormat::BC7_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool TextureContainer::isSrgb(
+    TextureFormat format
+) {
+    switch (format)
+    {
+        case TextureFormat::RGBA8_SRGB:
+        case TextureFormat::BC1_RGBA_SRGB:
+        case TextureFormat::BC3_SRGB:
+        case TextureFormat::BC7_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t TextureContainer::blockSize(
+    TextureFormat format
+) {
+    switch (format)
+    {
+        case TextureFormat::BC1_RGBA_UNORM:
+        case TextureFormat::BC1_RGBA_SRGB:
+            return 8;
+        case TextureFormat::BC3_UNORM:
+        case TextureFormat::BC3_SRGB:
+        case TextureFormat::BC7_UNORM:
+        case TextureFormat::BC7_SRGB:
+            return 16;
+        case TextureFormat::RGBA8_UNORM:
+        case TextureFormat::RGBA8_SRGB:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+uint64_t TextureContainer::mipSize(
+    TextureFormat format,
+    uint32_t width,
+    uint32_t height
+) {
+    if (isBlockCompressed(format))
+    {
+        uint64_t blocksX = (width + 3) / 4;
+        uint64_t blocksY = (height + 3) / 4;
+        return blocksX * blocksY * blockSize(format);
+    }
+
+    return static_cast<uint64_t>(width) * height * blockSize(format);
+}
+
+uint32_t TextureContainer::fullMipCount(
+    uint32_t width,
+    uint32_t height
+) {
+    uint32_t levels = 1;
+    uint32_t size = std::max(width, height);
+    while (size > 1)
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+void TextureContainer::addMip(
+    uint32_t width,
+    uint32_t height,
+    const uint8_t* bytes,
+    uint64_t size
+) {
+    Mip mip;
+    mip.offset = data.size();
+    mip.size = size;
+    mip.width = width;
+    mip.height = height;
+    mips.push_back(mip);
+
+    data.insert(data.end(), bytes, bytes + size);
+}
+
+void TextureContainer::skipMip(
+    uint32_t width,
+    uint32_t height,
+    uint64_t size
+) {
+    Mip mip;
+    mip.offset = data.size();
+    mip.size = size;
+    mip.width = width;
+    mip.height = height;
+    mips.push_back(mip);
+}
+
+TextureContainer TextureContainer::load(
+    const std::string& path,
+    uint32_t firstLevel,
+    uint32_t endLevel
+) {
+    auto endsWith = [&](const char* ext) {
+        size_t n = std::strlen(ext);
+        if (path.size() < n)
+            return false;
+        for (size_t i = 0; i < n; i++)
+        {
+            char c = path[path.size() - n + i];
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c - 'A' + 'a');
+            if (c != ext[i])
+                return false;
+        }
+        return true;
+    };
+
+    if (endsWith(".ktx2"))
+        return loadKtx2(path, firstLevel, endLevel);
+    if (endsWith(".dds"))
+        return loadDds(path, firstLevel, endLevel);
+
+    throw std::runtime_error("unknown texture container " + path);
+}
+
+TextureContainer TextureContainer::loadKtx2(
+    const std::string& path,
+    uint32_t firstLevel,
+    uint32_t endLevel
+) {
+    const MappedFile bytes(path);
+
+    if (bytes.size() < KTX2_HEADER_SIZE || std::memcmp(bytes.data(), KTX2_IDENTIFIER, 12) != 0)
+        throw std::runtime_error("not a KTX2 file " + path);
+
+    const uint32_t vkFormat = readU32(bytes, 12);
+    const uint32_t pixelWidth = readU32(bytes, 20);
+    const uint32_t pixelHeight = readU32(bytes, 24);
+    const uint32_t pixelDepth = readU32(bytes, 28);
+    const uint32_t layerCount = readU32(bytes, 32);
+    const uint32_t faceCount = readU32(bytes, 36);
+    const uint32_t levelCount = std::max(readU32(bytes, 40), 1u);
+    const uint32_t supercompression = readU32(bytes, 44);
+
+    TextureContainer texture;
+    texture.format = formatFromVk(vkFormat);
+    texture.width = pixelWidth;
+    texture.height = pixelHeight;
+
+    if (texture.format == TextureFormat::Undefined)
+        throw std::runtime_error("unsupported KTX2 format in " + path);
+    if (supercompression != 0)
+        throw std::runtime_error("supercompressed KTX2 is not supported: " + path);
+    if (pixelWidth == 0 || pixelHeight == 0 || pixelDepth > 1 || layerCount > 1 || faceCount != 1)
+        throw std::runtime_error("only single 2D KTX2 textures are supported: " + path);
+
+    if (KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE > bytes.size())
+        throw std::runtime_error("KTX2 level index is truncated: " + path);
+
+    uint64_t total = 0;
+    for (uint32_t level = firstLevel; level < std::min(levelCount, endLevel); level++)
+        total += readU64(bytes, KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE + 8);
+    texture.data.reserve(static_cast<size_t>(total));
+
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        const uint64_t offset = readU64(bytes, entry);
+        const uint64_t length = readU64(bytes, entry + 8);
+
+        const uint32_t w = std::max(pixelWidth >> level, 1u);
+        const uint32_t h = std::max(pixelHeight >> level, 1u);
+
+        if (length != mipSize(texture.format, w, h) || offset + length > bytes.size())
+            throw std::runtime_error("invalid KTX2 level data in " + path);
+
+        if (level >= firstLevel && level < endLevel)
+            texture.addMip(w, h, bytes.data() + offset, length);
+        else
+            texture.skipMip(w, h, length);
+    }
+
+    return texture;
+}
+
+TextureContainer TextureContainer::loadDds(
+    const std::string& path,
+    uint32_t firstLevel,
+    uint32_t endLevel
+) {
+    const MappedFile bytes(path);
+
+    if (bytes.size() < DDS_HEADER_SIZE || readU32(bytes, 0) != fourCC('D', 'D', 'S', ' '))
+        throw std::runtime_error("not a DDS file " + path);
+
+    TextureContainer texture;
+    texture.height = readU32(bytes, 12);
+    texture.width = readU32(bytes, 16);
+    const uint32_t flags = readU32(bytes, 8);
+    const uint32_t pixelFlags = readU32(bytes, 80);
+    const uint32_t pixelFourCC = readU32(bytes, 84);
+
+    size_t dataOffset = DDS_HEADER_SIZE;
+
+    if (!(pixelFlags & DDS_PIXELFORMAT_FOURCC))
+        throw std::runtime_error("uncompressed legacy DDS is not supported: " + path);
+
+    if (pixelFourCC == fourCC('D', 'X', '1', '0'))
+    {
+        if (bytes.size() < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+            throw std::runtime_error("DDS DX10 header is truncated: " + path);
+
+        const uint32_t dimension = readU32(bytes, DDS_HEADER_SIZE + 4);
+        const uint32_t arraySize = readU32(bytes, DDS_HEADER_SIZE + 12);
+        if (dimension != 3 || arraySize > 1) // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+            throw std::runtime_error("only single 2D DDS textures are supported: " + path);
+
+        texture.format = formatFromDxgi(readU32(bytes, DDS_HEADER_SIZE));
+        dataOffset += DDS_DX10_HEADER_SIZE;
+    }
+    else if (pixelFourCC == fourCC('D', 'X', 'T', '1'))
+    {
+        // legacy headers carry no color space, albedo maps are sRGB
+        texture.format = TextureFormat::BC1_RGBA_SRGB;
+    }
+    else if (pixelFourCC == fourCC('D', 'X', 'T', '5'))
+    {
+        texture.format = TextureFormat::BC3_SRGB;
+    }
+
+    if (texture.format == TextureFormat::Undefined)
+        throw std::runtime_error("unsupported DDS format in " + path);
+    if (texture.width == 0 || texture.height == 0)
+        throw std::runtime_error("invalid DDS size in " + path);
+
+    // the count field is only meaningful with its flag set
+    uint32_t mipCount = 1;
+    if (flags & DDS_HEADER_MIPMAPCOUNT)
+        mipCount = std::min(std::max(readU32(bytes, 28), 1u), fullMipCount(texture.width, texture.height));
+
+    uint64_t offset = dataOffset;
+    for (uint32_t level = 0; level < mipCount; level++)
+    {
+        const uint32_t w = std::max(texture.width >> level, 1u);
+        const uint32_t h = std::max(texture.height >> level, 1u);
+        const uint64_t length = mipSize(texture.format, w, h);
+
+        if (offset + length > bytes.size())
+            throw std::runtime_error("DDS level data is truncated: " + path);
+
+        if (level >= firstLevel && level < endLevel)
+            texture.addMip(w, h, bytes.data() + offset, length);
+        else
+            texture.skipMip(w, h, length);
+        offset += length;
+    }
+
+    return texture;
+}
+
+void TextureContainer::saveKtx2(
+    const std::string& path
+) const {
+    if (mips.empty())
+        throw std::runtime_error("cannot save a texture without mips: " + path);
+
+    const uint32_t levelCount = static_cast<uint32_t>(mips.size());
+    const std::vector<uint8_t> dfd = buildDataFormatDescriptor(format);
+
+    std::vector<uint8_t> out;
+    out.reserve(KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE + dfd.size() + data.size() + 16 * levelCount);
+
+    out.insert(out.end(), KTX2_IDENTIFIER, KTX2_IDENTIFIER + 12);
+    writeU32(out, static_cast<uint32_t>(format));
+    writeU32(out, 1);                                   // typeSize
+    writeU32(out, width);
+    writeU32(out, height);
+    writeU32(out, 0);                                   // pixelDepth
+    writeU32(out, 0);                                   // layerCount
+    writeU32(out, 1);                                   // faceCount
+    writeU32(out, levelCount);
+    writeU32(out, 0);                                   // supercompressionScheme
+
+    const size_t dfdOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_SIZE;
+    writeU32(out, static_cast<uint32_t>(dfdOffset));
+    writeU32(out, static_cast<uint32_t>(dfd.size()));
+    writeU32(out, 0);                                   // kvd offset / length
+    writeU32(out, 0);
+    writeU64(out, 0);                                   // sgd offset / length
+    writeU64(out, 0);
+
+    const size_t levelIndex = out.size();
+    out.resize(out.size() + levelCount * KTX2_LEVEL_SIZE, 0);
+    out.insert(out.end(), dfd.begin(), dfd.end());
+
+    // levels are stored smallest first, each aligned to lcm(block size, 4)
+    const size_t alignment = std::max<size_t>(blockSize(format), 4);
+    for (uint32_t level = levelCount; level-- > 0;)
+    {
+        out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+
+        const Mip& mip = mips[level];
+        const size_t entry = levelIndex + level * KTX2_LEVEL_SIZE;
+        patchU64(out, entry, out.size());
+        patchU64(out, entry + 8, mip.size);
+        patchU64(out, entry + 16, mip.size);
+
+        out.insert(out.end(), data.begin() + mip.offset, data.begin() + mip.offset + mip.size);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("failed to create texture file " + path);
+
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+
+    if (!file)
+        throw std::runtime_error("failed to write texture file " + path);
+}
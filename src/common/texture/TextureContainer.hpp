@@ -0,0 +1,141 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Pixel formats a texture container may hold.
+ *
+ * Values match VkFormat so the client can cast them directly, while the
+ * common library and the cooker stay free of Vulkan headers.
+ */
+enum class TextureFormat : uint32_t {
+    Undefined = 0,
+    RGBA8_UNORM = 37,
+    RGBA8_SRGB = 43,
+    BC1_RGBA_UNORM = 133,
+    BC1_RGBA_SRGB = 134,
+    BC3_UNORM = 137,
+    BC3_SRGB = 138,
+    BC7_UNORM = 145,
+    BC7_SRGB = 146,
+};
+
+/**
+ * @brief A 2D texture with its full mip chain, as stored on disk.
+ *
+ * Block-compressed data is kept as is, so it can be copied to the GPU
+ * without any CPU decoding. Mips are ordered from the largest (level 0)
+ * to the smallest and all live in a single tightly packed buffer.
+ *
+ * Supported containers:
+ * - KTX2 (read and write), without supercompression
+ * - DDS (read), legacy DXT1/DXT5 FourCC and DX10 headers
+ *
+ * Only single-layer, single-face 2D textures are accepted.
+ */
+class TextureContainer
+{
+public:
+    struct Mip {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    TextureFormat format = TextureFormat::Undefined;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<Mip> mips;
+    std::vector<uint8_t> data;
+
+    /// True for the 4x4 block-compressed formats
+    static bool isBlockCompressed(
+        TextureFormat format
+    );
+
+    static bool isSrgb(
+        TextureFormat format
+    );
+
+    /// Bytes per 4x4 block, or per texel for uncompressed formats
+    static uint32_t blockSize(
+        TextureFormat format
+    );
+
+    /// Bytes taken by one mip level of the given size
+    static uint64_t mipSize(
+        TextureFormat format,
+        uint32_t width,
+        uint32_t height
+    );
+
+    /// Number of levels of a full chain down to 1x1
+    static uint32_t fullMipCount(
+        uint32_t width,
+        uint32_t height
+    );
+
+    /**
+     * @brief Loads a .ktx2 or .dds file, picked by extension.
+     *
+     * Only the bytes of levels firstLevel up to endLevel are read, packed
+     * from data byte 0. Every level keeps its entry in mips, so streamed
+     * textures can read their missing levels alone; the others have no
+     * bytes in data.
+     *
+     * @throws std::runtime_error on IO errors and unsupported content.
+     */
+    static TextureContainer load(
+        const std::string& path,
+        uint32_t firstLevel = 0,
+        uint32_t endLevel = UINT32_MAX
+    );
+
+    static TextureContainer loadKtx2(
+        const std::string& path,
+        uint32_t firstLevel = 0,
+        uint32_t endLevel = UINT32_MAX
+    );
+
+    static TextureContainer loadDds(
+        const std::string& path,
+        uint32_t firstLevel = 0,
+        uint32_t endLevel = UINT32_MAX
+    );
+
+    /**
+     * @brief Writes the texture as KTX2, with a basic data format descriptor.
+     *
+     * @throws std::runtime_error on IO errors.
+     */
+    void saveKtx2(
+        const std::string& path
+    ) const;
+
+    /**
+     * @brief Appends a mip level, packing it after the previous ones.
+     */
+    void addMip(
+        uint32_t width,
+        uint32_t height,
+        const uint8_t* bytes,
+        uint64_t size
+    );
+
+    /**
+     * @brief Adds the entry of a level whose bytes are not loaded.
+     */
+    void skipMip(
+        uint32_t width,
+        uint32_t height,
+        uint64_t size
+    );
+
+    uint64_t totalSize() const { return data.size(); }
+};
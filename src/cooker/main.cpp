@@ -0,0 +1,168 @@
+// Copyright © 2026 SrPatsu21
+// Licensed under the Apache License, Version 2.0
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "stb_image.h"
+#include "texture/BlockCompressor.hpp"
+#include "texture/MipGenerator.hpp"
+#include "texture/TextureContainer.hpp"
+
+namespace fs = std::filesystem;
+
+/**
+ * Asset cooker: converts source images to block-compressed KTX2.
+ *
+ * Usage: cooker [--linear] [--rgba] [--box] [--force] <image or directory>...
+ *
+ * Each image is written next to its source with the .ktx2 extension,
+ * where ResourceManager looks for it first. Opaque images become BC1,
+ * images with alpha become BC3, or RGBA8 with --rgba. The full mip chain
+ * is precomputed in linear light with a Kaiser filter (--box for a 2x2
+ * average), so loading is a single copy with no GPU mip generation.
+ * Directories are walked recursively and sources older than their
+ * cooked file are skipped unless --force.
+ */
+
+struct CookOptions {
+    bool linear = false;
+    bool rgba = false;
+    bool box = false;
+    bool force = false;
+};
+
+static bool isSourceImage(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+static void cookImage(
+    const fs::path& source,
+    const CookOptions& options
+) {
+    fs::path target = source;
+    target.replace_extension(".ktx2");
+
+    if (!options.force && fs::exists(target) && fs::last_write_time(target) >= fs::last_write_time(source))
+        return;
+
+    int width;
+    int height;
+    int channels;
+    stbi_uc* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+        throw std::runtime_error("failed to load " + source.string() + ": " + stbi_failure_reason());
+
+    TextureContainer mips = MipGenerator::generate(
+        pixels,
+        static_cast<uint32_t>(width),
+        static_cast<uint32_t>(height),
+        !options.linear,
+        options.box ? MipGenerator::Filter::Box : MipGenerator::Filter::Kaiser
+    );
+    stbi_image_free(pixels);
+
+    const bool opaque = BlockCompressor::isOpaque(mips.data.data(), mips.width, mips.height);
+    const char* formatName = "RGBA8";
+
+    TextureContainer texture;
+    if (options.rgba)
+    {
+        texture = std::move(mips);
+    }
+    else
+    {
+        if (opaque)
+        {
+            texture.format = options.linear ? TextureFormat::BC1_RGBA_UNORM : TextureFormat::BC1_RGBA_SRGB;
+            formatName = "BC1";
+        }
+        else
+        {
+            texture.format = options.linear ? TextureFormat::BC3_UNORM : TextureFormat::BC3_SRGB;
+            formatName = "BC3";
+        }
+        texture.width = mips.width;
+        texture.height = mips.height;
+
+        for (const TextureContainer::Mip& mip : mips.mips)
+        {
+            std::vector<uint8_t> blocks = BlockCompressor::compress(
+                mips.data.data() + mip.offset,
+                mip.width,
+                mip.height,
+                texture.format
+            );
+            texture.addMip(mip.width, mip.height, blocks.data(), blocks.size());
+        }
+    }
+
+    texture.saveKtx2(target.string());
+
+    std::cout << source.string() << " -> " << target.filename().string()
+        << " (" << formatName << ", " << texture.mips.size() << " mips, "
+        << texture.totalSize() / 1024 << " KiB)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    CookOptions options;
+    std::vector<fs::path> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--linear")
+            options.linear = true;
+        else if (arg == "--rgba")
+            options.rgba = true;
+        else if (arg == "--box")
+            options.box = true;
+        else if (arg == "--force")
+            options.force = true;
+        else
+            inputs.emplace_back(arg);
+    }
+
+    if (inputs.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--linear] [--rgba] [--box] [--force] <image or directory>..." << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (const fs::path& input : inputs)
+    {
+        std::vector<fs::path> sources;
+        if (fs::is_directory(input))
+        {
+            for (const auto& entry : fs::recursive_directory_iterator(input))
+                if (entry.is_regular_file() && isSourceImage(entry.path()))
+                    sources.push_back(entry.path());
+        }
+        else
+        {
+            sources.push_back(input);
+        }
+
+        for (const fs::path& source : sources)
+        {
+            try {
+                cookImage(source, options);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                failures++;
+            }
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}